@@ -81,47 +81,18 @@ extern int verbose;
 
 /* readNvBufferMax() determines the maximum NV read/write block size.  The limit is typically set by
    the TPM property TPM_PT_NV_BUFFER_MAX.  However, it's possible that a value could be larger than
-   the TSS side structure MAX_NV_BUFFER_SIZE.
+   the TSS side structure MAX_NV_BUFFER_SIZE.  The TSS reads the property once per context.
 */
 
 TPM_RC readNvBufferMax(TSS_CONTEXT *tssContext,
 		       uint32_t *nvBufferMax)
 {
     TPM_RC			rc = 0;
-    GetCapability_In 		in;
-    GetCapability_Out		out;
 
-    in.capability = TPM_CAP_TPM_PROPERTIES;
-    in.property = TPM_PT_NV_BUFFER_MAX;
-    in.propertyCount = 1;	/* ask for one property */
     if (rc == 0) {
-	rc = TSS_Execute(tssContext,
-			 (RESPONSE_PARAMETERS *)&out, 
-			 (COMMAND_PARAMETERS *)&in,
-			 NULL,
-			 TPM_CC_GetCapability,
-			 TPM_RH_NULL, NULL, 0);
+	rc = TSS_NV_GetBufferMax(tssContext, nvBufferMax);
     }
-    /* sanity check that the property name is correct (demo of how to parse the structure) */
     if (rc == 0) {
-	if ((out.capabilityData.data.tpmProperties.count > 0) &&
-	    (out.capabilityData.data.tpmProperties.tpmProperty[0].property ==
-	     TPM_PT_NV_BUFFER_MAX)) {
-	    *nvBufferMax = out.capabilityData.data.tpmProperties.tpmProperty[0].value;
-	}
-	else {
-	    if (verbose) printf("readNvBufferMax: wrong property returned: %08x\n",
-		   out.capabilityData.data.tpmProperties.tpmProperty[0].property);
-	    /* hard code a value for a back level HW TPM that does not implement
-	       TPM_PT_NV_BUFFER_MAX yet */
-	    *nvBufferMax = 512;
-	}
-	if (verbose) printf("readNvBufferMax: TPM max read/write: %u\n", *nvBufferMax);
-	/* in addition, the maximum TSS side structure MAX_NV_BUFFER_SIZE is accounted for.  The TSS
-	   value is typically larger than the TPM value. */
-	if (*nvBufferMax > MAX_NV_BUFFER_SIZE) {
-	    *nvBufferMax = MAX_NV_BUFFER_SIZE;
-	}
 	if (verbose) printf("readNvBufferMax: combined max read/write: %u\n", *nvBufferMax);
     }
     else {
@@ -186,63 +157,25 @@ TPM_RC getIndexData(TSS_CONTEXT *tssContext,
 		    uint16_t readDataSize)		/* total size to read */
 {
     TPM_RC			rc = 0;
-    int				done = FALSE;
-    uint32_t 			nvBufferMax;
-    uint16_t 			bytesRead;			/* bytes read so far */
-    NV_Read_In 			in;
-    NV_Read_Out			out;
     
-    /* data may have to be read in chunks.  Read the TPM_PT_NV_BUFFER_MAX, the chunk size */
-    if (rc == 0) {
-	rc = readNvBufferMax(tssContext,
-			     &nvBufferMax);
-    }    
     if (rc == 0) {
 	if (verbose) printf("getIndexData: index %08x\n", nvIndex);
-	in.authHandle = nvIndex;	/* index authorization */
-	in.nvIndex = nvIndex;
-	in.offset = 0;			/* start at beginning */
-	bytesRead = 0;			/* bytes read so far */
-    }
-    if (rc == 0) {
 	rc = TSS_Malloc(readBuffer, readDataSize);
     }
-    /* call TSS to execute the command */
-    while ((rc == 0) && !done) {
-	if (rc == 0) {
-	    /* read a chunk */
-	    in.offset = bytesRead;
-	    if ((uint32_t)(readDataSize - bytesRead) < nvBufferMax) {
-		in.size = readDataSize - bytesRead;	/* last chunk */
-	    }
-	    else {
-		in.size = nvBufferMax;		/* next chunk */
-	    }
-	}
-	if (rc == 0) {
-	    rc = TSS_Execute(tssContext,
-			     (RESPONSE_PARAMETERS *)&out,
-			     (COMMAND_PARAMETERS *)&in,
-			     NULL,
-			     TPM_CC_NV_Read,
-			     TPM_RS_PW, NULL, 0,
-			     TPM_RH_NULL, NULL, 0);
-	    if (rc != 0) {
-		const char *msg;
-		const char *submsg;
-		const char *num;
-		printf("nvread: failed, rc %08x\n", rc);
-		TSS_ResponseCode_toString(&msg, &submsg, &num, rc);
-		printf("%s%s%s\n", msg, submsg, num);
-	    }
-	}
- 	/* copy the results to the read buffer */
-	if (rc == 0) {
-	    memcpy(*readBuffer + bytesRead, out.data.b.buffer, out.data.b.size);
-	    bytesRead += out.data.b.size;
-	    if (bytesRead == readDataSize) {
-		done = TRUE;
-	    }
+    /* data may have to be read in chunks, index authorization */
+    if (rc == 0) {
+	rc = TSS_NV_Read(tssContext,
+			 *readBuffer, readDataSize,
+			 nvIndex, nvIndex, 0,
+			 TPM_RS_PW, NULL, 0,
+			 TPM_RH_NULL, NULL, 0);
+	if (rc != 0) {
+	    const char *msg;
+	    const char *submsg;
+	    const char *num;
+	    printf("nvread: failed, rc %08x\n", rc);
+	    TSS_ResponseCode_toString(&msg, &submsg, &num, rc);
+	    printf("%s%s%s\n", msg, submsg, num);
 	}
     }
     return rc;
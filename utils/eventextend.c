@@ -52,6 +52,10 @@
 
 /* local prototypes */
 
+static TPM_RC extendBatch(TSS_CONTEXT *tssContext,
+			  FILE *infile,
+			  unsigned int *eventCount);
+static TPM_RC replayLog(FILE *infile);
 static void printUsage(void);
 
 int verbose = FALSE;
@@ -69,6 +73,8 @@ int main(int argc, char * argv[])
     unsigned int 		lineNum;
     int 			endOfFile = FALSE;
     PCR_Extend_In 		in;
+    int				batch = FALSE;
+    int				replay = FALSE;		/* offline, no TPM */
 	
     setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
     TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
@@ -85,6 +91,12 @@ int main(int argc, char * argv[])
 		exit(2);
 	    }
 	}
+	else if (!strcmp(argv[i], "-batch")) {
+	    batch = TRUE;
+	}
+	else if (!strcmp(argv[i], "-replay")) {
+	    replay = TRUE;
+	}
 	else if (!strcmp(argv[i], "-h")) {
 	    printUsage();
 	}
@@ -109,9 +121,14 @@ int main(int argc, char * argv[])
 	printf("Unable to open input file '%s'\n", infilename);
 	exit(-4);
     }
+    /* replay every bank offline instead of extending the TPM */
+    if (replay) {
+	rc = replayLog(infile);
+	endOfFile = TRUE;
+    }
     /* the first event is a TPM 1.2 format event */
     /* read an event line */
-    if (rc == 0) {
+    if ((rc == 0) && !replay) {
 	rc = TSS_EVENT_Line_Read(&event, &endOfFile, infile);
     }
     /* debug tracing */
@@ -129,9 +146,22 @@ int main(int argc, char * argv[])
 	TSS_SpecIdEvent_Trace(&specIdEvent);
     }
     /* Start a TSS context */
-    if (rc == 0) {
+    if ((rc == 0) && !replay) {
 	rc = TSS_Create(&tssContext);
     }
+    /* batch mode, no per event tracing or PCR read */
+    if ((rc == 0) && batch && !endOfFile) {
+	uint64_t startTime;
+	double ns;
+	startTime = TSS_Timing_Now();
+	rc = extendBatch(tssContext, infile, &lineNum);
+	if (rc == 0) {
+	    ns = (double)(TSS_Timing_Now() - startTime);
+	    printf("eventextend: %u events, %.1f ms, %.0f events/s\n",
+		   lineNum, ns / 1000000.0, (ns > 0) ? (lineNum * 1000000000.0 / ns) : 0.0);
+	}
+	endOfFile = TRUE;	/* skip the per event loop */
+    }
     /* scan each measurement 'line' in the binary */
     for (lineNum = 1 ; !endOfFile && (rc == 0) ; lineNum++) {
 	/* read a TPM 2.0 hash agile event line */
@@ -214,14 +244,109 @@ int main(int argc, char * argv[])
     return rc;
 }
 
+/* extendBatch() extends the rest of the log using the split execute API.  The next event is
+   parsed into the other command buffer before the previous response is collected.  Each event is
+   still one PCR_Extend that completes before the next is sent, so the TPM round trip per event
+   is unchanged.  EV_NO_ACTION events are skipped and not counted. */
+
+static TPM_RC extendBatch(TSS_CONTEXT *tssContext,
+			  FILE *infile,
+			  unsigned int *eventCount)
+{
+    TPM_RC 		rc = 0;
+    TCG_PCR_EVENT2 	event2;
+    PCR_Extend_In 	in[2];		/* the pending command and the next one */
+    unsigned int	current = 0;	/* index of the next command to submit */
+    int			pending = FALSE;
+    int 		endOfFile = FALSE;
+
+    *eventCount = 0;
+    while ((rc == 0) && !endOfFile) {
+	rc = TSS_EVENT2_Line_Read(&event2, &endOfFile, infile);
+	/* don't extend no action events */
+	if ((rc == 0) && !endOfFile && (event2.eventType == EV_NO_ACTION)) {
+	    continue;
+	}
+	if ((rc == 0) && !endOfFile) {
+	    in[current].pcrHandle = event2.pcrIndex;
+	    in[current].digests = event2.digests;
+	}
+	/* the previous command must complete before the next is submitted */
+	if ((rc == 0) && pending) {
+	    pending = FALSE;
+	    rc = TSS_ExecuteComplete(tssContext, NULL);
+	}
+	if ((rc == 0) && !endOfFile) {
+	    rc = TSS_ExecuteSubmit(tssContext,
+				   (COMMAND_PARAMETERS *)&in[current],
+				   NULL,
+				   TPM_CC_PCR_Extend,
+				   TPM_RS_PW, NULL, 0,
+				   TPM_RH_NULL, NULL, 0);
+	    if (rc == 0) {
+		pending = TRUE;
+		current = 1 - current;
+		(*eventCount)++;
+	    }
+	}
+    }
+    /* do not leave a command pending on an error */
+    if (pending) {
+	TPM_RC rc1 = TSS_ExecuteComplete(tssContext, NULL);
+	if (rc == 0) {
+	    rc = rc1;
+	}
+    }
+    return rc;
+}
+
+/* replayLog() replays every bank in the log header offline, using the mapped log iterator, and
+   traces the resulting PCR values */
+
+static TPM_RC replayLog(FILE *infile)
+{
+    TPM_RC 			rc = 0;
+    TSS_EVENT2_ITERATOR		iterator;
+    TSS_EVENT2_VIEW		*view = NULL;
+    TCG_EfiSpecIDEvent 		specIdEvent;
+    TSS_EVENT2_REPLAY		eventReplay;
+    int 			endOfFile = FALSE;
+    int				iteratorOpen = FALSE;
+
+    if (rc == 0) {
+	rc = TSS_EVENT2_Iterator_Open(&iterator, infile, &specIdEvent);
+    }
+    if (rc == 0) {
+	iteratorOpen = TRUE;
+	if (verbose) TSS_SpecIdEvent_Trace(&specIdEvent);
+	rc = TSS_EVENT2_Replay_Init(&eventReplay, &specIdEvent);
+    }
+    while ((rc == 0) && !endOfFile) {
+	rc = TSS_EVENT2_Iterator_Next(&iterator, &view, &endOfFile);
+	if ((rc == 0) && !endOfFile) {
+	    rc = TSS_EVENT2_Replay_ExtendView(&eventReplay, view);
+	}
+    }
+    if (rc == 0) {
+	TSS_EVENT2_Replay_Trace(&eventReplay);
+    }
+    if (iteratorOpen) {
+	TSS_EVENT2_Iterator_Close(&iterator);
+    }
+    return rc;
+}
+
 static void printUsage(void)
 {
-    printf("Usage: eventextend -if <measurement file> [-v]\n");
+    printf("Usage: eventextend -if <measurement file> [-batch] [-replay] [-v]\n");
     printf("\n");
     printf("Extends a measurement file (binary) into TPM PCRs\n");
     printf("\n");
     printf("   Where the arguments are...\n");
     printf("    -if <input file> is the file containing the data to be extended\n");
+    printf("    -batch extends without per event tracing or PCR read, and reports events/second\n");
+    printf("    -replay replays every PCR bank in the log header without a TPM, and traces the\n"
+	   "\tresulting PCR values\n");
     printf("\n");
     exit(-1);
 }
@@ -41,6 +41,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef TPM_POSIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+#include <tss2/tss.h>
 #include <tss2/tssprint.h>
 #include <tss2/Unmarshal_fp.h>
 #include <tss2/tssmarshal.h>
@@ -198,6 +205,13 @@ TPM_RC TSS_SpecIdEvent_Unmarshal(TCG_EfiSpecIDEvent *specIdEvent,
     if (rc == 0) {
 	rc = UINT32LE_Unmarshal(&(specIdEvent->numberOfAlgorithms), &buffer, &size);
     }
+    if (rc == 0) {
+	if (specIdEvent->numberOfAlgorithms > HASH_COUNT) {
+	    printf("TSS_SpecIdEvent_Unmarshal: Error, numberOfAlgorithms %u greater than %u\n",
+		   specIdEvent->numberOfAlgorithms, HASH_COUNT);
+	    rc = ERR_STRUCTURE;
+	}
+    }
     for (i = 0 ; (rc == 0) && (i < specIdEvent->numberOfAlgorithms) ; i++) {
 	rc = TSS_SpecIdEventAlgorithmSize_Unmarshal(&(specIdEvent->digestSizes[i]),
 						    &buffer, &size);
@@ -530,6 +544,410 @@ TPM_RC TSS_EVENT2_PCR_Extend(TPMT_HA pcrs[8],
     return rc;
 }
 
+/* TSS_EVENT2_Iterator_Open() makes the event log in inFile available to
+   TSS_EVENT2_Iterator_Next().  A regular file is mapped read only.  Otherwise, such as for a pipe,
+   the stream is read into a malloced buffer.  inFile can be closed after this call.
+
+   The first entry is the TPM 1.2 format header.  If specIdEvent is not NULL, its event data is
+   unmarshaled into it.  The iterator is left at the first TCG_PCR_EVENT2 entry.
+*/
+
+TPM_RC TSS_EVENT2_Iterator_Open(TSS_EVENT2_ITERATOR *iterator,
+				FILE *inFile,
+				TCG_EfiSpecIDEvent *specIdEvent)
+{
+    TPM_RC 	rc = 0;
+    long	position = ftell(inFile);	/* -1 for a pipe */
+    size_t	offset = 0;			/* of the first entry in the log */
+    uint8_t	*buffer;
+    int32_t	size;
+    uint32_t	pcrIndex;
+    uint32_t	eventType;
+    uint32_t	eventDataSize;
+
+    if (position < 0) {
+	position = 0;
+    }
+    iterator->log = NULL;
+    iterator->logLength = 0;
+    iterator->next = 0;
+    iterator->mapped = FALSE;
+#ifdef TPM_POSIX
+    /* map a regular file */
+    if (rc == 0) {
+	struct stat statBuf;
+	int irc = fstat(fileno(inFile), &statBuf);
+	if ((irc == 0) && S_ISREG(statBuf.st_mode) && (statBuf.st_size >= position) &&
+	    (statBuf.st_size > 0)) {
+	    void *map = mmap(NULL, (size_t)statBuf.st_size, PROT_READ, MAP_PRIVATE,
+			     fileno(inFile), 0);
+	    if (map != MAP_FAILED) {
+		/* the log is read once, front to back */
+		madvise(map, (size_t)statBuf.st_size, MADV_SEQUENTIAL);
+		iterator->log = map;
+		iterator->logLength = (size_t)statBuf.st_size;
+		iterator->mapped = TRUE;
+		offset = position;	/* the whole file is mapped */
+	    }
+	}
+    }
+#endif
+    /* fallback, read the stream */
+    if ((rc == 0) && !iterator->mapped) {
+	size_t 	bufferSize = 0;
+	size_t	readSize;
+	int	done = FALSE;
+	while ((rc == 0) && !done) {
+	    /* grow the buffer */
+	    if (iterator->logLength == bufferSize) {
+		uint8_t *tmp;
+		bufferSize = (bufferSize == 0) ? 0x10000 : bufferSize * 2;
+		tmp = realloc(iterator->log, bufferSize);
+		if (tmp == NULL) {
+		    printf("TSS_EVENT2_Iterator_Open: Error, could not allocate %lu bytes\n",
+			   (unsigned long)bufferSize);
+		    rc = ERR_STRUCTURE;
+		}
+		else {
+		    iterator->log = tmp;
+		}
+	    }
+	    if (rc == 0) {
+		readSize = fread(iterator->log + iterator->logLength, 1,
+				 bufferSize - iterator->logLength, inFile);
+		iterator->logLength += readSize;
+		if (readSize == 0) {
+		    if (ferror(inFile)) {
+			printf("TSS_EVENT2_Iterator_Open: Error, could not read event log\n");
+			rc = ERR_STRUCTURE;
+		    }
+		    done = TRUE;
+		}
+	    }
+	}
+    }
+    /* the TPM 1.2 format header entry */
+    if (rc == 0) {
+	buffer = iterator->log + offset;
+	size = (int32_t)(((iterator->logLength - offset) > INT32_MAX) ?
+			 INT32_MAX : (iterator->logLength - offset));
+	rc = UINT32LE_Unmarshal(&pcrIndex, &buffer, &size);
+    }
+    if (rc == 0) {
+	rc = UINT32LE_Unmarshal(&eventType, &buffer, &size);
+    }
+    if (rc == 0) {
+	if (size < SHA1_DIGEST_SIZE) {
+	    rc = TPM_RC_INSUFFICIENT;
+	}
+	else {
+	    buffer += SHA1_DIGEST_SIZE;
+	    size -= SHA1_DIGEST_SIZE;
+	}
+    }
+    if (rc == 0) {
+	rc = UINT32LE_Unmarshal(&eventDataSize, &buffer, &size);
+    }
+    if (rc == 0) {
+	if (eventDataSize > (uint32_t)size) {
+	    rc = TPM_RC_INSUFFICIENT;
+	}
+    }
+    if ((rc == 0) && (specIdEvent != NULL)) {
+	rc = TSS_SpecIdEvent_Unmarshal(specIdEvent, eventDataSize, buffer);
+    }
+    if (rc == 0) {
+	iterator->next = (buffer - iterator->log) + eventDataSize;
+    }
+    else {
+	printf("TSS_EVENT2_Iterator_Open: Error, could not parse the header entry\n");
+	TSS_EVENT2_Iterator_Close(iterator);
+    }
+    return rc;
+}
+
+/* TSS_EVENT2_Iterator_Next() returns a view of the next TCG_PCR_EVENT2 entry in the log.
+
+   The view belongs to the iterator and is valid until the next call.  Its digests and event data
+   point into the log and are read only.
+
+   At the end of the log, endOfFile is set TRUE.
+*/
+
+TPM_RC TSS_EVENT2_Iterator_Next(TSS_EVENT2_ITERATOR *iterator,
+				TSS_EVENT2_VIEW **view,
+				int *endOfFile)
+{
+    TPM_RC 		rc = 0;
+    TSS_EVENT2_VIEW	*entry = &iterator->view;
+    uint8_t		*buffer = iterator->log + iterator->next;
+    size_t		remaining = iterator->logLength - iterator->next;
+    int32_t		size = (int32_t)((remaining > INT32_MAX) ? INT32_MAX : remaining);
+    uint32_t		count;
+    uint16_t		digestSize;
+
+    *view = NULL;
+    *endOfFile = (remaining == 0);
+    if ((rc == 0) && !*endOfFile) {
+	rc = UINT32LE_Unmarshal(&entry->pcrIndex, &buffer, &size);
+    }
+    if ((rc == 0) && !*endOfFile) {
+	rc = UINT32LE_Unmarshal(&entry->eventType, &buffer, &size);
+    }
+    if ((rc == 0) && !*endOfFile) {
+	rc = UINT32LE_Unmarshal(&entry->digestCount, &buffer, &size);
+    }
+    /* range check the digest count */
+    if ((rc == 0) && !*endOfFile) {
+	if ((entry->digestCount > HASH_COUNT) || (entry->digestCount == 0)) {
+	    printf("TSS_EVENT2_Iterator_Next: Error, digest count %u out of range\n",
+		   entry->digestCount);
+	    rc = ERR_STRUCTURE;
+	}
+    }
+    for (count = 0 ; (rc == 0) && !*endOfFile && (count < entry->digestCount) ; count++) {
+	rc = UINT16LE_Unmarshal(&entry->hashAlg[count], &buffer, &size);
+	/* map from the digest algorithm to the digest length */
+	if (rc == 0) {
+	    digestSize = TSS_GetDigestSize(entry->hashAlg[count]);
+	    if (digestSize == 0) {
+		printf("TSS_EVENT2_Iterator_Next: Error, unknown digest algorithm %04x\n",
+		       entry->hashAlg[count]);
+		rc = ERR_STRUCTURE;
+	    }
+	}
+	if (rc == 0) {
+	    if (size < digestSize) {
+		rc = TPM_RC_INSUFFICIENT;
+	    }
+	    else {
+		entry->digest[count] = buffer;
+		buffer += digestSize;
+		size -= digestSize;
+	    }
+	}
+    }
+    if ((rc == 0) && !*endOfFile) {
+	rc = UINT32LE_Unmarshal(&entry->eventSize, &buffer, &size);
+    }
+    if ((rc == 0) && !*endOfFile) {
+	if (entry->eventSize > (uint32_t)size) {
+	    rc = TPM_RC_INSUFFICIENT;
+	}
+	else {
+	    entry->event = buffer;
+	    buffer += entry->eventSize;
+	}
+    }
+    if ((rc == 0) && !*endOfFile) {
+	iterator->next = buffer - iterator->log;
+	*view = entry;
+    }
+    if (rc != 0) {
+	printf("TSS_EVENT2_Iterator_Next: Error, malformed entry at offset %lu\n",
+	       (unsigned long)iterator->next);
+    }
+    return rc;
+}
+
+/* TSS_EVENT2_Iterator_Close() unmaps or frees the log.  It is safe to call on a closed iterator. */
+
+void TSS_EVENT2_Iterator_Close(TSS_EVENT2_ITERATOR *iterator)
+{
+    if (iterator->log != NULL) {
+#ifdef TPM_POSIX
+	if (iterator->mapped) {
+	    munmap(iterator->log, iterator->logLength);
+	}
+	else {
+	    free(iterator->log);
+	}
+#else
+	free(iterator->log);
+#endif
+    }
+    iterator->log = NULL;
+    iterator->logLength = 0;
+    iterator->next = 0;
+    iterator->mapped = FALSE;
+    return;
+}
+
+/* TSS_EVENT2_Replay_Init() initializes the replay with a bank for each algorithm in the
+   TCG_EfiSpecIDEvent header.  PCRs 17-22 start at all ones, as after a TPM reset without a
+   dynamic launch.  The others start at zero.
+*/
+
+TPM_RC TSS_EVENT2_Replay_Init(TSS_EVENT2_REPLAY *replay,
+			      TCG_EfiSpecIDEvent *specIdEvent)
+{
+    TPM_RC 	rc = 0;
+    uint32_t	bank;
+    uint32_t	pcr;
+
+    if (rc == 0) {
+	if ((specIdEvent->numberOfAlgorithms == 0) ||
+	    (specIdEvent->numberOfAlgorithms > HASH_COUNT)) {
+	    printf("ERROR: TSS_EVENT2_Replay_Init: numberOfAlgorithms %u out of range\n",
+		   specIdEvent->numberOfAlgorithms);
+	    rc = 1;
+	}
+    }
+    for (bank = 0 ; (rc == 0) && (bank < specIdEvent->numberOfAlgorithms) ; bank++) {
+	TPMI_ALG_HASH hashAlg = specIdEvent->digestSizes[bank].algorithmId;
+	switch (hashAlg) {
+#ifdef TPM_ALG_SHA1
+	  case TPM_ALG_SHA1:
+#endif
+#ifdef TPM_ALG_SHA256
+	  case TPM_ALG_SHA256:
+#endif
+#ifdef TPM_ALG_SHA384
+	  case TPM_ALG_SHA384:
+#endif
+#ifdef TPM_ALG_SHA512
+	  case TPM_ALG_SHA512:
+#endif
+	    break;
+	  default:
+	    printf("ERROR: TSS_EVENT2_Replay_Init: Unsupported hash algorithm: %04x\n",
+		   hashAlg);
+	    rc = 1;
+	}
+	for (pcr = 0 ; (rc == 0) && (pcr < IMPLEMENTATION_PCR) ; pcr++) {
+	    replay->pcrs[bank][pcr].hashAlg = hashAlg;
+	    memset((uint8_t *)&replay->pcrs[bank][pcr].digest,
+		   ((pcr >= 17) && (pcr <= 22)) ? 0xff : 0x00,
+		   sizeof(TPMU_HA));
+	}
+    }
+    if (rc == 0) {
+	replay->bankCount = specIdEvent->numberOfAlgorithms;
+    }
+    return rc;
+}
+
+/* TSS_EVENT2_Replay_Extend() extends the digests of one TCG_PCR_EVENT2 event log entry into every
+   bank of the replay.  See TSS_EVENT2_Replay_ExtendView().
+*/
+
+TPM_RC TSS_EVENT2_Replay_Extend(TSS_EVENT2_REPLAY *replay,
+				TCG_PCR_EVENT2 *event2)
+{
+    TPM_RC 		rc = 0;
+    TSS_EVENT2_VIEW	view;
+    uint32_t		i;
+
+    /* validate event count */
+    if (rc == 0) {
+	uint32_t maxCount = sizeof(((TPML_DIGEST_VALUES *)NULL)->digests) / sizeof(TPMT_HA);
+	if (event2->digests.count > maxCount) {
+	    printf("ERROR: TSS_EVENT2_Replay_Extend: PCR count %u out of range, max %u\n",
+		   event2->digests.count, maxCount);
+	    rc = 1;
+	}
+    }
+    if (rc == 0) {
+	view.pcrIndex = event2->pcrIndex;
+	view.eventType = event2->eventType;
+	view.digestCount = event2->digests.count;
+	for (i = 0 ; i < event2->digests.count ; i++) {
+	    view.hashAlg[i] = event2->digests.digests[i].hashAlg;
+	    view.digest[i] = (uint8_t *)&event2->digests.digests[i].digest;
+	}
+	view.eventSize = event2->eventSize;
+	view.event = event2->event;
+	rc = TSS_EVENT2_Replay_ExtendView(replay, &view);
+    }
+    return rc;
+}
+
+/* TSS_EVENT2_Replay_ExtendView() extends the digests of one event log entry into every bank of
+   the replay.  Each bank must have a digest in the entry.  The banks are extended with one
+   TSS_Hash_ExtendBatch() call.
+
+   EV_NO_ACTION entries are not extended.  The exception is the StartupLocality entry, which sets
+   the initial value of PCR 0 to the startup locality.
+*/
+
+TPM_RC TSS_EVENT2_Replay_ExtendView(TSS_EVENT2_REPLAY *replay,
+				    TSS_EVENT2_VIEW *view)
+{
+    TPM_RC 		rc = 0;
+    uint32_t		bank;
+    uint32_t		i;
+    TPMT_HA		*pcrs[HASH_COUNT];
+    const uint8_t	*extend[HASH_COUNT];
+    uint16_t		extendSize[HASH_COUNT];
+    static const char	startupLocality[] = "StartupLocality";
+
+    /* validate PCR number */
+    if (rc == 0) {
+	if (view->pcrIndex >= IMPLEMENTATION_PCR) {
+	    printf("ERROR: TSS_EVENT2_Replay_ExtendView: PCR number %u out of range\n",
+		   view->pcrIndex);
+	    rc = 1;
+	}
+    }
+    if ((rc == 0) && (view->eventType == EV_NO_ACTION)) {
+	/* signature including the nul terminator, then the locality */
+	if ((view->pcrIndex == 0) &&
+	    (view->eventSize == sizeof(startupLocality) + 1) &&
+	    (memcmp(view->event, startupLocality, sizeof(startupLocality)) == 0)) {
+	    for (bank = 0 ; bank < replay->bankCount ; bank++) {
+		uint16_t digestSize = TSS_GetDigestSize(replay->pcrs[bank][0].hashAlg);
+		memset((uint8_t *)&replay->pcrs[bank][0].digest, 0, sizeof(TPMU_HA));
+		((uint8_t *)&replay->pcrs[bank][0].digest)[digestSize - 1] =
+		    view->event[sizeof(startupLocality)];
+	    }
+	}
+	return rc;
+    }
+    /* find the event digest for each bank */
+    for (bank = 0 ; (rc == 0) && (bank < replay->bankCount) ; bank++) {
+	pcrs[bank] = &replay->pcrs[bank][view->pcrIndex];
+	extend[bank] = NULL;
+	for (i = 0 ; (i < view->digestCount) && (extend[bank] == NULL) ; i++) {
+	    if (view->hashAlg[i] == pcrs[bank]->hashAlg) {
+		extend[bank] = view->digest[i];
+		extendSize[bank] = TSS_GetDigestSize(pcrs[bank]->hashAlg);
+	    }
+	}
+	if (extend[bank] == NULL) {
+	    printf("ERROR: TSS_EVENT2_Replay_ExtendView: no %04x entry in event record, PCR %u\n",
+		   pcrs[bank]->hashAlg, view->pcrIndex);
+	    rc = 1;
+	}
+    }
+    if (rc == 0) {
+	rc = TSS_Hash_ExtendBatch(pcrs, extend, extendSize, replay->bankCount);
+    }
+    return rc;
+}
+
+/* TSS_EVENT2_Replay_Trace() traces the PCRs of each bank that are not at their initial value */
+
+void TSS_EVENT2_Replay_Trace(TSS_EVENT2_REPLAY *replay)
+{
+    uint32_t	bank;
+    uint32_t	pcr;
+    uint8_t	initial[sizeof(TPMU_HA)];
+    char	label[64];
+
+    for (bank = 0 ; bank < replay->bankCount ; bank++) {
+	uint16_t digestSize = TSS_GetDigestSize(replay->pcrs[bank][0].hashAlg);
+	for (pcr = 0 ; pcr < IMPLEMENTATION_PCR ; pcr++) {
+	    memset(initial, ((pcr >= 17) && (pcr <= 22)) ? 0xff : 0x00, digestSize);
+	    if (memcmp(&replay->pcrs[bank][pcr].digest, initial, digestSize) != 0) {
+		sprintf(label, "TSS_EVENT2_Replay_Trace: algorithm %04x PCR %u",
+			replay->pcrs[bank][pcr].hashAlg, pcr);
+		TSS_PrintAll(label, (uint8_t *)&replay->pcrs[bank][pcr].digest, digestSize);
+	    }
+	}
+    }
+    return;
+}
+
 /* Uint16_Convert() converts a little endian uint16_t (from an input stream) to host byte order
  */
 
@@ -565,7 +983,7 @@ static uint32_t Uint32_Convert(uint32_t in)
 static TPM_RC
 UINT16LE_Unmarshal(uint16_t *target, BYTE **buffer, int32_t *size)
 {
-    if ((uint16_t)*size < sizeof(uint16_t)) {
+    if ((uint32_t)*size < sizeof(uint16_t)) {
 	return TPM_RC_INSUFFICIENT;
     }
     *target = ((uint16_t)((*buffer)[0]) <<  0) |
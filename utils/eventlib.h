@@ -137,6 +137,40 @@ typedef struct tdTCG_EfiSpecIdEvent {
     uint8_t 					vendorInfo[0xff]; 
 } TCG_EfiSpecIDEvent;
 
+/* TSS_EVENT2_VIEW is a TCG_PCR_EVENT2 event log entry parsed in place.  The digests and the event
+   data point into the log rather than being copied.
+*/
+
+typedef struct tdTSS_EVENT2_VIEW {
+    uint32_t 		pcrIndex;
+    uint32_t 		eventType;
+    uint32_t		digestCount;
+    TPMI_ALG_HASH	hashAlg[HASH_COUNT];
+    const uint8_t	*digest[HASH_COUNT];	/* points into the log */
+    uint32_t 		eventSize;
+    const uint8_t	*event;			/* points into the log */
+} TSS_EVENT2_VIEW;
+
+/* TSS_EVENT2_ITERATOR walks a TPM 2.0 event log held in memory, either mapped or read from a
+   stream */
+
+typedef struct tdTSS_EVENT2_ITERATOR {
+    uint8_t		*log;			/* the entire event log */
+    size_t		logLength;
+    size_t		next;			/* offset of the next entry */
+    int			mapped;			/* TRUE if log is mmapped, FALSE if malloced */
+    TSS_EVENT2_VIEW	view;			/* the current entry */
+} TSS_EVENT2_ITERATOR;
+
+/* TSS_EVENT2_REPLAY is the offline replay of a TPM 2.0 event log.  It holds all PCRs of every bank
+   listed in the TCG_EfiSpecIDEvent header.
+*/
+
+typedef struct tdTSS_EVENT2_REPLAY {
+    uint32_t	bankCount;
+    TPMT_HA	pcrs[HASH_COUNT][IMPLEMENTATION_PCR];	/* bank, PCR index */
+} TSS_EVENT2_REPLAY;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -158,6 +192,27 @@ extern "C" {
     TPM_RC TSS_EVENT2_PCR_Extend(TPMT_HA pcrs[8],
 				 TCG_PCR_EVENT2 *event2);
 
+    TPM_RC TSS_EVENT2_Iterator_Open(TSS_EVENT2_ITERATOR *iterator,
+				    FILE *inFile,
+				    TCG_EfiSpecIDEvent *specIdEvent);
+
+    TPM_RC TSS_EVENT2_Iterator_Next(TSS_EVENT2_ITERATOR *iterator,
+				    TSS_EVENT2_VIEW **view,
+				    int *endOfFile);
+
+    void TSS_EVENT2_Iterator_Close(TSS_EVENT2_ITERATOR *iterator);
+
+    TPM_RC TSS_EVENT2_Replay_Init(TSS_EVENT2_REPLAY *replay,
+				  TCG_EfiSpecIDEvent *specIdEvent);
+
+    TPM_RC TSS_EVENT2_Replay_Extend(TSS_EVENT2_REPLAY *replay,
+				    TCG_PCR_EVENT2 *event2);
+
+    TPM_RC TSS_EVENT2_Replay_ExtendView(TSS_EVENT2_REPLAY *replay,
+					TSS_EVENT2_VIEW *view);
+
+    void TSS_EVENT2_Replay_Trace(TSS_EVENT2_REPLAY *replay);
+
     void TSS_EVENT_Line_Trace(TCG_PCR_EVENT *event);
 
     void TSS_EVENT2_Line_Trace(TCG_PCR_EVENT2 *event);
@@ -52,6 +52,14 @@
 #include <tss2/Unmarshal_fp.h>
 
 static void printUsage(void);
+static TPM_RC getRandomBytes(TSS_CONTEXT *tssContext,
+			     unsigned char *buffer,
+			     uint32_t length,
+			     int noZeros,
+			     TPMI_SH_AUTH_SESSION sessionHandle[],
+			     unsigned int sessionAttributes[]);
+
+#define GETRANDOM_CHUNK 0x8000		/* chunk size for streaming to the output file */
 
 int verbose = FALSE;
 
@@ -60,12 +68,12 @@ int main(int argc, char *argv[])
     TPM_RC			rc = 0;
     int				i;    /* argc iterator */
     TSS_CONTEXT			*tssContext = NULL;
-    GetRandom_In 		in;
-    GetRandom_Out 		out;
     uint32_t			bytesRequested = 0;
     uint32_t 			bytesCopied;
     const char 			*outFilename = NULL;
     unsigned char 		*randomBuffer = NULL;
+    uint32_t			bufferSize;
+    FILE			*outFile = NULL;
     int				noZeros = FALSE;
     int				noSpace = FALSE;
     TPMI_SH_AUTH_SESSION    	sessionHandle0 = TPM_RH_NULL;
@@ -74,6 +82,8 @@ int main(int argc, char *argv[])
     unsigned int		sessionAttributes1 = 0;
     TPMI_SH_AUTH_SESSION    	sessionHandle2 = TPM_RH_NULL;
     unsigned int		sessionAttributes2 = 0;
+    TPMI_SH_AUTH_SESSION    	sessionHandle[3];
+    unsigned int		sessionAttributes[3];
     
     setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
     TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
@@ -185,57 +195,54 @@ int main(int argc, char *argv[])
 	}
     }
     if ((bytesRequested == 0) ||
-	(bytesRequested > 0xffff)) {
-	printf("Missing or bad parameter -by\n");
+	((bytesRequested > 0xffff) && (outFilename == NULL))) {
+	printf("Missing or bad parameter -by, more than 65535 bytes requires -of\n");
 	printUsage();
     }
+    if (rc == 0) {
+	sessionHandle[0] = sessionHandle0;
+	sessionHandle[1] = sessionHandle1;
+	sessionHandle[2] = sessionHandle2;
+	sessionAttributes[0] = sessionAttributes0;
+	sessionAttributes[1] = sessionAttributes1;
+	sessionAttributes[2] = sessionAttributes2;
+	/* large requests are streamed to the output file in chunks */
+	if (bytesRequested > 0xffff) {
+	    bufferSize = GETRANDOM_CHUNK;
+	}
+	else {
+	    bufferSize = bytesRequested;
+	}
+    }
     /* allocate a buffer for the bytes requested, add 1 for optional nul terminator */
     if (rc == 0) {
-	rc = TSS_Malloc(&randomBuffer, bytesRequested + 1);	/* freed @1 */
+	rc = TSS_Malloc(&randomBuffer, bufferSize + 1);	/* freed @1 */
     }
     /* Start a TSS context */
     if (rc == 0) {
 	rc = TSS_Create(&tssContext);
     }
-    /* This is somewhat optimized, but if a zero byte is obtained in the last pass, an extra pass is
-       needed.  The trade-off is that, in general, asking for more random numbers than needed may slow
-       down the TPM.  In any case, needing non-zero values for random auth should not happen very
-       often.
-     */
+    if ((rc == 0) && (bytesRequested > 0xffff)) {
+	rc = TSS_File_Open(&outFile, outFilename, "wb");	/* closed @2 */
+    }
     for (bytesCopied = 0 ; (rc == 0) && (bytesCopied < bytesRequested) ; ) {
-	/* Request whatever is left */
-	if (rc == 0) {
-	    in.bytesRequested = bytesRequested - bytesCopied;
+	uint32_t chunkBytes;
+	if ((bytesRequested - bytesCopied) < bufferSize) {
+	    chunkBytes = bytesRequested - bytesCopied;
 	}
-	/* call TSS to execute the command */
-	if (rc == 0) {
-	    rc = TSS_Execute(tssContext,
-			     (RESPONSE_PARAMETERS *)&out, 
-			     (COMMAND_PARAMETERS *)&in,
-			     NULL,
-			     TPM_CC_GetRandom,
-			     sessionHandle0, NULL, sessionAttributes0,
-			     sessionHandle1, NULL, sessionAttributes1,
-			     sessionHandle2, NULL, sessionAttributes2,
-			     TPM_RH_NULL, NULL, 0);
+	else {
+	    chunkBytes = bufferSize;
 	}
-	if (rc == 0) {
-	    if (verbose) TSS_PrintAll("randomBytes in pass",
-				      out.randomBytes.t.buffer, out.randomBytes.t.size);
-	    size_t br;
-	    /* copy as many bytes as were received or until bytes requested */
-	    for (br = 0 ; (br < out.randomBytes.t.size) && (bytesCopied < bytesRequested) ; br++) {
-
-		if (!noZeros || (out.randomBytes.t.buffer[br] != 0)) {
-		    randomBuffer[bytesCopied] = out.randomBytes.t.buffer[br];
-		    bytesCopied++;
-		}
+	rc = getRandomBytes(tssContext, randomBuffer, chunkBytes, noZeros,
+			    sessionHandle, sessionAttributes);
+	if ((rc == 0) && (outFile != NULL)) {
+	    if (fwrite(randomBuffer, 1, chunkBytes, outFile) != chunkBytes) {
+		printf("getrandom: Error writing %s\n", outFilename);
+		rc = TSS_RC_FILE_WRITE;
 	    }
 	}
 	if (rc == 0) {
-	    if (noZeros) {
-		randomBuffer[bytesCopied] = 0x00;
-	    }
+	    bytesCopied += chunkBytes;
 	}
     }
     {
@@ -244,13 +251,32 @@ int main(int argc, char *argv[])
 	    rc = rc1;
 	}
     }
-    if ((rc == 0) && (outFilename != NULL)) {
+    if (outFile != NULL) {
+	if ((rc == 0) && noZeros) {
+	    if (fputc(0x00, outFile) == EOF) {
+		rc = TSS_RC_FILE_WRITE;
+	    }
+	}
+	if (fclose(outFile) != 0) {		/* @2 */
+	    if (rc == 0) {
+		rc = TSS_RC_FILE_CLOSE;
+	    }
+	}
+    }
+    if ((rc == 0) && noZeros && (outFile == NULL)) {
+	randomBuffer[bytesRequested] = 0x00;
+    }
+    if ((rc == 0) && (outFilename != NULL) && (outFile == NULL)) {
 	rc = TSS_File_WriteBinaryFile(randomBuffer, bytesRequested + (noZeros ? 1 : 0),
 				      outFilename);
     }
     if (rc == 0) {
+	/* streamed to the output file, too large to print */
+	if (bytesRequested > 0xffff) {
+	    if (verbose) printf("getrandom: wrote %u bytes\n", bytesRequested);
+	}
 	/* machine readable format */
-	if (noSpace) {
+	else if (noSpace) {
 	    uint32_t bp;
 	    for (bp = 0 ; bp < bytesRequested ; bp++) {
 		printf("%02x", randomBuffer[bp]);
@@ -275,6 +301,68 @@ int main(int argc, char *argv[])
     return rc;
 }
 
+/* getRandomBytes() fills 'buffer' with 'length' random bytes, optionally with no zero bytes.
+
+   Without sessions, the bytes come from TSS_GetRandom(), which can use the TSS random number pool.
+   With sessions, each TPM2_GetRandom is sent with the sessions.
+*/
+
+static TPM_RC getRandomBytes(TSS_CONTEXT *tssContext,
+			     unsigned char *buffer,
+			     uint32_t length,
+			     int noZeros,
+			     TPMI_SH_AUTH_SESSION sessionHandle[],
+			     unsigned int sessionAttributes[])
+{
+    TPM_RC			rc = 0;
+    GetRandom_In 		in;
+    GetRandom_Out 		out;
+    uint32_t 			bytesCopied;
+    unsigned char		*received;
+    uint32_t 			receivedBytes;
+    uint32_t 			br;
+
+    /* This is somewhat optimized, but if a zero byte is obtained in the last pass, an extra pass is
+       needed.  The trade-off is that, in general, asking for more random numbers than needed may slow
+       down the TPM.  In any case, needing non-zero values for random auth should not happen very
+       often.
+     */
+    for (bytesCopied = 0 ; (rc == 0) && (bytesCopied < length) ; ) {
+	/* Request whatever is left */
+	if (sessionHandle[0] == TPM_RH_NULL) {
+	    received = buffer + bytesCopied;
+	    receivedBytes = length - bytesCopied;
+	    rc = TSS_GetRandom(tssContext, received, receivedBytes);
+	}
+	else {
+	    in.bytesRequested = length - bytesCopied;
+	    rc = TSS_Execute(tssContext,
+			     (RESPONSE_PARAMETERS *)&out, 
+			     (COMMAND_PARAMETERS *)&in,
+			     NULL,
+			     TPM_CC_GetRandom,
+			     sessionHandle[0], NULL, sessionAttributes[0],
+			     sessionHandle[1], NULL, sessionAttributes[1],
+			     sessionHandle[2], NULL, sessionAttributes[2],
+			     TPM_RH_NULL, NULL, 0);
+	    received = out.randomBytes.t.buffer;
+	    receivedBytes = out.randomBytes.t.size;
+	}
+	if (rc == 0) {
+	    if (verbose) TSS_PrintAll("randomBytes in pass", received, receivedBytes);
+	    /* copy as many bytes as were received or until bytes requested, in place for
+	       TSS_GetRandom() */
+	    for (br = 0 ; (br < receivedBytes) && (bytesCopied < length) ; br++) {
+		if (!noZeros || (received[br] != 0)) {
+		    buffer[bytesCopied] = received[br];
+		    bytesCopied++;
+		}
+	    }
+	}
+    }
+    return rc;
+}
+
 static void printUsage(void)
 {
     printf("\n");
@@ -283,6 +371,7 @@ static void printUsage(void)
     printf("Runs TPM2_GetRandom\n");
     printf("\n");
     printf("\t-by bytes requested\n");
+    printf("\t\tmore than 65535 bytes are streamed to the -of file and not printed\n");
     printf("\t[-of output file, with -nz, appends nul terminator (default do not save)]\n");
     printf("\t[-nz get random number with no zero bytes (for authorization value)]\n");
     printf("\t[-ns no space, no text, no newlines]\n");
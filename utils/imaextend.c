@@ -47,6 +47,8 @@
 #include <openssl/err.h>
 
 #include <tss2/tss.h>
+#include <tss2/tssfile.h>
+#include <tss2/tssprint.h>
 #include <tss2/tssresponsecode.h>
 
 #include "imalib.h"
@@ -55,6 +57,11 @@
 
 static TPM_RC pcrread(TSS_CONTEXT *tssContext,
 		      TPMI_DH_PCR pcrHandle);
+static void setDigests(PCR_Extend_In *in,
+		       ImaEvent *imaEvent);
+static TPM_RC extendBatch(TSS_CONTEXT *tssContext,
+			  ImaEventIterator *imaEventIterator,
+			  unsigned int *eventCount);
 static void printUsage(void);
 
 int verbose = FALSE;
@@ -69,6 +76,12 @@ int main(int argc, char * argv[])
     const char 		*infilename = NULL;
     FILE 		*infile = NULL;
     int 		littleEndian = FALSE;
+    const char 		*inCheckpointFilename = NULL;
+    const char 		*outCheckpointFilename = NULL;
+    ImaCheckpoint	imaCheckpoint;
+    ImaCheckpoint	endCheckpoint;		/* after the last event */
+    unsigned int	verifyThreads = 0;
+    int			batch = FALSE;
 	
     setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
     TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
@@ -85,6 +98,39 @@ int main(int argc, char * argv[])
 		exit(2);
 	    }
 	}
+	else if (strcmp(argv[i],"-ickpt") == 0) {
+	    i++;
+	    if (i < argc) {
+		inCheckpointFilename = argv[i];
+	    }
+	    else {
+		printf("-ickpt option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-ockpt") == 0) {
+	    i++;
+	    if (i < argc) {
+		outCheckpointFilename = argv[i];
+	    }
+	    else {
+		printf("-ockpt option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-vt") == 0) {
+	    i++;
+	    if (i < argc) {
+		verifyThreads = atoi(argv[i]);
+	    }
+	    else {
+		printf("-vt option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-batch") == 0) {
+	    batch = TRUE;
+	}
 	else if (strcmp(argv[i],"-le") == 0) {
 	    littleEndian = TRUE; 
 	}
@@ -113,16 +159,46 @@ int main(int argc, char * argv[])
 	printf("Unable to open input file '%s'\n", infilename);
 	exit(-4);
     }
+    /* map or read the event log */
+    ImaEventIterator imaEventIterator;
+    if (rc == 0) {
+	rc = IMA_EventIterator_Open(&imaEventIterator, infile, littleEndian);
+    }
+    /* resume after the events already extended */
+    if (rc == 0) {
+	IMA_Checkpoint_Init(&imaCheckpoint);
+	if (inCheckpointFilename != NULL) {
+	    rc = TSS_File_ReadStructure(&imaCheckpoint,
+					(UnmarshalFunction_t)ImaCheckpoint_Unmarshal,
+					inCheckpointFilename);
+	}
+    }
+    if (rc == 0) {
+	rc = IMA_Checkpoint_Resume(&imaCheckpoint, &imaEventIterator);
+	if ((rc == 0) && verbose) printf("imaextend: resume at event %u, offset %llu\n",
+					 imaCheckpoint.eventCount,
+					 (unsigned long long)imaCheckpoint.offset);
+    }
+    /* verify the template data and calculate the final checkpoint before extending anything */
+    if ((rc == 0) && ((outCheckpointFilename != NULL) || (verifyThreads != 0))) {
+	uint32_t badEvent;
+	endCheckpoint = imaCheckpoint;
+	rc = IMA_Checkpoint_Extend(&endCheckpoint, &imaEventIterator, verifyThreads, &badEvent);
+	if ((rc == 0) && badEvent) {
+	    printf("imaextend: template data hash does not match, event %u\n",
+		   endCheckpoint.eventCount);
+	    rc = ERR_STRUCTURE;
+	}
+	if (rc == 0) {
+	    rc = IMA_EventIterator_Seek(&imaEventIterator, imaCheckpoint.offset);
+	}
+    }
     /* Start a TSS context */
     if (rc == 0) {
 	rc = TSS_Create(&tssContext);
     }
-    unsigned char zeroDigest[SHA1_DIGEST_SIZE];
-    unsigned char oneDigest[SHA1_DIGEST_SIZE];
     if (rc == 0) {
 	uint32_t algs;				/* hash algorithm iterator */
-	memset(zeroDigest, 0, SHA1_DIGEST_SIZE);
-	memset(oneDigest, 0xff, SHA1_DIGEST_SIZE);
 	in.digests.count = 2;			/* extend SHA-1 and SHA-256 banks */
 	in.digests.digests[0].hashAlg = TPM_ALG_SHA1;
 	in.digests.digests[1].hashAlg = TPM_ALG_SHA256;
@@ -135,38 +211,43 @@ int main(int argc, char * argv[])
 	printf("Initial PCR 10 value\n");
 	rc = pcrread(tssContext, 10);
     }
-    ImaEvent imaEvent;
+    ImaEvent *imaEvent = NULL;		/* points into the iterator, not freed */
     unsigned int lineNum;
     int endOfFile = FALSE;
+    /* batch mode, no per event tracing or PCR read */
+    if ((rc == 0) && batch) {
+	uint64_t startTime;
+	double ns;
+	startTime = TSS_Timing_Now();
+	rc = extendBatch(tssContext, &imaEventIterator, &lineNum);
+	if (rc == 0) {
+	    ns = (double)(TSS_Timing_Now() - startTime);
+	    printf("imaextend: %u events, %.1f ms, %.0f events/s\n",
+		   lineNum, ns / 1000000.0, (ns > 0) ? (lineNum * 1000000000.0 / ns) : 0.0);
+	}
+	if ((rc == 0) && verbose) {
+	    printf("Final PCR 10 value\n");
+	    rc = pcrread(tssContext, 10);
+	}
+	endOfFile = TRUE;	/* skip the per event loop */
+    }
     /* scan each measurement 'line' in the binary */
     for (lineNum = 0 ; !endOfFile && (rc == 0) ; lineNum++) {
 	/* read an IMA event line */
-	IMA_Event_Init(&imaEvent);
 	if (rc == 0) {
-	    rc = IMA_Event_ReadFile(&imaEvent, &endOfFile, infile,
-				    littleEndian);
+	    rc = IMA_EventIterator_Next(&imaEventIterator, &imaEvent, &endOfFile);
 	}
-	if (rc == 0) {
-	    in.pcrHandle = imaEvent.pcrIndex;		/* normally PCR 10 */
+	if ((rc == 0) && !endOfFile) {
+	    in.pcrHandle = imaEvent->pcrIndex;		/* normally PCR 10 */
 	}
 	/* debug tracing */
 	if (verbose && !endOfFile && (rc == 0)) {
 	    printf("\nimaextend: line %u\n", lineNum);
-	    IMA_Event_Trace(&imaEvent, FALSE);
+	    IMA_Event_Trace(imaEvent, FALSE);
 	}
 	/* copy the SHA-1 digest to be extended */
 	if ((rc == 0) && !endOfFile) {
-	    int notAllZero = memcmp(imaEvent.digest, zeroDigest, SHA1_DIGEST_SIZE);
-	    /* IMA has a quirk where some measurements store a zero digest in the event log, but
-	       extend ones into PCR 10 */
-	    if (notAllZero) {
-		memcpy((uint8_t *)&in.digests.digests[0].digest, imaEvent.digest, SHA1_DIGEST_SIZE);
-		memcpy((uint8_t *)&in.digests.digests[1].digest, imaEvent.digest, SHA1_DIGEST_SIZE);
-	    }
-	    else {
-		memset((uint8_t *)&in.digests.digests[0].digest, 0xff, SHA1_DIGEST_SIZE);
-		memset((uint8_t *)&in.digests.digests[1].digest, 0xff, SHA1_DIGEST_SIZE);
-	    }
+	    setDigests(&in, imaEvent);
 	}	
 	if ((rc == 0) && !endOfFile) {
 	    rc = TSS_Execute(tssContext,
@@ -178,9 +259,22 @@ int main(int argc, char * argv[])
 			     TPM_RH_NULL, NULL, 0);
 	}
 	if ((rc == 0) && !endOfFile && verbose) {
-	    rc = pcrread(tssContext, imaEvent.pcrIndex);
+	    rc = pcrread(tssContext, imaEvent->pcrIndex);
+	}
+    }
+    /* store the checkpoint after the events just extended */
+    if ((rc == 0) && (outCheckpointFilename != NULL)) {
+	rc = TSS_File_WriteStructure(&endCheckpoint,
+				     (MarshalFunction_t)ImaCheckpoint_Marshal,
+				     outCheckpointFilename);
+	if ((rc == 0) && verbose) {
+	    printf("imaextend: checkpoint at event %u, offset %llu\n",
+		   endCheckpoint.eventCount, (unsigned long long)endCheckpoint.offset);
+	    TSS_PrintAll("imaextend: checkpoint PCR 10 SHA-1",
+			 (uint8_t *)&endCheckpoint.imapcr[0].digest, SHA1_DIGEST_SIZE);
+	    TSS_PrintAll("imaextend: checkpoint PCR 10 SHA-256",
+			 (uint8_t *)&endCheckpoint.imapcr[1].digest, SHA256_DIGEST_SIZE);
 	}
-	IMA_Event_Free(&imaEvent);
     }
     {
 	TPM_RC rc1 = TSS_Delete(tssContext);
@@ -200,12 +294,96 @@ int main(int argc, char * argv[])
 	printf("%s%s%s\n", msg, submsg, num);
 	rc = EXIT_FAILURE;
     }
+    IMA_EventIterator_Close(&imaEventIterator);
     if (infile != NULL) {
 	fclose(infile);
     }
     return rc;
 }
 
+/* setDigests() sets the SHA-1 and zero padded SHA-256 digests to be extended for the IMA event */
+
+static void setDigests(PCR_Extend_In *in,
+		       ImaEvent *imaEvent)
+{
+    unsigned char zeroDigest[SHA1_DIGEST_SIZE];
+
+    memset(zeroDigest, 0, SHA1_DIGEST_SIZE);
+    /* IMA has a quirk where some measurements store a zero digest in the event log, but extend
+       ones into PCR 10 */
+    if (memcmp(imaEvent->digest, zeroDigest, SHA1_DIGEST_SIZE) != 0) {
+	memcpy((uint8_t *)&in->digests.digests[0].digest, imaEvent->digest, SHA1_DIGEST_SIZE);
+	memcpy((uint8_t *)&in->digests.digests[1].digest, imaEvent->digest, SHA1_DIGEST_SIZE);
+    }
+    else {
+	memset((uint8_t *)&in->digests.digests[0].digest, 0xff, SHA1_DIGEST_SIZE);
+	memset((uint8_t *)&in->digests.digests[1].digest, 0xff, SHA1_DIGEST_SIZE);
+    }
+    return;
+}
+
+/* extendBatch() extends the rest of the log using the split execute API.  The next event is
+   parsed into the other command buffer before the previous response is collected.  Each event is
+   still one PCR_Extend that completes before the next is sent, so the TPM round trip per event
+   is unchanged. */
+
+static TPM_RC extendBatch(TSS_CONTEXT *tssContext,
+			  ImaEventIterator *imaEventIterator,
+			  unsigned int *eventCount)
+{
+    TPM_RC 		rc = 0;
+    PCR_Extend_In 	in[2];		/* the pending command and the next one */
+    unsigned int	current = 0;	/* index of the next command to submit */
+    int			pending = FALSE;
+    ImaEvent 		*imaEvent = NULL;
+    int 		endOfFile = FALSE;
+    uint32_t		algs;
+
+    *eventCount = 0;
+    for (current = 0 ; current < 2 ; current++) {
+	in[current].digests.count = 2;
+	in[current].digests.digests[0].hashAlg = TPM_ALG_SHA1;
+	in[current].digests.digests[1].hashAlg = TPM_ALG_SHA256;
+	for (algs = 0 ; algs < in[current].digests.count ; algs++) {
+	    memset((uint8_t *)&in[current].digests.digests[algs].digest, 0, sizeof(TPMU_HA));
+	}
+    }
+    current = 0;
+    while ((rc == 0) && !endOfFile) {
+	rc = IMA_EventIterator_Next(imaEventIterator, &imaEvent, &endOfFile);
+	if ((rc == 0) && !endOfFile) {
+	    in[current].pcrHandle = imaEvent->pcrIndex;
+	    setDigests(&in[current], imaEvent);
+	}
+	/* the previous command must complete before the next is submitted */
+	if ((rc == 0) && pending) {
+	    pending = FALSE;
+	    rc = TSS_ExecuteComplete(tssContext, NULL);
+	}
+	if ((rc == 0) && !endOfFile) {
+	    rc = TSS_ExecuteSubmit(tssContext,
+				   (COMMAND_PARAMETERS *)&in[current],
+				   NULL,
+				   TPM_CC_PCR_Extend,
+				   TPM_RS_PW, NULL, 0,
+				   TPM_RH_NULL, NULL, 0);
+	    if (rc == 0) {
+		pending = TRUE;
+		current = 1 - current;
+		(*eventCount)++;
+	    }
+	}
+    }
+    /* do not leave a command pending on an error */
+    if (pending) {
+	TPM_RC rc1 = TSS_ExecuteComplete(tssContext, NULL);
+	if (rc == 0) {
+	    rc = rc1;
+	}
+    }
+    return rc;
+}
+
 static TPM_RC pcrread(TSS_CONTEXT *tssContext,
 		      TPMI_DH_PCR pcrHandle)
 {
@@ -262,6 +440,11 @@ static void printUsage(void)
     printf("\n");
     printf("\t-if IMA event log file name\n");
     printf("\t[-le input file is little endian (default big endian)\n]");
+    printf("\t[-ickpt checkpoint file, extend only the events after the checkpoint]\n");
+    printf("\t[-ockpt checkpoint file, written after the last event]\n");
+    printf("\t[-batch extend without per event tracing or PCR read, and report events/second]\n");
+    printf("\t[-vt verify the template data hashes first, using n threads (default 0, no\n"
+	   "\t\tverification)]\n");
     printf("\n");
     exit(1);
 }
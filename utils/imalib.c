@@ -49,6 +49,10 @@
 
 #ifdef TPM_POSIX
 #include <arpa/inet.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <pthread.h>
 #endif
 
 #ifdef TPM_WINDOWS
@@ -58,9 +62,10 @@
 #include <openssl/sha.h>
 #include <openssl/engine.h>
 
-#include <tss2/TPM_Types.h>
+#include <tss2/tss.h>
 #include <tss2/tsscryptoh.h>
 #include <tss2/tssmarshal.h>
+#include <tss2/Unmarshal_fp.h>
 #include <tss2/tssprint.h>
 
 #include "imalib.h"
@@ -69,6 +74,13 @@ static uint32_t IMA_Uint32_Convert(const uint8_t *stream,
 				   int littleEndian);
 static uint32_t IMA_Strn2cpy(char *dest, const uint8_t *src,
 			     size_t destLength, size_t srcLength);
+#ifdef TPM_POSIX
+static uint32_t IMA_Checkpoint_ExtendParallel(ImaCheckpoint *imaCheckpoint,
+					      ImaEventIterator *imaEventIterator,
+					      unsigned int verifyThreads,
+					      uint32_t *badEvent);
+static void *IMA_VerifyPool_Worker(void *arg);
+#endif
 
 extern int verbose;
 extern int vverbose;
@@ -440,6 +452,13 @@ uint32_t IMA_Event_ReadBuffer(ImaEvent *imaEvent,	/* freed by caller */
 		*length -= sizeof(uint32_t);
 	    }
 	}
+	/* bounds check the length, even if the template data is skipped */
+	if (rc == 0) {
+	    if (*length < imaEvent->template_data_len) {
+		printf("ERROR: IMA_Event_ReadBuffer: buffer too small for template data\n");
+		rc = ERR_STRUCTURE;
+	    }
+	}
 	/* allocate for the template data */
 	if (rc == 0) {
 	    if (getTemplate) {
@@ -449,10 +468,6 @@ uint32_t IMA_Event_ReadBuffer(ImaEvent *imaEvent,	/* freed by caller */
 			   imaEvent->template_data_len );
 		    rc = ERR_STRUCTURE;
 		}
-		else if (*length < imaEvent->template_data_len) {
-		    printf("ERROR: IMA_Event_ReadBuffer: buffer too small for template data\n");
-		    rc = ERR_STRUCTURE;
-		}
 		else {
 		    if (rc == 0) {
 			imaEvent->template_data = malloc(imaEvent->template_data_len);
@@ -478,6 +493,194 @@ uint32_t IMA_Event_ReadBuffer(ImaEvent *imaEvent,	/* freed by caller */
     return rc;
 }
 
+/* IMA_EventIterator_Open() prepares an iterator over the IMA events in inFile, starting at the
+   current file position.
+
+   A regular file is memory mapped.  Anything that cannot be mapped, such as a pipe or the
+   securityfs pseudofile, is read into a malloced buffer.  Either way, IMA_EventIterator_Next()
+   parses events in place.
+
+   The iterator must be closed with IMA_EventIterator_Close().  inFile can be closed after this
+   call.
+*/
+
+uint32_t IMA_EventIterator_Open(ImaEventIterator *imaEventIterator,
+				FILE *inFile,
+				int littleEndian)
+{
+    uint32_t 	rc = 0;
+    long	position = ftell(inFile);	/* -1 for a pipe */
+    size_t	offset = 0;			/* of the first event in the log */
+    
+    if (position < 0) {
+	position = 0;
+    }
+    imaEventIterator->log = NULL;
+    imaEventIterator->logLength = 0;
+    imaEventIterator->logOffset = 0;
+    imaEventIterator->next = NULL;
+    imaEventIterator->length = 0;
+    imaEventIterator->mapped = FALSE;
+    imaEventIterator->littleEndian = littleEndian;
+    imaEventIterator->imaEvent.template_data = NULL;
+#ifdef TPM_POSIX
+    /* map a regular file */
+    if (rc == 0) {
+	struct stat statBuf;
+	int irc = fstat(fileno(inFile), &statBuf);
+	if ((irc == 0) && S_ISREG(statBuf.st_mode) && (statBuf.st_size >= position) &&
+	    (statBuf.st_size > 0)) {
+	    void *map = mmap(NULL, (size_t)statBuf.st_size, PROT_READ, MAP_PRIVATE,
+			     fileno(inFile), 0);
+	    if (map != MAP_FAILED) {
+		/* the log is read once, front to back */
+		madvise(map, (size_t)statBuf.st_size, MADV_SEQUENTIAL);
+		imaEventIterator->log = map;
+		imaEventIterator->logLength = (size_t)statBuf.st_size;
+		imaEventIterator->mapped = TRUE;
+		offset = position;	/* the whole file is mapped */
+	    }
+	}
+    }
+#endif
+    /* fallback, read the stream */
+    if ((rc == 0) && !imaEventIterator->mapped) {
+	size_t 	bufferSize = 0;
+	size_t	readSize;
+	int	done = FALSE;
+	imaEventIterator->logOffset = position;	/* the log starts at the file position */
+	while ((rc == 0) && !done) {
+	    /* grow the buffer */
+	    if (imaEventIterator->logLength == bufferSize) {
+		uint8_t *tmp;
+		bufferSize = (bufferSize == 0) ? 0x10000 : bufferSize * 2;
+		tmp = realloc(imaEventIterator->log, bufferSize);
+		if (tmp == NULL) {
+		    printf("ERROR: IMA_EventIterator_Open: could not allocate %lu bytes\n",
+			   (unsigned long)bufferSize);
+		    rc = ERR_FILE;
+		}
+		else {
+		    imaEventIterator->log = tmp;
+		}
+	    }
+	    if (rc == 0) {
+		readSize = fread(imaEventIterator->log + imaEventIterator->logLength, 1,
+				 bufferSize - imaEventIterator->logLength, inFile);
+		imaEventIterator->logLength += readSize;
+		if (readSize == 0) {
+		    if (ferror(inFile)) {
+			printf("ERROR: IMA_EventIterator_Open: could not read event log\n");
+			rc = ERR_FILE;
+		    }
+		    done = TRUE;
+		}
+	    }
+	}
+    }
+    if (rc == 0) {
+	imaEventIterator->next = imaEventIterator->log + offset;
+	imaEventIterator->length = imaEventIterator->logLength - offset;
+    }
+    else {
+	IMA_EventIterator_Close(imaEventIterator);
+    }
+    return rc;
+}
+
+/* IMA_EventIterator_Next() returns the next IMA event in the log.
+
+   The returned event belongs to the iterator and is valid until the next call.  Its template_data
+   points into the log and is read only.  Nothing is allocated, and the event must not be freed
+   with IMA_Event_Free().
+
+   At the end of the log, endOfFile is set TRUE.
+*/
+
+uint32_t IMA_EventIterator_Next(ImaEventIterator *imaEventIterator,
+				ImaEvent **imaEvent,
+				int *endOfFile)
+{
+    uint32_t 	rc = 0;
+    ImaEvent	*event = &imaEventIterator->imaEvent;
+
+    *endOfFile = FALSE;
+    if (rc == 0) {
+	rc = IMA_Event_ReadBuffer(event,
+				  &imaEventIterator->length,
+				  &imaEventIterator->next,
+				  endOfFile,
+				  imaEventIterator->littleEndian,
+				  FALSE);		/* skip the template data */
+    }
+    /* point to the template data just skipped */
+    if ((rc == 0) && !*endOfFile) {
+	event->template_data = imaEventIterator->next - event->template_data_len;
+	*imaEvent = event;
+    }
+    else {
+	event->template_data = NULL;
+	*imaEvent = NULL;
+    }
+    return rc;
+}
+
+/* IMA_EventIterator_Close() unmaps or frees the log.  It is safe to call on a closed iterator. */
+
+void IMA_EventIterator_Close(ImaEventIterator *imaEventIterator)
+{
+    if (imaEventIterator->log != NULL) {
+#ifdef TPM_POSIX
+	if (imaEventIterator->mapped) {
+	    munmap(imaEventIterator->log, imaEventIterator->logLength);
+	}
+	else {
+	    free(imaEventIterator->log);
+	}
+#else
+	free(imaEventIterator->log);
+#endif
+    }
+    imaEventIterator->log = NULL;
+    imaEventIterator->logLength = 0;
+    imaEventIterator->logOffset = 0;
+    imaEventIterator->next = NULL;
+    imaEventIterator->length = 0;
+    imaEventIterator->mapped = FALSE;
+    imaEventIterator->imaEvent.template_data = NULL;
+    return;
+}
+
+/* IMA_EventIterator_Tell() returns the file offset of the next event */
+
+uint64_t IMA_EventIterator_Tell(ImaEventIterator *imaEventIterator)
+{
+    return imaEventIterator->logOffset + (imaEventIterator->next - imaEventIterator->log);
+}
+
+/* IMA_EventIterator_Seek() sets the next event to the file offset, typically one returned by
+   IMA_EventIterator_Tell().  The offset must be within the log held by the iterator.
+*/
+
+uint32_t IMA_EventIterator_Seek(ImaEventIterator *imaEventIterator,
+				uint64_t offset)
+{
+    uint32_t 	rc = 0;
+
+    if ((offset < imaEventIterator->logOffset) ||
+	(offset > imaEventIterator->logOffset + imaEventIterator->logLength)) {
+	printf("ERROR: IMA_EventIterator_Seek: offset %llu outside the event log\n",
+	       (unsigned long long)offset);
+	rc = ERR_STRUCTURE;
+    }
+    else {
+	size_t start = (size_t)(offset - imaEventIterator->logOffset);
+	imaEventIterator->next = imaEventIterator->log + start;
+	imaEventIterator->length = imaEventIterator->logLength - start;
+    }
+    return rc;
+}
+
 /* IMA_TemplateData_ReadBuffer() unmarshals the template data fields from the template data byte
    array.
 
@@ -827,7 +1030,7 @@ uint32_t IMA_Extend(TPMT_HA *imapcr,
 	}
     }
     if (rc == 0) {
-	notAllZero = memcmp(imaEvent->digest, zeroDigest, digestSize);
+	notAllZero = memcmp(imaEvent->digest, zeroDigest, SHA1_DIGEST_SIZE);
 	imapcr->hashAlg = hashAlg;
 	if (notAllZero) {
 #if 0
@@ -847,7 +1050,7 @@ uint32_t IMA_Extend(TPMT_HA *imapcr,
 	else {
 	    rc = TSS_Hash_Generate(imapcr,
 				   digestSize, (uint8_t *)&imapcr->digest,
-				   digestSize, oneDigest,
+				   SHA1_DIGEST_SIZE, oneDigest,
 				   /* SHA-1 gets zero padded */
 				   zeroPad, zeroDigest,
 				   0, NULL);
@@ -859,6 +1062,68 @@ uint32_t IMA_Extend(TPMT_HA *imapcr,
     return rc;
 }
 
+#define IMA_EXTEND_BATCH	256	/* extends per TSS_Hash_ExtendBatch() call */
+
+/* IMA_ExtendBatch() extends count IMA event digests, in order, into the IMA PCR values imapcr[].
+   The hash algorithm of each imapcr selects the bank.  The imapcr need not be distinct, so this
+   can fold a sequence of events into one PCR, or one event from each of several logs.
+
+   The extends use one digest context per IMA_EXTEND_BATCH rather than one per event.  The
+   zero padding and the all zero digest quirk are the same as IMA_Extend().
+*/
+
+uint32_t IMA_ExtendBatch(TPMT_HA *imapcr[],
+			 const uint8_t *imaDigest[],
+			 size_t count)
+{
+    uint32_t 		rc = 0;
+    size_t		start;
+    size_t		batch;
+    size_t		i;
+    uint8_t		extend[IMA_EXTEND_BATCH][SHA256_DIGEST_SIZE];
+    const uint8_t	*extendPtr[IMA_EXTEND_BATCH];
+    uint16_t		extendSize[IMA_EXTEND_BATCH];
+    unsigned char 	zeroDigest[SHA1_DIGEST_SIZE];
+
+    memset(zeroDigest, 0, SHA1_DIGEST_SIZE);
+    for (start = 0 ; (rc == 0) && (start < count) ; start += batch) {
+	batch = count - start;
+	if (batch > IMA_EXTEND_BATCH) {
+	    batch = IMA_EXTEND_BATCH;
+	}
+	for (i = 0 ; (rc == 0) && (i < batch) ; i++) {
+	    if (memcmp(imaDigest[start + i], zeroDigest, SHA1_DIGEST_SIZE) != 0) {
+		memcpy(extend[i], imaDigest[start + i], SHA1_DIGEST_SIZE);
+	    }
+	    /* IMA extends all ones for an all zero digest */
+	    else {
+		memset(extend[i], 0xff, SHA1_DIGEST_SIZE);
+	    }
+	    /* pad the SHA-1 event with zeros for the SHA-256 bank */
+	    memset(extend[i] + SHA1_DIGEST_SIZE, 0, SHA256_DIGEST_SIZE - SHA1_DIGEST_SIZE);
+	    extendPtr[i] = extend[i];
+	    if (imapcr[start + i]->hashAlg == TPM_ALG_SHA1) {
+		extendSize[i] = SHA1_DIGEST_SIZE;
+	    }
+	    else if (imapcr[start + i]->hashAlg == TPM_ALG_SHA256) {
+		extendSize[i] = SHA256_DIGEST_SIZE;
+	    }
+	    else {
+		printf("ERROR: IMA_ExtendBatch: Unsupported hash algorithm: %04x\n",
+		       imapcr[start + i]->hashAlg);
+		rc = ERR_HASH_ALGORITHM;
+	    }
+	}
+	if (rc == 0) {
+	    rc = TSS_Hash_ExtendBatch(imapcr + start, extendPtr, extendSize, batch);
+	    if (rc != 0) {
+		printf("ERROR: IMA_ExtendBatch: could not extend imapcr, rc %08x\n", rc);
+	    }
+	}
+    }
+    return rc;
+}
+
 /* IMA_VerifyImaDigest() verifies the IMA digest against the hash of the template data.
 
    This handles the SHA-1 IMA event log.
@@ -900,6 +1165,555 @@ uint32_t IMA_VerifyImaDigest(uint32_t *badEvent, /* TRUE if hash does not match
     return rc;
 }
 
+/* IMA_Checkpoint_Init() initializes a checkpoint to the start of an event log, with PCR 10 reset
+   to zero */
+
+void IMA_Checkpoint_Init(ImaCheckpoint *imaCheckpoint)
+{
+    imaCheckpoint->offset = 0;
+    imaCheckpoint->eventCount = 0;
+    imaCheckpoint->imapcr[0].hashAlg = TPM_ALG_SHA1;
+    imaCheckpoint->imapcr[1].hashAlg = TPM_ALG_SHA256;
+    memset((uint8_t *)&imaCheckpoint->imapcr[0].digest, 0, sizeof(TPMU_HA));
+    memset((uint8_t *)&imaCheckpoint->imapcr[1].digest, 0, sizeof(TPMU_HA));
+    imaCheckpoint->lastOffset = 0;
+    memset(imaCheckpoint->lastDigest, 0, SHA1_DIGEST_SIZE);
+    return;
+}
+
+/* IMA_Checkpoint_Resume() sets the iterator to the next event after the checkpoint.
+
+   The checkpoint PCR 10 values must be the SHA-1 and SHA-256 banks that the events are extended
+   into, otherwise they cannot describe the log.
+
+   Unless the checkpoint is at the start of the log, the last processed event is read again and
+   must end at the checkpoint offset and have the recorded IMA digest.  Otherwise the log was
+   truncated, rotated, or replaced, and resuming would extend the new events onto PCR values that
+   do not describe it.
+*/
+
+uint32_t IMA_Checkpoint_Resume(ImaCheckpoint *imaCheckpoint,
+			       ImaEventIterator *imaEventIterator)
+{
+    uint32_t 		rc = 0;
+    ImaEvent 		*imaEvent = NULL;
+    int 		endOfFile = FALSE;
+
+    if (rc == 0) {
+	if ((imaCheckpoint->imapcr[0].hashAlg != TPM_ALG_SHA1) ||
+	    (imaCheckpoint->imapcr[1].hashAlg != TPM_ALG_SHA256)) {
+	    printf("ERROR: IMA_Checkpoint_Resume: checkpoint PCR hash algorithms %04x %04x "
+		   "do not match the sha1 and sha256 banks\n",
+		   imaCheckpoint->imapcr[0].hashAlg, imaCheckpoint->imapcr[1].hashAlg);
+	    rc = TPM_RC_HASH;
+	}
+    }
+    if ((rc == 0) && (imaCheckpoint->eventCount != 0)) {
+	rc = IMA_EventIterator_Seek(imaEventIterator, imaCheckpoint->lastOffset);
+	if (rc == 0) {
+	    rc = IMA_EventIterator_Next(imaEventIterator, &imaEvent, &endOfFile);
+	}
+	if (rc == 0) {
+	    if (endOfFile ||
+		(IMA_EventIterator_Tell(imaEventIterator) != imaCheckpoint->offset) ||
+		(memcmp(imaEvent->digest, imaCheckpoint->lastDigest, SHA1_DIGEST_SIZE) != 0)) {
+		printf("ERROR: IMA_Checkpoint_Resume: event %u at offset %llu "
+		       "does not match the checkpoint\n",
+		       imaCheckpoint->eventCount - 1,
+		       (unsigned long long)imaCheckpoint->lastOffset);
+		rc = ERR_STRUCTURE;
+	    }
+	}
+    }
+    if (rc == 0) {
+	rc = IMA_EventIterator_Seek(imaEventIterator, imaCheckpoint->offset);
+    }
+    return rc;
+}
+
+/* IMA_Checkpoint_Extend() resumes at the checkpoint and extends each remaining event in the log
+   into the checkpoint PCR 10 values.  On return, the checkpoint is at the end of the log.
+
+   If verifyThreads is not zero, the template data hash of each event with a non-zero digest is
+   verified first.  On a mismatch, badEvent is set to TRUE and the checkpoint is left at that
+   event.  With more than one thread, the template data hashes are verified in parallel while the
+   calling thread extends the PCR values.
+
+   The caller should store the updated checkpoint only after the PCR values match a quote.
+*/
+
+uint32_t IMA_Checkpoint_Extend(ImaCheckpoint *imaCheckpoint,
+			       ImaEventIterator *imaEventIterator,
+			       unsigned int verifyThreads,
+			       uint32_t *badEvent)
+{
+    uint32_t 		rc = 0;
+    ImaEvent 		*imaEvent = NULL;
+    int 		endOfFile = FALSE;
+    uint64_t		eventOffset;
+    unsigned char 	zeroDigest[SHA1_DIGEST_SIZE];
+
+    *badEvent = FALSE;
+    memset(zeroDigest, 0, SHA1_DIGEST_SIZE);
+    /* without verification, the events can be extended in batches, which resumes each log */
+    if ((rc == 0) && (verifyThreads == 0)) {
+	rc = IMA_Checkpoint_ExtendLogs(imaCheckpoint, imaEventIterator, 1);
+	endOfFile = TRUE;	/* skip the serial loop */
+    }
+    /* skip the events already processed */
+    if ((rc == 0) && (verifyThreads != 0)) {
+	rc = IMA_Checkpoint_Resume(imaCheckpoint, imaEventIterator);
+    }
+#ifdef TPM_POSIX
+    if ((rc == 0) && (verifyThreads > 1)) {
+	rc = IMA_Checkpoint_ExtendParallel(imaCheckpoint, imaEventIterator,
+					   verifyThreads, badEvent);
+	endOfFile = TRUE;	/* skip the serial loop */
+    }
+#endif
+    while ((rc == 0) && !endOfFile && !*badEvent) {
+	if (rc == 0) {
+	    eventOffset = IMA_EventIterator_Tell(imaEventIterator);
+	    rc = IMA_EventIterator_Next(imaEventIterator, &imaEvent, &endOfFile);
+	}
+	if ((rc == 0) && !endOfFile && (verifyThreads != 0)) {
+	    if (memcmp(imaEvent->digest, zeroDigest, SHA1_DIGEST_SIZE) != 0) {
+		rc = IMA_VerifyImaDigest(badEvent, imaEvent, imaCheckpoint->eventCount);
+	    }
+	}
+	if ((rc == 0) && !endOfFile && !*badEvent) {
+	    rc = IMA_Extend(&imaCheckpoint->imapcr[0], imaEvent, TPM_ALG_SHA1);
+	}
+	if ((rc == 0) && !endOfFile && !*badEvent) {
+	    rc = IMA_Extend(&imaCheckpoint->imapcr[1], imaEvent, TPM_ALG_SHA256);
+	}
+	if ((rc == 0) && !endOfFile && !*badEvent) {
+	    imaCheckpoint->offset = IMA_EventIterator_Tell(imaEventIterator);
+	    imaCheckpoint->eventCount++;
+	    imaCheckpoint->lastOffset = eventOffset;
+	    memcpy(imaCheckpoint->lastDigest, imaEvent->digest, SHA1_DIGEST_SIZE);
+	}
+    }
+    return rc;
+}
+
+/* IMA_Checkpoint_ExtendLogs() replays logs independent event logs, such as those of a fleet of
+   attested machines, each from its own checkpoint to the end of its log.  There is no template
+   data verification.
+
+   The logs are read round robin, a slice of events from each, and each round is extended with
+   IMA_ExtendBatch(), one call per bank.
+*/
+
+uint32_t IMA_Checkpoint_ExtendLogs(ImaCheckpoint imaCheckpoint[],
+				   ImaEventIterator imaEventIterator[],
+				   size_t logs)
+{
+    uint32_t 		rc = 0;
+    ImaEvent 		*imaEvent = NULL;
+    int 		endOfFile;
+    int			*endOfLog = NULL;	/* TRUE when the log has been read to the end */
+    uint32_t		*roundEvents = NULL;	/* events read from the log this round */
+    size_t		active = logs;		/* logs not at their end */
+    size_t		perLog;			/* events read from each log per round */
+    size_t		count;			/* events in the batch */
+    size_t		first;			/* first log in the batch */
+    size_t		log;
+    size_t		i;
+    uint64_t		eventOffset;
+    TPMT_HA 		*imapcrSha1[IMA_EXTEND_BATCH];
+    TPMT_HA 		*imapcrSha256[IMA_EXTEND_BATCH];
+    const uint8_t	*imaDigest[IMA_EXTEND_BATCH];
+    uint8_t		digests[IMA_EXTEND_BATCH][SHA1_DIGEST_SIZE];
+
+    if (rc == 0) {
+	endOfLog = malloc(logs * sizeof(int));
+	roundEvents = malloc(logs * sizeof(uint32_t));
+	if ((logs != 0) && ((endOfLog == NULL) || (roundEvents == NULL))) {
+	    printf("ERROR: IMA_Checkpoint_ExtendLogs: could not allocate %lu logs\n",
+		   (unsigned long)logs);
+	    rc = ERR_STRUCTURE;
+	}
+    }
+    /* skip the events already processed */
+    for (log = 0 ; (rc == 0) && (log < logs) ; log++) {
+	endOfLog[log] = FALSE;
+	rc = IMA_Checkpoint_Resume(&imaCheckpoint[log], &imaEventIterator[log]);
+    }
+    perLog = IMA_EXTEND_BATCH / ((logs != 0) ? logs : 1);
+    if (perLog == 0) {
+	perLog = 1;
+    }
+    while ((rc == 0) && (active > 0)) {
+	count = 0;
+	first = 0;
+	for (log = 0 ; (rc == 0) && (log <= logs) ; log++) {
+	    /* extend the batch when it is full or at the end of the round, then advance the
+	       checkpoints of the logs in the batch */
+	    if ((log == logs) || ((count + perLog) > IMA_EXTEND_BATCH)) {
+		if (rc == 0) {
+		    rc = IMA_ExtendBatch(imapcrSha1, imaDigest, count);
+		}
+		if (rc == 0) {
+		    rc = IMA_ExtendBatch(imapcrSha256, imaDigest, count);
+		}
+		for ( ; (rc == 0) && (first < log) ; first++) {
+		    imaCheckpoint[first].offset =
+			IMA_EventIterator_Tell(&imaEventIterator[first]);
+		    imaCheckpoint[first].eventCount += roundEvents[first];
+		}
+		count = 0;
+	    }
+	    if (log == logs) {
+		break;
+	    }
+	    roundEvents[log] = 0;
+	    for (i = 0 ; (rc == 0) && !endOfLog[log] && (i < perLog) ; i++) {
+		eventOffset = IMA_EventIterator_Tell(&imaEventIterator[log]);
+		rc = IMA_EventIterator_Next(&imaEventIterator[log], &imaEvent, &endOfFile);
+		if ((rc == 0) && endOfFile) {
+		    endOfLog[log] = TRUE;
+		    active--;
+		}
+		else if (rc == 0) {
+		    /* the checkpoint is only stored after a successful return, so the last event
+		       can be recorded before its batch is extended */
+		    imaCheckpoint[log].lastOffset = eventOffset;
+		    memcpy(imaCheckpoint[log].lastDigest, imaEvent->digest, SHA1_DIGEST_SIZE);
+		    memcpy(digests[count], imaEvent->digest, SHA1_DIGEST_SIZE);
+		    imaDigest[count] = digests[count];
+		    imapcrSha1[count] = &imaCheckpoint[log].imapcr[0];
+		    imapcrSha256[count] = &imaCheckpoint[log].imapcr[1];
+		    count++;
+		    roundEvents[log]++;
+		}
+	    }
+	}
+    }
+    free(endOfLog);
+    free(roundEvents);
+    return rc;
+}
+
+#ifdef TPM_POSIX
+
+#define IMA_VERIFY_BATCH	4096	/* events read and verified per batch */
+#define IMA_VERIFY_CHUNK	64	/* events claimed by a verify thread at a time */
+
+/* ImaDigestJob is the template data hash verification of one event */
+
+typedef struct ImaDigestJob {
+    uint8_t digest[SHA1_DIGEST_SIZE];		/* IMA event digest */
+    uint32_t template_data_len;
+    const uint8_t *template_data;		/* points into the event log */
+    uint64_t offset;				/* file offset of the event */
+    uint64_t nextOffset;			/* file offset after the event */
+    uint32_t bad;				/* TRUE if the digest does not match */
+} ImaDigestJob;
+
+/* ImaVerifyPool is the state shared between IMA_Checkpoint_ExtendParallel() and the verify
+   threads.  The jobs for one batch are claimed in chunks under the mutex. */
+
+typedef struct ImaVerifyPool {
+    pthread_mutex_t mutex;
+    pthread_cond_t workCond;			/* a batch is ready, or shutdown */
+    pthread_cond_t doneCond;			/* the batch is verified */
+    ImaDigestJob *jobs;
+    size_t jobCount;				/* jobs in the batch */
+    size_t nextJob;				/* next job not yet claimed */
+    size_t doneJobs;				/* jobs completed */
+    int shutdown;
+    uint32_t rc;				/* first hash failure */
+} ImaVerifyPool;
+
+/* IMA_Checkpoint_ExtendParallel() is IMA_Checkpoint_Extend() with verifyThreads verifying the
+   template data hashes.
+
+   Events are read in batches.  While the threads verify a batch, the calling thread folds the
+   batch into a copy of the PCR values.  The copy is committed if the whole batch verifies.
+   Otherwise, the PCR values are folded again from the start of the batch up to the bad event.
+*/
+
+static uint32_t IMA_Checkpoint_ExtendParallel(ImaCheckpoint *imaCheckpoint,
+					      ImaEventIterator *imaEventIterator,
+					      unsigned int verifyThreads,
+					      uint32_t *badEvent)
+{
+    uint32_t 		rc = 0;
+    int 		irc;
+    ImaVerifyPool	pool;
+    pthread_t		*threads = NULL;
+    unsigned int	threadCount = 0;	/* threads started */
+    ImaEvent 		*imaEvent = NULL;
+    TPMT_HA 		imapcr[2];		/* PCR values for the batch */
+    TPMT_HA 		**foldSha1 = NULL;	/* IMA_ExtendBatch() arguments for the batch */
+    TPMT_HA 		**foldSha256 = NULL;
+    const uint8_t	**foldDigest = NULL;
+    int 		endOfFile = FALSE;
+    size_t		i;
+    size_t		goodJobs;
+
+    pool.jobs = NULL;
+    pool.jobCount = 0;
+    pool.nextJob = 0;
+    pool.doneJobs = 0;
+    pool.shutdown = FALSE;
+    pool.rc = 0;
+    pthread_mutex_init(&pool.mutex, NULL);
+    pthread_cond_init(&pool.workCond, NULL);
+    pthread_cond_init(&pool.doneCond, NULL);
+    if (rc == 0) {
+	pool.jobs = malloc(IMA_VERIFY_BATCH * sizeof(ImaDigestJob));
+	threads = malloc(verifyThreads * sizeof(pthread_t));
+	foldSha1 = malloc(IMA_VERIFY_BATCH * sizeof(TPMT_HA *));
+	foldSha256 = malloc(IMA_VERIFY_BATCH * sizeof(TPMT_HA *));
+	foldDigest = malloc(IMA_VERIFY_BATCH * sizeof(const uint8_t *));
+	if ((pool.jobs == NULL) || (threads == NULL) ||
+	    (foldSha1 == NULL) || (foldSha256 == NULL) || (foldDigest == NULL)) {
+	    printf("ERROR: IMA_Checkpoint_ExtendParallel: could not allocate %u threads\n",
+		   verifyThreads);
+	    rc = ERR_STRUCTURE;
+	}
+    }
+    /* every event of a batch folds into the same PCR values */
+    for (i = 0 ; (rc == 0) && (i < IMA_VERIFY_BATCH) ; i++) {
+	foldSha1[i] = &imapcr[0];
+	foldSha256[i] = &imapcr[1];
+	foldDigest[i] = pool.jobs[i].digest;
+    }
+    for ( ; (rc == 0) && (threadCount < verifyThreads) ; threadCount++) {
+	irc = pthread_create(&threads[threadCount], NULL, IMA_VerifyPool_Worker, &pool);
+	if (irc != 0) {
+	    printf("ERROR: IMA_Checkpoint_ExtendParallel: could not create thread, %d\n", irc);
+	    rc = ERR_STRUCTURE;
+	    break;
+	}
+    }
+    while ((rc == 0) && !endOfFile && !*badEvent) {
+	size_t jobCount;
+	/* read a batch of events */
+	for (jobCount = 0 ; (rc == 0) && !endOfFile && (jobCount < IMA_VERIFY_BATCH) ; ) {
+	    uint64_t eventOffset = IMA_EventIterator_Tell(imaEventIterator);
+	    rc = IMA_EventIterator_Next(imaEventIterator, &imaEvent, &endOfFile);
+	    if ((rc == 0) && !endOfFile) {
+		ImaDigestJob *job = &pool.jobs[jobCount];
+		memcpy(job->digest, imaEvent->digest, SHA1_DIGEST_SIZE);
+		job->offset = eventOffset;
+		job->template_data_len = imaEvent->template_data_len;
+		job->template_data = imaEvent->template_data;
+		job->nextOffset = IMA_EventIterator_Tell(imaEventIterator);
+		job->bad = FALSE;
+		jobCount++;
+	    }
+	}
+	if ((rc != 0) || (jobCount == 0)) {
+	    break;
+	}
+	/* start the verify threads on the batch */
+	pthread_mutex_lock(&pool.mutex);
+	pool.jobCount = jobCount;
+	pool.nextJob = 0;
+	pool.doneJobs = 0;
+	pthread_cond_broadcast(&pool.workCond);
+	pthread_mutex_unlock(&pool.mutex);
+	/* meanwhile, fold the extend chain */
+	imapcr[0] = imaCheckpoint->imapcr[0];
+	imapcr[1] = imaCheckpoint->imapcr[1];
+	rc = IMA_ExtendBatch(foldSha1, foldDigest, jobCount);
+	if (rc == 0) {
+	    rc = IMA_ExtendBatch(foldSha256, foldDigest, jobCount);
+	}
+	/* wait for the batch to be verified */
+	pthread_mutex_lock(&pool.mutex);
+	while (pool.doneJobs < pool.jobCount) {
+	    pthread_cond_wait(&pool.doneCond, &pool.mutex);
+	}
+	if (rc == 0) {
+	    rc = pool.rc;
+	}
+	pthread_mutex_unlock(&pool.mutex);
+	if (rc == 0) {
+	    for (goodJobs = 0 ; (goodJobs < jobCount) && !pool.jobs[goodJobs].bad ; goodJobs++);
+	    /* bad event, fold again up to the bad event */
+	    if (goodJobs != jobCount) {
+		printf("ERROR: IMA_Checkpoint_ExtendParallel: IMA digest did not verify, "
+		       "event %u\n", imaCheckpoint->eventCount + (uint32_t)goodJobs);
+		*badEvent = TRUE;
+		imapcr[0] = imaCheckpoint->imapcr[0];
+		imapcr[1] = imaCheckpoint->imapcr[1];
+		rc = IMA_ExtendBatch(foldSha1, foldDigest, goodJobs);
+		if (rc == 0) {
+		    rc = IMA_ExtendBatch(foldSha256, foldDigest, goodJobs);
+		}
+	    }
+	}
+	if (rc == 0) {
+	    imaCheckpoint->imapcr[0] = imapcr[0];
+	    imaCheckpoint->imapcr[1] = imapcr[1];
+	    if (goodJobs > 0) {
+		imaCheckpoint->offset = pool.jobs[goodJobs - 1].nextOffset;
+		imaCheckpoint->eventCount += (uint32_t)goodJobs;
+		imaCheckpoint->lastOffset = pool.jobs[goodJobs - 1].offset;
+		memcpy(imaCheckpoint->lastDigest, pool.jobs[goodJobs - 1].digest,
+		       SHA1_DIGEST_SIZE);
+	    }
+	}
+    }
+    /* stop the verify threads */
+    pthread_mutex_lock(&pool.mutex);
+    pool.shutdown = TRUE;
+    pthread_cond_broadcast(&pool.workCond);
+    pthread_mutex_unlock(&pool.mutex);
+    for (i = 0 ; i < threadCount ; i++) {
+	pthread_join(threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool.doneCond);
+    pthread_cond_destroy(&pool.workCond);
+    pthread_mutex_destroy(&pool.mutex);
+    free(threads);
+    free(pool.jobs);
+    free(foldSha1);
+    free(foldSha256);
+    free(foldDigest);
+    return rc;
+}
+
+/* IMA_VerifyPool_Worker() is the verify thread.  It claims chunks of the current batch and hashes
+   the template data of each event, skipping the all zero digests that IMA records for
+   violations. */
+
+static void *IMA_VerifyPool_Worker(void *arg)
+{
+    ImaVerifyPool 	*pool = arg;
+    unsigned char 	zeroDigest[SHA1_DIGEST_SIZE];
+    TPMT_HA 		calculatedImaDigest;
+    size_t		start;
+    size_t		end;
+    size_t		i;
+    uint32_t		rc;
+
+    memset(zeroDigest, 0, SHA1_DIGEST_SIZE);
+    pthread_mutex_lock(&pool->mutex);
+    while (TRUE) {
+	while (!pool->shutdown && (pool->nextJob >= pool->jobCount)) {
+	    pthread_cond_wait(&pool->workCond, &pool->mutex);
+	}
+	if (pool->shutdown) {
+	    break;
+	}
+	start = pool->nextJob;
+	end = start + IMA_VERIFY_CHUNK;
+	if (end > pool->jobCount) {
+	    end = pool->jobCount;
+	}
+	pool->nextJob = end;
+	pthread_mutex_unlock(&pool->mutex);
+
+	rc = 0;
+	for (i = start ; (rc == 0) && (i < end) ; i++) {
+	    ImaDigestJob *job = &pool->jobs[i];
+	    if (memcmp(job->digest, zeroDigest, SHA1_DIGEST_SIZE) != 0) {
+		calculatedImaDigest.hashAlg = TPM_ALG_SHA1;
+		rc = TSS_Hash_Generate(&calculatedImaDigest,
+				       job->template_data_len, job->template_data,
+				       0, NULL);
+		if (rc == 0) {
+		    job->bad = (memcmp(job->digest, &calculatedImaDigest.digest,
+				       SHA1_DIGEST_SIZE) != 0);
+		}
+	    }
+	}
+	pthread_mutex_lock(&pool->mutex);
+	if ((rc != 0) && (pool->rc == 0)) {
+	    pool->rc = rc;
+	}
+	pool->doneJobs += end - start;
+	if (pool->doneJobs == pool->jobCount) {
+	    pthread_cond_signal(&pool->doneCond);
+	}
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+#endif	/* TPM_POSIX */
+
+/* ImaCheckpoint_Marshal() marshals the checkpoint, for TSS_File_WriteStructure() */
+
+TPM_RC ImaCheckpoint_Marshal(ImaCheckpoint *source,
+			     uint16_t *written, uint8_t **buffer, int32_t *size)
+{
+    TPM_RC 	rc = 0;
+    uint32_t	version = IMA_CHECKPOINT_VERSION;
+
+    if (rc == 0) {
+	rc = TSS_UINT32_Marshal(&version, written, buffer, size);
+    }
+    if (rc == 0) {
+	rc = TSS_UINT64_Marshal(&source->offset, written, buffer, size);
+    }
+    if (rc == 0) {
+	rc = TSS_UINT32_Marshal(&source->eventCount, written, buffer, size);
+    }
+    if (rc == 0) {
+	rc = TSS_TPMT_HA_Marshal(&source->imapcr[0], written, buffer, size);
+    }
+    if (rc == 0) {
+	rc = TSS_TPMT_HA_Marshal(&source->imapcr[1], written, buffer, size);
+    }
+    if (rc == 0) {
+	rc = TSS_UINT64_Marshal(&source->lastOffset, written, buffer, size);
+    }
+    if (rc == 0) {
+	rc = TSS_Array_Marshal(source->lastDigest, SHA1_DIGEST_SIZE, written, buffer, size);
+    }
+    return rc;
+}
+
+/* ImaCheckpoint_Unmarshal() unmarshals the checkpoint, for TSS_File_ReadStructure() */
+
+TPM_RC ImaCheckpoint_Unmarshal(ImaCheckpoint *target, uint8_t **buffer, int32_t *size)
+{
+    TPM_RC 	rc = 0;
+    uint32_t	version;
+
+    if (rc == 0) {
+	rc = UINT32_Unmarshal(&version, buffer, size);
+    }
+    if (rc == 0) {
+	if (version != IMA_CHECKPOINT_VERSION) {
+	    printf("ERROR: ImaCheckpoint_Unmarshal: unsupported version %u\n", version);
+	    rc = TPM_RC_VALUE;
+	}
+    }
+    if (rc == 0) {
+	rc = UINT64_Unmarshal(&target->offset, buffer, size);
+    }
+    if (rc == 0) {
+	rc = UINT32_Unmarshal(&target->eventCount, buffer, size);
+    }
+    if (rc == 0) {
+	rc = TPMT_HA_Unmarshal(&target->imapcr[0], buffer, size, NO);
+    }
+    if (rc == 0) {
+	rc = TPMT_HA_Unmarshal(&target->imapcr[1], buffer, size, NO);
+    }
+    if (rc == 0) {
+	rc = UINT64_Unmarshal(&target->lastOffset, buffer, size);
+    }
+    if (rc == 0) {
+	rc = Array_Unmarshal(target->lastDigest, SHA1_DIGEST_SIZE, buffer, size);
+    }
+    if (rc == 0) {
+	if ((target->imapcr[0].hashAlg != TPM_ALG_SHA1) ||
+	    (target->imapcr[1].hashAlg != TPM_ALG_SHA256)) {
+	    printf("ERROR: ImaCheckpoint_Unmarshal: unexpected PCR hash algorithms\n");
+	    rc = TPM_RC_HASH;
+	}
+    }
+    return rc;
+}
+
 /* IMA_Uint32_Convert() converts a uint8_t (from an input stream) to host byte order
  */
 
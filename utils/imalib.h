@@ -47,6 +47,9 @@
 
 #include <sys/param.h>
 
+#ifndef TPM_TSS
+#define TPM_TSS
+#endif
 #include <tss2/TPM_Types.h>
 
 #define IMA_PCR 		10
@@ -55,6 +58,7 @@
 
 #define ERR_STRUCTURE  		1 	/* this is not the stream for the structure to be parsed */
 #define ERR_HASH_ALGORITHM	2 	/* unsupported hash algorithm */
+#define ERR_FILE		3 	/* the event log could not be mapped or read */
 #define TCG_EVENT_NAME_LEN_MAX	255	/* FIXME need verification */
 
 #define TCG_TEMPLATE_DATA_LEN_MAX				\
@@ -116,6 +120,34 @@ typedef struct ImaEvent {
     uint8_t *template_data;			/* template related data */
 } ImaEvent;
 
+/* ImaEventIterator walks an IMA event log in memory, either mapped from a file or read from a
+   stream, without copying or allocating per event */
+
+typedef struct ImaEventIterator {
+    uint8_t *log;				/* start of the log */
+    size_t logLength;				/* bytes in the log */
+    size_t logOffset;				/* file offset of the start of the log */
+    uint8_t *next;				/* next event to parse */
+    size_t length;				/* bytes remaining after next */
+    int mapped;					/* TRUE if mapped, FALSE if malloced */
+    int littleEndian;
+    ImaEvent imaEvent;				/* current event */
+} ImaEventIterator;
+
+/* ImaCheckpoint records how far an IMA event log has been processed, so that verification of a
+   growing log can resume with the new events.  The last processed event is recorded so that a
+   resume can check that the log still holds it. */
+
+#define IMA_CHECKPOINT_VERSION	2
+
+typedef struct ImaCheckpoint {
+    uint64_t offset;				/* file offset of the next event */
+    uint32_t eventCount;			/* events processed */
+    TPMT_HA imapcr[2];				/* PCR 10, SHA-1 and SHA-256 banks */
+    uint64_t lastOffset;			/* file offset of the last processed event */
+    uint8_t lastDigest[SHA1_DIGEST_SIZE];	/* IMA digest of the last processed event */
+} ImaCheckpoint;
+
 typedef struct ImaTemplateData {
     uint32_t hashLength;
     char hashAlg[64+1];		/* FIXME need verification */
@@ -150,6 +182,16 @@ extern "C" {
 				  int *endOfBuffer,
 				  int littleEndian,
 				  int getTemplate);
+    uint32_t IMA_EventIterator_Open(ImaEventIterator *imaEventIterator,
+				    FILE *inFile,
+				    int littleEndian);
+    uint32_t IMA_EventIterator_Next(ImaEventIterator *imaEventIterator,
+				    ImaEvent **imaEvent,
+				    int *endOfFile);
+    void IMA_EventIterator_Close(ImaEventIterator *imaEventIterator);
+    uint64_t IMA_EventIterator_Tell(ImaEventIterator *imaEventIterator);
+    uint32_t IMA_EventIterator_Seek(ImaEventIterator *imaEventIterator,
+				    uint64_t offset);
     uint32_t IMA_TemplateData_ReadBuffer(ImaTemplateData *imaTemplateData,
 					 ImaEvent *imaEvent,
 					 int littleEndian);
@@ -158,11 +200,27 @@ extern "C" {
     uint32_t IMA_Extend(TPMT_HA *imapcr,
 			ImaEvent *imaEvent,
 			TPMI_ALG_HASH hashAlg);
+    uint32_t IMA_ExtendBatch(TPMT_HA *imapcr[],
+			     const uint8_t *imaDigest[],
+			     size_t count);
     uint32_t IMA_VerifyImaDigest(uint32_t *badEvent,
 				 ImaEvent *imaEvent,
 				 int eventNum);
     TPM_RC ImaEvent_Marshal(ImaEvent *source,
 			    uint16_t *written, uint8_t **buffer, int32_t *size);
+    void IMA_Checkpoint_Init(ImaCheckpoint *imaCheckpoint);
+    uint32_t IMA_Checkpoint_Resume(ImaCheckpoint *imaCheckpoint,
+				   ImaEventIterator *imaEventIterator);
+    uint32_t IMA_Checkpoint_Extend(ImaCheckpoint *imaCheckpoint,
+				   ImaEventIterator *imaEventIterator,
+				   unsigned int verifyThreads,
+				   uint32_t *badEvent);
+    uint32_t IMA_Checkpoint_ExtendLogs(ImaCheckpoint imaCheckpoint[],
+				       ImaEventIterator imaEventIterator[],
+				       size_t logs);
+    TPM_RC ImaCheckpoint_Marshal(ImaCheckpoint *source,
+				 uint16_t *written, uint8_t **buffer, int32_t *size);
+    TPM_RC ImaCheckpoint_Unmarshal(ImaCheckpoint *target, uint8_t **buffer, int32_t *size);
 
 #if 0
     uint32_t IMA_Event_ToString(char **eventString,
@@ -91,7 +91,8 @@ ALL =
 
 TSS_OBJS = 	tssfile.o 		\
 		tsscryptoh.o 		\
-		tsscrypto.o
+		tsscrypto.o		\
+		tsspolicy.o
 
 # common to all builds
 
@@ -127,6 +128,8 @@ tsscryptoh.o: 	$(TSS_HEADERS) tsscryptoh.c
 		$(CC) $(CCFLAGS) $(CCLFLAGS) tsscryptoh.c
 tsscrypto.o: 	$(TSS_HEADERS) tsscrypto.c
 		$(CC) $(CCFLAGS) $(CCLFLAGS) tsscrypto.c
+tsspolicy.o: 	$(TSS_HEADERS) tsspolicy.c
+		$(CC) $(CCFLAGS) $(CCLFLAGS) tsspolicy.c
 tssutils.o: 	$(TSS_HEADERS) tssutils.c
 		$(CC) $(CCFLAGS) $(CCLFLAGS) tssutils.c
 tssfile.o: 	$(TSS_HEADERS) tssfile.c
@@ -215,6 +218,9 @@ writeapp.exe:	writeapp.o ekutils.o cryptoutils.o $(LIBTSS)
 pprovision.exe:	pprovision.o ekutils.o cryptoutils.o $(LIBTSS) 
 		$(CC) $(LNFLAGS) -L. -ltss $< -o $@ applink.o ekutils.o cryptoutils.o $(LNLIBS) $(LIBTSS)
 
+tssbatch.exe:	tssbatch.o objecttemplates.o cryptoutils.o ekutils.o $(LIBTSS)
+		$(CC) $(LNFLAGS) -L. -ltss $< -o $@ applink.o objecttemplates.o cryptoutils.o ekutils.o $(LNLIBS) $(LIBTSS)
+
 %.exe:		%.o applink.o $(LIBTSS)
 		$(CC) $(LNFLAGS) -L. -ltss $< -o $@ applink.o $(LNLIBS) $(LIBTSS)
 
@@ -49,7 +49,6 @@
 #include <tss2/tss.h>
 #include <tss2/tssutils.h>
 #include <tss2/tssresponsecode.h>
-#include "ekutils.h"
 
 static void printUsage(void);
 
@@ -60,8 +59,7 @@ int main(int argc, char *argv[])
     TPM_RC			rc = 0;
     int				i;    /* argc iterator */
     TSS_CONTEXT			*tssContext = NULL;
-    NV_Read_In 			in;
-    NV_Read_Out			out;
+    TPMI_RH_NV_AUTH		authHandle = 0;
     uint16_t 			offset = 0;			/* default 0 */
     uint16_t 			readLength = 0;			/* bytes to read */
     char 			hierarchyAuthChar = 0;
@@ -75,9 +73,6 @@ int main(int argc, char *argv[])
     TPMI_SH_AUTH_SESSION    	sessionHandle2 = TPM_RH_NULL;
     unsigned int		sessionAttributes2 = 0;
     unsigned char 		*readBuffer = NULL; 
-    uint32_t 			nvBufferMax;
-    uint16_t 			bytesRead;			/* bytes read so far */
-    int				done = FALSE;
    
     setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
     TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
@@ -228,13 +223,13 @@ int main(int argc, char *argv[])
     /* Authorization handle */
     if (rc == 0) {
 	if (hierarchyAuthChar == 'o') {
-	    in.authHandle = TPM_RH_OWNER;  
+	    authHandle = TPM_RH_OWNER;  
 	}
 	else if (hierarchyAuthChar == 'p') {
-	    in.authHandle = TPM_RH_PLATFORM;  
+	    authHandle = TPM_RH_PLATFORM;  
 	}
 	else if (hierarchyAuthChar == 0) {
-	    in.authHandle = nvIndex;
+	    authHandle = nvIndex;
 	}
 	else {
 	    printf("\n");
@@ -257,48 +252,16 @@ int main(int argc, char *argv[])
     if (rc == 0) {
 	rc = TSS_Create(&tssContext);
     }
-    /* data may have to be read in chunks.  Read the TPM_PT_NV_BUFFER_MAX, the chunk size */
+    /* data may have to be read in chunks, the TSS keeps the sessions resident between chunks */
     if (rc == 0) {
-	rc = readNvBufferMax(tssContext,
-			     &nvBufferMax);
-    }    
-    if (rc == 0) {
-	in.nvIndex = nvIndex;
-	in.offset = offset;	/* start at supplied offset */
-	bytesRead = 0;		/* bytes read so far */
-    }
-    /* call TSS to execute the command */
-    while ((rc == 0) && !done) {
-	if (rc == 0) {
-	    /* read a chunk */
-	    in.offset = offset + bytesRead;
-	    if ((uint32_t)(readLength - bytesRead) < nvBufferMax) {
-		in.size = readLength - bytesRead;	/* last chunk */
-	    }
-	    else {
-		in.size = nvBufferMax;		/* next chunk */
-	    }
-	}
-	if (rc == 0) {
-	    if (verbose) printf("nvread: reading %u bytes\n", in.size);
-	    rc = TSS_Execute(tssContext,
-			     (RESPONSE_PARAMETERS *)&out,
-			     (COMMAND_PARAMETERS *)&in,
-			     NULL,
-			     TPM_CC_NV_Read,
-			     sessionHandle0, nvPassword, sessionAttributes0,
-			     sessionHandle1, NULL, sessionAttributes1,
-			     sessionHandle2, NULL, sessionAttributes2,
-			     TPM_RH_NULL, NULL, 0);
-	}
-	/* copy the results to the read buffer */
-	if (rc == 0) {
-	    memcpy(readBuffer + bytesRead, out.data.b.buffer, out.data.b.size);
-	    bytesRead += out.data.b.size;
-	    if (bytesRead == readLength) {
-		done = TRUE;
-	    }
-	}
+	if (verbose) printf("nvread: reading %u bytes\n", readLength);
+	rc = TSS_NV_Read(tssContext,
+			 readBuffer, readLength,
+			 authHandle, nvIndex, offset,
+			 sessionHandle0, nvPassword, sessionAttributes0,
+			 sessionHandle1, NULL, sessionAttributes1,
+			 sessionHandle2, NULL, sessionAttributes2,
+			 TPM_RH_NULL, NULL, 0);
     }
     {
 	TPM_RC rc1 = TSS_Delete(tssContext);
@@ -87,8 +87,6 @@ int main(int argc, char *argv[])
     uint32_t 			nvBufferMax;
     size_t 			writeLength;		/* file bytes to write */
     unsigned char 		*writeBuffer = NULL; 	/* file buffer to write */
-    uint16_t 			bytesWritten;		/* bytes written so far */
-    int				done = FALSE;
  
     setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
     TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
@@ -314,50 +312,38 @@ int main(int argc, char *argv[])
     if (rc == 0) {
 	in.nvIndex = nvIndex;
 	in.offset = offset;		/* beginning offset */
-	bytesWritten = 0;
     }
-    while ((rc == 0) && !done) {
-	uint16_t writeBytes;		/* bytes to write in this pass */
-	if (rc == 0) {
-	    /* for data from file, write a chunk */
-	    if (datafilename != NULL) {
-		in.offset = offset + bytesWritten;
-		if ((uint32_t)(writeLength - bytesWritten) < nvBufferMax) {
-		    writeBytes = writeLength - bytesWritten;	/* last chunk */
-		}
-		else {
-		    writeBytes = nvBufferMax;	/* next chunk */
-		}
-		rc = TSS_TPM2B_Create(&in.data.b, writeBuffer + bytesWritten, writeBytes,
-				      MAX_NV_BUFFER_SIZE);
-	    }
-	}
-	/* call TSS to execute the command */
-	if (rc == 0) {
-	    if (verbose) printf("nvwrite: writing %u bytes\n", in.data.b.size);
-	    rc = TSS_Execute(tssContext,
-			     NULL,
-			     (COMMAND_PARAMETERS *)&in,
-			     NULL,
-			     TPM_CC_NV_Write,
-			     sessionHandle0, nvPassword, sessionAttributes0,
-			     sessionHandle1, NULL, sessionAttributes1,
-			     sessionHandle2, NULL, sessionAttributes2,
-			     TPM_RH_NULL, NULL, 0);
+    /* -if, data file can be written in chunks, the TSS keeps the sessions resident between
+       chunks */
+    if ((rc == 0) && (datafilename != NULL)) {
+	if (writeLength > 0xffff) {
+	    printf("nvwrite: data file size %lu too large\n", (unsigned long)writeLength);
+	    rc = TSS_RC_INSUFFICIENT_BUFFER;
 	}
-	/* data file can be written in chunks, other options are single write */
 	if (rc == 0) {
-	    if (datafilename == NULL) {
-		done = TRUE;
-	    }
-	    else {
-		bytesWritten += writeBytes;
-		if (bytesWritten == writeLength) {
-		    done = TRUE;
-		}
-	    }
+	    if (verbose) printf("nvwrite: writing %lu bytes\n", (unsigned long)writeLength);
+	    rc = TSS_NV_Write(tssContext,
+			      writeBuffer, (uint32_t)writeLength,
+			      in.authHandle, nvIndex, offset,
+			      sessionHandle0, nvPassword, sessionAttributes0,
+			      sessionHandle1, NULL, sessionAttributes1,
+			      sessionHandle2, NULL, sessionAttributes2,
+			      TPM_RH_NULL, NULL, 0);
 	}
     }
+    /* other options are single write */
+    else if (rc == 0) {
+	if (verbose) printf("nvwrite: writing %u bytes\n", in.data.b.size);
+	rc = TSS_Execute(tssContext,
+			 NULL,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_NV_Write,
+			 sessionHandle0, nvPassword, sessionAttributes0,
+			 sessionHandle1, NULL, sessionAttributes1,
+			 sessionHandle2, NULL, sessionAttributes2,
+			 TPM_RH_NULL, NULL, 0);
+    }
     {
 	TPM_RC rc1 = TSS_Delete(tssContext);
 	if (rc == 0) {
@@ -0,0 +1,517 @@
+/********************************************************************************/
+/*										*/
+/*			     Policy Compiler					*/
+/*			     Written by agent					*/
+/*	      $Id: policycompile.c $						*/
+/*										*/
+/* (c) Copyright agent 2026.							*/
+/*										*/
+/* All rights reserved.								*/
+/* 										*/
+/* Redistribution and use in source and binary forms, with or without		*/
+/* modification, are permitted provided that the following conditions are	*/
+/* met:										*/
+/* 										*/
+/* Redistributions of source code must retain the above copyright notice,	*/
+/* this list of conditions and the following disclaimer.			*/
+/* 										*/
+/* Redistributions in binary form must reproduce the above copyright		*/
+/* notice, this list of conditions and the following disclaimer in the		*/
+/* documentation and/or other materials provided with the distribution.		*/
+/* 										*/
+/* Neither the names of the IBM Corporation nor the names of its		*/
+/* contributors may be used to endorse or promote products derived from		*/
+/* this software without specific prior written permission.			*/
+/* 										*/
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		*/
+/* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		*/
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	*/
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		*/
+/* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	*/
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		*/
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	*/
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	*/
+/* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		*/
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	*/
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		*/
+/********************************************************************************/
+
+/*
+   policycompile compiles a policy description with TSS_Policy_Compile() and optionally satisfies
+   it in a policy session with TSS_Policy_Execute().
+
+   The policy description file has one policy assertion per line, ANDed in order.  Empty lines and
+   lines starting with # are ignored.
+
+   pcr halg pcr value			PolicyPCR, one PCR in the halg bank, value in hexascii
+   cc commandcode			PolicyCommandCode, hex
+   authvalue				PolicyAuthValue
+   password				PolicyPassword
+   locality locality			PolicyLocality, hex
+   nvwritten y|n			PolicyNvWritten
+   authorize keyname [policyref]	PolicyAuthorize, hexascii
+   secret handle name [password]	PolicySecret, handle hex, Name hexascii
+   or file file ...			PolicyOR of 2 to 8 policy description files
+
+   PolicyAuthorize cannot be executed, since it needs a signature over the approved policy.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <tss2/tss.h>
+#include <tss2/tssutils.h>
+#include <tss2/tssresponsecode.h>
+#include <tss2/tssprint.h>
+#include <tss2/tssfile.h>
+#include <tss2/tsspolicy.h>
+
+#define POLICY_LINE_MAX	4096
+
+static TPM_RC Policy_Read(TSS_POLICY **policy,
+			  const char *filename,
+			  unsigned int depth);
+static TPM_RC Policy_ParseLine(TSS_POLICY_TERM *term,
+			       char *line,
+			       unsigned int depth);
+static TPM_RC Policy_ScanHex(uint8_t *buffer,
+			     uint16_t *size,
+			     uint16_t sizeMax,
+			     const char *string);
+static TPM_RC Policy_ScanHashAlg(TPMI_ALG_HASH *halg,
+				 const char *string);
+static void Policy_Free(TSS_POLICY *policy);
+static void printUsage(void);
+
+int verbose = FALSE;
+
+int main(int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;    /* argc iterator */
+    TSS_CONTEXT			*tssContext = NULL;
+    const char			*policyFilename = NULL;
+    const char			*digestFilename = NULL;
+    TPMI_ALG_HASH		halg = TPM_ALG_SHA256;
+    TPMI_SH_POLICY		policySession = 0;
+    TPM_CC			commandCode = 0;
+    int				pr = FALSE;
+    TSS_POLICY			*policy = NULL;
+    TSS_POLICY_COMPILED		*compiled = NULL;
+    TPM2B_DIGEST		policyDigest;
+
+    setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
+    TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
+
+    /* command line argument defaults */
+
+    for (i=1 ; (i<argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-if") == 0) {
+	    i++;
+	    if (i < argc) {
+		policyFilename = argv[i];
+	    }
+	    else {
+		printf("-if option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-of") == 0) {
+	    i++;
+	    if (i < argc) {
+		digestFilename = argv[i];
+	    }
+	    else {
+		printf("-of option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-halg") == 0) {
+	    i++;
+	    if (i < argc) {
+		if (Policy_ScanHashAlg(&halg, argv[i]) != 0) {
+		    printf("Bad parameter %s for -halg\n", argv[i]);
+		    printUsage();
+		}
+	    }
+	    else {
+		printf("-halg option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-ha") == 0) {
+	    i++;
+	    if (i < argc) {
+		sscanf(argv[i],"%x", &policySession);
+	    }
+	    else {
+		printf("Missing parameter for -ha\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-cc") == 0) {
+	    i++;
+	    if (i < argc) {
+		sscanf(argv[i],"%x", &commandCode);
+	    }
+	    else {
+		printf("Missing parameter for -cc\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-pr") == 0) {
+	    pr = TRUE;
+	}
+	else if (strcmp(argv[i],"-h") == 0) {
+	    printUsage();
+	}
+	else if (strcmp(argv[i],"-v") == 0) {
+	    verbose = TRUE;
+	    TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "2");
+	}
+	else {
+	    printf("\n%s is not a valid option\n", argv[i]);
+	    printUsage();
+	}
+    }
+    if (policyFilename == NULL) {
+	printf("Missing policy description file parameter -if\n");
+	printUsage();
+    }
+    if (rc == 0) {
+	rc = Policy_Read(&policy, policyFilename, 0);
+    }
+    if (rc == 0) {
+	rc = TSS_Policy_Compile(&compiled, policy, &halg, 1);
+    }
+    if (rc == 0) {
+	if (verbose) TSS_Policy_Print(compiled);
+	rc = TSS_Policy_GetDigest(&policyDigest, compiled, halg);
+    }
+    if ((rc == 0) && (digestFilename != NULL)) {
+	rc = TSS_File_WriteBinaryFile(policyDigest.t.buffer,
+				      policyDigest.t.size,
+				      digestFilename);
+    }
+    if ((rc == 0) && pr) {
+	TSS_PrintAll("policy digest", policyDigest.t.buffer, policyDigest.t.size);
+    }
+    /* satisfy the policy in the policy session */
+    if ((rc == 0) && (policySession != 0)) {
+	rc = TSS_Create(&tssContext);
+	if (rc == 0) {
+	    rc = TSS_Policy_Execute(tssContext,
+				    policySession,
+				    compiled,
+				    halg,
+				    commandCode,
+				    NULL, NULL);
+	}
+	{
+	    TPM_RC rc1 = TSS_Delete(tssContext);
+	    if (rc == 0) {
+		rc = rc1;
+	    }
+	}
+    }
+    TSS_Policy_Free(compiled);
+    Policy_Free(policy);
+    if (rc == 0) {
+	if (verbose) printf("policycompile: success\n");
+    }
+    else {
+	const char *msg;
+	const char *submsg;
+	const char *num;
+	printf("policycompile: failed, rc %08x\n", rc);
+	TSS_ResponseCode_toString(&msg, &submsg, &num, rc);
+	printf("%s%s%s\n", msg, submsg, num);
+	rc = EXIT_FAILURE;
+    }
+    return rc;
+}
+
+/* Policy_Read() reads the policy description file into an allocated TSS_POLICY.  PolicyOR
+   branch files are read recursively, up to TSS_POLICY_DEPTH_MAX. */
+
+static TPM_RC Policy_Read(TSS_POLICY **policy,
+			  const char *filename,
+			  unsigned int depth)
+{
+    TPM_RC		rc = 0;
+    FILE		*inFile = NULL;
+    char		line[POLICY_LINE_MAX];
+    unsigned int	lineNumber = 0;
+    TSS_POLICY_TERM	*terms = NULL;
+    uint32_t		termCount = 0;
+
+    if (rc == 0) {
+	if (depth > TSS_POLICY_DEPTH_MAX) {
+	    printf("Policy_Read: Error, %s nests PolicyOR deeper than %u\n",
+		   filename, TSS_POLICY_DEPTH_MAX);
+	    rc = TSS_RC_BAD_POLICY;
+	}
+    }
+    if (rc == 0) {
+	rc = TSS_Malloc((unsigned char **)policy, sizeof(TSS_POLICY));
+    }
+    if (rc == 0) {
+	(*policy)->terms = NULL;
+	(*policy)->termCount = 0;
+	inFile = fopen(filename, "r");
+	if (inFile == NULL) {
+	    printf("Policy_Read: Error opening %s\n", filename);
+	    rc = TSS_RC_FILE_OPEN;
+	}
+    }
+    while ((rc == 0) && (fgets(line, sizeof(line), inFile) != NULL)) {
+	size_t length = strlen(line);
+	lineNumber++;
+	/* a line that fills the buffer without a newline was truncated */
+	if ((length == (sizeof(line) - 1)) && (line[length - 1] != '\n')) {
+	    printf("Policy_Read: Error, %s line %u is longer than %u bytes\n",
+		   filename, lineNumber, POLICY_LINE_MAX - 2);
+	    rc = TSS_RC_BAD_POLICY;
+	    break;
+	}
+	/* strip the line ending */
+	while ((length > 0) && ((line[length - 1] == '\n') || (line[length - 1] == '\r'))) {
+	    line[--length] = '\0';
+	}
+	if ((strspn(line, " \t") == length) || (line[0] == '#')) {
+	    continue;
+	}
+	rc = TSS_Realloc((unsigned char **)&terms, (termCount + 1) * sizeof(TSS_POLICY_TERM));
+	if (rc == 0) {
+	    /* link the terms now, so that Policy_Free() frees a partially parsed term */
+	    (*policy)->terms = terms;
+	    (*policy)->termCount = termCount + 1;
+	    memset(&terms[termCount], 0, sizeof(TSS_POLICY_TERM));
+	    rc = Policy_ParseLine(&terms[termCount], line, depth);
+	    termCount++;
+	}
+	if (rc != 0) {
+	    printf("Policy_Read: Error in %s line %u\n", filename, lineNumber);
+	}
+    }
+    if (inFile != NULL) {
+	fclose(inFile);
+    }
+    return rc;
+}
+
+/* Policy_ParseLine() parses one policy description line into term */
+
+static TPM_RC Policy_ParseLine(TSS_POLICY_TERM *term,
+			       char *line,
+			       unsigned int depth)
+{
+    TPM_RC		rc = 0;
+    const char		*keyword;
+    const char		*arg[TSS_POLICY_OR_MAX + 1];
+    unsigned int	argCount = 0;
+    unsigned int	pcr;
+    char		*token;
+
+    keyword = strtok(line, " \t");
+    while ((token = strtok(NULL, " \t")) != NULL) {
+	if (argCount == (sizeof(arg) / sizeof(arg[0]))) {
+	    printf("Policy_ParseLine: Error, too many arguments for %s\n", keyword);
+	    rc = TSS_RC_BAD_POLICY;
+	    break;
+	}
+	arg[argCount++] = token;
+    }
+    if (rc != 0) {
+	/* too many arguments */
+    }
+    else if ((strcmp(keyword, "pcr") == 0) && (argCount == 3)) {
+	uint8_t		*pcrValue = NULL;
+	size_t		pcrValueSize;
+	term->commandCode = TPM_CC_PolicyPCR;
+	term->pcrs.count = 1;
+	term->pcrs.pcrSelections[0].sizeofSelect = 3;
+	memset(term->pcrs.pcrSelections[0].pcrSelect, 0, PCR_SELECT_MAX);
+	rc = Policy_ScanHashAlg(&term->pcrs.pcrSelections[0].hash, arg[0]);
+	if (rc == 0) {
+	    if ((sscanf(arg[1], "%u", &pcr) != 1) || (pcr >= IMPLEMENTATION_PCR)) {
+		printf("Policy_ParseLine: Error, bad PCR %s\n", arg[1]);
+		rc = TSS_RC_BAD_POLICY;
+	    }
+	}
+	if (rc == 0) {
+	    term->pcrs.pcrSelections[0].pcrSelect[pcr / 8] = 1 << (pcr % 8);
+	    rc = TSS_Array_Scan(&pcrValue, &pcrValueSize, arg[2]);
+	}
+	if (rc == 0) {
+	    term->pcrValues = pcrValue;
+	    term->pcrValuesSize = (uint32_t)pcrValueSize;
+	}
+    }
+    else if ((strcmp(keyword, "cc") == 0) && (argCount == 1)) {
+	term->commandCode = TPM_CC_PolicyCommandCode;
+	sscanf(arg[0], "%x", &term->code);
+    }
+    else if ((strcmp(keyword, "authvalue") == 0) && (argCount == 0)) {
+	term->commandCode = TPM_CC_PolicyAuthValue;
+    }
+    else if ((strcmp(keyword, "password") == 0) && (argCount == 0)) {
+	term->commandCode = TPM_CC_PolicyPassword;
+    }
+    else if ((strcmp(keyword, "locality") == 0) && (argCount == 1)) {
+	unsigned int locality;
+	term->commandCode = TPM_CC_PolicyLocality;
+	sscanf(arg[0], "%x", &locality);
+	term->locality.val = (uint8_t)locality;
+    }
+    else if ((strcmp(keyword, "nvwritten") == 0) && (argCount == 1)) {
+	term->commandCode = TPM_CC_PolicyNvWritten;
+	term->writtenSet = (arg[0][0] == 'y') ? YES : NO;
+    }
+    else if ((strcmp(keyword, "authorize") == 0) && ((argCount == 1) || (argCount == 2))) {
+	term->commandCode = TPM_CC_PolicyAuthorize;
+	rc = Policy_ScanHex(term->name.t.name, &term->name.t.size,
+			    sizeof(term->name.t.name), arg[0]);
+	if ((rc == 0) && (argCount == 2)) {
+	    rc = Policy_ScanHex(term->policyRef.t.buffer, &term->policyRef.t.size,
+				sizeof(term->policyRef.t.buffer), arg[1]);
+	}
+    }
+    else if ((strcmp(keyword, "secret") == 0) && ((argCount == 2) || (argCount == 3))) {
+	term->commandCode = TPM_CC_PolicySecret;
+	sscanf(arg[0], "%x", &term->handle);
+	rc = Policy_ScanHex(term->name.t.name, &term->name.t.size,
+			    sizeof(term->name.t.name), arg[1]);
+	if ((rc == 0) && (argCount == 3)) {
+	    char *password = NULL;
+	    rc = TSS_Malloc((unsigned char **)&password, strlen(arg[2]) + 1);
+	    if (rc == 0) {
+		strcpy(password, arg[2]);
+		term->password = password;
+	    }
+	}
+    }
+    else if ((strcmp(keyword, "or") == 0) && (argCount >= 2) &&
+	     (argCount <= TSS_POLICY_OR_MAX)) {
+	unsigned int j;
+	term->commandCode = TPM_CC_PolicyOR;
+	for (j = 0 ; (rc == 0) && (j < argCount) ; j++) {
+	    TSS_POLICY *branch = NULL;
+	    rc = Policy_Read(&branch, arg[j], depth + 1);
+	    /* link even on error, so that Policy_Free() frees the partial branch */
+	    term->branch[j] = branch;
+	    term->branchCount = j + 1;
+	}
+    }
+    else {
+	printf("Policy_ParseLine: Error, bad assertion %s with %u arguments\n",
+	       keyword, argCount);
+	rc = TSS_RC_BAD_POLICY;
+    }
+    return rc;
+}
+
+/* Policy_ScanHex() converts the hexascii string to at most sizeMax bytes of binary */
+
+static TPM_RC Policy_ScanHex(uint8_t *buffer,
+			     uint16_t *size,
+			     uint16_t sizeMax,
+			     const char *string)
+{
+    TPM_RC		rc = 0;
+    unsigned char	*data = NULL;
+    size_t		length;
+
+    if (rc == 0) {
+	rc = TSS_Array_Scan(&data, &length, string);
+    }
+    if (rc == 0) {
+	if (length > sizeMax) {
+	    printf("Policy_ScanHex: Error, %s is longer than %u bytes\n", string, sizeMax);
+	    rc = TSS_RC_BAD_POLICY;
+	}
+    }
+    if (rc == 0) {
+	memcpy(buffer, data, length);
+	*size = (uint16_t)length;
+    }
+    free(data);
+    return rc;
+}
+
+/* Policy_ScanHashAlg() converts the hash algorithm name to the algorithm ID */
+
+static TPM_RC Policy_ScanHashAlg(TPMI_ALG_HASH *halg,
+				 const char *string)
+{
+    TPM_RC		rc = 0;
+
+    if (strcmp(string, "sha1") == 0) {
+	*halg = TPM_ALG_SHA1;
+    }
+    else if (strcmp(string, "sha256") == 0) {
+	*halg = TPM_ALG_SHA256;
+    }
+    else if (strcmp(string, "sha384") == 0) {
+	*halg = TPM_ALG_SHA384;
+    }
+    else {
+	printf("Policy_ScanHashAlg: Error, bad hash algorithm %s\n", string);
+	rc = TSS_RC_BAD_HASH_ALGORITHM;
+    }
+    return rc;
+}
+
+/* Policy_Free() frees a TSS_POLICY read by Policy_Read(), including its PolicyOR branches */
+
+static void Policy_Free(TSS_POLICY *policy)
+{
+    uint32_t		i;
+    uint32_t		j;
+    TSS_POLICY_TERM	*terms;
+
+    if (policy != NULL) {
+	terms = (TSS_POLICY_TERM *)policy->terms;
+	for (i = 0 ; i < policy->termCount ; i++) {
+	    free((uint8_t *)terms[i].pcrValues);
+	    free((char *)terms[i].password);
+	    for (j = 0 ; j < terms[i].branchCount ; j++) {
+		Policy_Free((TSS_POLICY *)terms[i].branch[j]);
+	    }
+	}
+	free(terms);
+	free(policy);
+    }
+    return;
+}
+
+static void printUsage(void)
+{
+    printf("\n");
+    printf("policycompile\n");
+    printf("\n");
+    printf("Compiles a policy description to a policy digest, and optionally satisfies\n");
+    printf("the policy in a policy session\n");
+    printf("\n");
+    printf("\t-if policy description file\n");
+    printf("\t[-halg (sha1, sha256, sha384) (default sha256)]\n");
+    printf("\t[-of policy digest file]\n");
+    printf("\t[-pr print policy digest]\n");
+    printf("\t[-ha policy session handle, satisfy the policy]\n");
+    printf("\t[-cc command code the session will authorize (default any)]\n");
+    printf("\n");
+    printf("Policy description lines, ANDed in order:\n");
+    printf("\n");
+    printf("\tpcr halg pcr value (hexascii)\n");
+    printf("\tcc commandcode\n");
+    printf("\tauthvalue\n");
+    printf("\tpassword\n");
+    printf("\tlocality locality\n");
+    printf("\tnvwritten y|n\n");
+    printf("\tauthorize keyname [policyref] (hexascii, compile only)\n");
+    printf("\tsecret handle name (hexascii) [password]\n");
+    printf("\tor file file ... (2 to 8 policy description files)\n");
+    exit(1);
+}
@@ -282,6 +282,27 @@ IF !ERRORLEVEL! NEQ 0 (
   exit /B 1
 )
 
+call regtests\testpolicycompile.bat
+IF !ERRORLEVEL! NEQ 0 (
+      echo ""
+      echo "Failed testpolicycompile.bat"
+  exit /B 1
+)
+
+call regtests\testbatch.bat
+IF !ERRORLEVEL! NEQ 0 (
+      echo ""
+      echo "Failed testbatch.bat"
+  exit /B 1
+)
+
+call regtests\testsessionpool.bat
+IF !ERRORLEVEL! NEQ 0 (
+      echo ""
+      echo "Failed testsessionpool.bat"
+  exit /B 1
+)
+
 call regtests\testshutdown.bat
 IF !ERRORLEVEL! NEQ 0 (
       echo ""
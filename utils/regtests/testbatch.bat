@@ -0,0 +1,160 @@
+REM #############################################################################
+REM										#
+REM			TPM2 regression test					#
+REM			     Written by agent					#
+REM		$Id: testbatch.bat $						#
+REM										#
+REM (c) Copyright agent 2026							#
+REM 										#
+REM All rights reserved.							#
+REM 										#
+REM Redistribution and use in source and binary forms, with or without		#
+REM modification, are permitted provided that the following conditions are	#
+REM met:									#
+REM 										#
+REM Redistributions of source code must retain the above copyright notice,	#
+REM this list of conditions and the following disclaimer.			#
+REM 										#
+REM Redistributions in binary form must reproduce the above copyright		#
+REM notice, this list of conditions and the following disclaimer in the		#
+REM documentation and/or other materials provided with the distribution.	#
+REM 										#
+REM Neither the names of the IBM Corporation nor the names of its		#
+REM contributors may be used to endorse or promote products derived from	#
+REM this software without specific prior written permission.			#
+REM 										#
+REM THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		#
+REM "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		#
+REM LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	#
+REM A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT	#
+REM HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	#
+REM SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		#
+REM LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	#
+REM DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	#
+REM THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		#
+REM (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	#
+REM OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.	#
+REM										#
+REM #############################################################################
+
+setlocal enableDelayedExpansion
+
+REM tssbatch scripts, one command and its arguments per line
+REM
+REM batchpolicy.txt	policy command code sign, then policy OR of sign and quote
+REM batchsign.txt		sign with a policy OR key, the quote branch fails
+REM batchpcr.txt		sign with a policy PCR 16 zero key
+REM batchkeepgoing.txt	flush a session that does not exist, then getrandom
+REM
+REM The policy digests must match the policymaker digests used by the other tests.
+
+echo ""
+echo "TSS Batch"
+echo ""
+
+echo "Batch policy command code and policy OR, compare to policymaker"
+%TPM_EXE_PATH%tssbatch -if policies/batchpolicy.txt > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+diff tmppol.bin policies/policyccsign.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+diff tmppol1.bin policies/policyor.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Batch policy command code and policy OR, session cache, compare to policymaker"
+%TPM_EXE_PATH%tssbatch -if policies/batchpolicy.txt -cache > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+diff tmppol.bin policies/policyccsign.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+diff tmppol1.bin policies/policyor.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Batch sign with policy OR - should fail at the quote branch"
+%TPM_EXE_PATH%tssbatch -if policies/batchsign.txt > run.out
+IF !ERRORLEVEL! EQU 0 (
+   exit /B 1
+)
+
+echo "Check that the sign branch succeeded and the quote branch failed"
+findstr /C:"line 7 sign ok" run.out > nul
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+findstr /C:"line 10 sign failed" run.out > nul
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Flush the policy session"
+%TPM_EXE_PATH%flushcontext -ha 03000000 > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Flush the signing key"
+%TPM_EXE_PATH%flushcontext -ha 80000001 > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Batch policy PCR, compare to policymaker"
+%TPM_EXE_PATH%tssbatch -if policies/batchpcr.txt > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+diff tmppol.bin policies/policypcr.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Batch policy PCR, session and name cache"
+%TPM_EXE_PATH%tssbatch -if policies/batchpcr.txt -cache > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Batch stops at a failed command - should fail"
+%TPM_EXE_PATH%tssbatch -if policies/batchkeepgoing.txt > run.out
+IF !ERRORLEVEL! EQU 0 (
+   exit /B 1
+)
+
+echo "Check that the second command did not run"
+findstr /C:"1 commands, 1 failed" run.out > nul
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Batch continues after a failed command - should fail"
+%TPM_EXE_PATH%tssbatch -if policies/batchkeepgoing.txt -k > run.out
+IF !ERRORLEVEL! EQU 0 (
+   exit /B 1
+)
+
+echo "Check that the second command ran"
+findstr /C:"2 commands, 1 failed" run.out > nul
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+rm tmppol.bin
+rm tmppol1.bin
+
+exit /B 0
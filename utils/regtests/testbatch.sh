@@ -0,0 +1,116 @@
+#!/bin/bash
+#
+
+#################################################################################
+#										#
+#			TPM2 regression test					#
+#			     Written by agent					#
+#	$Id: testbatch.sh $							#
+#										#
+# (c) Copyright agent 2026							#
+# 										#
+# All rights reserved.								#
+# 										#
+# Redistribution and use in source and binary forms, with or without		#
+# modification, are permitted provided that the following conditions are	#
+# met:										#
+# 										#
+# Redistributions of source code must retain the above copyright notice,	#
+# this list of conditions and the following disclaimer.				#
+# 										#
+# Redistributions in binary form must reproduce the above copyright		#
+# notice, this list of conditions and the following disclaimer in the		#
+# documentation and/or other materials provided with the distribution.		#
+# 										#
+# Neither the names of the IBM Corporation nor the names of its			#
+# contributors may be used to endorse or promote products derived from		#
+# this software without specific prior written permission.			#
+# 										#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		#
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		#
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR		#
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		#
+# HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	#
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		#
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,		#
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY		#
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		#
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE		#
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		#
+#										#
+#################################################################################
+
+
+# tssbatch scripts, one command and its arguments per line
+#
+# batchpolicy.txt	policy command code sign, then policy OR of sign and quote
+# batchsign.txt		sign with a policy OR key, the quote branch fails
+# batchpcr.txt		sign with a policy PCR 16 zero key
+# batchkeepgoing.txt	flush a session that does not exist, then getrandom
+#
+# The policy digests must match the policymaker digests used by the other tests.
+
+echo ""
+echo "TSS Batch"
+echo ""
+
+echo "Batch policy command code and policy OR, compare to policymaker"
+${PREFIX}tssbatch -if policies/batchpolicy.txt > run.out
+checkSuccess $?
+diff tmppol.bin policies/policyccsign.bin > run.out
+checkSuccess $?
+diff tmppol1.bin policies/policyor.bin > run.out
+checkSuccess $?
+
+echo "Batch policy command code and policy OR, session cache, compare to policymaker"
+${PREFIX}tssbatch -if policies/batchpolicy.txt -cache > run.out
+checkSuccess $?
+diff tmppol.bin policies/policyccsign.bin > run.out
+checkSuccess $?
+diff tmppol1.bin policies/policyor.bin > run.out
+checkSuccess $?
+
+echo "Batch sign with policy OR - should fail at the quote branch"
+${PREFIX}tssbatch -if policies/batchsign.txt > run.out
+checkFailure $?
+
+echo "Check that the sign branch succeeded and the quote branch failed"
+grep "line 7 sign ok" run.out > /dev/null && grep "line 10 sign failed" run.out > /dev/null
+checkSuccess $?
+
+echo "Flush the policy session"
+${PREFIX}flushcontext -ha 03000000 > run.out
+checkSuccess $?
+
+echo "Flush the signing key"
+${PREFIX}flushcontext -ha 80000001 > run.out
+checkSuccess $?
+
+echo "Batch policy PCR, compare to policymaker"
+${PREFIX}tssbatch -if policies/batchpcr.txt > run.out
+checkSuccess $?
+diff tmppol.bin policies/policypcr.bin > run.out
+checkSuccess $?
+
+echo "Batch policy PCR, session and name cache"
+${PREFIX}tssbatch -if policies/batchpcr.txt -cache > run.out
+checkSuccess $?
+
+echo "Batch stops at a failed command - should fail"
+${PREFIX}tssbatch -if policies/batchkeepgoing.txt > run.out
+checkFailure $?
+
+echo "Check that the second command did not run"
+grep "1 commands, 1 failed" run.out > /dev/null
+checkSuccess $?
+
+echo "Batch continues after a failed command - should fail"
+${PREFIX}tssbatch -if policies/batchkeepgoing.txt -k > run.out
+checkFailure $?
+
+echo "Check that the second command ran"
+grep "2 commands, 1 failed" run.out > /dev/null
+checkSuccess $?
+
+rm -f tmppol.bin
+rm -f tmppol1.bin
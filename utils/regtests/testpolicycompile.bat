@@ -0,0 +1,233 @@
+REM #############################################################################
+REM										#
+REM			TPM2 regression test					#
+REM			     Written by agent					#
+REM		$Id: testpolicycompile.bat $					#
+REM										#
+REM (c) Copyright agent 2026							#
+REM 										#
+REM All rights reserved.							#
+REM 										#
+REM Redistribution and use in source and binary forms, with or without		#
+REM modification, are permitted provided that the following conditions are	#
+REM met:									#
+REM 										#
+REM Redistributions of source code must retain the above copyright notice,	#
+REM this list of conditions and the following disclaimer.			#
+REM 										#
+REM Redistributions in binary form must reproduce the above copyright		#
+REM notice, this list of conditions and the following disclaimer in the		#
+REM documentation and/or other materials provided with the distribution.	#
+REM 										#
+REM Neither the names of the IBM Corporation nor the names of its		#
+REM contributors may be used to endorse or promote products derived from	#
+REM this software without specific prior written permission.			#
+REM 										#
+REM THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		#
+REM "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		#
+REM LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	#
+REM A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT	#
+REM HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	#
+REM SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		#
+REM LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	#
+REM DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	#
+REM THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		#
+REM (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	#
+REM OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.	#
+REM										#
+REM #############################################################################
+
+setlocal enableDelayedExpansion
+
+REM Policy descriptions for policycompile, one assertion per line
+REM
+REM compileccsign.txt	cc 15d
+REM compileccquote.txt	cc 158
+REM compileor.txt		or compileccsign.txt compileccquote.txt
+REM compilepcr.txt	pcr sha256 16 c211...bb (PCR 16 after extending aaa)
+REM compileauthorize.txt	authorize 00044234...8f6f (Name of policies/rsapubkey.pem, sha1)
+REM
+REM The compiled digests must match the policymaker digests used by the other tests.
+
+echo ""
+echo "Policy Compile"
+echo ""
+
+echo "Compile policy command code sign, compare to policymaker"
+%TPM_EXE_PATH%policycompile -if policies/compileccsign.txt -of tmppol.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+diff tmppol.bin policies/policyccsign.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Compile policy command code quote, compare to policymaker"
+%TPM_EXE_PATH%policycompile -if policies/compileccquote.txt -of tmppol.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+diff tmppol.bin policies/policyccquote.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Compile policy OR of sign and quote, compare to policymaker"
+%TPM_EXE_PATH%policycompile -if policies/compileor.txt -of tmppol.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+diff tmppol.bin policies/policyor.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Compile policy PCR 16, compare to policymakerpcr and policymaker"
+%TPM_EXE_PATH%policycompile -if policies/compilepcr.txt -of tmppol.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+diff tmppol.bin policies/policypcr16aaasha256.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Compile policy authorize, compare to policymaker"
+%TPM_EXE_PATH%policycompile -if policies/compileauthorize.txt -of tmppol.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+diff tmppol.bin policies/policyauthorize.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+REM compileexec.txt is a PolicyOR of two branches, each policy command code sign AND policy PCR 16
+REM
+REM compileexecpcr0.txt	PCR 16 all zero, after PCR reset
+REM compileexecpcraaa.txt	PCR 16 after extending aaa
+REM
+REM With PCR 16 extended, the first branch passes policy command code and then fails policy PCR.
+REM The executor must restart the session and replay the commands before the PolicyOR.
+
+echo ""
+echo "Policy Execute"
+echo ""
+
+echo "Compile the policy OR of two PCR 16 values"
+%TPM_EXE_PATH%policycompile -if policies/compileexec.txt -of tmppol.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Create a signing key with the compiled policy"
+%TPM_EXE_PATH%create -hp 80000000 -si -kt f -kt p -opr tmppriv.bin -opu tmppub.bin -pwdp pps -pwdk sig -pol tmppol.bin > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Load the signing key"
+%TPM_EXE_PATH%load -hp 80000000 -ipr tmppriv.bin -ipu tmppub.bin -pwdp pps > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Start a policy session"
+%TPM_EXE_PATH%startauthsession -se p > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "PCR 16 Reset"
+%TPM_EXE_PATH%pcrreset -ha 16 > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Execute the policy, first branch"
+%TPM_EXE_PATH%policycompile -if policies/compileexec.txt -ha 03000000 -cc 15d > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Sign a digest"
+%TPM_EXE_PATH%sign -hk 80000001 -if msg.bin -os sig.bin -se0 03000000 1 > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Execute the policy for quote - should fail, no branch for quote"
+%TPM_EXE_PATH%policycompile -if policies/compileexec.txt -ha 03000000 -cc 158 > run.out
+IF !ERRORLEVEL! EQU 0 (
+   exit /B 1
+)
+
+echo "Policy restart, set back to zero"
+%TPM_EXE_PATH%policyrestart -ha 03000000 > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Extend PCR 16 to aaa"
+%TPM_EXE_PATH%pcrextend -halg sha256 -ha 16 -if policies/aaa > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Execute the policy, first branch fails at policy PCR, second branch after restart"
+%TPM_EXE_PATH%policycompile -if policies/compileexec.txt -ha 03000000 -cc 15d > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Sign a digest"
+%TPM_EXE_PATH%sign -hk 80000001 -if msg.bin -os sig.bin -se0 03000000 1 > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Extend PCR 16 again"
+%TPM_EXE_PATH%pcrextend -halg sha256 -ha 16 -if policies/aaa > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Execute the policy - should fail, PCR 16 matches no branch"
+%TPM_EXE_PATH%policycompile -if policies/compileexec.txt -ha 03000000 -cc 15d > run.out
+IF !ERRORLEVEL! EQU 0 (
+   exit /B 1
+)
+
+echo "Sign a digest - should fail"
+%TPM_EXE_PATH%sign -hk 80000001 -if msg.bin -os sig.bin -se0 03000000 0 > run.out
+IF !ERRORLEVEL! EQU 0 (
+   exit /B 1
+)
+
+echo "Flush the policy session"
+%TPM_EXE_PATH%flushcontext -ha 03000000 > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Flush the signing key"
+%TPM_EXE_PATH%flushcontext -ha 80000001 > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "PCR 16 Reset"
+%TPM_EXE_PATH%pcrreset -ha 16 > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+rm tmppol.bin
+
+exit /B 0
@@ -0,0 +1,171 @@
+#!/bin/bash
+#
+
+#################################################################################
+#										#
+#			TPM2 regression test					#
+#			     Written by agent					#
+#	$Id: testpolicycompile.sh $						#
+#										#
+# (c) Copyright agent 2026							#
+# 										#
+# All rights reserved.								#
+# 										#
+# Redistribution and use in source and binary forms, with or without		#
+# modification, are permitted provided that the following conditions are	#
+# met:										#
+# 										#
+# Redistributions of source code must retain the above copyright notice,	#
+# this list of conditions and the following disclaimer.				#
+# 										#
+# Redistributions in binary form must reproduce the above copyright		#
+# notice, this list of conditions and the following disclaimer in the		#
+# documentation and/or other materials provided with the distribution.		#
+# 										#
+# Neither the names of the IBM Corporation nor the names of its			#
+# contributors may be used to endorse or promote products derived from		#
+# this software without specific prior written permission.			#
+# 										#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		#
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		#
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR		#
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		#
+# HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	#
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		#
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,		#
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY		#
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		#
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE		#
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		#
+#										#
+#################################################################################
+
+# Policy descriptions for policycompile, one assertion per line
+#
+# compileccsign.txt	cc 15d
+# compileccquote.txt	cc 158
+# compileor.txt		or compileccsign.txt compileccquote.txt
+# compilepcr.txt	pcr sha256 16 c211...bb (PCR 16 after extending aaa)
+# compileauthorize.txt	authorize 00044234...8f6f (Name of policies/rsapubkey.pem, sha1)
+#
+# The compiled digests must match the policymaker digests used by the other tests.
+
+echo ""
+echo "Policy Compile"
+echo ""
+
+echo "Compile policy command code sign, compare to policymaker"
+${PREFIX}policycompile -if policies/compileccsign.txt -of tmppol.bin > run.out
+checkSuccess $?
+diff tmppol.bin policies/policyccsign.bin > run.out
+checkSuccess $?
+
+echo "Compile policy command code quote, compare to policymaker"
+${PREFIX}policycompile -if policies/compileccquote.txt -of tmppol.bin > run.out
+checkSuccess $?
+diff tmppol.bin policies/policyccquote.bin > run.out
+checkSuccess $?
+
+echo "Compile policy OR of sign and quote, compare to policymaker"
+${PREFIX}policycompile -if policies/compileor.txt -of tmppol.bin > run.out
+checkSuccess $?
+diff tmppol.bin policies/policyor.bin > run.out
+checkSuccess $?
+
+echo "Compile policy PCR 16, compare to policymakerpcr and policymaker"
+${PREFIX}policycompile -if policies/compilepcr.txt -of tmppol.bin > run.out
+checkSuccess $?
+diff tmppol.bin policies/policypcr16aaasha256.bin > run.out
+checkSuccess $?
+
+echo "Compile policy authorize, compare to policymaker"
+${PREFIX}policycompile -if policies/compileauthorize.txt -of tmppol.bin > run.out
+checkSuccess $?
+diff tmppol.bin policies/policyauthorize.bin > run.out
+checkSuccess $?
+
+# compileexec.txt is a PolicyOR of two branches, each policy command code sign AND policy PCR 16
+#
+# compileexecpcr0.txt	PCR 16 all zero, after PCR reset
+# compileexecpcraaa.txt	PCR 16 after extending aaa
+#
+# With PCR 16 extended, the first branch passes policy command code and then fails policy PCR.
+# The executor must restart the session and replay the commands before the PolicyOR.
+
+echo ""
+echo "Policy Execute"
+echo ""
+
+echo "Compile the policy OR of two PCR 16 values"
+${PREFIX}policycompile -if policies/compileexec.txt -of tmppol.bin > run.out
+checkSuccess $?
+
+echo "Create a signing key with the compiled policy"
+${PREFIX}create -hp 80000000 -si -kt f -kt p -opr tmppriv.bin -opu tmppub.bin -pwdp pps -pwdk sig -pol tmppol.bin > run.out
+checkSuccess $?
+
+echo "Load the signing key"
+${PREFIX}load -hp 80000000 -ipr tmppriv.bin -ipu tmppub.bin -pwdp pps > run.out
+checkSuccess $?
+
+echo "Start a policy session"
+${PREFIX}startauthsession -se p > run.out
+checkSuccess $?
+
+echo "PCR 16 Reset"
+${PREFIX}pcrreset -ha 16 > run.out
+checkSuccess $?
+
+echo "Execute the policy, first branch"
+${PREFIX}policycompile -if policies/compileexec.txt -ha 03000000 -cc 15d > run.out
+checkSuccess $?
+
+echo "Sign a digest"
+${PREFIX}sign -hk 80000001 -if msg.bin -os sig.bin -se0 03000000 1 > run.out
+checkSuccess $?
+
+echo "Execute the policy for quote - should fail, no branch for quote"
+${PREFIX}policycompile -if policies/compileexec.txt -ha 03000000 -cc 158 > run.out
+checkFailure $?
+
+echo "Policy restart, set back to zero"
+${PREFIX}policyrestart -ha 03000000 > run.out
+checkSuccess $?
+
+echo "Extend PCR 16 to aaa"
+${PREFIX}pcrextend -halg sha256 -ha 16 -if policies/aaa > run.out
+checkSuccess $?
+
+echo "Execute the policy, first branch fails at policy PCR, second branch after restart"
+${PREFIX}policycompile -if policies/compileexec.txt -ha 03000000 -cc 15d > run.out
+checkSuccess $?
+
+echo "Sign a digest"
+${PREFIX}sign -hk 80000001 -if msg.bin -os sig.bin -se0 03000000 1 > run.out
+checkSuccess $?
+
+echo "Extend PCR 16 again"
+${PREFIX}pcrextend -halg sha256 -ha 16 -if policies/aaa > run.out
+checkSuccess $?
+
+echo "Execute the policy - should fail, PCR 16 matches no branch"
+${PREFIX}policycompile -if policies/compileexec.txt -ha 03000000 -cc 15d > run.out
+checkFailure $?
+
+echo "Sign a digest - should fail"
+${PREFIX}sign -hk 80000001 -if msg.bin -os sig.bin -se0 03000000 0 > run.out
+checkFailure $?
+
+echo "Flush the policy session"
+${PREFIX}flushcontext -ha 03000000 > run.out
+checkSuccess $?
+
+echo "Flush the signing key"
+${PREFIX}flushcontext -ha 80000001 > run.out
+checkSuccess $?
+
+echo "PCR 16 Reset"
+${PREFIX}pcrreset -ha 16 > run.out
+checkSuccess $?
+
+rm -f tmppol.bin
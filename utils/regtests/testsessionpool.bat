@@ -0,0 +1,93 @@
+REM #############################################################################
+REM										#
+REM			TPM2 regression test					#
+REM			     Written by agent					#
+REM		$Id: testsessionpool.bat $					#
+REM										#
+REM (c) Copyright agent 2026							#
+REM 										#
+REM All rights reserved.							#
+REM 										#
+REM Redistribution and use in source and binary forms, with or without		#
+REM modification, are permitted provided that the following conditions are	#
+REM met:									#
+REM 										#
+REM Redistributions of source code must retain the above copyright notice,	#
+REM this list of conditions and the following disclaimer.			#
+REM 										#
+REM Redistributions in binary form must reproduce the above copyright		#
+REM notice, this list of conditions and the following disclaimer in the		#
+REM documentation and/or other materials provided with the distribution.	#
+REM 										#
+REM Neither the names of the IBM Corporation nor the names of its		#
+REM contributors may be used to endorse or promote products derived from	#
+REM this software without specific prior written permission.			#
+REM 										#
+REM THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		#
+REM "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		#
+REM LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	#
+REM A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT	#
+REM HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	#
+REM SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		#
+REM LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	#
+REM DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	#
+REM THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		#
+REM (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	#
+REM OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.	#
+REM										#
+REM #############################################################################
+
+setlocal enableDelayedExpansion
+
+REM batchpool.txt leases an HMAC session, signs, releases it, and does it again.  The session pool
+REM counters are printed after the second release and after the pool is flushed.
+REM
+REM TPM_SESSION_POOL 1 keeps the released session, so the second lease reuses it.
+REM TPM_SESSION_POOL 0 flushes each released session, so the second lease starts another.
+
+echo ""
+echo "TSS Session Pool"
+echo ""
+
+echo "Session pool 1, sign twice with a leased session"
+set TPM_SESSION_POOL=1
+%TPM_EXE_PATH%tssbatch -if policies/batchpool.txt > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Check that the second lease reused the session"
+findstr /C:"leases 2 hits 1 starts 1 saves 0 loads 0 flushes 0" run.out > nul
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Check that the pool flush flushed the idle session"
+findstr /C:"leases 2 hits 1 starts 1 saves 0 loads 0 flushes 1" run.out > nul
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Session pool 0, sign twice with a leased session"
+set TPM_SESSION_POOL=0
+%TPM_EXE_PATH%tssbatch -if policies/batchpool.txt > run.out
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Check that each release flushed the session"
+findstr /C:"leases 2 hits 0 starts 2 saves 0 loads 0 flushes 2" run.out > nul
+IF !ERRORLEVEL! NEQ 0 (
+   exit /B 1
+)
+
+echo "Session pool 9 - should fail, the maximum is 8"
+set TPM_SESSION_POOL=9
+%TPM_EXE_PATH%tssbatch -if policies/batchpool.txt > run.out
+IF !ERRORLEVEL! EQU 0 (
+   exit /B 1
+)
+
+set TPM_SESSION_POOL=
+
+exit /B 0
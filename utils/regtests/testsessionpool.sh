@@ -0,0 +1,76 @@
+#!/bin/bash
+#
+
+#################################################################################
+#										#
+#			TPM2 regression test					#
+#			     Written by agent					#
+#	$Id: testsessionpool.sh $						#
+#										#
+# (c) Copyright agent 2026							#
+# 										#
+# All rights reserved.								#
+# 										#
+# Redistribution and use in source and binary forms, with or without		#
+# modification, are permitted provided that the following conditions are	#
+# met:										#
+# 										#
+# Redistributions of source code must retain the above copyright notice,	#
+# this list of conditions and the following disclaimer.				#
+# 										#
+# Redistributions in binary form must reproduce the above copyright		#
+# notice, this list of conditions and the following disclaimer in the		#
+# documentation and/or other materials provided with the distribution.		#
+# 										#
+# Neither the names of the IBM Corporation nor the names of its			#
+# contributors may be used to endorse or promote products derived from		#
+# this software without specific prior written permission.			#
+# 										#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		#
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		#
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR		#
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		#
+# HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	#
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		#
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,		#
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY		#
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		#
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE		#
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		#
+#										#
+#################################################################################
+
+
+# batchpool.txt leases an HMAC session, signs, releases it, and does it again.  The session pool
+# counters are printed after the second release and after the pool is flushed.
+#
+# TPM_SESSION_POOL 1 keeps the released session, so the second lease reuses it.
+# TPM_SESSION_POOL 0 flushes each released session, so the second lease starts another.
+
+echo ""
+echo "TSS Session Pool"
+echo ""
+
+echo "Session pool 1, sign twice with a leased session"
+TPM_SESSION_POOL=1 ${PREFIX}tssbatch -if policies/batchpool.txt > run.out
+checkSuccess $?
+
+echo "Check that the second lease reused the session"
+grep "leases 2 hits 1 starts 1 saves 0 loads 0 flushes 0" run.out > /dev/null
+checkSuccess $?
+
+echo "Check that the pool flush flushed the idle session"
+grep "leases 2 hits 1 starts 1 saves 0 loads 0 flushes 1" run.out > /dev/null
+checkSuccess $?
+
+echo "Session pool 0, sign twice with a leased session"
+TPM_SESSION_POOL=0 ${PREFIX}tssbatch -if policies/batchpool.txt > run.out
+checkSuccess $?
+
+echo "Check that each release flushed the session"
+grep "leases 2 hits 0 starts 2 saves 0 loads 0 flushes 2" run.out > /dev/null
+checkSuccess $?
+
+echo "Session pool 9 - should fail, the maximum is 8"
+TPM_SESSION_POOL=9 ${PREFIX}tssbatch -if policies/batchpool.txt > run.out
+checkFailure $?
@@ -0,0 +1,250 @@
+/********************************************************************************/
+/*										*/
+/*		     Time the TSS Command Dispatch				*/
+/*			     Written by agent					*/
+/*	      $Id: timedispatch.c $						*/
+/*										*/
+/* (c) Copyright agent 2026.							*/
+/*										*/
+/* All rights reserved.								*/
+/* 										*/
+/* Redistribution and use in source and binary forms, with or without		*/
+/* modification, are permitted provided that the following conditions are	*/
+/* met:										*/
+/* 										*/
+/* Redistributions of source code must retain the above copyright notice,	*/
+/* this list of conditions and the following disclaimer.			*/
+/* 										*/
+/* Redistributions in binary form must reproduce the above copyright		*/
+/* notice, this list of conditions and the following disclaimer in the		*/
+/* documentation and/or other materials provided with the distribution.		*/
+/* 										*/
+/* Neither the names of the IBM Corporation nor the names of its		*/
+/* contributors may be used to endorse or promote products derived from		*/
+/* this software without specific prior written permission.			*/
+/* 										*/
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		*/
+/* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		*/
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	*/
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		*/
+/* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	*/
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		*/
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	*/
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	*/
+/* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		*/
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	*/
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		*/
+
+/* timedispatch times the TSS command dispatch, the lookup from the command code to the marshal
+   table and command attribute table entries.  It does not use a TPM.
+
+   It compares the command attribute lookup with a linear search of the same table, and times
+   TSS_Marshal() for commands at the start, middle, and end of the marshal table.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <tss2/tss.h>
+#include <tss2/tssresponsecode.h>
+#include "tssauth.h"
+#include "tssccattributes.h"
+
+static void printUsage(void);
+static double timeDiffNs(struct timespec *startTime, struct timespec *endTime);
+static COMMAND_INDEX linearSearch(TPM_CC commandCode);
+static TPM_RC timeMarshal(TSS_AUTH_CONTEXT *tssAuthContext,
+			  COMMAND_PARAMETERS *in,
+			  TPM_CC commandCode,
+			  const char *commandText,
+			  unsigned int loops);
+
+int verbose = FALSE;
+
+int main(int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;    	/* argc iterator */
+    TSS_AUTH_CONTEXT		*tssAuthContext = NULL;
+    unsigned int 		loops = 1000000;
+    unsigned int 		count;
+    size_t			ccCount = 0;	/* number of command codes in s_ccAttr */
+    size_t			ccIndex;
+    COMMAND_INDEX		commandIndex;
+    unsigned long		checksum = 0;	/* prevents the compiler from discarding the lookup */
+    struct timespec 		startTime;
+    struct timespec		endTime;
+    double			tableNs;
+    double			searchNs;
+    COMMAND_PARAMETERS		in;
+    
+    setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
+    TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
+
+    /* command line argument defaults */
+    for (i=1 ; (i<argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-l") == 0) {
+	    i++;
+	    if (i < argc) {
+		loops = atoi(argv[i]);
+	    }
+	    else {
+		printf("-l option needs a value\n");
+		printUsage();
+	    }
+	}
+ 	else if (strcmp(argv[i],"-h") == 0) {
+	    printUsage();
+	}
+	else if (strcmp(argv[i],"-v") == 0) {
+	    verbose = TRUE;
+	}
+	else {
+	    printf("\n%s is not a valid option\n", argv[i]);
+	    printUsage();
+	}
+    }
+    if (loops == 0) {
+	printf("Bad parameter -l\n");
+	printUsage();
+    }
+    /* s_ccAttr has terminating 0x0000 command code and V */
+    for (ccCount = 0 ; (s_ccAttr[ccCount].commandCode != 0) || (s_ccAttr[ccCount].V != 0) ;
+	 ccCount++);
+    /* command attribute lookup, direct index table */
+    if (rc == 0) {
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	for (count = 0 ; count < loops ; count++) {
+	    for (ccIndex = 0 ; ccIndex < ccCount ; ccIndex++) {
+		commandIndex = CommandCodeToCommandIndex(s_ccAttr[ccIndex].commandCode);
+		checksum += commandIndex;
+	    }
+	}
+	clock_gettime(CLOCK_MONOTONIC, &endTime);
+	tableNs = timeDiffNs(&startTime, &endTime) / ((double)loops * ccCount);
+    }
+    /* command attribute lookup, linear search */
+    if (rc == 0) {
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	for (count = 0 ; count < loops ; count++) {
+	    for (ccIndex = 0 ; ccIndex < ccCount ; ccIndex++) {
+		commandIndex = linearSearch(s_ccAttr[ccIndex].commandCode);
+		checksum -= commandIndex;
+	    }
+	}
+	clock_gettime(CLOCK_MONOTONIC, &endTime);
+	searchNs = timeDiffNs(&startTime, &endTime) / ((double)loops * ccCount);
+    }
+    if (rc == 0) {
+	if (checksum != 0) {
+	    printf("timedispatch: command index lookup and search differ\n");
+	    rc = EXIT_FAILURE;
+	}
+    }
+    if (rc == 0) {
+	printf("Command codes %lu\n", (unsigned long)ccCount);
+	printf("CommandCodeToCommandIndex: %.1f ns per lookup\n", tableNs);
+	printf("Linear search:             %.1f ns per lookup\n", searchNs);
+    }
+    /* complete command marshaling, including the marshal table lookup */
+    if (rc == 0) {
+	rc = TSS_AuthCreate(&tssAuthContext);
+    }
+    if (rc == 0) {
+	memset(&in, 0, sizeof(in));
+	in.Startup.startupType = TPM_SU_CLEAR;
+	rc = timeMarshal(tssAuthContext, &in, TPM_CC_Startup, "Startup", loops / 100);
+    }
+    if (rc == 0) {
+	memset(&in, 0, sizeof(in));
+	in.GetRandom.bytesRequested = 32;
+	rc = timeMarshal(tssAuthContext, &in, TPM_CC_GetRandom, "GetRandom", loops / 100);
+    }
+    if (rc == 0) {
+	memset(&in, 0, sizeof(in));
+	in.FlushContext.flushHandle = TRANSIENT_FIRST;
+	rc = timeMarshal(tssAuthContext, &in, TPM_CC_FlushContext, "FlushContext", loops / 100);
+    }
+    if (rc == 0) {
+	memset(&in, 0, sizeof(in));
+	in.PolicyGetDigest.policySession = POLICY_SESSION_FIRST;
+	rc = timeMarshal(tssAuthContext, &in, TPM_CC_PolicyGetDigest, "PolicyGetDigest",
+			 loops / 100);
+    }
+    TSS_AuthDelete(tssAuthContext);
+    if (rc == 0) {
+	if (verbose) printf("timedispatch: success\n");
+    }
+    else {
+	const char *msg;
+	const char *submsg;
+	const char *num;
+	printf("timedispatch: failed, rc %08x\n", rc);
+	TSS_ResponseCode_toString(&msg, &submsg, &num, rc);
+	printf("%s%s%s\n", msg, submsg, num);
+	rc = EXIT_FAILURE;
+    }
+    return rc;
+}
+
+/* timeMarshal() times TSS_Marshal() for the command */
+
+static TPM_RC timeMarshal(TSS_AUTH_CONTEXT *tssAuthContext,
+			  COMMAND_PARAMETERS *in,
+			  TPM_CC commandCode,
+			  const char *commandText,
+			  unsigned int loops)
+{
+    TPM_RC		rc = 0;
+    unsigned int 	count;
+    struct timespec 	startTime;
+    struct timespec	endTime;
+
+    if (loops == 0) {
+	loops = 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    for (count = 0 ; (rc == 0) && (count < loops) ; count++) {
+	rc = TSS_Marshal(tssAuthContext, in, commandCode);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    if (rc == 0) {
+	printf("TSS_Marshal %-16s %.1f ns per command\n", commandText,
+	       timeDiffNs(&startTime, &endTime) / loops);
+    }
+    return rc;
+}
+
+/* linearSearch() is the reference, a linear search of s_ccAttr */
+
+static COMMAND_INDEX linearSearch(TPM_CC commandCode)
+{
+    COMMAND_INDEX i;
+
+    for (i = 0 ; (s_ccAttr[i].commandCode != 0) || (s_ccAttr[i].V != 0) ; i++) {
+	if (s_ccAttr[i].commandCode == commandCode) {
+	    return i;
+	}
+    }
+    return UNIMPLEMENTED_COMMAND_INDEX;
+}
+
+static double timeDiffNs(struct timespec *startTime, struct timespec *endTime)
+{
+    return ((double)(endTime->tv_sec - startTime->tv_sec) * 1000000000.0) +
+	(double)(endTime->tv_nsec - startTime->tv_nsec);
+}
+
+static void printUsage(void)
+{
+    printf("\n");
+    printf("timedispatch\n");
+    printf("\n");
+    printf("Times the TSS command code dispatch.  Does not use a TPM.\n");
+    printf("\n");
+    printf("\t[-l number of loops to time (default 1000000)]\n");
+    exit(1);	
+}
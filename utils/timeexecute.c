@@ -0,0 +1,311 @@
+/********************************************************************************/
+/*										*/
+/*		     Time the TSS_Execute() Steps				*/
+/*			     Written by agent					*/
+/*	      $Id: timeexecute.c $						*/
+/*										*/
+/* (c) Copyright agent 2026.							*/
+/*										*/
+/* All rights reserved.								*/
+/* 										*/
+/* Redistribution and use in source and binary forms, with or without		*/
+/* modification, are permitted provided that the following conditions are	*/
+/* met:										*/
+/* 										*/
+/* Redistributions of source code must retain the above copyright notice,	*/
+/* this list of conditions and the following disclaimer.			*/
+/* 										*/
+/* Redistributions in binary form must reproduce the above copyright		*/
+/* notice, this list of conditions and the following disclaimer in the		*/
+/* documentation and/or other materials provided with the distribution.		*/
+/* 										*/
+/* Neither the names of the IBM Corporation nor the names of its		*/
+/* contributors may be used to endorse or promote products derived from		*/
+/* this software without specific prior written permission.			*/
+/* 										*/
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		*/
+/* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		*/
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	*/
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		*/
+/* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	*/
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		*/
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	*/
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	*/
+/* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		*/
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	*/
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		*/
+
+
+/* timeexecute runs a command repeatedly in one TSS context with the TPM_EXECUTE_TIMING property
+   set, and prints a histogram of the time spent in each TSS_Execute() step.
+
+   The transmit step is the TPM latency, including the transport.  The other steps are TSS
+   overhead.  Use -se0 with an HMAC session from startauthsession to time the session steps.
+
+   The command is TPM2_GetRandom.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <tss2/tss.h>
+#include <tss2/tssutils.h>
+#include <tss2/tssresponsecode.h>
+
+#define HISTOGRAM_BUCKETS	24	/* powers of 2 microseconds */
+
+typedef struct {
+    uint64_t	count;
+    uint64_t	minNs;
+    uint64_t	maxNs;
+    uint64_t	totalNs;
+    uint64_t	bucket[HISTOGRAM_BUCKETS];
+} HISTOGRAM;
+
+static void printUsage(void);
+static void histogramInit(HISTOGRAM *histogram);
+static void histogramAdd(HISTOGRAM *histogram, uint64_t ns);
+static void histogramPrint(HISTOGRAM *histogram, const char *name);
+
+/* step names, in TSS_STEP_ order */
+
+static const char *stepName[TSS_STEP_MAX] = {
+    "marshal",
+    "names",
+    "session load",
+    "hmac",
+    "encrypt",
+    "transmit",
+    "verify",
+    "session save",
+    "decrypt",
+    "unmarshal"
+};
+
+int verbose = FALSE;
+
+int main(int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;    	/* argc iterator */
+    TSS_CONTEXT			*tssContext = NULL;
+    GetRandom_In 		in;
+    GetRandom_Out 		out;
+    unsigned int		loops = 100;
+    unsigned int		bytesRequested = 32;
+    unsigned int 		count;
+    TSS_EXECUTE_TIMING		timing;
+    uint32_t			timingCount;
+    unsigned int		step;
+    HISTOGRAM			stepHistogram[TSS_STEP_MAX];
+    HISTOGRAM			overheadHistogram;	/* all steps except transmit */
+    uint64_t			overheadNs;
+    TPMI_SH_AUTH_SESSION    	sessionHandle0 = TPM_RH_NULL;
+    unsigned int		sessionAttributes0 = 0;
+    
+    setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
+    TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
+
+    /* command line argument defaults */
+    for (i=1 ; (i<argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-l") == 0) {
+	    i++;
+	    if (i < argc) {
+		loops = atoi(argv[i]);
+	    }
+	    else {
+		printf("-l option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-by") == 0) {
+	    i++;
+	    if (i < argc) {
+		bytesRequested = atoi(argv[i]);
+	    }
+	    else {
+		printf("-by option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-se0") == 0) {
+	    i++;
+	    if (i < argc) {
+		sscanf(argv[i],"%x", &sessionHandle0);
+	    }
+	    else {
+		printf("Missing parameter for -se0\n");
+		printUsage();
+	    }
+	    i++;
+	    if (i < argc) {
+		sscanf(argv[i],"%x", &sessionAttributes0);
+		if (sessionAttributes0 > 0xff) {
+		    printf("Out of range session attributes for -se0\n");
+		    printUsage();
+		}
+	    }
+	    else {
+		printf("Missing parameter for -se0\n");
+		printUsage();
+	    }
+	}
+ 	else if (strcmp(argv[i],"-h") == 0) {
+	    printUsage();
+	}
+	else if (strcmp(argv[i],"-v") == 0) {
+	    verbose = TRUE;
+	    TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "2");
+	}
+	else {
+	    printf("\n%s is not a valid option\n", argv[i]);
+	    printUsage();
+	}
+    }
+    if (loops == 0) {
+	printf("Bad parameter -l\n");
+	printUsage();
+    }
+    if ((bytesRequested == 0) || (bytesRequested > 0xffff)) {
+	printf("Bad parameter -by\n");
+	printUsage();
+    }
+    for (step = 0 ; step < TSS_STEP_MAX ; step++) {
+	histogramInit(&stepHistogram[step]);
+    }
+    histogramInit(&overheadHistogram);
+    /* Start a TSS context */
+    if (rc == 0) {
+	rc = TSS_Create(&tssContext);
+    }
+    /* keep one record, drained after each command */
+    if (rc == 0) {
+	rc = TSS_SetProperty(tssContext, TPM_EXECUTE_TIMING, "1");
+    }
+    for (count = 0 ; (rc == 0) && (count < loops) ; count++) {
+	in.bytesRequested = bytesRequested;
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out, 
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_GetRandom,
+			 sessionHandle0, NULL, sessionAttributes0,
+			 TPM_RH_NULL, NULL, 0);
+	if (rc == 0) {
+	    timingCount = 1;
+	    rc = TSS_GetExecuteTiming(tssContext, &timing, &timingCount);
+	}
+	if ((rc == 0) && (timingCount == 1)) {
+	    overheadNs = 0;
+	    for (step = 0 ; step < TSS_STEP_MAX ; step++) {
+		histogramAdd(&stepHistogram[step], timing.stepNs[step]);
+		if (step != TSS_STEP_TRANSMIT) {
+		    overheadNs += timing.stepNs[step];
+		}
+	    }
+	    histogramAdd(&overheadHistogram, overheadNs);
+	}
+    }
+    {
+	TPM_RC rc1 = TSS_Delete(tssContext);
+	if (rc == 0) {
+	    rc = rc1;
+	}
+    }
+    if (rc == 0) {
+	printf("GetRandom %u bytes, %u commands\n", bytesRequested, loops);
+	for (step = 0 ; step < TSS_STEP_MAX ; step++) {
+	    histogramPrint(&stepHistogram[step], stepName[step]);
+	}
+	histogramPrint(&overheadHistogram, "TSS overhead");
+	if (verbose) printf("timeexecute: success\n");
+    }
+    else {
+	const char *msg;
+	const char *submsg;
+	const char *num;
+	printf("timeexecute: failed, rc %08x\n", rc);
+	TSS_ResponseCode_toString(&msg, &submsg, &num, rc);
+	printf("%s%s%s\n", msg, submsg, num);
+	rc = EXIT_FAILURE;
+    }
+    return rc;
+}
+
+static void histogramInit(HISTOGRAM *histogram)
+{
+    memset(histogram, 0, sizeof(HISTOGRAM));
+    histogram->minNs = UINT64_MAX;
+    return;
+}
+
+/* histogramAdd() adds a sample.  Bucket 0 is less than 1 usec, bucket n is 2^(n-1) to 2^n usec, and
+   the last bucket holds everything larger. */
+
+static void histogramAdd(HISTOGRAM *histogram, uint64_t ns)
+{
+    uint64_t	us = ns / 1000;
+    size_t	b;
+
+    for (b = 0 ; (us != 0) && (b < (HISTOGRAM_BUCKETS - 1)) ; b++) {
+	us >>= 1;
+    }
+    histogram->bucket[b]++;
+    histogram->count++;
+    histogram->totalNs += ns;
+    if (ns < histogram->minNs) {
+	histogram->minNs = ns;
+    }
+    if (ns > histogram->maxNs) {
+	histogram->maxNs = ns;
+    }
+    return;
+}
+
+/* histogramPrint() prints the summary and the non-empty buckets.  A step that never ran, e.g. the
+   session steps without a session, is printed as one line. */
+
+static void histogramPrint(HISTOGRAM *histogram, const char *name)
+{
+    size_t	b;
+
+    if ((histogram->count == 0) || (histogram->maxNs == 0)) {
+	printf("%-12s not used\n", name);
+	return;
+    }
+    printf("%-12s min %.1f us avg %.1f us max %.1f us\n", name,
+	   (double)histogram->minNs / 1000.0,
+	   ((double)histogram->totalNs / histogram->count) / 1000.0,
+	   (double)histogram->maxNs / 1000.0);
+    for (b = 0 ; b < HISTOGRAM_BUCKETS ; b++) {
+	if (histogram->bucket[b] != 0) {
+	    if (b == 0) {
+		printf("\t          < 1 us %8lu\n", (unsigned long)histogram->bucket[b]);
+	    }
+	    else {
+		printf("\t%7lu - %7lu us %8lu\n",
+		       1UL << (b - 1), 1UL << b, (unsigned long)histogram->bucket[b]);
+	    }
+	}
+    }
+    return;
+}
+
+static void printUsage(void)
+{
+    printf("\n");
+    printf("timeexecute\n");
+    printf("\n");
+    printf("Runs TPM2_GetRandom repeatedly and prints a histogram of the time spent in\n");
+    printf("each TSS_Execute() step\n");
+    printf("\n");
+    printf("\t[-l loops (default 100)]\n");
+    printf("\t[-by bytes requested (default 32)]\n");
+    printf("\t[-se0 session handle / attributes (default none)]\n");
+    printf("\t\t01 continue\n");
+    printf("\t\t20 command decrypt\n");
+    printf("\t\t40 response encrypt\n");
+    exit(1);	
+}
@@ -0,0 +1,450 @@
+/********************************************************************************/
+/*										*/
+/*		     Time IMA Event Log Verification				*/
+/*			     Written by agent					*/
+/*	      $Id: timeima.c $							*/
+/*										*/
+/* (c) Copyright agent 2026.							*/
+/*										*/
+/* All rights reserved.								*/
+/* 										*/
+/* Redistribution and use in source and binary forms, with or without		*/
+/* modification, are permitted provided that the following conditions are	*/
+/* met:										*/
+/* 										*/
+/* Redistributions of source code must retain the above copyright notice,	*/
+/* this list of conditions and the following disclaimer.			*/
+/* 										*/
+/* Redistributions in binary form must reproduce the above copyright		*/
+/* notice, this list of conditions and the following disclaimer in the		*/
+/* documentation and/or other materials provided with the distribution.		*/
+/* 										*/
+/* Neither the names of the IBM Corporation nor the names of its		*/
+/* contributors may be used to endorse or promote products derived from		*/
+/* this software without specific prior written permission.			*/
+/* 										*/
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		*/
+/* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		*/
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	*/
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		*/
+/* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	*/
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		*/
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	*/
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	*/
+/* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		*/
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	*/
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		*/
+
+/* timeima times IMA event log verification over a synthetic ima-ng event log.  It does not use a
+   TPM.
+
+   It times IMA_Checkpoint_Extend() without template data verification, and with verification
+   using 1 to the maximum number of threads, doubling each time.  It checks that each pass
+   reaches the same checkpoint.
+
+   It also times the per event IMA_Extend() loop against the batched extend, and the replay of
+   several copies of the log at once with IMA_Checkpoint_ExtendLogs().
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <tss2/tss.h>
+#include <tss2/tssresponsecode.h>
+#include <tss2/tsscryptoh.h>
+
+#include "imalib.h"
+
+static void printUsage(void);
+static double timeDiffNs(struct timespec *startTime, struct timespec *endTime);
+static TPM_RC writeLog(FILE *logFile,
+		       unsigned int events);
+static void putUint32Le(uint8_t *buffer, uint32_t value);
+static TPM_RC timeCheckpoint(ImaCheckpoint *imaCheckpoint,
+			     ImaEventIterator *imaEventIterator,
+			     unsigned int events,
+			     unsigned int verifyThreads);
+static TPM_RC timePerEvent(ImaCheckpoint *imaCheckpoint,
+			   ImaEventIterator *imaEventIterator,
+			   unsigned int events);
+static TPM_RC timeLogs(ImaCheckpoint *firstCheckpoint,
+		       FILE *logFile,
+		       unsigned int events,
+		       unsigned int logs);
+
+int verbose = FALSE;
+int vverbose = FALSE;
+
+int main(int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;    	/* argc iterator */
+    unsigned int 		events = 100000;
+    unsigned int 		maxThreads = 8;
+    unsigned int 		logs = 16;
+    unsigned int 		verifyThreads;
+    FILE			*logFile = NULL;
+    ImaEventIterator		imaEventIterator;
+    ImaCheckpoint		firstCheckpoint;
+    ImaCheckpoint		imaCheckpoint;
+    int				iteratorOpen = FALSE;
+    
+    setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
+    TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
+
+    /* command line argument defaults */
+    for (i=1 ; (i<argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-ev") == 0) {
+	    i++;
+	    if (i < argc) {
+		events = atoi(argv[i]);
+	    }
+	    else {
+		printf("-ev option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-logs") == 0) {
+	    i++;
+	    if (i < argc) {
+		logs = atoi(argv[i]);
+	    }
+	    else {
+		printf("-logs option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-th") == 0) {
+	    i++;
+	    if (i < argc) {
+		maxThreads = atoi(argv[i]);
+	    }
+	    else {
+		printf("-th option needs a value\n");
+		printUsage();
+	    }
+	}
+ 	else if (strcmp(argv[i],"-h") == 0) {
+	    printUsage();
+	}
+	else if (strcmp(argv[i],"-v") == 0) {
+	    verbose = TRUE;
+	}
+	else {
+	    printf("\n%s is not a valid option\n", argv[i]);
+	    printUsage();
+	}
+    }
+    if (events == 0) {
+	printf("Bad parameter -ev\n");
+	printUsage();
+    }
+    if (maxThreads == 0) {
+	printf("Bad parameter -th\n");
+	printUsage();
+    }
+    if (logs == 0) {
+	printf("Bad parameter -logs\n");
+	printUsage();
+    }
+    /* build the synthetic event log */
+    if (rc == 0) {
+	logFile = tmpfile();
+	if (logFile == NULL) {
+	    printf("timeima: could not create a temporary file\n");
+	    rc = EXIT_FAILURE;
+	}
+    }
+    if (rc == 0) {
+	rc = writeLog(logFile, events);
+    }
+    if (rc == 0) {
+	rewind(logFile);
+	rc = IMA_EventIterator_Open(&imaEventIterator, logFile, TRUE);
+    }
+    if (rc == 0) {
+	iteratorOpen = TRUE;
+	printf("Events %u, log %lu bytes\n", events, (unsigned long)imaEventIterator.logLength);
+    }
+    /* extend only, as the reference */
+    if (rc == 0) {
+	rc = timeCheckpoint(&firstCheckpoint, &imaEventIterator, events, 0);
+    }
+    /* one IMA_Extend() per event and bank */
+    if (rc == 0) {
+	rc = timePerEvent(&imaCheckpoint, &imaEventIterator, events);
+    }
+    if (rc == 0) {
+	if (memcmp(imaCheckpoint.imapcr, firstCheckpoint.imapcr,
+		   sizeof(imaCheckpoint.imapcr)) != 0) {
+	    printf("timeima: per event extend differs\n");
+	    rc = EXIT_FAILURE;
+	}
+    }
+    /* several copies of the log at once */
+    if (rc == 0) {
+	rc = timeLogs(&firstCheckpoint, logFile, events, logs);
+    }
+    /* verify the template data hashes with 1, 2, 4, ... threads */
+    for (verifyThreads = 1 ; (rc == 0) && (verifyThreads <= maxThreads) ; verifyThreads *= 2) {
+	rc = timeCheckpoint(&imaCheckpoint, &imaEventIterator, events, verifyThreads);
+	if (rc == 0) {
+	    if ((imaCheckpoint.offset != firstCheckpoint.offset) ||
+		(imaCheckpoint.lastOffset != firstCheckpoint.lastOffset) ||
+		(memcmp(imaCheckpoint.lastDigest, firstCheckpoint.lastDigest,
+			SHA1_DIGEST_SIZE) != 0) ||
+		(memcmp(imaCheckpoint.imapcr, firstCheckpoint.imapcr,
+			sizeof(imaCheckpoint.imapcr)) != 0)) {
+		printf("timeima: checkpoint with %u threads differs\n", verifyThreads);
+		rc = EXIT_FAILURE;
+	    }
+	}
+    }
+    if (iteratorOpen) {
+	IMA_EventIterator_Close(&imaEventIterator);
+    }
+    if (logFile != NULL) {
+	fclose(logFile);
+    }
+    if (rc == 0) {
+	if (verbose) printf("timeima: success\n");
+    }
+    else {
+	const char *msg;
+	const char *submsg;
+	const char *num;
+	printf("timeima: failed, rc %08x\n", rc);
+	TSS_ResponseCode_toString(&msg, &submsg, &num, rc);
+	printf("%s%s%s\n", msg, submsg, num);
+	rc = EXIT_FAILURE;
+    }
+    return rc;
+}
+
+/* timeCheckpoint() times IMA_Checkpoint_Extend() from the start of the log */
+
+static TPM_RC timeCheckpoint(ImaCheckpoint *imaCheckpoint,
+			     ImaEventIterator *imaEventIterator,
+			     unsigned int events,
+			     unsigned int verifyThreads)
+{
+    TPM_RC		rc = 0;
+    uint32_t		badEvent = FALSE;
+    struct timespec 	startTime;
+    struct timespec	endTime;
+    double		ns;
+
+    IMA_Checkpoint_Init(imaCheckpoint);
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    rc = IMA_Checkpoint_Extend(imaCheckpoint, imaEventIterator, verifyThreads, &badEvent);
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    if (rc == 0) {
+	if (badEvent || (imaCheckpoint->eventCount != events)) {
+	    printf("timeima: verification stopped at event %u\n", imaCheckpoint->eventCount);
+	    rc = EXIT_FAILURE;
+	}
+    }
+    if (rc == 0) {
+	ns = timeDiffNs(&startTime, &endTime);
+	if (verifyThreads == 0) {
+	    printf("Extend only:          ");
+	}
+	else {
+	    printf("Verify, %2u thread(s): ", verifyThreads);
+	}
+	printf("%8.1f ms  %10.0f events/s\n", ns / 1000000.0, events * 1000000000.0 / ns);
+    }
+    return rc;
+}
+
+/* timePerEvent() times the IMA_Extend() loop from the start of the log, as the reference for the
+   batched extend */
+
+static TPM_RC timePerEvent(ImaCheckpoint *imaCheckpoint,
+			   ImaEventIterator *imaEventIterator,
+			   unsigned int events)
+{
+    TPM_RC		rc = 0;
+    ImaEvent 		*imaEvent = NULL;
+    int 		endOfFile = FALSE;
+    struct timespec 	startTime;
+    struct timespec	endTime;
+    double		ns;
+
+    IMA_Checkpoint_Init(imaCheckpoint);
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    rc = IMA_EventIterator_Seek(imaEventIterator, 0);
+    while ((rc == 0) && !endOfFile) {
+	rc = IMA_EventIterator_Next(imaEventIterator, &imaEvent, &endOfFile);
+	if ((rc == 0) && !endOfFile) {
+	    rc = IMA_Extend(&imaCheckpoint->imapcr[0], imaEvent, TPM_ALG_SHA1);
+	}
+	if ((rc == 0) && !endOfFile) {
+	    rc = IMA_Extend(&imaCheckpoint->imapcr[1], imaEvent, TPM_ALG_SHA256);
+	}
+    }
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    if (rc == 0) {
+	ns = timeDiffNs(&startTime, &endTime);
+	printf("Per event extend:     ");
+	printf("%8.1f ms  %10.0f events/s\n", ns / 1000000.0, events * 1000000000.0 / ns);
+    }
+    return rc;
+}
+
+/* timeLogs() times IMA_Checkpoint_ExtendLogs() replaying logs copies of the log, and checks
+   that each reaches the first checkpoint */
+
+static TPM_RC timeLogs(ImaCheckpoint *firstCheckpoint,
+		       FILE *logFile,
+		       unsigned int events,
+		       unsigned int logs)
+{
+    TPM_RC		rc = 0;
+    ImaEventIterator	*imaEventIterator = NULL;
+    ImaCheckpoint	*imaCheckpoint = NULL;
+    unsigned int 	iteratorCount = 0;	/* iterators opened */
+    unsigned int 	log;
+    struct timespec 	startTime;
+    struct timespec	endTime;
+    double		ns;
+
+    if (rc == 0) {
+	imaEventIterator = malloc(logs * sizeof(ImaEventIterator));
+	imaCheckpoint = malloc(logs * sizeof(ImaCheckpoint));
+	if ((imaEventIterator == NULL) || (imaCheckpoint == NULL)) {
+	    printf("timeima: could not allocate %u logs\n", logs);
+	    rc = EXIT_FAILURE;
+	}
+    }
+    for ( ; (rc == 0) && (iteratorCount < logs) ; iteratorCount++) {
+	rewind(logFile);
+	rc = IMA_EventIterator_Open(&imaEventIterator[iteratorCount], logFile, TRUE);
+	IMA_Checkpoint_Init(&imaCheckpoint[iteratorCount]);
+	if (rc != 0) {
+	    break;
+	}
+    }
+    if (rc == 0) {
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	rc = IMA_Checkpoint_ExtendLogs(imaCheckpoint, imaEventIterator, logs);
+	clock_gettime(CLOCK_MONOTONIC, &endTime);
+    }
+    for (log = 0 ; (rc == 0) && (log < logs) ; log++) {
+	if ((imaCheckpoint[log].offset != firstCheckpoint->offset) ||
+	    (imaCheckpoint[log].eventCount != events) ||
+	    (memcmp(imaCheckpoint[log].imapcr, firstCheckpoint->imapcr,
+		    sizeof(imaCheckpoint[log].imapcr)) != 0)) {
+	    printf("timeima: replay of log %u differs\n", log);
+	    rc = EXIT_FAILURE;
+	}
+    }
+    if (rc == 0) {
+	ns = timeDiffNs(&startTime, &endTime);
+	printf("Replay %4u logs:      ", logs);
+	printf("%8.1f ms  %10.0f events/s\n", ns / 1000000.0,
+	       (double)events * logs * 1000000000.0 / ns);
+    }
+    for (log = 0 ; log < iteratorCount ; log++) {
+	IMA_EventIterator_Close(&imaEventIterator[log]);
+    }
+    free(imaEventIterator);
+    free(imaCheckpoint);
+    return rc;
+}
+
+/* writeLog() writes a little endian ima-ng event log.  Every 1000th event is a violation, with
+   an all zero digest. */
+
+static TPM_RC writeLog(FILE *logFile,
+		       unsigned int events)
+{
+    TPM_RC		rc = 0;
+    unsigned int 	count;
+    uint8_t		event[512];
+    uint8_t		*templateData;
+    uint32_t		templateDataLength;
+    uint32_t		hashLength;
+    int			fileNameLength;
+    TPMT_HA		fileHash;
+    TPMT_HA		imaDigest;
+    size_t		writeSize;
+
+    for (count = 0 ; (rc == 0) && (count < events) ; count++) {
+	/* pcrIndex, digest, name_len, "ima-ng", template_data_len, template data */
+	templateData = event + 4 + SHA1_DIGEST_SIZE + 4 + 6 + 4;
+	/* file data hash, as "sha256:" || nul || hash */
+	fileHash.hashAlg = TPM_ALG_SHA256;
+	rc = TSS_Hash_Generate(&fileHash,
+			       sizeof(count), &count,
+			       0, NULL);
+	if (rc == 0) {
+	    hashLength = 8 + SHA256_DIGEST_SIZE;
+	    putUint32Le(templateData, hashLength);
+	    memcpy(templateData + 4, "sha256:", 8);
+	    memcpy(templateData + 12, &fileHash.digest, SHA256_DIGEST_SIZE);
+	    /* file name, nul terminated */
+	    fileNameLength = sprintf((char *)templateData + 4 + hashLength + 4,
+				     "/usr/lib/synthetic/file%u", count) + 1;
+	    putUint32Le(templateData + 4 + hashLength, fileNameLength);
+	    templateDataLength = 4 + hashLength + 4 + fileNameLength;
+	    /* the event header */
+	    putUint32Le(event, IMA_PCR);
+	    imaDigest.hashAlg = TPM_ALG_SHA1;
+	    rc = TSS_Hash_Generate(&imaDigest,
+				   templateDataLength, templateData,
+				   0, NULL);
+	}
+	if (rc == 0) {
+	    if ((count % 1000) == 999) {
+		memset(event + 4, 0, SHA1_DIGEST_SIZE);
+	    }
+	    else {
+		memcpy(event + 4, &imaDigest.digest, SHA1_DIGEST_SIZE);
+	    }
+	    putUint32Le(event + 4 + SHA1_DIGEST_SIZE, 6);
+	    memcpy(event + 4 + SHA1_DIGEST_SIZE + 4, "ima-ng", 6);
+	    putUint32Le(event + 4 + SHA1_DIGEST_SIZE + 4 + 6, templateDataLength);
+	    writeSize = fwrite(event, 1, (templateData - event) + templateDataLength, logFile);
+	    if (writeSize != (size_t)((templateData - event) + templateDataLength)) {
+		printf("timeima: could not write the event log\n");
+		rc = EXIT_FAILURE;
+	    }
+	}
+    }
+    if (rc == 0) {
+	fflush(logFile);
+    }
+    return rc;
+}
+
+static void putUint32Le(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value >> 0);
+    buffer[1] = (uint8_t)(value >> 8);
+    buffer[2] = (uint8_t)(value >> 16);
+    buffer[3] = (uint8_t)(value >> 24);
+    return;
+}
+
+static double timeDiffNs(struct timespec *startTime, struct timespec *endTime)
+{
+    return ((double)(endTime->tv_sec - startTime->tv_sec) * 1000000000.0) +
+	(double)(endTime->tv_nsec - startTime->tv_nsec);
+}
+
+static void printUsage(void)
+{
+    printf("\n");
+    printf("timeima\n");
+    printf("\n");
+    printf("Times IMA event log verification over a synthetic log.  Does not use a TPM.\n");
+    printf("\n");
+    printf("\t[-ev number of events (default 100000)]\n");
+    printf("\t[-th maximum verify threads (default 8)]\n");
+    printf("\t[-logs copies of the log replayed at once (default 16)]\n");
+    exit(1);	
+}
@@ -0,0 +1,301 @@
+/********************************************************************************/
+/*										*/
+/*		     Time the TSS KDFa Key Stream				*/
+/*			     Written by agent					*/
+/*	      $Id: timekdfa.c $							*/
+/*										*/
+/* (c) Copyright agent 2026.							*/
+/*										*/
+/* All rights reserved.								*/
+/* 										*/
+/* Redistribution and use in source and binary forms, with or without		*/
+/* modification, are permitted provided that the following conditions are	*/
+/* met:										*/
+/* 										*/
+/* Redistributions of source code must retain the above copyright notice,	*/
+/* this list of conditions and the following disclaimer.			*/
+/* 										*/
+/* Redistributions in binary form must reproduce the above copyright		*/
+/* notice, this list of conditions and the following disclaimer in the		*/
+/* documentation and/or other materials provided with the distribution.		*/
+/* 										*/
+/* Neither the names of the IBM Corporation nor the names of its		*/
+/* contributors may be used to endorse or promote products derived from		*/
+/* this software without specific prior written permission.			*/
+/* 										*/
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		*/
+/* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		*/
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	*/
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		*/
+/* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	*/
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		*/
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	*/
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	*/
+/* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		*/
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	*/
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		*/
+
+/* timekdfa times TSS_KDFA() generating the XOR parameter encryption mask for a TPM2B_MAX_BUFFER
+   sized parameter, and the XOR itself.  It does not use a TPM.
+
+   TSS_KDFA() keys the HMAC once and reuses the inner and outer pad state for each block.  As a
+   reference, it also times the same key stream with the HMAC re-keyed for each block, and checks
+   that the two key streams match.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef TPM_POSIX
+#include <netinet/in.h>
+#endif
+#ifdef TPM_WINDOWS
+#include <winsock2.h>
+#endif
+
+#include <tss2/tss.h>
+#include <tss2/tssutils.h>
+#include <tss2/tssresponsecode.h>
+#include <tss2/tsscryptoh.h>
+#include <tss2/tsscrypto.h>
+
+static void printUsage(void);
+static double timeDiffNs(struct timespec *startTime, struct timespec *endTime);
+static TPM_RC kdfaRekeyed(uint8_t *keyStream,
+			  TPM_ALG_ID hashAlg,
+			  const TPM2B *key,
+			  const char *label,
+			  const TPM2B *contextU,
+			  const TPM2B *contextV,
+			  uint32_t sizeInBits);
+
+int verbose = FALSE;
+
+int main(int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;    	/* argc iterator */
+    TPMI_ALG_HASH		halg = TPM_ALG_SHA256;
+    unsigned int 		loops = 10000;
+    unsigned int 		count;
+    uint32_t			bytes = MAX_DIGEST_BUFFER;	/* TPM2B_MAX_BUFFER */
+    TPM2B_KEY			sessionValue;
+    TPM2B_NONCE			nonceNewer;
+    TPM2B_NONCE			nonceOlder;
+    TPM2B_MAX_BUFFER		parameter;
+    uint8_t			mask[MAX_DIGEST_BUFFER];
+    uint8_t			reference[MAX_DIGEST_BUFFER];
+    struct timespec 		startTime;
+    struct timespec		endTime;
+    double			keyedNs = 0;
+    double			rekeyedNs = 0;
+    double			xorNs = 0;
+    
+    setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
+    TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
+
+    /* command line argument defaults */
+    for (i=1 ; (i<argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-halg") == 0) {
+	    i++;
+	    if (i < argc) {
+		if (strcmp(argv[i],"sha1") == 0) {
+		    halg = TPM_ALG_SHA1;
+		}
+		else if (strcmp(argv[i],"sha256") == 0) {
+		    halg = TPM_ALG_SHA256;
+		}
+		else if (strcmp(argv[i],"sha384") == 0) {
+		    halg = TPM_ALG_SHA384;
+		}
+		else {
+		    printf("Bad parameter for -halg\n");
+		    printUsage();
+		}
+	    }
+	    else {
+		printf("-halg option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-by") == 0) {
+	    i++;
+	    if (i < argc) {
+		bytes = atoi(argv[i]);
+	    }
+	    else {
+		printf("-by option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-l") == 0) {
+	    i++;
+	    if (i < argc) {
+		loops = atoi(argv[i]);
+	    }
+	    else {
+		printf("-l option needs a value\n");
+		printUsage();
+	    }
+	}
+ 	else if (strcmp(argv[i],"-h") == 0) {
+	    printUsage();
+	}
+	else if (strcmp(argv[i],"-v") == 0) {
+	    verbose = TRUE;
+	}
+	else {
+	    printf("\n%s is not a valid option\n", argv[i]);
+	    printUsage();
+	}
+    }
+    if (loops == 0) {
+	printf("Bad parameter -l\n");
+	printUsage();
+    }
+    if ((bytes == 0) || (bytes > MAX_DIGEST_BUFFER)) {
+	printf("Bad parameter -by, must be 1 to %u\n", MAX_DIGEST_BUFFER);
+	printUsage();
+    }
+    /* an HMAC session with a salt and authValue has a sessionValue of two digests */
+    if (rc == 0) {
+	sessionValue.t.size = TSS_GetDigestSize(halg) * 2;
+	nonceNewer.t.size = TSS_GetDigestSize(halg);
+	nonceOlder.t.size = TSS_GetDigestSize(halg);
+	parameter.t.size = bytes;
+	rc = TSS_RandBytes(sessionValue.t.buffer, sessionValue.t.size);
+    }
+    if (rc == 0) {
+	rc = TSS_RandBytes(nonceNewer.t.buffer, nonceNewer.t.size);
+    }
+    if (rc == 0) {
+	rc = TSS_RandBytes(nonceOlder.t.buffer, nonceOlder.t.size);
+    }
+    if (rc == 0) {
+	rc = TSS_RandBytes(parameter.t.buffer, parameter.t.size);
+    }
+    /* KDFa, HMAC keyed once per key stream */
+    if (rc == 0) {
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	for (count = 0 ; (rc == 0) && (count < loops) ; count++) {
+	    rc = TSS_KDFA(mask, halg, &sessionValue.b, "XOR",
+			  &nonceNewer.b, &nonceOlder.b, bytes * 8);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &endTime);
+	keyedNs = timeDiffNs(&startTime, &endTime) / loops;
+    }
+    /* KDFa, HMAC re-keyed for each block */
+    if (rc == 0) {
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	for (count = 0 ; (rc == 0) && (count < loops) ; count++) {
+	    rc = kdfaRekeyed(reference, halg, &sessionValue.b, "XOR",
+			     &nonceNewer.b, &nonceOlder.b, bytes * 8);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &endTime);
+	rekeyedNs = timeDiffNs(&startTime, &endTime) / loops;
+    }
+    if (rc == 0) {
+	if (memcmp(mask, reference, bytes) != 0) {
+	    printf("timekdfa: keyed and re-keyed key streams differ\n");
+	    rc = EXIT_FAILURE;
+	}
+    }
+    /* complete XOR parameter encryption, mask and XOR */
+    if (rc == 0) {
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	for (count = 0 ; (rc == 0) && (count < loops) ; count++) {
+	    rc = TSS_KDFA(mask, halg, &sessionValue.b, "XOR",
+			  &nonceNewer.b, &nonceOlder.b, bytes * 8);
+	    if (rc == 0) {
+		TSS_XOR(parameter.t.buffer, parameter.t.buffer, mask, bytes);
+	    }
+	}
+	clock_gettime(CLOCK_MONOTONIC, &endTime);
+	xorNs = timeDiffNs(&startTime, &endTime) / loops;
+    }
+    if (rc == 0) {
+	printf("Key stream %u bytes, digest %u bytes\n", bytes, TSS_GetDigestSize(halg));
+	printf("TSS_KDFA keyed once:     %8.2f us  %8.1f MB/s\n",
+	       keyedNs / 1000.0, bytes * 1000.0 / keyedNs);
+	printf("KDFa re-keyed per block: %8.2f us  %8.1f MB/s\n",
+	       rekeyedNs / 1000.0, bytes * 1000.0 / rekeyedNs);
+	printf("XOR encryption:          %8.2f us  %8.1f MB/s\n",
+	       xorNs / 1000.0, bytes * 1000.0 / xorNs);
+    }
+    if (rc == 0) {
+	if (verbose) printf("timekdfa: success\n");
+    }
+    else {
+	const char *msg;
+	const char *submsg;
+	const char *num;
+	printf("timekdfa: failed, rc %08x\n", rc);
+	TSS_ResponseCode_toString(&msg, &submsg, &num, rc);
+	printf("%s%s%s\n", msg, submsg, num);
+	rc = EXIT_FAILURE;
+    }
+    return rc;
+}
+
+/* kdfaRekeyed() is the reference, KDFa calling TSS_HMAC_Generate() for each block, which re-keys
+   the HMAC each time */
+
+static TPM_RC kdfaRekeyed(uint8_t *keyStream,
+			  TPM_ALG_ID hashAlg,
+			  const TPM2B *key,
+			  const char *label,
+			  const TPM2B *contextU,
+			  const TPM2B *contextV,
+			  uint32_t sizeInBits)
+{
+    TPM_RC	rc = 0;
+    uint32_t 	bytes = ((sizeInBits + 7) / 8);	/* bytes left to produce */
+    uint32_t 	sizeInBitsNbo = htonl(sizeInBits);	/* KDFa L2 */
+    uint16_t    bytesThisPass = TSS_GetDigestSize(hashAlg);
+    uint32_t	counter;
+    uint32_t 	counterNbo;
+    TPMT_HA 	hmac;
+
+    hmac.hashAlg = hashAlg;
+    for (counter = 1 ; (rc == 0) && (bytes > 0) ;
+	 keyStream += bytesThisPass, bytes -= bytesThisPass, counter++) {
+	if (bytes < bytesThisPass) {
+	    bytesThisPass = bytes;
+	}
+	counterNbo = htonl(counter);
+	rc = TSS_HMAC_Generate(&hmac,
+			       (const TPM2B_KEY *)key,
+			       sizeof(UINT32), &counterNbo,
+			       strlen(label) + 1, label,
+			       contextU->size, contextU->buffer,
+			       contextV->size, contextV->buffer,
+			       sizeof(UINT32), &sizeInBitsNbo,
+			       0, NULL);
+	if (rc == 0) {
+	    memcpy(keyStream, &hmac.digest, bytesThisPass);
+	}
+    }
+    return rc;
+}
+
+static double timeDiffNs(struct timespec *startTime, struct timespec *endTime)
+{
+    return ((double)(endTime->tv_sec - startTime->tv_sec) * 1000000000.0) +
+	(double)(endTime->tv_nsec - startTime->tv_nsec);
+}
+
+static void printUsage(void)
+{
+    printf("\n");
+    printf("timekdfa\n");
+    printf("\n");
+    printf("Times the TSS KDFa XOR parameter encryption key stream.  Does not use a TPM.\n");
+    printf("\n");
+    printf("\t[-halg (sha1, sha256, sha384) (default sha256)]\n");
+    printf("\t[-by key stream bytes (default %u)]\n", MAX_DIGEST_BUFFER);
+    printf("\t[-l number of loops to time (default 10000)]\n");
+    exit(1);	
+}
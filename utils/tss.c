@@ -44,6 +44,7 @@
 
 #ifdef TPM_POSIX
 #include <netinet/in.h>
+#include <time.h>
 #endif
 #ifdef TPM_WINDOWS
 #include <winsock2.h>
@@ -73,6 +74,11 @@
    cxxxx...xxxx.bin - context blob name
 */
 
+/* TPM_SESSION_CACHE property values */
+
+#define TSS_SESSION_CACHE_WRITETHROUGH	1	/* cache loads, save every update */
+#define TSS_SESSION_CACHE_WRITEBACK	2	/* cache loads, save when the cache is flushed */
+
 /* NOTE Synchronize with
 
    TSS_HmacSession_InitContext
@@ -104,10 +110,35 @@ struct TSS_HMAC_CONTEXT {
     /* Items below this line are for the lifetime of one command.  They are not saved and loaded. */
     TPM2B_KEY			hmacKey;		/* HMAC key calculated for each command */
 #ifndef TPM_TSS_NOCRYPTO
+    void			*hmacKeyCtx;		/* hmacKey inner and outer pad state */
     TPM2B_KEY			sessionValue;		/* KDFa secret for parameter encryption */
 #endif	/* TPM_TSS_NOCRYPTO */
 } TSS_HMAC_CONTEXT;
 
+/* TSS_EXECUTE_STATE holds the authorization state of one command between building the command
+   (steps 1-7) and processing the response (steps 9-13).  TSS_Execute() keeps it on the stack.
+   TSS_ExecuteSubmit() allocates it and TSS_ExecuteComplete() frees it.
+*/
+
+struct TSS_EXECUTE_STATE {
+    COMMAND_PARAMETERS		*in;			/* needed by the post processor */
+    EXTRA_PARAMETERS		*extra;
+    /* the vararg parameters */
+    TPMI_SH_AUTH_SESSION 	sessionHandle[MAX_SESSION_NUM];
+    const char 			*password[MAX_SESSION_NUM];
+    unsigned int		sessionAttributes[MAX_SESSION_NUM]; 
+    /* structures filled in */
+    TPMS_AUTH_COMMAND 		authCommand[MAX_SESSION_NUM];
+    TPMS_AUTH_RESPONSE 		authResponse[MAX_SESSION_NUM];
+    /* pointer to the above structures as used */
+    TPMS_AUTH_COMMAND 		*authC[MAX_SESSION_NUM];
+    TPMS_AUTH_RESPONSE 		*authR[MAX_SESSION_NUM];
+    /* TSS sessions */
+    struct TSS_HMAC_CONTEXT 	*session[MAX_SESSION_NUM];
+    TPM2B_NAME 			authName[MAX_SESSION_NUM];
+    TPM2B_NAME 			*names[MAX_SESSION_NUM];
+};
+
 /* functions for command pre- and post- processing */
 
 typedef TPM_RC (*TSS_PreProcessFunction_t)(TSS_CONTEXT *tssContext,
@@ -362,6 +393,66 @@ static TPM_RC TSS_Context_Init(TSS_CONTEXT *tssContext);
 static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
 				 COMMAND_PARAMETERS *in,
 				 va_list ap);
+static TPM_RC TSS_Execute_Command(TSS_CONTEXT *tssContext,
+				  struct TSS_EXECUTE_STATE *state,
+				  va_list ap);
+static TPM_RC TSS_Execute_Response(TSS_CONTEXT *tssContext,
+				   struct TSS_EXECUTE_STATE *state);
+static void   TSS_Execute_FreeState(struct TSS_EXECUTE_STATE *state);
+static void   TSS_Timing_Begin(TSS_CONTEXT *tssContext,
+			       TPM_CC commandCode);
+static void   TSS_Timing_Step(TSS_CONTEXT *tssContext,
+			      unsigned int step);
+static void   TSS_Timing_End(TSS_CONTEXT *tssContext,
+			     TPM_RC rc);
+static TPM_RC TSS_Random_Fill(TSS_CONTEXT *tssContext,
+			      uint8_t *buffer,
+			      uint32_t bytes);
+static TPM_RC TSS_TpmProperties_Load(TSS_CONTEXT *tssContext);
+#ifndef TPM_TSS_NOFILE
+static TPM_RC TSS_TpmProperties_Check(TSS_CONTEXT *tssContext,
+				      const TPML_TAGGED_TPM_PROPERTY *fixedProperties,
+				      int *match);
+#endif
+static TPM_RC TSS_TpmProperties_Read(TSS_CONTEXT *tssContext,
+				     TPML_TAGGED_TPM_PROPERTY *fixedProperties);
+static TPM_RC TSS_NV_Chunks(TSS_CONTEXT *tssContext,
+			    TPM_CC commandCode,
+			    uint8_t *buffer,
+			    uint32_t size,
+			    TPMI_RH_NV_AUTH authHandle,
+			    TPMI_RH_NV_INDEX nvIndex,
+			    uint32_t offset,
+			    va_list ap);
+static TPM_RC TSS_NV_Chunk(TSS_CONTEXT *tssContext,
+			   TPM_CC commandCode,
+			   uint8_t *buffer,
+			   uint32_t size,
+			   TPMI_RH_NV_AUTH authHandle,
+			   TPMI_RH_NV_INDEX nvIndex,
+			   uint32_t offset,
+			   TPMI_SH_AUTH_SESSION sessionHandle[],
+			   const char *password[],
+			   unsigned int sessionAttributes[]);
+static TSS_SESSION_POOL_ENTRY *TSS_SessionPool_Find(TSS_CONTEXT *tssContext,
+						    TPMI_DH_OBJECT tpmKey,
+						    TPMI_ALG_HASH authHash,
+						    const TPMT_SYM_DEF *symmetric);
+static TSS_SESSION_POOL_ENTRY *TSS_SessionPool_Victim(TSS_CONTEXT *tssContext,
+						      int loadedOnly);
+static TPM_RC TSS_SessionPool_Start(TSS_CONTEXT *tssContext,
+				    TSS_SESSION_POOL_ENTRY *entry,
+				    TPMI_DH_OBJECT tpmKey,
+				    TPMI_ALG_HASH authHash,
+				    const TPMT_SYM_DEF *symmetric);
+static TPM_RC TSS_SessionPool_Load(TSS_CONTEXT *tssContext,
+				   TSS_SESSION_POOL_ENTRY *entry);
+static TPM_RC TSS_SessionPool_MakeRoom(TSS_CONTEXT *tssContext,
+				       TPM_RC tpmRc);
+static TPM_RC TSS_SessionPool_Evict(TSS_CONTEXT *tssContext,
+				    TSS_SESSION_POOL_ENTRY *entry);
+static void TSS_SessionPool_Delete(TSS_CONTEXT *tssContext,
+				   TPMI_SH_AUTH_SESSION sessionHandle);
 
 
 static TPM_RC TSS_PwapSession_Set(TPMS_AUTH_COMMAND *authCommand,
@@ -409,6 +500,18 @@ static TPM_RC TSS_HmacSession_SaveSession(TSS_CONTEXT *tssContext,
 static TPM_RC TSS_HmacSession_LoadSession(TSS_CONTEXT *tssContext,
 					  struct TSS_HMAC_CONTEXT *session,
 					  TPMI_SH_AUTH_SESSION	sessionHandle);
+static TPM_RC TSS_HmacSession_StoreSession(TSS_CONTEXT *tssContext,
+					   struct TSS_HMAC_CONTEXT *session);
+static TPM_RC TSS_HmacSession_ReadSession(TSS_CONTEXT *tssContext,
+					  struct TSS_HMAC_CONTEXT *session,
+					  TPMI_SH_AUTH_SESSION	sessionHandle);
+static TSS_SESSION_CACHE *TSS_SessionCache_Find(TSS_CONTEXT *tssContext,
+						TPMI_SH_AUTH_SESSION sessionHandle);
+static TSS_SESSION_CACHE *TSS_SessionCache_Put(TSS_CONTEXT *tssContext,
+					       struct TSS_HMAC_CONTEXT *session);
+static void TSS_SessionCache_Delete(TSS_CONTEXT *tssContext,
+				    TPMI_SH_AUTH_SESSION sessionHandle,
+				    int *stored);
 #ifdef TPM_TSS_NOFILE
 static TPM_RC TSS_HmacSession_SaveData(TSS_CONTEXT *tssContext,
 				       TPMI_SH_AUTH_SESSION sessionHandle,
@@ -430,6 +533,14 @@ static TPM_RC TSS_HmacSession_Unmarshal(struct TSS_HMAC_CONTEXT *target,
 
 static TPM_RC TSS_Name_GetAllNames(TSS_CONTEXT *tssContext,
 				   TPM2B_NAME **names);
+#ifndef TPM_TSS_NOFILE
+static TSS_NAME_CACHE *TSS_NameCache_Get(TSS_CONTEXT *tssContext,
+					 TPM_HANDLE handle,
+					 const char *string,
+					 int create);
+static void TSS_NameCache_Delete(TSS_CONTEXT *tssContext,
+				 TPM_HANDLE handle);
+#endif
 static TPM_RC TSS_Name_GetName(TSS_CONTEXT *tssContext,
 			       TPM2B_NAME *name,
 			       TPM_HANDLE  handle);
@@ -537,8 +648,17 @@ static TPM_RC TSS_HashToString(char *str, uint8_t *digest);
 #ifndef TPM_TSS_NOCRYPTO
 static TPM_RC TSS_RSA_Salt(TPM2B_DIGEST 		*salt,
 			   TPM2B_ENCRYPTED_SECRET	*encryptedSalt,
-			   TPMT_PUBLIC			*publicArea);
+			   TPMT_PUBLIC			*publicArea,
+			   void				*rsaKey);
+static TSS_SALT_KEY_CACHE *TSS_SaltKeyCache_Get(TSS_CONTEXT *tssContext,
+						TPM_HANDLE handle);
+static TSS_SALT_KEY_CACHE *TSS_SaltKeyCache_Add(TSS_CONTEXT *tssContext,
+						TPM_HANDLE handle,
+						TPMT_PUBLIC *publicArea);
 #endif
+static void TSS_SaltKeyCache_Clear(TSS_CONTEXT *tssContext);
+static void TSS_SaltKeyCache_Delete(TSS_CONTEXT *tssContext,
+				    TPM_HANDLE handle);
 extern int tssVerbose;
 extern int tssVverbose;
 extern int tssFirstCall;
@@ -561,10 +681,16 @@ TPM_RC TSS_Create(TSS_CONTEXT **tssContext)
     }
     /* initialize the high level TSS structure */
     if (rc == 0) {
+	(*tssContext)->tssEccSaltPool = 0;	/* before any failure can release it */
 	rc = TSS_Context_Init(*tssContext);
 	/* the likely cause of a failure is a bad environment variable */
 	if (rc != 0) {
 	    if (tssVerbose) printf("TSS_Create: TSS_Context_Init() failed\n");
+#ifndef TPM_TSS_NOCRYPTO
+	    if ((*tssContext)->tssEccSaltPool > 0) {
+		TSS_ECC_PoolStop();
+	    }
+#endif
 	    free(*tssContext);
 	    *tssContext = NULL;
 	}
@@ -637,8 +763,26 @@ static TPM_RC TSS_Context_Init(TSS_CONTEXT *tssContext)
 TPM_RC TSS_Delete(TSS_CONTEXT *tssContext)
 {
     TPM_RC rc = 0;
+    TPM_RC rc1;
 
     if (tssContext != NULL) {
+	/* flush the idle pooled sessions, unless a pending command holds the connection */
+	if (tssContext->tssExecuteState == NULL) {
+	    rc = TSS_SessionPool_Flush(tssContext);
+	}
+	/* write back cached sessions while the session encryption key is still available */
+	rc1 = TSS_SessionCache_Flush(tssContext);
+	if (rc == 0) {
+	    rc = rc1;
+	}
+	/* abandon a submitted command that was never completed */
+	TSS_Execute_FreeState(tssContext->tssExecuteState);
+	free(tssContext->timingRing);
+	/* erase any unused random numbers */
+	if (tssContext->randomPool != NULL) {
+	    memset(tssContext->randomPool, 0, tssContext->tssRandomPool);
+	    free(tssContext->randomPool);
+	}
 	TSS_AuthDelete(tssContext->tssAuthContext);
 #ifdef TPM_TSS_NOFILE
 	{
@@ -653,11 +797,19 @@ TPM_RC TSS_Delete(TSS_CONTEXT *tssContext)
 	    }
 	}
 #endif
+	TSS_SaltKeyCache_Clear(tssContext);
 #ifndef TPM_TSS_NOCRYPTO
+	/* release the ECC salt pool reference, the last one stops the refill thread */
+	if (tssContext->tssEccSaltPool > 0) {
+	    TSS_ECC_PoolStop();
+	}
 	free(tssContext->tssSessionEncKey);
 	free(tssContext->tssSessionDecKey);
 #endif
-	rc = TSS_Close(tssContext);
+	rc1 = TSS_Close(tssContext);
+	if (rc == 0) {
+	    rc = rc1;
+	}
 	free(tssContext);
     }
     return rc;
@@ -689,9 +841,15 @@ TPM_RC TSS_Execute(TSS_CONTEXT *tssContext,
     TPM_RC		rc = 0;
     va_list		ap;
 
-    /* create a TSS context */
+    /* a pending TSS_ExecuteSubmit() owns the authorization context until TSS_ExecuteComplete() */
+    if (tssContext->tssExecuteState != NULL) {
+	if (tssVerbose) printf("TSS_Execute: Error, command already pending\n");
+	return TSS_RC_COMMAND_PENDING;
+    }
+    TSS_Timing_Begin(tssContext, commandCode);
+    /* reset the TSS authorization context, reused for each command */
     if (rc == 0) {
-	TSS_InitAuthContext(tssContext->tssAuthContext);
+	TSS_ResetAuthContext(tssContext->tssAuthContext);
     }
     /* handle any command specific command pre-processing */
     if (rc == 0) {
@@ -707,6 +865,7 @@ TPM_RC TSS_Execute(TSS_CONTEXT *tssContext,
 			 in,
 			 commandCode);
     }
+    TSS_Timing_Step(tssContext, TSS_STEP_MARSHAL);
     /* execute the command */
     if (rc == 0) {
 	va_start(ap, commandCode);
@@ -726,6 +885,162 @@ TPM_RC TSS_Execute(TSS_CONTEXT *tssContext,
 					out,
 					extra);
     }
+    TSS_Timing_Step(tssContext, TSS_STEP_UNMARSHAL);
+    TSS_Timing_End(tssContext, rc);
+    /* erase the buffers of a sensitive command */
+    TSS_WipeAuthContext(tssContext->tssAuthContext, tssContext->tssSecureWipe);
+    return rc;
+}
+
+/* TSS_ExecuteSubmit() performs the first half of TSS_Execute().  It marshals the command, adds
+   the authorizations and parameter encryption, and transmits the command without waiting for the
+   response.
+
+   The varargs are the same as TSS_Execute().  The passwords are only used during the call.  'in'
+   and 'extra' must remain valid until TSS_ExecuteComplete().
+
+   Only one command can be pending per TSS_CONTEXT.  An application multiplexing several commands
+   uses a TSS_CONTEXT per command in flight, and calls TSS_ExecuteComplete() when TSS_GetPollFd()
+   is readable.  TSS_Execute() on a context with a pending command returns
+   TSS_RC_COMMAND_PENDING.
+
+   TSS_ExecuteComplete() still reads the response with a blocking receive.  Waiting for
+   TSS_GetPollFd() first is what keeps it from blocking.
+*/
+
+TPM_RC TSS_ExecuteSubmit(TSS_CONTEXT *tssContext,
+			 COMMAND_PARAMETERS *in,
+			 EXTRA_PARAMETERS *extra,
+			 TPM_CC commandCode,
+			 ...)
+{
+    TPM_RC		rc = 0;
+    va_list		ap;
+    struct TSS_EXECUTE_STATE *state = NULL;
+
+    if (rc == 0) {
+	if (tssContext->tssExecuteState != NULL) {
+	    if (tssVerbose) printf("TSS_ExecuteSubmit: Error, command already pending\n");
+	    rc = TSS_RC_COMMAND_PENDING;
+	}
+    }
+    if (rc == 0) {
+	TSS_Timing_Begin(tssContext, commandCode);
+	TSS_ResetAuthContext(tssContext->tssAuthContext);
+    }
+    /* handle any command specific command pre-processing */
+    if (rc == 0) {
+	rc = TSS_Command_PreProcessor(tssContext,
+				      commandCode,
+				      in,
+				      extra);
+    }
+    /* marshal input parameters */
+    if (rc == 0) {
+	if (tssVverbose) printf("TSS_ExecuteSubmit: Command %08x marshal\n", commandCode);
+	rc = TSS_Marshal(tssContext->tssAuthContext,
+			 in,
+			 commandCode);
+	TSS_Timing_Step(tssContext, TSS_STEP_MARSHAL);
+    }
+    if (rc == 0) {
+	rc = TSS_Malloc((uint8_t **)&state, sizeof(struct TSS_EXECUTE_STATE));
+    }
+    /* steps 1-7, authorizations and parameter encryption */
+    if (rc == 0) {
+	state->in = in;
+	state->extra = extra;
+	va_start(ap, commandCode);
+	rc = TSS_Execute_Command(tssContext, state, ap);
+	va_end(ap);
+    }
+    /* step 8, transmit only */
+    if (rc == 0) {
+	if (tssVverbose) printf("TSS_ExecuteSubmit: Step 8: send the command\n");
+	rc = TSS_AuthSend(tssContext);
+    }
+    if (rc == 0) {
+	tssContext->tssExecuteState = state;
+    }
+    else {
+	TSS_Execute_FreeState(state);
+	/* the buffers and the timing belong to the pending command */
+	if (rc != TSS_RC_COMMAND_PENDING) {
+	    TSS_Timing_End(tssContext, rc);
+	    TSS_WipeAuthContext(tssContext->tssAuthContext, tssContext->tssSecureWipe);
+	}
+    }
+    return rc;
+}
+
+/* TSS_ExecuteComplete() performs the second half of TSS_Execute() for the command sent by
+   TSS_ExecuteSubmit().  It receives the response, validates the response authorizations, saves
+   the sessions, decrypts the response parameters, and unmarshals 'out'.
+
+   It returns the TPM response code, as TSS_Execute() does.  The command is no longer pending after
+   the call, whether or not it succeeds.
+
+   The exception is TSS_RC_WOULD_BLOCK, returned by a non-blocking device when the complete
+   response is not yet available.  The command remains pending, and the application calls
+   TSS_ExecuteComplete() again when TSS_GetPollFd() is readable.
+*/
+
+TPM_RC TSS_ExecuteComplete(TSS_CONTEXT *tssContext,
+			   RESPONSE_PARAMETERS *out)
+{
+    TPM_RC		rc = 0;
+    struct TSS_EXECUTE_STATE *state = tssContext->tssExecuteState;
+    COMMAND_PARAMETERS	*in = NULL;
+    EXTRA_PARAMETERS	*extra = NULL;
+
+    if (rc == 0) {
+	if (state == NULL) {
+	    if (tssVerbose) printf("TSS_ExecuteComplete: Error, no command pending\n");
+	    rc = TSS_RC_NO_COMMAND_PENDING;
+	}
+    }
+    if (rc == 0) {
+	tssContext->tssExecuteState = NULL;
+	in = state->in;
+	extra = state->extra;
+    }
+    /* step 8, receive only.  Normally returns the TPM response code. */
+    if (rc == 0) {
+	if (tssVverbose) printf("TSS_ExecuteComplete: Step 8: receive the response\n");
+	rc = TSS_AuthReceive(tssContext);
+    }
+    /* the transmit time runs from the send to the end of the receive */
+    if (state != NULL) {
+	TSS_Timing_Step(tssContext, TSS_STEP_TRANSMIT);
+    }
+    if (rc == TSS_RC_WOULD_BLOCK) {
+	tssContext->tssExecuteState = state;
+	return rc;
+    }
+    /* steps 9-13, response authorizations and parameter decryption */
+    if (rc == 0) {
+	rc = TSS_Execute_Response(tssContext, state);
+    }
+    TSS_Execute_FreeState(state);
+    /* unmarshal the response parameters */
+    if (rc == 0) {
+	if (tssVverbose) printf("TSS_ExecuteComplete: Command %08x unmarshal\n",
+				TSS_GetCommandCode(tssContext->tssAuthContext));
+	rc = TSS_Unmarshal(tssContext->tssAuthContext, out);
+    }
+    /* handle any command specific response post-processing */
+    if (rc == 0) {
+	rc = TSS_Response_PostProcessor(tssContext,
+					in,
+					out,
+					extra);
+    }
+    /* erase the buffers of a sensitive command */
+    if (state != NULL) {
+	TSS_Timing_Step(tssContext, TSS_STEP_UNMARSHAL);
+	TSS_Timing_End(tssContext, rc);
+	TSS_WipeAuthContext(tssContext->tssAuthContext, tssContext->tssSecureWipe);
+    }
     return rc;
 }
 
@@ -744,6 +1059,43 @@ TPM_RC TSS_Execute(TSS_CONTEXT *tssContext,
 static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
 				 COMMAND_PARAMETERS *in,
 				 va_list ap)
+{
+    TPM_RC		rc = 0;
+    unsigned int	i;
+    struct TSS_EXECUTE_STATE state;
+
+    state.in = in;
+    state.extra = NULL;
+    /* Steps 1-7: build the command */
+    if (rc == 0) {
+	rc = TSS_Execute_Command(tssContext, &state, ap);
+    }
+    /* Step 8: process the command.  Normally returns the TPM response code. */
+    if (rc == 0) {
+	if (tssVverbose) printf("TSS_Execute_valist: Step 8: process the command\n");
+	rc = TSS_AuthExecute(tssContext);
+	TSS_Timing_Step(tssContext, TSS_STEP_TRANSMIT);
+    }
+    /* Steps 9-13: process the response */
+    if (rc == 0) {
+	rc = TSS_Execute_Response(tssContext, &state);
+    }
+    /* cleanup */
+    for (i = 0 ; i < MAX_SESSION_NUM ; i++) {
+	TSS_HmacSession_FreeContext(state.session[i]);
+    }
+    return rc;
+}
+
+/* TSS_Execute_Command() performs steps 1-7 of TSS_Execute_valist(), gathering the
+   authorizations, rolling nonces, calculating HMACs, and encrypting the command parameter.
+
+   The session contexts in 'state' are allocated even on error, and must be freed by the caller.
+*/
+
+static TPM_RC TSS_Execute_Command(TSS_CONTEXT *tssContext,
+				  struct TSS_EXECUTE_STATE *state,
+				  va_list ap)
 {
     TPM_RC		rc = 0;
     int 		done;
@@ -751,22 +1103,22 @@ static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
     unsigned int	i = 0;
 
     /* the vararg parameters */
-    TPMI_SH_AUTH_SESSION sessionHandle[MAX_SESSION_NUM];
-    const char 		*password[MAX_SESSION_NUM];
-    unsigned int	sessionAttributes[MAX_SESSION_NUM]; 
+    TPMI_SH_AUTH_SESSION *sessionHandle = state->sessionHandle;
+    const char 		**password = state->password;
+    unsigned int	*sessionAttributes = state->sessionAttributes;
 
     /* structures filled in */
-    TPMS_AUTH_COMMAND 	authCommand[MAX_SESSION_NUM];
-    TPMS_AUTH_RESPONSE 	authResponse[MAX_SESSION_NUM];
+    TPMS_AUTH_COMMAND 	*authCommand = state->authCommand;
+    TPMS_AUTH_RESPONSE 	*authResponse = state->authResponse;
     
     /* pointer to the above structures as used */
-    TPMS_AUTH_COMMAND 	*authC[MAX_SESSION_NUM];
-    TPMS_AUTH_RESPONSE 	*authR[MAX_SESSION_NUM];
+    TPMS_AUTH_COMMAND 	**authC = state->authC;
+    TPMS_AUTH_RESPONSE 	**authR = state->authR;
 
     /* TSS sessions */
-    struct TSS_HMAC_CONTEXT *session[MAX_SESSION_NUM];
-    TPM2B_NAME authName[MAX_SESSION_NUM];
-    TPM2B_NAME *names[MAX_SESSION_NUM];
+    struct TSS_HMAC_CONTEXT **session = state->session;
+    TPM2B_NAME		*authName = state->authName;
+    TPM2B_NAME		**names = state->names;
 	
     /* Step 1: initialization */
     if (tssVverbose) printf("TSS_Execute_valist: Step 1: initialization\n");
@@ -817,6 +1169,7 @@ static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
 		if ((rc == 0) && !haveNames) {
 		    rc = TSS_Name_GetAllNames(tssContext, names);
 		    haveNames = TRUE;	/* get only once, minor optimization */
+		    TSS_Timing_Step(tssContext, TSS_STEP_NAMES);
 		}
 		/* initialize a TSS HMAC session */
 		if (rc == 0) {
@@ -825,6 +1178,7 @@ static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
 		/* load the session created by startauthsession */
 		if (rc == 0) {
 		    rc = TSS_HmacSession_LoadSession(tssContext, session[i], sessionHandle[i]);
+		    TSS_Timing_Step(tssContext, TSS_STEP_SESSION_LOAD);
 		}
 	    }
 	}
@@ -856,6 +1210,7 @@ static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
 	}
     }
 #endif	/* TPM_TSS_NOCRYPTO */
+    TSS_Timing_Step(tssContext, TSS_STEP_HMAC);
     /* Step 5: command parameter encryption */
     if (rc == 0) {
 	if (tssVverbose) printf("TSS_Execute_valist: Step 5: command encrypt\n");
@@ -863,6 +1218,7 @@ static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
 				 session,
 				 sessionHandle,
 				 sessionAttributes);
+	TSS_Timing_Step(tssContext, TSS_STEP_ENCRYPT);
     }
     /* Step 6: for each HMAC session, calculate cpHash, calculate the HMAC, and set it in
        TPMS_AUTH_COMMAND */
@@ -887,11 +1243,26 @@ static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
 			     authC[2],
 			     NULL);
     }
-    /* Step 8: process the command.  Normally returns the TPM response code. */
-    if (rc == 0) {
-	if (tssVverbose) printf("TSS_Execute_valist: Step 8: process the command\n");
-	rc = TSS_AuthExecute(tssContext);
-    }
+    TSS_Timing_Step(tssContext, TSS_STEP_HMAC);
+    return rc;
+}
+
+/* TSS_Execute_Response() performs steps 9-13 of TSS_Execute_valist(), validating the response
+   authorizations, saving or deleting the sessions, and decrypting the response parameter.  It is
+   called only if the TPM returned success.
+*/
+
+static TPM_RC TSS_Execute_Response(TSS_CONTEXT *tssContext,
+				   struct TSS_EXECUTE_STATE *state)
+{
+    TPM_RC		rc = 0;
+    unsigned int	i = 0;
+    COMMAND_PARAMETERS	*in = state->in;
+    TPMI_SH_AUTH_SESSION *sessionHandle = state->sessionHandle;
+    unsigned int	*sessionAttributes = state->sessionAttributes;
+    TPMS_AUTH_RESPONSE 	**authR = state->authR;
+    struct TSS_HMAC_CONTEXT **session = state->session;
+
     /* Step 9: get the response authorizations from the TSS response stream */
     if (rc == 0) {
 	if (tssVverbose) printf("TSS_Execute_valist: Step 9 get response authorizations\n");
@@ -952,6 +1323,7 @@ static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
 	    session[i]->bind = TPM_RH_NULL;
 	}
     }
+    TSS_Timing_Step(tssContext, TSS_STEP_VERIFY);
     /* Step 12: process the response continue flag */
     for (i = 0 ; (rc == 0) && (i < MAX_SESSION_NUM) && (sessionHandle[i] != TPM_RH_NULL) ; i++) {
 	if (sessionHandle[i] != TPM_RS_PW) {
@@ -960,6 +1332,7 @@ static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
 	    rc = TSS_HmacSession_Continue(tssContext, session[i], authR[i]);
 	}
     }
+    TSS_Timing_Step(tssContext, TSS_STEP_SESSION_SAVE);
     /* Step 13: response parameter decryption */
     if (rc == 0) {
 	if (tssVverbose) printf("TSS_Execute_valist: Step 13: response decryption\n");
@@ -967,14 +1340,1202 @@ static TPM_RC TSS_Execute_valist(TSS_CONTEXT *tssContext,
 				  session,
 				  sessionHandle,
 				  sessionAttributes);
+	TSS_Timing_Step(tssContext, TSS_STEP_DECRYPT);
     }
-    /* cleanup */
-    for (i = 0 ; i < MAX_SESSION_NUM ; i++) {
-	TSS_HmacSession_FreeContext(session[i]);
+    return rc;
+}
+
+/* TSS_Execute_FreeState() frees the session contexts and the TSS_ExecuteSubmit() state */
+
+static void TSS_Execute_FreeState(struct TSS_EXECUTE_STATE *state)
+{
+    unsigned int	i;
+
+    if (state != NULL) {
+	for (i = 0 ; i < MAX_SESSION_NUM ; i++) {
+	    TSS_HmacSession_FreeContext(state->session[i]);
+	}
+	free(state);
+    }
+    return;
+}
+
+/*
+  Execute Timing
+*/
+
+/* TSS_Timing_Now() returns a monotonic time in nanoseconds.  It is exported so that the utilities
+   can time their own loops portably. */
+
+uint64_t TSS_Timing_Now(void)
+{
+#ifdef TPM_POSIX
+    struct timespec	now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+#endif
+#ifdef TPM_WINDOWS
+    LARGE_INTEGER	count;
+    LARGE_INTEGER	frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    /* split to avoid overflow of count * 10^9 */
+    return (((uint64_t)count.QuadPart / frequency.QuadPart) * 1000000000) +
+	((((uint64_t)count.QuadPart % frequency.QuadPart) * 1000000000) / frequency.QuadPart);
+#endif
+}
+
+/* TSS_Timing_Begin() starts the timing record for a command.  The timing functions do nothing
+   unless the TPM_EXECUTE_TIMING property is set.
+*/
+
+static void TSS_Timing_Begin(TSS_CONTEXT *tssContext,
+			     TPM_CC commandCode)
+{
+    if (tssContext->timingRing != NULL) {
+	memset(&tssContext->timingCurrent, 0, sizeof(TSS_EXECUTE_TIMING));
+	tssContext->timingCurrent.commandCode = commandCode;
+	tssContext->timingMark = TSS_Timing_Now();
+    }
+    return;
+}
+
+/* TSS_Timing_Step() adds the time since the end of the previous step to 'step'.  A step can occur
+   more than once per command, e.g. once per session, and accumulates.
+*/
+
+static void TSS_Timing_Step(TSS_CONTEXT *tssContext,
+			    unsigned int step)
+{
+    uint64_t	now;
+
+    if (tssContext->timingRing != NULL) {
+	now = TSS_Timing_Now();
+	tssContext->timingCurrent.stepNs[step] += now - tssContext->timingMark;
+	tssContext->timingMark = now;
+    }
+    return;
+}
+
+/* TSS_Timing_End() records the command in the ring, replacing the oldest record if the ring is
+   full */
+
+static void TSS_Timing_End(TSS_CONTEXT *tssContext,
+			   TPM_RC rc)
+{
+    if (tssContext->timingRing != NULL) {
+	tssContext->timingCurrent.rc = rc;
+	tssContext->timingRing[tssContext->timingNext] = tssContext->timingCurrent;
+	tssContext->timingNext = (tssContext->timingNext + 1) % tssContext->tssExecuteTiming;
+	if (tssContext->timingCount < tssContext->tssExecuteTiming) {
+	    tssContext->timingCount++;
+	}
+    }
+    return;
+}
+
+/* TSS_GetExecuteTiming() returns the TSS_Execute() step timing records, oldest first, and removes
+   them from the context.
+
+   On input, count is the number of entries in the timing array.  On output, it is the number of
+   records returned.  It is 0 unless the TPM_EXECUTE_TIMING property is set.
+
+   For TSS_ExecuteSubmit() and TSS_ExecuteComplete(), the transmit step includes the time between
+   the two calls.
+*/
+
+TPM_RC TSS_GetExecuteTiming(TSS_CONTEXT *tssContext,
+			    TSS_EXECUTE_TIMING *timing,
+			    uint32_t *count)
+{
+    TPM_RC	rc = 0;
+    uint32_t	i;
+    uint32_t	oldest;
+
+    if (rc == 0) {
+	if ((tssContext == NULL) || (timing == NULL) || (count == NULL)) {
+	    if (tssVerbose) printf("TSS_GetExecuteTiming: Error, NULL parameter\n");
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    if (rc == 0) {
+	if (*count > tssContext->timingCount) {
+	    *count = tssContext->timingCount;
+	}
+	for (i = 0 ; i < *count ; i++) {
+	    oldest = (tssContext->timingNext + tssContext->tssExecuteTiming -
+		      tssContext->timingCount) % tssContext->tssExecuteTiming;
+	    timing[i] = tssContext->timingRing[oldest];
+	    tssContext->timingCount--;
+	}
+    }
+    return rc;
+}
+
+/*
+  Random Number Pool
+*/
+
+/* TSS_GetRandom() returns 'bytes' random numbers from the TPM.
+
+   If the TPM_RANDOM_POOL property is set, small requests are served from a pool that is refilled
+   from the TPM in pool size batches, so most requests do not need a TPM command.  Requests at
+   least as large as the pool bypass it and are filled directly.
+
+   If the TPM_RANDOM_MIX property is set, the TPM random numbers are XORed with random numbers from
+   the crypto library.
+*/
+
+TPM_RC TSS_GetRandom(TSS_CONTEXT *tssContext,
+		     uint8_t *buffer,
+		     uint32_t bytes)
+{
+    TPM_RC	rc = 0;
+    uint32_t	copyBytes;
+    uint8_t	*poolBytes;
+
+    if (rc == 0) {
+	if ((tssContext == NULL) || ((buffer == NULL) && (bytes != 0))) {
+	    if (tssVerbose) printf("TSS_GetRandom: Error, NULL parameter\n");
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    /* the TPM commands would overwrite the pending command */
+    if (rc == 0) {
+	if (tssContext->tssExecuteState != NULL) {
+	    if (tssVerbose) printf("TSS_GetRandom: Error, command pending\n");
+	    rc = TSS_RC_COMMAND_PENDING;
+	}
+    }
+    while ((rc == 0) && (bytes > 0)) {
+	/* serve from the pool, erasing the bytes handed out */
+	if (tssContext->randomPoolAvailable > 0) {
+	    copyBytes = (bytes < tssContext->randomPoolAvailable) ?
+			bytes : tssContext->randomPoolAvailable;
+	    poolBytes = tssContext->randomPool +
+			(tssContext->tssRandomPool - tssContext->randomPoolAvailable);
+	    memcpy(buffer, poolBytes, copyBytes);
+	    memset(poolBytes, 0, copyBytes);
+	    tssContext->randomPoolAvailable -= copyBytes;
+	    buffer += copyBytes;
+	    bytes -= copyBytes;
+	}
+	/* large request or no pool, fill the caller's buffer directly */
+	else if (bytes >= tssContext->tssRandomPool) {
+	    rc = TSS_Random_Fill(tssContext, buffer, bytes);
+	    bytes = 0;
+	}
+	/* refill the pool */
+	else {
+	    rc = TSS_Random_Fill(tssContext, tssContext->randomPool, tssContext->tssRandomPool);
+	    if (rc == 0) {
+		tssContext->randomPoolAvailable = tssContext->tssRandomPool;
+	    }
+	}
+    }
+    return rc;
+}
+
+/* TSS_Random_Fill() fills 'buffer' with TPM random numbers, optionally mixed with crypto library
+   random numbers.  Each TPM2_GetRandom returns at most the size of the TPM's largest digest.
+*/
+
+static TPM_RC TSS_Random_Fill(TSS_CONTEXT *tssContext,
+			      uint8_t *buffer,
+			      uint32_t bytes)
+{
+    TPM_RC		rc = 0;
+    GetRandom_In 	in;
+    GetRandom_Out 	out;
+    uint32_t		bytesCopied;
+#ifndef TPM_TSS_NOCRYPTO
+    uint32_t		i;
+    uint8_t		mix[sizeof(TPMU_HA)];
+#endif
+
+    for (bytesCopied = 0 ; (rc == 0) && (bytesCopied < bytes) ; ) {
+	if ((bytes - bytesCopied) < sizeof(TPMU_HA)) {
+	    in.bytesRequested = bytes - bytesCopied;
+	}
+	else {
+	    in.bytesRequested = sizeof(TPMU_HA);
+	}
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_GetRandom,
+			 TPM_RH_NULL, NULL, 0);
+	/* guard against a TPM that never makes progress */
+	if (rc == 0) {
+	    if ((out.randomBytes.t.size == 0) ||
+		(out.randomBytes.t.size > in.bytesRequested)) {
+		if (tssVerbose) printf("TSS_Random_Fill: Error, TPM returned %u bytes\n",
+				       out.randomBytes.t.size);
+		rc = TSS_RC_RNG_FAILURE;
+	    }
+	}
+#ifndef TPM_TSS_NOCRYPTO
+	if ((rc == 0) && tssContext->tssRandomMix) {
+	    rc = TSS_RandBytes(mix, out.randomBytes.t.size);
+	    for (i = 0 ; (rc == 0) && (i < out.randomBytes.t.size) ; i++) {
+		out.randomBytes.t.buffer[i] ^= mix[i];
+	    }
+	}
+#endif
+	if (rc == 0) {
+	    memcpy(buffer + bytesCopied, out.randomBytes.t.buffer, out.randomBytes.t.size);
+	    bytesCopied += out.randomBytes.t.size;
+	}
+    }
+#ifndef TPM_TSS_NOCRYPTO
+    memset(mix, 0, sizeof(mix));
+#endif
+    memset(out.randomBytes.t.buffer, 0, sizeof(out.randomBytes.t.buffer));
+    return rc;
+}
+
+/*
+  TPM Properties
+*/
+
+/* TSS_GetTpmProperty() returns the value of the TPM_CAP_TPM_PROPERTIES property 'property'.
+
+   The fixed properties (PT_FIXED group) do not change while the TPM is powered.  They are read
+   with one bulk TPM2_GetCapability the first time any of them is requested, and then served from
+   the context until the connection is closed.  If the TPM_PROPERTY_CACHE property is set, they are
+   also saved in the data directory, and a later context loads them from there after checking the
+   TPM manufacturer and firmware version with one small TPM command.  Other properties are read
+   from the TPM on each call.
+
+   Returns TSS_RC_NO_TPM_PROPERTY if the TPM does not report the property.
+*/
+
+TPM_RC TSS_GetTpmProperty(TSS_CONTEXT *tssContext,
+			  TPM_PT property,
+			  uint32_t *value)
+{
+    TPM_RC			rc = 0;
+    uint32_t			i;
+    int				found = FALSE;
+    GetCapability_In 		in;
+    GetCapability_Out		out;
+    TPML_TAGGED_TPM_PROPERTY 	*tpmProperties = NULL;
+
+    if (rc == 0) {
+	if ((tssContext == NULL) || (value == NULL)) {
+	    if (tssVerbose) printf("TSS_GetTpmProperty: Error, NULL parameter\n");
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    /* the TPM commands would overwrite the pending command */
+    if (rc == 0) {
+	if (tssContext->tssExecuteState != NULL) {
+	    if (tssVerbose) printf("TSS_GetTpmProperty: Error, command pending\n");
+	    rc = TSS_RC_COMMAND_PENDING;
+	}
+    }
+    if (rc == 0) {
+	if ((property >= PT_FIXED) && (property < PT_VAR)) {
+	    if (!tssContext->fixedPropertiesValid) {
+		rc = TSS_TpmProperties_Load(tssContext);
+	    }
+	    tpmProperties = &tssContext->fixedProperties;
+	}
+	else {
+	    in.capability = TPM_CAP_TPM_PROPERTIES;
+	    in.property = property;
+	    in.propertyCount = 1;
+	    rc = TSS_Execute(tssContext,
+			     (RESPONSE_PARAMETERS *)&out,
+			     (COMMAND_PARAMETERS *)&in,
+			     NULL,
+			     TPM_CC_GetCapability,
+			     TPM_RH_NULL, NULL, 0);
+	    tpmProperties = &out.capabilityData.data.tpmProperties;
+	}
+    }
+    for (i = 0 ; (rc == 0) && !found && (i < tpmProperties->count) ; i++) {
+	if (tpmProperties->tpmProperty[i].property == property) {
+	    *value = tpmProperties->tpmProperty[i].value;
+	    found = TRUE;
+	}
+    }
+    if ((rc == 0) && !found) {
+	if (tssVverbose) printf("TSS_GetTpmProperty: property %08x not reported\n", property);
+	rc = TSS_RC_NO_TPM_PROPERTY;
+    }
+    return rc;
+}
+
+/* TSS_TpmProperties_Load() fills the context fixed property cache, from the data directory if
+   the TPM_PROPERTY_CACHE property is set and the file exists, otherwise from the TPM. */
+
+static TPM_RC TSS_TpmProperties_Load(TSS_CONTEXT *tssContext)
+{
+    TPM_RC		rc = 0;
+    int			loaded = FALSE;
+#ifndef TPM_TSS_NOFILE
+    char 		propertiesFilename[128];
+    FILE		*propertiesFile = NULL;
+    int			exists = FALSE;
+
+    if (tssContext->tssPropertyCache) {
+	sprintf(propertiesFilename, "%s/tpmproperties.bin", tssContext->tssDataDirectory);
+	/* a missing file is the normal first use, so check for it before TSS_File_Open() traces an
+	   error */
+	propertiesFile = fopen(propertiesFilename, "rb");
+	if (propertiesFile != NULL) {
+	    fclose(propertiesFile);
+	    exists = TRUE;
+	}
+	else {
+	    if (tssVverbose) printf("TSS_TpmProperties_Load: No file %s\n", propertiesFilename);
+	}
+    }
+    if (exists) {
+	/* a bad file is not an error, the properties are read from the TPM */
+	if (TSS_File_ReadStructure(&tssContext->fixedProperties,
+				   (UnmarshalFunction_t)TPML_TAGGED_TPM_PROPERTY_Unmarshal,
+				   propertiesFilename) == 0) {
+	    /* a file saved from a different TPM or firmware is stale, and is overwritten */
+	    rc = TSS_TpmProperties_Check(tssContext, &tssContext->fixedProperties, &loaded);
+	    if (tssVverbose) printf("TSS_TpmProperties_Load: File %s %s\n", propertiesFilename,
+				    loaded ? "matches" : "is stale");
+	}
+    }
+#endif
+    if ((rc == 0) && !loaded) {
+	rc = TSS_TpmProperties_Read(tssContext, &tssContext->fixedProperties);
+#ifndef TPM_TSS_NOFILE
+	if ((rc == 0) && tssContext->tssPropertyCache) {
+	    if (tssVverbose) printf("TSS_TpmProperties_Load: Store %s\n", propertiesFilename);
+	    rc = TSS_File_WriteStructure(&tssContext->fixedProperties,
+					 (MarshalFunction_t)TSS_TPML_TAGGED_TPM_PROPERTY_Marshal,
+					 propertiesFilename);
+	}
+#endif
+    }
+    if (rc == 0) {
+	tssContext->fixedPropertiesValid = TRUE;
+    }
+    return rc;
+}
+
+#ifndef TPM_TSS_NOFILE
+
+/* TSS_TpmProperties_Check() compares the TPM_PT_MANUFACTURER, TPM_PT_FIRMWARE_VERSION_1, and
+   TPM_PT_FIRMWARE_VERSION_2 values in the saved fixedProperties to the TPM.  They are read with
+   one TPM2_GetCapability of the short property range that holds them.
+
+   match is TRUE if all three are present in both and equal.
+*/
+
+static TPM_RC TSS_TpmProperties_Check(TSS_CONTEXT *tssContext,
+				      const TPML_TAGGED_TPM_PROPERTY *fixedProperties,
+				      int *match)
+{
+    TPM_RC			rc = 0;
+    size_t			p;
+    uint32_t			i;
+    int				foundSaved;
+    int				foundTpm;
+    uint32_t			savedValue;
+    uint32_t			tpmValue;
+    GetCapability_In 		in;
+    GetCapability_Out		out;
+    static const TPM_PT 	identity[] = {TPM_PT_MANUFACTURER,
+					      TPM_PT_FIRMWARE_VERSION_1,
+					      TPM_PT_FIRMWARE_VERSION_2};
+
+    *match = FALSE;
+    if (rc == 0) {
+	in.capability = TPM_CAP_TPM_PROPERTIES;
+	in.property = TPM_PT_MANUFACTURER;
+	in.propertyCount = TPM_PT_FIRMWARE_VERSION_2 - TPM_PT_MANUFACTURER + 1;
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_GetCapability,
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if (rc == 0) {
+	*match = TRUE;
+	for (p = 0 ; *match && (p < sizeof(identity) / sizeof(TPM_PT)) ; p++) {
+	    foundSaved = FALSE;
+	    foundTpm = FALSE;
+	    for (i = 0 ; !foundSaved && (i < fixedProperties->count) ; i++) {
+		if (fixedProperties->tpmProperty[i].property == identity[p]) {
+		    savedValue = fixedProperties->tpmProperty[i].value;
+		    foundSaved = TRUE;
+		}
+	    }
+	    for (i = 0 ; !foundTpm && (i < out.capabilityData.data.tpmProperties.count) ; i++) {
+		if (out.capabilityData.data.tpmProperties.tpmProperty[i].property == identity[p]) {
+		    tpmValue = out.capabilityData.data.tpmProperties.tpmProperty[i].value;
+		    foundTpm = TRUE;
+		}
+	    }
+	    if (!foundSaved || !foundTpm || (savedValue != tpmValue)) {
+		if (tssVverbose) printf("TSS_TpmProperties_Check: property %08x differs\n",
+					identity[p]);
+		*match = FALSE;
+	    }
+	}
+    }
+    return rc;
+}
+
+#endif
+
+/* TSS_TpmProperties_Read() reads all the fixed properties from the TPM.  A TPM normally returns them
+   in one response, but follows moreData if it does not. */
+
+static TPM_RC TSS_TpmProperties_Read(TSS_CONTEXT *tssContext,
+				     TPML_TAGGED_TPM_PROPERTY *fixedProperties)
+{
+    TPM_RC			rc = 0;
+    uint32_t			i;
+    int				more = TRUE;
+    GetCapability_In 		in;
+    GetCapability_Out		out;
+    TPMS_TAGGED_PROPERTY	*tpmProperty;
+    uint32_t			next;
+
+    fixedProperties->count = 0;
+    in.capability = TPM_CAP_TPM_PROPERTIES;
+    in.property = PT_FIXED;
+    in.propertyCount = MAX_TPM_PROPERTIES;
+    while ((rc == 0) && more) {
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_GetCapability,
+			 TPM_RH_NULL, NULL, 0);
+	if (rc == 0) {
+	    more = (out.moreData == YES);
+	    next = in.property;
+	}
+	for (i = 0 ; (rc == 0) && (i < out.capabilityData.data.tpmProperties.count) ; i++) {
+	    tpmProperty = &out.capabilityData.data.tpmProperties.tpmProperty[i];
+	    /* the fixed group ends where the variable group starts */
+	    if ((tpmProperty->property >= PT_VAR) ||
+		(fixedProperties->count >= MAX_TPM_PROPERTIES)) {
+		more = FALSE;
+	    }
+	    /* ignore a property out of order */
+	    else if (tpmProperty->property >= next) {
+		fixedProperties->tpmProperty[fixedProperties->count] = *tpmProperty;
+		fixedProperties->count++;
+		next = tpmProperty->property + 1;
+	    }
+	}
+	/* the next request starts after the last property returned, guard against a TPM that does
+	   not make progress */
+	if ((rc == 0) && more) {
+	    if (next == in.property) {
+		more = FALSE;
+	    }
+	    in.property = next;
+	}
+    }
+    if (rc == 0) {
+	if (tssVverbose) printf("TSS_TpmProperties_Read: %u fixed properties\n",
+				fixedProperties->count);
+    }
+    return rc;
+}
+
+/*
+  NV Index Read and Write
+*/
+
+/* TSS_NV_GetBufferMax() returns the largest NV_Read or NV_Write chunk, the TPM property
+   TPM_PT_NV_BUFFER_MAX limited by the TSS structure size MAX_NV_BUFFER_SIZE.  A back level TPM
+   that does not report the property gets 512 bytes.
+*/
+
+TPM_RC TSS_NV_GetBufferMax(TSS_CONTEXT *tssContext,
+			   uint32_t *nvBufferMax)
+{
+    TPM_RC			rc = 0;
+
+    if (rc == 0) {
+	if (nvBufferMax == NULL) {
+	    if (tssVerbose) printf("TSS_NV_GetBufferMax: Error, NULL parameter\n");
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    if (rc == 0) {
+	rc = TSS_GetTpmProperty(tssContext, TPM_PT_NV_BUFFER_MAX, nvBufferMax);
+	if ((rc == TSS_RC_NO_TPM_PROPERTY) || ((rc == 0) && (*nvBufferMax == 0))) {
+	    if (tssVverbose) printf("TSS_NV_GetBufferMax: "
+				    "TPM_PT_NV_BUFFER_MAX not reported, using 512\n");
+	    *nvBufferMax = 512;
+	    rc = 0;
+	}
+    }
+    if (rc == 0) {
+	if (*nvBufferMax > MAX_NV_BUFFER_SIZE) {
+	    *nvBufferMax = MAX_NV_BUFFER_SIZE;
+	}
+    }
+    return rc;
+}
+
+/* TSS_NV_Read() reads 'size' bytes starting at 'offset' of NV index 'nvIndex' into 'buffer', in
+   TSS_NV_GetBufferMax() chunks.
+
+   The varargs are the session handle, password, and attributes triples of TSS_Execute(),
+   terminated by TPM_RH_NULL.  Each chunk is authorized with the same sessions.  Continue session
+   is set on all but the last chunk, where the caller's attributes decide whether the sessions are
+   flushed.  A policy session must satisfy the policy for each chunk, so a multiple chunk read with
+   a policy session normally fails after the first chunk.
+
+   If the TPM_SESSION_CACHE property is off, write-back caching is used for the duration of the
+   call, so that the sessions are loaded once and saved once rather than for each chunk.
+
+   A 'size' of zero issues one zero length read, which checks the authorization.  'offset' is a
+   uint32_t rather than the 16 bit TPM offset, because the last named parameter before the varargs
+   must not be one that undergoes default argument promotion.
+*/
+
+TPM_RC TSS_NV_Read(TSS_CONTEXT *tssContext,
+		   uint8_t *buffer,
+		   uint32_t size,
+		   TPMI_RH_NV_AUTH authHandle,
+		   TPMI_RH_NV_INDEX nvIndex,
+		   uint32_t offset,
+		   ...)
+{
+    TPM_RC	rc = 0;
+    va_list	ap;
+
+    va_start(ap, offset);
+    rc = TSS_NV_Chunks(tssContext, TPM_CC_NV_Read, buffer, size,
+		       authHandle, nvIndex, offset, ap);
+    va_end(ap);
+    return rc;
+}
+
+/* TSS_NV_Write() writes 'size' bytes from 'buffer' starting at 'offset' of NV index 'nvIndex', in
+   TSS_NV_GetBufferMax() chunks.
+
+   The sessions are handled as in TSS_NV_Read().  A 'size' of zero issues one zero length write.
+   If a chunk fails, the chunks before it remain written.
+*/
+
+TPM_RC TSS_NV_Write(TSS_CONTEXT *tssContext,
+		    const uint8_t *buffer,
+		    uint32_t size,
+		    TPMI_RH_NV_AUTH authHandle,
+		    TPMI_RH_NV_INDEX nvIndex,
+		    uint32_t offset,
+		    ...)
+{
+    TPM_RC	rc = 0;
+    va_list	ap;
+
+    va_start(ap, offset);
+    /* the buffer is only read, TSS_NV_Chunks() is shared with NV_Read */
+    rc = TSS_NV_Chunks(tssContext, TPM_CC_NV_Write, (uint8_t *)buffer, size,
+		       authHandle, nvIndex, offset, ap);
+    va_end(ap);
+    return rc;
+}
+
+/* TSS_NV_Chunks() is the common code for TSS_NV_Read() and TSS_NV_Write().  It gathers the
+   session varargs, keeps the sessions resident in the session cache, and issues the chunks. */
+
+static TPM_RC TSS_NV_Chunks(TSS_CONTEXT *tssContext,
+			    TPM_CC commandCode,
+			    uint8_t *buffer,
+			    uint32_t size,
+			    TPMI_RH_NV_AUTH authHandle,
+			    TPMI_RH_NV_INDEX nvIndex,
+			    uint32_t offset,
+			    va_list ap)
+{
+    TPM_RC			rc = 0;
+    int				done;
+    int				cacheSet = FALSE;
+    unsigned int		i;
+    uint32_t 			nvBufferMax;
+    uint32_t 			bytesDone;
+    uint32_t 			chunkSize;
+    TPMI_SH_AUTH_SESSION 	sessionHandle[MAX_SESSION_NUM];
+    const char 			*password[MAX_SESSION_NUM];
+    unsigned int		sessionAttributes[MAX_SESSION_NUM];
+    unsigned int		chunkAttributes[MAX_SESSION_NUM];
+
+    /* the same termination rules as TSS_Execute_Command() */
+    done = FALSE;
+    for (i = 0 ; i < MAX_SESSION_NUM ; i++) {
+	if (!done) {
+	    sessionHandle[i] = va_arg(ap, TPMI_SH_AUTH_SESSION);
+	    password[i]= va_arg(ap, const char *);
+	    sessionAttributes[i] = va_arg(ap, unsigned int) & 0xff;
+	    done = (sessionHandle[i] == TPM_RH_NULL);
+	}
+	else {
+	    sessionHandle[i] = TPM_RH_NULL;
+	    password[i] = NULL;
+	    sessionAttributes[i] = 0;
+	}
+	chunkAttributes[i] = sessionAttributes[i] | TPMA_SESSION_CONTINUESESSION;
+    }
+    if (rc == 0) {
+	if ((tssContext == NULL) || ((buffer == NULL) && (size != 0))) {
+	    if (tssVerbose) printf("TSS_NV_Chunks: Error, NULL parameter\n");
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    /* the TPM commands would overwrite the pending command */
+    if (rc == 0) {
+	if (tssContext->tssExecuteState != NULL) {
+	    if (tssVerbose) printf("TSS_NV_Chunks: Error, command pending\n");
+	    rc = TSS_RC_COMMAND_PENDING;
+	}
+    }
+    /* NV offsets are 16 bits */
+    if (rc == 0) {
+	if ((offset > 0x10000) || (size > (0x10000 - offset))) {
+	    if (tssVerbose) printf("TSS_NV_Chunks: Error, offset %u size %u out of range\n",
+				   offset, size);
+	    rc = TSS_RC_IN_PARAMETER;
+	}
+    }
+    if (rc == 0) {
+	rc = TSS_NV_GetBufferMax(tssContext, &nvBufferMax);
+    }
+    /* keep the sessions resident across the chunks */
+    if (rc == 0) {
+	if ((size > nvBufferMax) && (tssContext->tssSessionCache == 0)) {
+	    tssContext->tssSessionCache = TSS_SESSION_CACHE_WRITEBACK;
+	    cacheSet = TRUE;
+	}
+    }
+    for (bytesDone = 0 , done = FALSE ; (rc == 0) && !done ; bytesDone += chunkSize) {
+	if ((size - bytesDone) > nvBufferMax) {
+	    chunkSize = nvBufferMax;		/* next chunk */
+	}
+	else {
+	    chunkSize = size - bytesDone;	/* last chunk */
+	    done = TRUE;
+	}
+	if (tssVverbose) printf("TSS_NV_Chunks: %s %u bytes at offset %u\n",
+				(commandCode == TPM_CC_NV_Read) ? "read" : "write",
+				chunkSize, offset + bytesDone);
+	rc = TSS_NV_Chunk(tssContext, commandCode, buffer + bytesDone, chunkSize,
+			  authHandle, nvIndex, offset + bytesDone,
+			  sessionHandle, password,
+			  done ? sessionAttributes : chunkAttributes);
+    }
+    /* save the sessions and return to the caller's cache policy */
+    if (cacheSet) {
+	TPM_RC rc1 = TSS_SessionCache_Flush(tssContext);
+	tssContext->tssSessionCache = 0;
+	if (rc == 0) {
+	    rc = rc1;
+	}
+    }
+    return rc;
+}
+
+/* TSS_NV_Chunk() issues one NV_Read or NV_Write of 'size' bytes, at most nvBufferMax */
+
+static TPM_RC TSS_NV_Chunk(TSS_CONTEXT *tssContext,
+			   TPM_CC commandCode,
+			   uint8_t *buffer,
+			   uint32_t size,
+			   TPMI_RH_NV_AUTH authHandle,
+			   TPMI_RH_NV_INDEX nvIndex,
+			   uint32_t offset,
+			   TPMI_SH_AUTH_SESSION sessionHandle[],
+			   const char *password[],
+			   unsigned int sessionAttributes[])
+{
+    TPM_RC		rc = 0;
+    union {
+	NV_Read_In	read;
+	NV_Write_In	write;
+    } in;
+    NV_Read_Out		out;
+
+    if (commandCode == TPM_CC_NV_Read) {
+	in.read.authHandle = authHandle;
+	in.read.nvIndex = nvIndex;
+	in.read.size = (uint16_t)size;
+	in.read.offset = (uint16_t)offset;
+    }
+    else {
+	in.write.authHandle = authHandle;
+	in.write.nvIndex = nvIndex;
+	in.write.offset = (uint16_t)offset;
+	rc = TSS_TPM2B_Create(&in.write.data.b, buffer, (uint16_t)size, MAX_NV_BUFFER_SIZE);
+    }
+    if (rc == 0) {
+	rc = TSS_Execute(tssContext,
+			 (commandCode == TPM_CC_NV_Read) ? (RESPONSE_PARAMETERS *)&out : NULL,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 commandCode,
+			 sessionHandle[0], password[0], sessionAttributes[0],
+			 sessionHandle[1], password[1], sessionAttributes[1],
+			 sessionHandle[2], password[2], sessionAttributes[2],
+			 TPM_RH_NULL, NULL, 0);
+    }
+    /* a short read would leave a hole in the caller's buffer */
+    if ((rc == 0) && (commandCode == TPM_CC_NV_Read)) {
+	if (out.data.t.size != size) {
+	    if (tssVerbose) printf("TSS_NV_Chunk: Error, read %u bytes, expected %u\n",
+				   out.data.t.size, size);
+	    rc = TSS_RC_MALFORMED_RESPONSE;
+	}
+	else {
+	    memcpy(buffer, out.data.t.buffer, size);
+	}
+    }
+    return rc;
+}
+
+/*
+  Session Pool
+*/
+
+/* TSS_SessionPool_Lease() returns an unbound HMAC session started with 'tpmKey', 'authHash', and
+   'symmetric'.  tpmKey TPM_RH_NULL is an unsalted session, symmetric NULL is TPM_ALG_NULL.
+
+   An idle session released earlier with the same parameters is reused, avoiding a
+   TPM2_StartAuthSession.  Otherwise a session is started.  When the TPM is out of session memory,
+   idle pooled sessions are context saved to free a slot, and they are context loaded again when
+   leased.  When the TPM is out of session handles, idle pooled sessions are flushed.
+
+   The caller must set TPMA_SESSION_CONTINUESESSION in each command that uses the session, and
+   return it with TSS_SessionPool_Release().  A session whose continueSession was clear ends at the
+   TPM, and the release only frees the lease.
+
+   Returns TSS_RC_NO_SESSION_SLOT if all TSS_SESSION_POOL_MAX sessions are leased.
+*/
+
+TPM_RC TSS_SessionPool_Lease(TSS_CONTEXT *tssContext,
+			     TPMI_SH_AUTH_SESSION *sessionHandle,
+			     TPMI_DH_OBJECT tpmKey,
+			     TPMI_ALG_HASH authHash,
+			     const TPMT_SYM_DEF *symmetric)
+{
+    TPM_RC			rc = 0;
+    TSS_SESSION_POOL_ENTRY	*entry = NULL;
+    size_t			i;
+
+    if (rc == 0) {
+	if ((tssContext == NULL) || (sessionHandle == NULL)) {
+	    if (tssVerbose) printf("TSS_SessionPool_Lease: Error, NULL parameter\n");
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    /* the TPM commands would overwrite the pending command */
+    if (rc == 0) {
+	if (tssContext->tssExecuteState != NULL) {
+	    if (tssVerbose) printf("TSS_SessionPool_Lease: Error, command pending\n");
+	    rc = TSS_RC_COMMAND_PENDING;
+	}
+    }
+    if (rc == 0) {
+	tssContext->sessionPoolStats.leases++;
+	entry = TSS_SessionPool_Find(tssContext, tpmKey, authHash, symmetric);
+    }
+    /* a saved session is loaded back.  If that fails it has been flushed, start a new one */
+    if ((rc == 0) && (entry != NULL) && entry->saved) {
+	if (TSS_SessionPool_Load(tssContext, entry) != 0) {
+	    entry = NULL;
+	}
+    }
+    if ((rc == 0) && (entry != NULL)) {
+	tssContext->sessionPoolStats.hits++;
+    }
+    /* else start a session in an empty slot, or in place of the least recently used idle one */
+    if ((rc == 0) && (entry == NULL)) {
+	for (i = 0 ; (entry == NULL) &&
+		 (i < (sizeof(tssContext->sessionPool) / sizeof(TSS_SESSION_POOL_ENTRY))) ; i++) {
+	    if (tssContext->sessionPool[i].sessionHandle == TPM_RH_NULL) {
+		entry = &tssContext->sessionPool[i];
+	    }
+	}
+	if (entry == NULL) {
+	    entry = TSS_SessionPool_Victim(tssContext, FALSE);
+	    if (entry != NULL) {
+		rc = TSS_SessionPool_Evict(tssContext, entry);
+	    }
+	    else {
+		if (tssVerbose) printf("TSS_SessionPool_Lease: Error, all sessions leased\n");
+		rc = TSS_RC_NO_SESSION_SLOT;
+	    }
+	}
+	if (rc == 0) {
+	    rc = TSS_SessionPool_Start(tssContext, entry, tpmKey, authHash, symmetric);
+	}
+    }
+    if (rc == 0) {
+	entry->leased = TRUE;
+	*sessionHandle = entry->sessionHandle;
+	if (tssVverbose) printf("TSS_SessionPool_Lease: Session %08x\n", *sessionHandle);
+    }
+    return rc;
+}
+
+/* TSS_SessionPool_Release() returns a leased session.  Up to the TPM_SESSION_POOL property idle
+   sessions are kept for later leases, the least recently used beyond that are flushed.
+*/
+
+TPM_RC TSS_SessionPool_Release(TSS_CONTEXT *tssContext,
+			       TPMI_SH_AUTH_SESSION sessionHandle)
+{
+    TPM_RC			rc = 0;
+    TSS_SESSION_POOL_ENTRY	*entry = NULL;
+    uint32_t			idle = 0;
+    size_t			i;
+
+    if (rc == 0) {
+	if (tssContext == NULL) {
+	    if (tssVerbose) printf("TSS_SessionPool_Release: Error, NULL parameter\n");
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    if (rc == 0) {
+	if (tssContext->tssExecuteState != NULL) {
+	    if (tssVerbose) printf("TSS_SessionPool_Release: Error, command pending\n");
+	    rc = TSS_RC_COMMAND_PENDING;
+	}
+    }
+    /* a session that is no longer in the pool has already ended */
+    for (i = 0 ; (rc == 0) &&
+	     (i < (sizeof(tssContext->sessionPool) / sizeof(TSS_SESSION_POOL_ENTRY))) ; i++) {
+	if ((tssContext->sessionPool[i].sessionHandle == sessionHandle) &&
+	    tssContext->sessionPool[i].leased) {
+	    entry = &tssContext->sessionPool[i];
+	    entry->leased = FALSE;
+	    entry->lastUse = ++tssContext->sessionPoolClock;
+	}
+	if ((tssContext->sessionPool[i].sessionHandle != TPM_RH_NULL) &&
+	    !tssContext->sessionPool[i].leased) {
+	    idle++;
+	}
+    }
+    if ((rc == 0) && (entry == NULL)) {
+	if (tssVverbose) printf("TSS_SessionPool_Release: Session %08x already ended\n",
+				sessionHandle);
+    }
+    for ( ; (rc == 0) && (idle > tssContext->tssSessionPool) ; idle--) {
+	rc = TSS_SessionPool_Evict(tssContext, TSS_SessionPool_Victim(tssContext, FALSE));
+    }
+    return rc;
+}
+
+/* TSS_SessionPool_Flush() flushes the idle pooled sessions.  Leased sessions are not affected.
+   TSS_Delete() calls it so that the context does not leave sessions on the TPM.
+*/
+
+TPM_RC TSS_SessionPool_Flush(TSS_CONTEXT *tssContext)
+{
+    TPM_RC			rc = 0;
+    TPM_RC			rc1;
+    TSS_SESSION_POOL_ENTRY	*entry;
+
+    if (rc == 0) {
+	if (tssContext->tssExecuteState != NULL) {
+	    if (tssVerbose) printf("TSS_SessionPool_Flush: Error, command pending\n");
+	    rc = TSS_RC_COMMAND_PENDING;
+	}
+    }
+    /* flush all, returning the first error */
+    while ((tssContext->tssExecuteState == NULL) &&
+	   ((entry = TSS_SessionPool_Victim(tssContext, FALSE)) != NULL)) {
+	rc1 = TSS_SessionPool_Evict(tssContext, entry);
+	if (rc == 0) {
+	    rc = rc1;
+	}
+    }
+    return rc;
+}
+
+/* TSS_SessionPool_GetStats() returns the session pool counters since the context was created */
+
+TPM_RC TSS_SessionPool_GetStats(TSS_CONTEXT *tssContext,
+				TSS_SESSION_POOL_STATS *stats)
+{
+    TPM_RC	rc = 0;
+
+    if (rc == 0) {
+	if ((tssContext == NULL) || (stats == NULL)) {
+	    if (tssVerbose) printf("TSS_SessionPool_GetStats: Error, NULL parameter\n");
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    if (rc == 0) {
+	*stats = tssContext->sessionPoolStats;
+    }
+    return rc;
+}
+
+/* TSS_SessionPool_Find() returns an idle session with the StartAuthSession parameters, preferring
+   one that is loaded, or NULL */
+
+static TSS_SESSION_POOL_ENTRY *TSS_SessionPool_Find(TSS_CONTEXT *tssContext,
+						    TPMI_DH_OBJECT tpmKey,
+						    TPMI_ALG_HASH authHash,
+						    const TPMT_SYM_DEF *symmetric)
+{
+    TSS_SESSION_POOL_ENTRY	*entry = NULL;
+    TSS_SESSION_POOL_ENTRY	*candidate;
+    TPMI_ALG_SYM		algorithm = (symmetric != NULL) ? symmetric->algorithm : TPM_ALG_NULL;
+    size_t			i;
+
+    for (i = 0 ; i < (sizeof(tssContext->sessionPool) / sizeof(TSS_SESSION_POOL_ENTRY)) ; i++) {
+	candidate = &tssContext->sessionPool[i];
+	if ((candidate->sessionHandle == TPM_RH_NULL) || candidate->leased ||
+	    (candidate->tpmKey != tpmKey) ||
+	    (candidate->authHash != authHash) ||
+	    (candidate->symmetric.algorithm != algorithm)) {
+	    continue;
+	}
+	/* XOR has no mode, TPM_ALG_NULL has neither key size nor mode */
+	if ((algorithm != TPM_ALG_NULL) &&
+	    (candidate->symmetric.keyBits.sym != symmetric->keyBits.sym)) {
+	    continue;
+	}
+	if ((algorithm != TPM_ALG_NULL) && (algorithm != TPM_ALG_XOR) &&
+	    (candidate->symmetric.mode.sym != symmetric->mode.sym)) {
+	    continue;
+	}
+	if ((entry == NULL) || (entry->saved && !candidate->saved)) {
+	    entry = candidate;
+	}
+    }
+    return entry;
+}
+
+/* TSS_SessionPool_Victim() returns the least recently used idle session, or NULL.  If 'loadedOnly'
+   is TRUE, only sessions that are not context saved are considered. */
+
+static TSS_SESSION_POOL_ENTRY *TSS_SessionPool_Victim(TSS_CONTEXT *tssContext,
+						      int loadedOnly)
+{
+    TSS_SESSION_POOL_ENTRY	*entry = NULL;
+    TSS_SESSION_POOL_ENTRY	*candidate;
+    size_t			i;
+
+    for (i = 0 ; i < (sizeof(tssContext->sessionPool) / sizeof(TSS_SESSION_POOL_ENTRY)) ; i++) {
+	candidate = &tssContext->sessionPool[i];
+	if ((candidate->sessionHandle == TPM_RH_NULL) || candidate->leased ||
+	    (loadedOnly && candidate->saved)) {
+	    continue;
+	}
+	/* lastUse wraps after 2^32 releases, the LRU choice is then briefly approximate */
+	if ((entry == NULL) || ((int32_t)(candidate->lastUse - entry->lastUse) < 0)) {
+	    entry = candidate;
+	}
+    }
+    return entry;
+}
+
+/* TSS_SessionPool_Start() starts a session into the empty slot 'entry', making room on the TPM if
+   required */
+
+static TPM_RC TSS_SessionPool_Start(TSS_CONTEXT *tssContext,
+				    TSS_SESSION_POOL_ENTRY *entry,
+				    TPMI_DH_OBJECT tpmKey,
+				    TPMI_ALG_HASH authHash,
+				    const TPMT_SYM_DEF *symmetric)
+{
+    TPM_RC			rc = 0;
+    StartAuthSession_In 	in;
+    StartAuthSession_Out 	out;
+    StartAuthSession_Extra	extra;
+    int				done = FALSE;
+
+    in.tpmKey = tpmKey;
+    in.bind = TPM_RH_NULL;
+    in.sessionType = TPM_SE_HMAC;
+    in.authHash = authHash;
+    memset(&in.symmetric, 0, sizeof(TPMT_SYM_DEF));
+    if (symmetric != NULL) {
+	in.symmetric.algorithm = symmetric->algorithm;
+	if (symmetric->algorithm != TPM_ALG_NULL) {
+	    in.symmetric.keyBits.sym = symmetric->keyBits.sym;
+	}
+	if ((symmetric->algorithm != TPM_ALG_NULL) && (symmetric->algorithm != TPM_ALG_XOR)) {
+	    in.symmetric.mode.sym = symmetric->mode.sym;
+	}
+    }
+    else {
+	in.symmetric.algorithm = TPM_ALG_NULL;
+    }
+    extra.bindPassword = NULL;
+    while ((rc == 0) && !done) {
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 (EXTRA_PARAMETERS *)&extra,
+			 TPM_CC_StartAuthSession,
+			 TPM_RH_NULL, NULL, 0);
+	if (rc == 0) {
+	    tssContext->sessionPoolStats.starts++;
+	    done = TRUE;
+	}
+	else {
+	    rc = TSS_SessionPool_MakeRoom(tssContext, rc);	/* retry if room was made */
+	}
+    }
+    if (rc == 0) {
+	entry->sessionHandle = out.sessionHandle;
+	entry->tpmKey = tpmKey;
+	entry->authHash = authHash;
+	entry->symmetric = in.symmetric;
+	entry->leased = FALSE;
+	entry->saved = FALSE;
+	entry->lastUse = tssContext->sessionPoolClock;
+    }
+    return rc;
+}
+
+/* TSS_SessionPool_Load() context loads a saved idle session, making room on the TPM if required.
+   If the load fails, the session is flushed. */
+
+static TPM_RC TSS_SessionPool_Load(TSS_CONTEXT *tssContext,
+				   TSS_SESSION_POOL_ENTRY *entry)
+{
+    TPM_RC			rc = 0;
+    ContextLoad_In 		in;
+    ContextLoad_Out 		out;
+    int				done = FALSE;
+
+    in.context = entry->context;
+    /* the session must not be chosen to make room for itself */
+    entry->leased = TRUE;
+    while ((rc == 0) && !done) {
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_ContextLoad,
+			 TPM_RH_NULL, NULL, 0);
+	if (rc == 0) {
+	    tssContext->sessionPoolStats.loads++;
+	    entry->saved = FALSE;
+	    done = TRUE;
+	}
+	else {
+	    rc = TSS_SessionPool_MakeRoom(tssContext, rc);
+	}
+    }
+    entry->leased = FALSE;
+    if (rc != 0) {
+	if (tssVerbose) printf("TSS_SessionPool_Load: Session %08x lost, rc %08x\n",
+			       entry->sessionHandle, rc);
+	TSS_SessionPool_Evict(tssContext, entry);
+    }
+    return rc;
+}
+
+/* TSS_SessionPool_MakeRoom() responds to a TPM session resource error 'tpmRc'.
+
+   For TPM_RC_SESSION_MEMORY, the least recently used loaded idle session is context saved, else an
+   idle session is flushed.  For TPM_RC_SESSION_HANDLES or TPM_RC_CONTEXT_GAP, the least recently
+   used idle session is flushed.
+
+   Returns 0 if the command should be retried, else 'tpmRc'.
+*/
+
+static TPM_RC TSS_SessionPool_MakeRoom(TSS_CONTEXT *tssContext,
+				       TPM_RC tpmRc)
+{
+    TPM_RC			rc = tpmRc;
+    TSS_SESSION_POOL_ENTRY	*entry = NULL;
+    ContextSave_In 		in;
+    ContextSave_Out 		out;
+
+    if (tpmRc == TPM_RC_SESSION_MEMORY) {
+	entry = TSS_SessionPool_Victim(tssContext, TRUE);
+	if (entry != NULL) {
+	    in.saveHandle = entry->sessionHandle;
+	    rc = TSS_Execute(tssContext,
+			     (RESPONSE_PARAMETERS *)&out,
+			     (COMMAND_PARAMETERS *)&in,
+			     NULL,
+			     TPM_CC_ContextSave,
+			     TPM_RH_NULL, NULL, 0);
+	    if (rc == 0) {
+		if (tssVverbose) printf("TSS_SessionPool_MakeRoom: Saved session %08x\n",
+					entry->sessionHandle);
+		tssContext->sessionPoolStats.saves++;
+		entry->context = out.context;
+		entry->saved = TRUE;
+	    }
+	    else {
+		rc = tpmRc;
+		entry = NULL;
+	    }
+	}
+    }
+    if (((tpmRc == TPM_RC_SESSION_MEMORY) && (entry == NULL)) ||
+	(tpmRc == TPM_RC_SESSION_HANDLES) ||
+	(tpmRc == TPM_RC_CONTEXT_GAP)) {
+	entry = TSS_SessionPool_Victim(tssContext, FALSE);
+	if (entry != NULL) {
+	    rc = TSS_SessionPool_Evict(tssContext, entry);
+	}
+    }
+    return rc;
+}
+
+/* TSS_SessionPool_Evict() flushes an idle pooled session and empties its slot */
+
+static TPM_RC TSS_SessionPool_Evict(TSS_CONTEXT *tssContext,
+				    TSS_SESSION_POOL_ENTRY *entry)
+{
+    TPM_RC			rc = 0;
+    FlushContext_In 		in;
+
+    if (tssVverbose) printf("TSS_SessionPool_Evict: Session %08x\n", entry->sessionHandle);
+    in.flushHandle = entry->sessionHandle;
+    /* the post processor deletes the session state and the pool entry */
+    rc = TSS_Execute(tssContext,
+		     NULL,
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     TPM_CC_FlushContext,
+		     TPM_RH_NULL, NULL, 0);
+    /* if the TPM no longer has the session, delete the state here */
+    if (rc != 0) {
+	if (tssVerbose) printf("TSS_SessionPool_Evict: Flush of %08x failed, rc %08x\n",
+			       in.flushHandle, rc);
+	rc = TSS_DeleteHandle(tssContext, in.flushHandle);
     }
     return rc;
 }
 
+/* TSS_SessionPool_Delete() removes a session from the pool when the session state is deleted, on a
+   flush or when the TPM ends a session whose continueSession was clear.  The slot is emptied at
+   once, even if leased, and the later release finds nothing to do. */
+
+static void TSS_SessionPool_Delete(TSS_CONTEXT *tssContext,
+				   TPMI_SH_AUTH_SESSION sessionHandle)
+{
+    size_t	i;
+
+    for (i = 0 ; i < (sizeof(tssContext->sessionPool) / sizeof(TSS_SESSION_POOL_ENTRY)) ; i++) {
+	if (tssContext->sessionPool[i].sessionHandle == sessionHandle) {
+	    tssContext->sessionPool[i].sessionHandle = TPM_RH_NULL;
+	    tssContext->sessionPool[i].leased = FALSE;
+	    tssContext->sessionPoolStats.flushes++;
+	}
+    }
+    return;
+}
+
 /*
   PWAP - Password Session
 */
@@ -1073,6 +2634,7 @@ static void TSS_HmacSession_InitContext(struct TSS_HMAC_CONTEXT *session)
     memset(session->hmacKey.t.buffer, 0, sizeof(TPMU_HA) + sizeof(TPMU_HA));
     session->hmacKey.b.size = 0;
 #ifndef TPM_TSS_NOCRYPTO
+    session->hmacKeyCtx = NULL;
     memset(session->sessionValue.t.buffer, 0, sizeof(TPMU_HA) + sizeof(TPMU_HA));
     session->sessionValue.b.size = 0;
 #endif
@@ -1081,6 +2643,9 @@ static void TSS_HmacSession_InitContext(struct TSS_HMAC_CONTEXT *session)
 void TSS_HmacSession_FreeContext(struct TSS_HMAC_CONTEXT *session)
 {
     if (session!= NULL) {
+#ifndef TPM_TSS_NOCRYPTO
+	TSS_HMAC_KeyDelete(session->hmacKeyCtx);
+#endif
 	TSS_HmacSession_InitContext(session);
 	free(session);
     }
@@ -1162,11 +2727,41 @@ static TPM_RC TSS_HmacSession_SetSessionKey(TSS_CONTEXT *tssContext,
 
    The initial session from startauthsession
    The updated session a TPM response
-*/
 
+   If the session cache is enabled, the session is saved in the cache.  It is also written to the
+   session store unless the policy is write-back or the cache is full.
+*/
 
 static TPM_RC TSS_HmacSession_SaveSession(TSS_CONTEXT *tssContext,
 					  struct TSS_HMAC_CONTEXT *session)
+{
+    TPM_RC		rc = 0;
+    TSS_SESSION_CACHE	*entry = NULL;
+    
+    if (tssVverbose) printf("TSS_HmacSession_SaveSession: handle %08x\n", session->sessionHandle);
+    if (rc == 0) {
+	if (tssContext->tssSessionCache != 0) {
+	    entry = TSS_SessionCache_Put(tssContext, session);
+	}
+    }
+    if (rc == 0) {
+	if ((entry == NULL) || (tssContext->tssSessionCache != TSS_SESSION_CACHE_WRITEBACK)) {
+	    rc = TSS_HmacSession_StoreSession(tssContext, session);
+	    if ((rc == 0) && (entry != NULL)) {
+		entry->dirty = FALSE;
+		entry->stored = TRUE;
+	    }
+	}
+    }
+    return rc;
+}
+
+/* TSS_HmacSession_StoreSession() marshals the session and writes it to the session store, the
+   hxxxxxxxx.bin file or, with no file support, the context.
+*/
+
+static TPM_RC TSS_HmacSession_StoreSession(TSS_CONTEXT *tssContext,
+					   struct TSS_HMAC_CONTEXT *session)
 {
     TPM_RC	rc = 0;
     uint8_t 	*buffer = NULL;		/* marshaled TSS_HMAC_CONTEXT */
@@ -1177,7 +2772,6 @@ static TPM_RC TSS_HmacSession_SaveSession(TSS_CONTEXT *tssContext,
     uint32_t outLength;
 #endif
     
-    if (tssVverbose) printf("TSS_HmacSession_SaveSession: handle %08x\n", session->sessionHandle);
     if (rc == 0) {
 	rc = TSS_Structure_Marshal(&buffer,	/* freed @1 */
 				   &written,
@@ -1229,11 +2823,50 @@ static TPM_RC TSS_HmacSession_SaveSession(TSS_CONTEXT *tssContext,
 
    startauthsession
    an update after a TPM response
+
+   If the session cache is enabled, a cached session is copied without reading the session store,
+   and a session read from the store is added to the cache.
 */
 
 static TPM_RC TSS_HmacSession_LoadSession(TSS_CONTEXT *tssContext,
 					  struct TSS_HMAC_CONTEXT *session,
 					  TPMI_SH_AUTH_SESSION	sessionHandle)
+{
+    TPM_RC		rc = 0;
+    TSS_SESSION_CACHE	*entry = NULL;
+
+    if (tssVverbose) printf("TSS_HmacSession_LoadSession: handle %08x\n", sessionHandle);
+    if (rc == 0) {
+	entry = TSS_SessionCache_Find(tssContext, sessionHandle);
+    }
+    /* cache hit */
+    if (entry != NULL) {
+	*session = *(entry->session);
+    }
+    /* cache miss, read the session store */
+    else {
+	if (rc == 0) {
+	    rc = TSS_HmacSession_ReadSession(tssContext, session, sessionHandle);
+	}
+	if (rc == 0) {
+	    if (tssContext->tssSessionCache != 0) {
+		entry = TSS_SessionCache_Put(tssContext, session);
+		if (entry != NULL) {
+		    entry->dirty = FALSE;
+		    entry->stored = TRUE;
+		}
+	    }
+	}
+    }
+    return rc;
+}
+
+/* TSS_HmacSession_ReadSession() reads the session from the session store and unmarshals it.
+*/
+
+static TPM_RC TSS_HmacSession_ReadSession(TSS_CONTEXT *tssContext,
+					  struct TSS_HMAC_CONTEXT *session,
+					  TPMI_SH_AUTH_SESSION	sessionHandle)
 {
     TPM_RC		rc = 0;
     uint8_t 		*buffer = NULL;
@@ -1245,7 +2878,6 @@ static TPM_RC TSS_HmacSession_LoadSession(TSS_CONTEXT *tssContext,
     unsigned char *inData = NULL;		/* output */
     uint32_t inLength;				/* output */
 
-    if (tssVverbose) printf("TSS_HmacSession_LoadSession: handle %08x\n", sessionHandle);
 #ifndef TPM_TSS_NOFILE
     /* load the session from a hard coded file name hxxxxxxxx.bin where xxxxxxxx is the session
        handle */
@@ -1291,6 +2923,159 @@ static TPM_RC TSS_HmacSession_LoadSession(TSS_CONTEXT *tssContext,
     return rc;
 }
 
+/* TSS_SaveSessionCache() writes the cached sessions that have changed to the session store.  The
+   sessions remain cached.
+
+   With the write-back policy, an application calls this before a script or another process uses
+   the sessions.
+*/
+
+TPM_RC TSS_SaveSessionCache(TSS_CONTEXT *tssContext)
+{
+    TPM_RC	rc = 0;
+    TPM_RC	rc1;
+    size_t	i;
+
+    for (i = 0 ; i < (sizeof(tssContext->sessionCache) / sizeof(TSS_SESSION_CACHE)) ; i++) {
+	if ((tssContext->sessionCache[i].sessionHandle != TPM_RH_NULL) &&
+	    tssContext->sessionCache[i].dirty) {
+	    rc1 = TSS_HmacSession_StoreSession(tssContext, tssContext->sessionCache[i].session);
+	    if (rc1 == 0) {
+		tssContext->sessionCache[i].dirty = FALSE;
+		tssContext->sessionCache[i].stored = TRUE;
+	    }
+	    /* save as many as possible, return the first error */
+	    else if (rc == 0) {
+		if (tssVerbose) printf("TSS_SaveSessionCache: Error saving handle %08x\n",
+				       tssContext->sessionCache[i].sessionHandle);
+		rc = rc1;
+	    }
+	}
+    }
+    return rc;
+}
+
+/* TSS_SessionCache_Flush() saves the cached sessions that have changed and then empties the
+   cache.  It is called before a property change that affects the session store, and at
+   TSS_Delete().
+*/
+
+TPM_RC TSS_SessionCache_Flush(TSS_CONTEXT *tssContext)
+{
+    TPM_RC	rc = 0;
+    size_t	i;
+
+    rc = TSS_SaveSessionCache(tssContext);
+    for (i = 0 ; i < (sizeof(tssContext->sessionCache) / sizeof(TSS_SESSION_CACHE)) ; i++) {
+	if (tssContext->sessionCache[i].sessionHandle != TPM_RH_NULL) {
+	    TSS_SessionCache_Delete(tssContext, tssContext->sessionCache[i].sessionHandle, NULL);
+	}
+    }
+    return rc;
+}
+
+/* TSS_SessionCache_Find() returns the cache entry for the session handle, or NULL if the session is
+   not cached.
+*/
+
+static TSS_SESSION_CACHE *TSS_SessionCache_Find(TSS_CONTEXT *tssContext,
+						TPMI_SH_AUTH_SESSION sessionHandle)
+{
+    size_t	i;
+
+    if (sessionHandle != TPM_RH_NULL) {
+	for (i = 0 ; i < (sizeof(tssContext->sessionCache) / sizeof(TSS_SESSION_CACHE)) ; i++) {
+	    if (tssContext->sessionCache[i].sessionHandle == sessionHandle) {
+		return &tssContext->sessionCache[i];
+	    }
+	}
+    }
+    return NULL;
+}
+
+/* TSS_SessionCache_Put() copies the session into the cache, replacing any previous copy.  The entry
+   is marked dirty.
+
+   Returns NULL if the cache is full or out of memory.  The caller then uses the session store.
+*/
+
+static TSS_SESSION_CACHE *TSS_SessionCache_Put(TSS_CONTEXT *tssContext,
+					       struct TSS_HMAC_CONTEXT *session)
+{
+    TPM_RC		rc = 0;
+    TSS_SESSION_CACHE	*entry = NULL;
+
+    if (rc == 0) {
+	entry = TSS_SessionCache_Find(tssContext, session->sessionHandle);
+	/* new session, take an empty slot */
+	if (entry == NULL) {
+	    size_t i;
+	    for (i = 0 ; i < (sizeof(tssContext->sessionCache) / sizeof(TSS_SESSION_CACHE)) ; i++) {
+		if (tssContext->sessionCache[i].sessionHandle == TPM_RH_NULL) {
+		    entry = &tssContext->sessionCache[i];
+		    break;
+		}
+	    }
+	    if (entry == NULL) {
+		if (tssVverbose) printf("TSS_SessionCache_Put: cache full for handle %08x\n",
+					session->sessionHandle);
+		rc = TSS_RC_NO_SESSION_SLOT;
+	    }
+	    else {
+		rc = TSS_HmacSession_GetContext(&entry->session);
+		if (rc == 0) {
+		    entry->sessionHandle = session->sessionHandle;
+		    entry->stored = FALSE;
+		}
+	    }
+	}
+    }
+    if (rc == 0) {
+	*(entry->session) = *session;
+	/* the per command secrets are not retained */
+	memset(entry->session->hmacKey.t.buffer, 0, sizeof(TPMU_HA) + sizeof(TPMU_HA));
+	entry->session->hmacKey.b.size = 0;
+#ifndef TPM_TSS_NOCRYPTO
+	entry->session->hmacKeyCtx = NULL;
+	memset(entry->session->sessionValue.t.buffer, 0, sizeof(TPMU_HA) + sizeof(TPMU_HA));
+	entry->session->sessionValue.b.size = 0;
+#endif
+	entry->dirty = TRUE;
+    }
+    else {
+	entry = NULL;
+    }
+    return entry;
+}
+
+/* TSS_SessionCache_Delete() removes the session from the cache and erases the secrets.
+
+   If 'stored' is not NULL, it returns FALSE if the session was cached but never written to the
+   session store, so there is nothing there to delete.
+*/
+
+static void TSS_SessionCache_Delete(TSS_CONTEXT *tssContext,
+				    TPMI_SH_AUTH_SESSION sessionHandle,
+				    int *stored)
+{
+    TSS_SESSION_CACHE	*entry = TSS_SessionCache_Find(tssContext, sessionHandle);
+
+    if (stored != NULL) {
+	*stored = TRUE;
+    }
+    if (entry != NULL) {
+	if (stored != NULL) {
+	    *stored = entry->stored;
+	}
+	TSS_HmacSession_FreeContext(entry->session);
+	entry->sessionHandle = TPM_RH_NULL;
+	entry->session = NULL;
+	entry->dirty = FALSE;
+	entry->stored = FALSE;
+    }
+    return;
+}
+
 #ifdef TPM_TSS_NOFILE
 
 static TPM_RC TSS_HmacSession_SaveData(TSS_CONTEXT *tssContext,
@@ -1585,11 +3370,102 @@ static TPM_RC TSS_Name_GetName(TSS_CONTEXT *tssContext,
     return rc;
 }
 
+/* TSS_NameCache_Clear() empties the Name and public cache, and the RSA salt keys parsed from the
+   cached publics.  It is called when the cache property or the data directory changes.
+*/
+
+void TSS_NameCache_Clear(TSS_CONTEXT *tssContext)
+{
+#ifndef TPM_TSS_NOFILE
+    size_t	i;
+#endif
+
+    TSS_SaltKeyCache_Clear(tssContext);
+#ifndef TPM_TSS_NOFILE
+    for (i = 0 ; i < (sizeof(tssContext->nameCache) / sizeof(TSS_NAME_CACHE)) ; i++) {
+	tssContext->nameCache[i].handle = TPM_RH_NULL;
+	tssContext->nameCache[i].nameValid = FALSE;
+	tssContext->nameCache[i].publicValid = FALSE;
+	tssContext->nameCache[i].nvPublicValid = FALSE;
+    }
+    tssContext->nameCacheNext = 0;
+#endif
+    return;
+}
+
+#ifndef TPM_TSS_NOFILE
+
+/* TSS_NameCache_Get() returns the cache entry for the handle.
+
+   If 'create' is TRUE and the handle is not cached, a slot is assigned, replacing an older entry
+   if the cache is full.
+
+   Returns NULL if the cache is disabled, the handle is not cached, or 'string' rather than the
+   handle names the file.
+*/
+
+static TSS_NAME_CACHE *TSS_NameCache_Get(TSS_CONTEXT *tssContext,
+					 TPM_HANDLE handle,
+					 const char *string,
+					 int create)
+{
+    TSS_NAME_CACHE	*entry = NULL;
+    TSS_NAME_CACHE	*empty = NULL;
+    size_t		i;
+
+    if (!tssContext->tssNameCache || (string != NULL) || (handle == 0)) {
+	return NULL;
+    }
+    for (i = 0 ; (entry == NULL) && (i < (sizeof(tssContext->nameCache) / sizeof(TSS_NAME_CACHE))) ;
+	 i++) {
+	if (tssContext->nameCache[i].handle == handle) {
+	    entry = &tssContext->nameCache[i];
+	}
+	else if ((empty == NULL) && (tssContext->nameCache[i].handle == TPM_RH_NULL)) {
+	    empty = &tssContext->nameCache[i];
+	}
+    }
+    if ((entry == NULL) && create) {
+	/* if full, replace the slots in turn */
+	if (empty == NULL) {
+	    empty = &tssContext->nameCache[tssContext->nameCacheNext];
+	    tssContext->nameCacheNext =
+		(tssContext->nameCacheNext + 1) % (sizeof(tssContext->nameCache) / sizeof(TSS_NAME_CACHE));
+	}
+	entry = empty;
+	entry->handle = handle;
+	entry->nameValid = FALSE;
+	entry->publicValid = FALSE;
+	entry->nvPublicValid = FALSE;
+    }
+    return entry;
+}
+
+/* TSS_NameCache_Delete() removes the handle from the Name and public cache */
+
+static void TSS_NameCache_Delete(TSS_CONTEXT *tssContext,
+				 TPM_HANDLE handle)
+{
+    TSS_NAME_CACHE	*entry = TSS_NameCache_Get(tssContext, handle, NULL, FALSE);
+
+    if (entry != NULL) {
+	entry->handle = TPM_RH_NULL;
+	entry->nameValid = FALSE;
+	entry->publicValid = FALSE;
+	entry->nvPublicValid = FALSE;
+    }
+    return;
+}
+
+#endif
+
 /* TSS_Name_Store() stores the 'name' parameter in a file.
 
    If handle is not 0, the handle is used as the file name.
 
    If 'string' is not NULL, the string is used as the file name.
+
+   If the Name cache is enabled, a Name stored by handle is also cached.
 */
 
 #ifndef TPM_TSS_NOFILE
@@ -1626,6 +3502,13 @@ static TPM_RC TSS_Name_Store(TSS_CONTEXT *tssContext,
 	if (tssVverbose) printf("TSS_Name_Store: File %s\n", nameFilename);
 	rc = TSS_File_WriteBinaryFile(name->b.buffer, name->b.size, nameFilename);
     }
+    if (rc == 0) {
+	TSS_NAME_CACHE *entry = TSS_NameCache_Get(tssContext, handle, string, TRUE);
+	if (entry != NULL) {
+	    entry->name = *name;
+	    entry->nameValid = TRUE;
+	}
+    }
     return rc;
 }
 
@@ -1636,6 +3519,8 @@ static TPM_RC TSS_Name_Store(TSS_CONTEXT *tssContext,
    If handle is not 0, the handle is used as the file name.
 
    If 'string' is not NULL, the string is used as the file name.
+
+   If the Name cache is enabled, a cached Name is returned without reading the file.
 */
    
 #ifndef TPM_TSS_NOFILE
@@ -1647,7 +3532,12 @@ static TPM_RC TSS_Name_Load(TSS_CONTEXT *tssContext,
 {
     TPM_RC 		rc = 0;
     char 		nameFilename[128];
+    TSS_NAME_CACHE	*entry = TSS_NameCache_Get(tssContext, handle, string, FALSE);
 		
+    if ((entry != NULL) && entry->nameValid) {
+	*name = entry->name;
+	return rc;
+    }
     if (rc == 0) {
 	if (string == NULL) {
 	    if (handle != 0) {
@@ -1674,6 +3564,13 @@ static TPM_RC TSS_Name_Load(TSS_CONTEXT *tssContext,
 			     sizeof(TPMU_NAME),
 			     nameFilename);
     }
+    if (rc == 0) {
+	entry = TSS_NameCache_Get(tssContext, handle, string, TRUE);
+	if (entry != NULL) {
+	    entry->name = *name;
+	    entry->nameValid = TRUE;
+	}
+    }
     return rc;
 }
 
@@ -1880,6 +3777,15 @@ static TPM_RC TSS_Public_Store(TSS_CONTEXT *tssContext,
 				     (MarshalFunction_t)TSS_TPM2B_PUBLIC_Marshal,
 				     publicFilename);
     }
+    if (rc == 0) {
+	TSS_NAME_CACHE *entry = TSS_NameCache_Get(tssContext, handle, string, TRUE);
+	if (entry != NULL) {
+	    entry->objectPublic = *public;
+	    entry->publicValid = TRUE;
+	}
+	/* a salt key parsed from the previous public is stale */
+	TSS_SaltKeyCache_Delete(tssContext, handle);
+    }
     return rc;
 }
 
@@ -1901,7 +3807,12 @@ static TPM_RC TSS_Public_Load(TSS_CONTEXT *tssContext,
 {
     TPM_RC 	rc = 0;
     char 	publicFilename[128];
+    TSS_NAME_CACHE	*entry = TSS_NameCache_Get(tssContext, handle, string, FALSE);
 		
+    if ((entry != NULL) && entry->publicValid) {
+	*public = entry->objectPublic;
+	return rc;
+    }
     if (rc == 0) {
 	if (string == NULL) {
 	    if (handle != 0) {
@@ -1928,6 +3839,13 @@ static TPM_RC TSS_Public_Load(TSS_CONTEXT *tssContext,
 				    (UnmarshalFunction_t)TPM2B_PUBLIC_Unmarshal,
 				    publicFilename);
     }
+    if (rc == 0) {
+	entry = TSS_NameCache_Get(tssContext, handle, string, TRUE);
+	if (entry != NULL) {
+	    entry->objectPublic = *public;
+	    entry->publicValid = TRUE;
+	}
+    }
     return rc;
 }
 
@@ -2002,6 +3920,8 @@ static TPM_RC TSS_Public_Store(TSS_CONTEXT *tssContext,
     }
     if (rc == 0) {
 	tssContext->objectPublic[slotIndex].objectPublic = *public;
+	/* a salt key parsed from the previous public is stale */
+	TSS_SaltKeyCache_Delete(tssContext, handle);
     }
     return rc;
 }
@@ -2113,14 +4033,25 @@ static TPM_RC TSS_DeleteHandle(TSS_CONTEXT *tssContext,
 {
     TPM_RC		rc = 0;
     TPM_HT 		handleType;
+    int			stored = TRUE;	/* FALSE if the session store has no copy */
 #ifndef TPM_TSS_NOFILE
     char		filename[128];
 #endif
 
     handleType = (TPM_HT) ((handle & HR_RANGE_MASK) >> HR_SHIFT);
+    /* remove a cached session */
+    if ((handleType == TPM_HT_HMAC_SESSION) ||
+	(handleType == TPM_HT_POLICY_SESSION)) {
+	TSS_SessionCache_Delete(tssContext, handle, &stored);
+	TSS_SessionPool_Delete(tssContext, handle);
+    }
+    /* remove a parsed salt key */
+    TSS_SaltKeyCache_Delete(tssContext, handle);
 #ifndef TPM_TSS_NOFILE
+    /* remove a cached Name and public */
+    TSS_NameCache_Delete(tssContext, handle);
     /* delete the Name */
-    if (rc == 0) {
+    if ((rc == 0) && stored) {
 	sprintf(filename, "%s/h%08x.bin", tssContext->tssDataDirectory, handle);
 	if (tssVverbose) printf("TSS_DeleteHandle: delete Name file %s\n", filename);
 	rc = TSS_File_DeleteFile(filename);
@@ -2144,7 +4075,9 @@ static TPM_RC TSS_DeleteHandle(TSS_CONTEXT *tssContext,
 	  case TPM_HT_HMAC_SESSION:
 	  case TPM_HT_POLICY_SESSION:
 	    if (tssVverbose) printf("TSS_DeleteHandle: delete session state %08x\n", handle);
-	    rc = TSS_HmacSession_DeleteData(tssContext, handle);
+	    if (stored) {
+		rc = TSS_HmacSession_DeleteData(tssContext, handle);
+	    }
 	    break;
 	  case TPM_HT_TRANSIENT:
 	  case TPM_HT_PERSISTENT:
@@ -2222,6 +4155,13 @@ static TPM_RC TSS_NVPublic_Store(TSS_CONTEXT *tssContext,
 				     (MarshalFunction_t)TSS_TPMS_NV_PUBLIC_Marshal,
 				     nvpFilename);
     }
+    if (rc == 0) {
+	TSS_NAME_CACHE *entry = TSS_NameCache_Get(tssContext, nvIndex, NULL, TRUE);
+	if (entry != NULL) {
+	    entry->nvPublic = *nvPublic;
+	    entry->nvPublicValid = TRUE;
+	}
+    }
     return rc;
 }
 
@@ -2241,13 +4181,25 @@ static TPM_RC TSS_NVPublic_Load(TSS_CONTEXT *tssContext,
 {
     TPM_RC 	rc = 0;
     char 	nvpFilename[128];
+    TSS_NAME_CACHE	*entry = TSS_NameCache_Get(tssContext, nvIndex, NULL, FALSE);
 
+    if ((entry != NULL) && entry->nvPublicValid) {
+	*nvPublic = entry->nvPublic;
+	return rc;
+    }
     if (rc == 0) {
 	sprintf(nvpFilename, "%s/nvp%08x.bin", tssContext->tssDataDirectory, nvIndex);
 	rc = TSS_File_ReadStructure(nvPublic,
 				    (UnmarshalFunction_t)TPMS_NV_PUBLIC_Unmarshal,
 				    nvpFilename);
     }
+    if (rc == 0) {
+	entry = TSS_NameCache_Get(tssContext, nvIndex, NULL, TRUE);
+	if (entry != NULL) {
+	    entry->nvPublic = *nvPublic;
+	    entry->nvPublicValid = TRUE;
+	}
+    }
     return rc;
 }
 
@@ -2261,7 +4213,11 @@ static TPM_RC TSS_NVPublic_Delete(TSS_CONTEXT *tssContext,
 {
     TPM_RC 	rc = 0;
     char 	nvpFilename[128];
+    TSS_NAME_CACHE	*entry = TSS_NameCache_Get(tssContext, nvIndex, NULL, FALSE);
     
+    if (entry != NULL) {
+	entry->nvPublicValid = FALSE;
+    }
     if (rc == 0) {
 	sprintf(nvpFilename, "%s/nvp%08x.bin", tssContext->tssDataDirectory, nvIndex);
 	rc = TSS_File_DeleteFile(nvpFilename);
@@ -2617,6 +4573,12 @@ static TPM_RC TSS_HmacSession_SetHmacKey(TSS_CONTEXT *tssContext,
 	    TSS_PrintAll("TSS_HmacSession_SetHmacKey: sessionValue",
 			 session->sessionValue.b.buffer, session->sessionValue.b.size);
     }
+    /* key the HMAC once, for both the command and response HMAC */
+    if (rc == 0) {
+	TSS_HMAC_KeyDelete(session->hmacKeyCtx);
+	session->hmacKeyCtx = NULL;
+	rc = TSS_HMAC_KeyCreate(&session->hmacKeyCtx, session->authHashAlg, &session->hmacKey);
+    }
     return rc;
 }
     
@@ -2771,22 +4733,22 @@ static TPM_RC TSS_HmacSession_SetHMAC(TSS_AUTH_CONTEXT *tssAuthContext,	/* autho
 		/* */
 		if (rc == 0) {
 		    hmac.hashAlg = session[i]->authHashAlg;
-		    rc = TSS_HMAC_Generate(&hmac,				/* output hmac */
-					   &session[i]->hmacKey,		/* input key */
-					   session[i]->sizeInBytes, (uint8_t *)&cpHash.digest,
-					   /* new is nonceCaller */
-					   session[i]->nonceCaller.b.size,
-					   &session[i]->nonceCaller.b.buffer,
-					   /* old is previous nonceTPM */
-					   session[i]->nonceTPM.b.size,
-					   &session[i]->nonceTPM.b.buffer,
-					   /* nonceTPMDecrypt */
-					   nonceTPMDecrypt.b.size, nonceTPMDecrypt.b.buffer,
-					   /* nonceTPMEncrypt */
-					   nonceTPMEncrypt.b.size, nonceTPMEncrypt.b.buffer,
-					   /* 1 byte, no endian conversion */
-					   sizeof(uint8_t), &sessionAttr8,
-					   0, NULL);
+		    rc = TSS_HMAC_GenerateKeyed(&hmac,			/* output hmac */
+						session[i]->hmacKeyCtx,	/* input key */
+						session[i]->sizeInBytes, (uint8_t *)&cpHash.digest,
+						/* new is nonceCaller */
+						session[i]->nonceCaller.b.size,
+						&session[i]->nonceCaller.b.buffer,
+						/* old is previous nonceTPM */
+						session[i]->nonceTPM.b.size,
+						&session[i]->nonceTPM.b.buffer,
+						/* nonceTPMDecrypt */
+						nonceTPMDecrypt.b.size, nonceTPMDecrypt.b.buffer,
+						/* nonceTPMEncrypt */
+						nonceTPMEncrypt.b.size, nonceTPMEncrypt.b.buffer,
+						/* 1 byte, no endian conversion */
+						sizeof(uint8_t), &sessionAttr8,
+						0, NULL);
 		    if (tssVverbose) {
 			TSS_PrintAll("TSS_HmacSession_SetHMAC: HMAC key",
 				     session[i]->hmacKey.t.buffer, session[i]->hmacKey.t.size);
@@ -2909,18 +4871,18 @@ static TPM_RC TSS_HmacSession_Verify(TSS_AUTH_CONTEXT *tssAuthContext,	/* author
 	    TSS_PrintAll("TSS_HmacSession_Verify: response HMAC",
 			 (uint8_t *)&authResponse->hmac.t.buffer, session->sizeInBytes);
 	}
-	rc = TSS_HMAC_Verify(&actualHmac,		/* input response hmac */
-			     &session->hmacKey,		/* input HMAC key */
-			     session->sizeInBytes,
-			     /* rpHash */
-			     session->sizeInBytes, (uint8_t *)&rpHash.digest,
-			     /* new is nonceTPM */
-			     session->nonceTPM.b.size, &session->nonceTPM.b.buffer,
-			     /* old is nonceCaller */
-			     session->nonceCaller.b.size, &session->nonceCaller.b.buffer,
-			     /* 1 byte, no endian conversion */
-			     sizeof(uint8_t), &authResponse->sessionAttributes.val,
-			     0, NULL);
+	rc = TSS_HMAC_VerifyKeyed(&actualHmac,		/* input response hmac */
+				  session->hmacKeyCtx,	/* input HMAC key */
+				  session->sizeInBytes,
+				  /* rpHash */
+				  session->sizeInBytes, (uint8_t *)&rpHash.digest,
+				  /* new is nonceTPM */
+				  session->nonceTPM.b.size, &session->nonceTPM.b.buffer,
+				  /* old is nonceCaller */
+				  session->nonceCaller.b.size, &session->nonceCaller.b.buffer,
+				  /* 1 byte, no endian conversion */
+				  sizeof(uint8_t), &authResponse->sessionAttributes.val,
+				  0, NULL);
     }
     return rc;
 }
@@ -3784,6 +5746,7 @@ static TPM_RC TSS_PR_StartAuthSession(TSS_CONTEXT *tssContext,
     if (in->tpmKey != TPM_RH_NULL) {
 #ifndef TPM_TSS_NOCRYPTO
 	TPM2B_PUBLIC		bPublic;
+	TSS_SALT_KEY_CACHE	*saltKey = NULL;
 	
 	if (rc == 0) {
 	    if (extra == NULL) {
@@ -3792,26 +5755,41 @@ static TPM_RC TSS_PR_StartAuthSession(TSS_CONTEXT *tssContext,
 		rc = TSS_RC_NULL_PARAMETER;
 	    }
 	}
-	/* get the tpmKey public key */
+	/* an RSA salt key parsed for an earlier session needs no public load */
 	if (rc == 0) {
+	    saltKey = TSS_SaltKeyCache_Get(tssContext, in->tpmKey);
+	}
+	/* get the tpmKey public key */
+	if ((rc == 0) && (saltKey == NULL)) {
 	    rc = TSS_Public_Load(tssContext, &bPublic, in->tpmKey, NULL);
 	}
  	/* generate the salt and encrypted salt based on the asymmetric key type */
-	if (bPublic.publicArea.type == TPM_ALG_ECC) {
-	    rc = TSS_ECC_Salt(&extra->salt,
-			      &in->encryptedSalt,
-			      &bPublic.publicArea);
-	} 
-	else if (bPublic.publicArea.type == TPM_ALG_RSA) {
+	if ((rc == 0) && (saltKey != NULL)) {
 	    rc = TSS_RSA_Salt(&extra->salt,
 			      &in->encryptedSalt,
-			      &bPublic.publicArea);
-	} 
-	else {
-	    if (tssVerbose)
-		printf("TSS_PR_StartAuthSession: public key type %04x not supported\n",
-		       bPublic.publicArea.type);
-	    rc = TSS_RC_BAD_SALT_KEY;
+			      &saltKey->publicArea,
+			      saltKey->rsaKey);
+	}
+	else if (rc == 0) {
+	    if (bPublic.publicArea.type == TPM_ALG_ECC) {
+		rc = TSS_ECC_Salt(&extra->salt,
+				  &in->encryptedSalt,
+				  &bPublic.publicArea);
+	    } 
+	    else if (bPublic.publicArea.type == TPM_ALG_RSA) {
+		/* NULL if the cache is disabled, the key is then parsed for this session only */
+		saltKey = TSS_SaltKeyCache_Add(tssContext, in->tpmKey, &bPublic.publicArea);
+		rc = TSS_RSA_Salt(&extra->salt,
+				  &in->encryptedSalt,
+				  &bPublic.publicArea,
+				  (saltKey != NULL) ? saltKey->rsaKey : NULL);
+	    } 
+	    else {
+		if (tssVerbose)
+		    printf("TSS_PR_StartAuthSession: public key type %04x not supported\n",
+			   bPublic.publicArea.type);
+		rc = TSS_RC_BAD_SALT_KEY;
+	    }
 	}
 #else
 	tssContext = tssContext;
@@ -3823,11 +5801,15 @@ static TPM_RC TSS_PR_StartAuthSession(TSS_CONTEXT *tssContext,
 
 #ifndef TPM_TSS_NOCRYPTO
 
-/* TSS_RSA_Salt() returns both the plaintext and excrypted salt, based on the salt key bPublic. */
+/* TSS_RSA_Salt() returns both the plaintext and excrypted salt, based on the salt key bPublic.
+
+   If 'rsaKey' is not NULL, it is the public key already parsed from bPublic.
+*/
 
 static TPM_RC TSS_RSA_Salt(TPM2B_DIGEST 		*salt,
 			   TPM2B_ENCRYPTED_SECRET	*encryptedSalt,
-			   TPMT_PUBLIC			*publicArea)
+			   TPMT_PUBLIC			*publicArea,
+			   void				*rsaKey)
 {
     TPM_RC		rc = 0;
 
@@ -3873,8 +5855,19 @@ static TPM_RC TSS_RSA_Salt(TPM2B_DIGEST 		*salt,
 				      (uint8_t *)&salt->t.buffer,
 				      salt->t.size);
     }
+    /* encrypt the salt with the parsed tpmKey public key */
+    if ((rc == 0) && (rsaKey != NULL)) {
+	rc = TSS_RSAPublicEncryptKeyed((uint8_t *)&encryptedSalt->t.secret,
+				       MAX_RSA_KEY_BYTES,	/* size of encrypted data buffer */
+				       (uint8_t *)&salt->t.buffer,
+				       salt->t.size,
+				       rsaKey,
+				       (unsigned char *)"SECRET",	/* encoding parameter */
+				       sizeof("SECRET"),
+				       publicArea->nameAlg);
+    }
     /* encrypt the salt */
-    if (rc == 0) {
+    else if (rc == 0) {
 	/* public exponent */
 	unsigned char earr[3] = {0x01, 0x00, 0x01};
 	/* encrypt the salt with the tpmKey public key */
@@ -3899,7 +5892,127 @@ static TPM_RC TSS_RSA_Salt(TPM2B_DIGEST 		*salt,
     return rc;
 }
 
+/* TSS_SaltKeyCache_Get() returns the parsed RSA salt key for the handle, or NULL if the cache is
+   disabled or the handle is not cached.
+
+   The salt key cache follows the TPM_NAME_CACHE property, since it is derived from the cached
+   public.  Entries are removed when the handle is flushed or evicted, or a new public is stored
+   for it.
+*/
+
+static TSS_SALT_KEY_CACHE *TSS_SaltKeyCache_Get(TSS_CONTEXT *tssContext,
+						TPM_HANDLE handle)
+{
+    TSS_SALT_KEY_CACHE	*entry = NULL;
+    size_t		i;
+
+    if (!tssContext->tssNameCache) {
+	return NULL;
+    }
+    for (i = 0 ; (entry == NULL) &&
+	     (i < (sizeof(tssContext->saltKeyCache) / sizeof(TSS_SALT_KEY_CACHE))) ; i++) {
+	if (tssContext->saltKeyCache[i].handle == handle) {
+	    entry = &tssContext->saltKeyCache[i];
+	}
+    }
+    if ((entry != NULL) && tssVverbose) printf("TSS_SaltKeyCache_Get: Hit %08x\n", handle);
+    return entry;
+}
+
+/* TSS_SaltKeyCache_Add() parses the RSA public key and caches it for the handle, replacing an
+   older entry if the cache is full.
+
+   Returns NULL if the cache is disabled or the key cannot be parsed.  The caller then encrypts
+   without the cache.
+*/
+
+static TSS_SALT_KEY_CACHE *TSS_SaltKeyCache_Add(TSS_CONTEXT *tssContext,
+						TPM_HANDLE handle,
+						TPMT_PUBLIC *publicArea)
+{
+    TPM_RC		rc = 0;
+    TSS_SALT_KEY_CACHE	*entry = NULL;
+    RSA			*rsaKey = NULL;
+    /* public exponent */
+    unsigned char 	earr[3] = {0x01, 0x00, 0x01};
+    size_t		i;
+
+    if (!tssContext->tssNameCache) {
+	return NULL;
+    }
+    if (rc == 0) {
+	rc = TSS_RSAGeneratePublicToken(&rsaKey,
+					publicArea->unique.rsa.t.buffer,	/* public modulus */
+					publicArea->unique.rsa.t.size,
+					earr, 					/* public exponent */
+					sizeof(earr));
+    }
+    /* use an empty slot, else replace the slots in turn */
+    if (rc == 0) {
+	for (i = 0 ; (entry == NULL) &&
+		 (i < (sizeof(tssContext->saltKeyCache) / sizeof(TSS_SALT_KEY_CACHE))) ; i++) {
+	    if (tssContext->saltKeyCache[i].handle == TPM_RH_NULL) {
+		entry = &tssContext->saltKeyCache[i];
+	    }
+	}
+	if (entry == NULL) {
+	    entry = &tssContext->saltKeyCache[tssContext->saltKeyCacheNext];
+	    tssContext->saltKeyCacheNext = (tssContext->saltKeyCacheNext + 1) %
+					   (sizeof(tssContext->saltKeyCache) / sizeof(TSS_SALT_KEY_CACHE));
+	    TSS_RSAPublicKeyDelete(entry->rsaKey);
+	}
+	entry->handle = handle;
+	entry->publicArea = *publicArea;
+	entry->rsaKey = rsaKey;
+    }
+    else {
+	TSS_RSAPublicKeyDelete(rsaKey);
+    }
+    return entry;
+}
+
+#endif
+
+/* TSS_SaltKeyCache_Delete() removes the handle from the RSA salt key cache */
+
+static void TSS_SaltKeyCache_Delete(TSS_CONTEXT *tssContext,
+				    TPM_HANDLE handle)
+{
+#ifndef TPM_TSS_NOCRYPTO
+    size_t	i;
+
+    for (i = 0 ; i < (sizeof(tssContext->saltKeyCache) / sizeof(TSS_SALT_KEY_CACHE)) ; i++) {
+	if ((handle != TPM_RH_NULL) && (tssContext->saltKeyCache[i].handle == handle)) {
+	    TSS_RSAPublicKeyDelete(tssContext->saltKeyCache[i].rsaKey);
+	    tssContext->saltKeyCache[i].rsaKey = NULL;
+	    tssContext->saltKeyCache[i].handle = TPM_RH_NULL;
+	}
+    }
+#else
+    tssContext = tssContext;
+    handle = handle;
+#endif
+    return;
+}
+
+/* TSS_SaltKeyCache_Clear() empties the RSA salt key cache */
+
+static void TSS_SaltKeyCache_Clear(TSS_CONTEXT *tssContext)
+{
+#ifndef TPM_TSS_NOCRYPTO
+    size_t	i;
+
+    for (i = 0 ; i < (sizeof(tssContext->saltKeyCache) / sizeof(TSS_SALT_KEY_CACHE)) ; i++) {
+	TSS_RSAPublicKeyDelete(tssContext->saltKeyCache[i].rsaKey);
+	tssContext->saltKeyCache[i].rsaKey = NULL;
+	tssContext->saltKeyCache[i].handle = TPM_RH_NULL;
+    }
+    tssContext->saltKeyCacheNext = 0;
+#else
+    tssContext = tssContext;
 #endif
+    return;
+}
 
 static TPM_RC TSS_PR_NV_DefineSpace(TSS_CONTEXT *tssContext,
 				    NV_DefineSpace_In *in,
@@ -62,6 +62,31 @@ typedef struct TSS_CONTEXT TSS_CONTEXT;
 #define TPM_DEVICE		7
 #define TPM_ENCRYPT_SESSIONS	8
 #define TPM_SERVER_TYPE		9
+#define TPM_SOCKET_POOL		10
+#define TPM_DEVICE_NONBLOCK	11
+#define TPM_SESSION_CACHE	12
+#define TPM_NAME_CACHE		13
+#define TPM_SECURE_WIPE		14
+#define TPM_EXECUTE_TIMING	15
+#define TPM_RANDOM_POOL		16
+#define TPM_RANDOM_MIX		17
+#define TPM_PROPERTY_CACHE	18
+#define TPM_ECC_SALT_POOL	19
+#define TPM_SESSION_POOL	20
+
+/* TSS_Execute() steps timed when the TPM_EXECUTE_TIMING property is set */
+
+#define TSS_STEP_MARSHAL	0	/* pre-processor, marshal command parameters */
+#define TSS_STEP_NAMES		1	/* get the Names of the command handles */
+#define TSS_STEP_SESSION_LOAD	2	/* load the session contexts */
+#define TSS_STEP_HMAC		3	/* nonces, HMAC keys, command HMACs */
+#define TSS_STEP_ENCRYPT	4	/* command parameter encryption */
+#define TSS_STEP_TRANSMIT	5	/* send the command and wait for the response */
+#define TSS_STEP_VERIFY		6	/* response authorizations and HMAC verification */
+#define TSS_STEP_SESSION_SAVE	7	/* save or delete the session contexts */
+#define TSS_STEP_DECRYPT	8	/* response parameter decryption */
+#define TSS_STEP_UNMARSHAL	9	/* unmarshal response parameters, post-processor */
+#define TSS_STEP_MAX		10
 
 #ifdef __cplusplus
 extern "C" {
@@ -78,6 +103,25 @@ extern "C" {
 	StartAuthSession_Extra 	StartAuthSession;
     } EXTRA_PARAMETERS;
 
+    /* the time spent in each step of one command, in nanoseconds */
+
+    typedef struct {
+	TPM_CC			commandCode;
+	TPM_RC			rc;		/* the TSS_Execute() return code */
+	uint64_t		stepNs[TSS_STEP_MAX];
+    } TSS_EXECUTE_TIMING;
+
+    /* session pool counters.  The hit rate is hits / leases. */
+
+    typedef struct {
+	uint32_t		leases;		/* TSS_SessionPool_Lease() calls */
+	uint32_t		hits;		/* leases served by a pooled session */
+	uint32_t		starts;		/* TPM2_StartAuthSession commands */
+	uint32_t		saves;		/* idle sessions context saved to free a TPM slot */
+	uint32_t		loads;		/* saved sessions context loaded for a lease */
+	uint32_t		flushes;	/* pooled sessions flushed or ended by the TPM */
+    } TSS_SESSION_POOL_STATS;
+
     LIB_EXPORT
     TPM_RC TSS_Create(TSS_CONTEXT **tssContext);
 
@@ -92,6 +136,78 @@ extern "C" {
 		       TPM_CC commandCode,
 		       ...);
 
+    LIB_EXPORT
+    TPM_RC TSS_ExecuteSubmit(TSS_CONTEXT *tssContext,
+			     COMMAND_PARAMETERS *in,
+			     EXTRA_PARAMETERS *extra,
+			     TPM_CC commandCode,
+			     ...);
+
+    LIB_EXPORT
+    TPM_RC TSS_ExecuteComplete(TSS_CONTEXT *tssContext,
+			       RESPONSE_PARAMETERS *out);
+
+    LIB_EXPORT
+    TPM_RC TSS_SaveSessionCache(TSS_CONTEXT *tssContext);
+
+    LIB_EXPORT
+    TPM_RC TSS_GetExecuteTiming(TSS_CONTEXT *tssContext,
+				TSS_EXECUTE_TIMING *timing,
+				uint32_t *count);
+
+    LIB_EXPORT
+    uint64_t TSS_Timing_Now(void);
+
+    LIB_EXPORT
+    TPM_RC TSS_GetRandom(TSS_CONTEXT *tssContext,
+			 uint8_t *buffer,
+			 uint32_t bytes);
+
+    LIB_EXPORT
+    TPM_RC TSS_GetTpmProperty(TSS_CONTEXT *tssContext,
+			      TPM_PT property,
+			      uint32_t *value);
+
+    LIB_EXPORT
+    TPM_RC TSS_NV_GetBufferMax(TSS_CONTEXT *tssContext,
+			       uint32_t *nvBufferMax);
+
+    LIB_EXPORT
+    TPM_RC TSS_NV_Read(TSS_CONTEXT *tssContext,
+		       uint8_t *buffer,
+		       uint32_t size,
+		       TPMI_RH_NV_AUTH authHandle,
+		       TPMI_RH_NV_INDEX nvIndex,
+		       uint32_t offset,
+		       ...);
+
+    LIB_EXPORT
+    TPM_RC TSS_NV_Write(TSS_CONTEXT *tssContext,
+			const uint8_t *buffer,
+			uint32_t size,
+			TPMI_RH_NV_AUTH authHandle,
+			TPMI_RH_NV_INDEX nvIndex,
+			uint32_t offset,
+			...);
+
+    LIB_EXPORT
+    TPM_RC TSS_SessionPool_Lease(TSS_CONTEXT *tssContext,
+				 TPMI_SH_AUTH_SESSION *sessionHandle,
+				 TPMI_DH_OBJECT tpmKey,
+				 TPMI_ALG_HASH authHash,
+				 const TPMT_SYM_DEF *symmetric);
+
+    LIB_EXPORT
+    TPM_RC TSS_SessionPool_Release(TSS_CONTEXT *tssContext,
+				   TPMI_SH_AUTH_SESSION sessionHandle);
+
+    LIB_EXPORT
+    TPM_RC TSS_SessionPool_Flush(TSS_CONTEXT *tssContext);
+
+    LIB_EXPORT
+    TPM_RC TSS_SessionPool_GetStats(TSS_CONTEXT *tssContext,
+				    TSS_SESSION_POOL_STATS *stats);
+
     LIB_EXPORT
     TPM_RC TSS_SetProperty(TSS_CONTEXT *tssContext,
 			   int property,
@@ -80,6 +80,16 @@ extern "C" {
     TPM_RC TSS_HMAC_Generate_valist(TPMT_HA *digest,
 				    const TPM2B_KEY *hmacKey,
 				    va_list ap);
+    LIB_EXPORT
+    TPM_RC TSS_HMAC_KeyCreate(void **hmacKeyCtx,
+			      TPMI_ALG_HASH hashAlg,
+			      const TPM2B_KEY *hmacKey);
+    LIB_EXPORT
+    void TSS_HMAC_KeyDelete(void *hmacKeyCtx);
+    LIB_EXPORT
+    TPM_RC TSS_HMAC_GenerateKeyed_valist(TPMT_HA *digest,
+					 void *hmacKeyCtx,
+					 va_list ap);
     LIB_EXPORT void TSS_XOR(unsigned char *out,
 			    const unsigned char *in1,
 			    const unsigned char *in2,
@@ -106,6 +116,17 @@ extern "C" {
 				int pl,
 				TPMI_ALG_HASH halg);
     LIB_EXPORT
+    TPM_RC TSS_RSAPublicEncryptKeyed(unsigned char* encrypt_data,
+				     size_t encrypt_data_size,
+				     const unsigned char *decrypt_data,
+				     size_t decrypt_data_size,
+				     void *rsaKey,
+				     unsigned char *p,
+				     int pl,
+				     TPMI_ALG_HASH halg);
+    LIB_EXPORT
+    void TSS_RSAPublicKeyDelete(void *rsaKey);
+    LIB_EXPORT
     TPM_RC TSS_RSAGeneratePublicToken(RSA **rsa_pub_key,		/* freed by caller */
 				      const unsigned char *narr,   	/* public modulus */
 				      uint32_t nbytes,
@@ -60,6 +60,12 @@ extern "C" {
     TPM_RC TSS_Hash_Generate(TPMT_HA *digest,
 			     ...);
 
+    LIB_EXPORT
+    TPM_RC TSS_Hash_ExtendBatch(TPMT_HA *pcrs[],
+				const uint8_t *extend[],
+				const uint16_t extendSize[],
+				size_t count);
+
     LIB_EXPORT
     TPM_RC TSS_HMAC_Generate(TPMT_HA *digest,
 			     const TPM2B_KEY *hmacKey,
@@ -70,6 +76,15 @@ extern "C" {
 			   UINT32 sizeInBytes,
 			   ...);
     LIB_EXPORT
+    TPM_RC TSS_HMAC_GenerateKeyed(TPMT_HA *digest,
+				  void *hmacKeyCtx,
+				  ...);
+    LIB_EXPORT
+    TPM_RC TSS_HMAC_VerifyKeyed(TPMT_HA *expect,
+				void *hmacKeyCtx,
+				UINT32 sizeInBytes,
+				...);
+    LIB_EXPORT
     TPM_RC TSS_KDFA(uint8_t          *keyStream,
 		    TPM_ALG_ID       hashAlg,
 		    const TPM2B     *key,
@@ -87,6 +102,11 @@ extern "C" {
 		    const TPM2B     *contextV,
 		    uint32_t         sizeInBits);
 
+    LIB_EXPORT
+    TPM_RC TSS_ECC_PoolStart(uint32_t poolSize);
+    LIB_EXPORT
+    void TSS_ECC_PoolStop(void);
+
     uint16_t TSS_Sym_GetBlockSize(TPM_ALG_ID	symmetricAlg, 
 				  uint16_t	keySizeInBits);
 
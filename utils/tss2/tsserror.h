@@ -106,6 +106,12 @@
 #define TSS_RC_BAD_HANDLE_NUMBER	0x000b0083	/* Bad handle number for this command */
 #define TSS_RC_KDFE_FAILED              0x000b0084      /* KDFe function failed */
 #define TSS_RC_EC_EPHEMERAL_FAILURE     0x000b0085      /* Failed while making or using EC ephemeral key */
+#define TSS_RC_COMMAND_PENDING		0x000b0086	/* A submitted command has not been completed */
+#define TSS_RC_NO_COMMAND_PENDING	0x000b0087	/* There is no submitted command to complete */
+#define TSS_RC_WOULD_BLOCK		0x000b0088	/* The response is not yet available */
+#define TSS_RC_NO_TPM_PROPERTY		0x000b0089	/* The TPM did not report the property */
+#define TSS_RC_BAD_POLICY		0x000b008a	/* The policy description is malformed */
+#define TSS_RC_POLICY_NOT_SATISFIED	0x000b008b	/* No policy branch can be satisfied */
 #define TSS_RC_NO_SESSION_SLOT		0x000b0090	/* TSS context has no session slot for handle */
 #define TSS_RC_NO_OBJECTPUBLIC_SLOT	0x000b0091	/* TSS context has no object public slot for handle */
 #define TSS_RC_NO_NVPUBLIC_SLOT		0x000b0092	/* TSS context has no NV public slot for handle */
@@ -0,0 +1,170 @@
+/********************************************************************************/
+/*										*/
+/*				      TSS Policy Compiler				*/
+/*			     Written by agent					*/
+/*	      $Id: tsspolicy.h $							*/
+/*										*/
+/* (c) Copyright agent 2026.							*/
+/*										*/
+/* All rights reserved.								*/
+/* 										*/
+/* Redistribution and use in source and binary forms, with or without		*/
+/* modification, are permitted provided that the following conditions are	*/
+/* met:										*/
+/* 										*/
+/* Redistributions of source code must retain the above copyright notice,	*/
+/* this list of conditions and the following disclaimer.			*/
+/* 										*/
+/* Redistributions in binary form must reproduce the above copyright		*/
+/* notice, this list of conditions and the following disclaimer in the		*/
+/* documentation and/or other materials provided with the distribution.		*/
+/* 										*/
+/* Neither the names of the IBM Corporation nor the names of its		*/
+/* contributors may be used to endorse or promote products derived from		*/
+/* this software without specific prior written permission.			*/
+/* 										*/
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		*/
+/* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		*/
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	*/
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		*/
+/* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	*/
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		*/
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	*/
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	*/
+/* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		*/
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	*/
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		*/
+/********************************************************************************/
+
+
+/* This is a semi-public header. The API is subject to change.
+
+   It compiles a structured policy description into the policy digest for one or more hash
+   algorithms and into the sequence of policy commands that satisfies the policy at runtime, and
+   executes that sequence against a policy session.
+*/
+
+#ifndef TSSPOLICY_H
+#define TSSPOLICY_H
+
+#ifndef TPM_TSS
+#define TPM_TSS
+#endif
+
+#include <tss2/tss.h>
+
+#define TSS_POLICY_OR_MAX	8	/* TPM2_PolicyOR() accepts at most 8 digests */
+#define TSS_POLICY_HASH_MAX	4	/* hash algorithms compiled in one pass */
+#define TSS_POLICY_DEPTH_MAX	8	/* PolicyOR nesting limit, also catches cycles */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    typedef struct TSS_POLICY TSS_POLICY;
+
+    /* TSS_POLICY_TERM is one policy assertion.  Only the members used by commandCode are
+       read. */
+
+    typedef struct {
+	TPM_CC			commandCode;	/* TPM_CC_PolicyPCR, TPM_CC_PolicyOR, ... */
+	/* PolicyPCR */
+	TPML_PCR_SELECTION	pcrs;		/* PCR selection */
+	const uint8_t		*pcrValues;	/* concatenated PCR values in selection order */
+	uint32_t		pcrValuesSize;
+	/* PolicyCommandCode */
+	TPM_CC			code;
+	/* PolicySigned, PolicySecret, PolicyAuthorize */
+	TPM2B_NAME		name;		/* authObject, authHandle, or keySign Name */
+	TPM2B_NONCE		policyRef;
+	TPM_HANDLE		handle;		/* authObject, authHandle, or keySign, execute only */
+	const char		*password;	/* PolicySecret authHandle password, execute only */
+	/* PolicyLocality */
+	TPMA_LOCALITY		locality;
+	/* PolicyNvWritten */
+	TPMI_YES_NO		writtenSet;
+	/* PolicyOR */
+	const TSS_POLICY	*branch[TSS_POLICY_OR_MAX];
+	uint32_t		branchCount;
+    } TSS_POLICY_TERM;
+
+    /* TSS_POLICY is the AND of its terms, in order.  A TSS_POLICY referenced from more than one
+       PolicyOR is compiled once for each distinct starting digest. */
+
+    struct TSS_POLICY {
+	const TSS_POLICY_TERM	*terms;
+	uint32_t		termCount;
+    };
+
+    /* TSS_POLICY_STEP is one policy command of the compiled program */
+
+    typedef struct {
+	TPM_CC			commandCode;
+	const TSS_POLICY_TERM	*term;
+	/* pcrDigest for PolicyPCR, approvedPolicy for PolicyAuthorize, per hash algorithm */
+	TPM2B_DIGEST		digest[TSS_POLICY_HASH_MAX];
+	/* PolicyOR, indexes into branches */
+	uint32_t		branch[TSS_POLICY_OR_MAX];
+	uint32_t		branchCount;
+    } TSS_POLICY_STEP;
+
+    /* TSS_POLICY_BRANCH is a compiled TSS_POLICY, steps start to start + count - 1, which
+       moves the policy digest from prefix to digest. */
+
+    typedef struct {
+	const TSS_POLICY	*policy;
+	uint32_t		start;
+	uint32_t		count;
+	int			complete;
+	TPM2B_DIGEST		prefix[TSS_POLICY_HASH_MAX];
+	TPM2B_DIGEST		digest[TSS_POLICY_HASH_MAX];
+    } TSS_POLICY_BRANCH;
+
+    /* TSS_POLICY_COMPILED is the compiled policy.  branches[0] is the top level policy. */
+
+    typedef struct {
+	uint32_t		hashCount;
+	TPMI_ALG_HASH		hashAlg[TSS_POLICY_HASH_MAX];
+	TSS_POLICY_STEP		*steps;
+	uint32_t		stepCount;
+	TSS_POLICY_BRANCH	*branches;
+	uint32_t		branchCount;
+	uint32_t		memoHits;	/* subtrees reused rather than recompiled */
+    } TSS_POLICY_COMPILED;
+
+    /* TSS_POLICY_SIGN_FUNCTION signs message with the key whose Name is term->name, for
+       PolicySigned and for the PolicyAuthorize approvedPolicy.  The message is not hashed. */
+
+    typedef TPM_RC (*TSS_POLICY_SIGN_FUNCTION)(TPMT_SIGNATURE *signature,
+					       const TSS_POLICY_TERM *term,
+					       const uint8_t *message,
+					       uint32_t messageSize,
+					       void *signParam);
+
+    LIB_EXPORT
+    TPM_RC TSS_Policy_Compile(TSS_POLICY_COMPILED **compiled,
+			      const TSS_POLICY *policy,
+			      const TPMI_ALG_HASH *hashAlg,
+			      uint32_t hashCount);
+    LIB_EXPORT
+    TPM_RC TSS_Policy_GetDigest(TPM2B_DIGEST *policyDigest,
+				const TSS_POLICY_COMPILED *compiled,
+				TPMI_ALG_HASH hashAlg);
+    LIB_EXPORT
+    TPM_RC TSS_Policy_Execute(TSS_CONTEXT *tssContext,
+			      TPMI_SH_POLICY policySession,
+			      const TSS_POLICY_COMPILED *compiled,
+			      TPMI_ALG_HASH hashAlg,
+			      TPM_CC commandCode,
+			      TSS_POLICY_SIGN_FUNCTION signFunction,
+			      void *signParam);
+    LIB_EXPORT
+    void TSS_Policy_Print(const TSS_POLICY_COMPILED *compiled);
+    LIB_EXPORT
+    void TSS_Policy_Free(TSS_POLICY_COMPILED *compiled);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
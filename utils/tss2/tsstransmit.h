@@ -66,9 +66,22 @@ extern "C" {
 		 const uint8_t *commandBuffer, uint32_t written,
 		 const char *message);
 
+    LIB_EXPORT TPM_RC
+    TSS_TransmitSend(TSS_CONTEXT *tssContext,
+		     const uint8_t *commandBuffer, uint32_t written,
+		     const char *message);
+    LIB_EXPORT TPM_RC
+    TSS_TransmitReceive(TSS_CONTEXT *tssContext,
+			uint8_t *responseBuffer, uint32_t *read);
+    LIB_EXPORT TPM_RC
+    TSS_GetPollFd(TSS_CONTEXT *tssContext, int *fd);
+
     LIB_EXPORT TPM_RC
     TSS_Close(TSS_CONTEXT *tssContext);
 
+    LIB_EXPORT TPM_RC
+    TSS_ClosePool(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,6 +47,7 @@
 
 #ifdef TPM_POSIX
 #include <netinet/in.h>
+#include <pthread.h>
 #endif
 #ifdef TPM_WINDOWS
 #include <winsock2.h>
@@ -680,21 +681,93 @@ struct TSS_AUTH_CONTEXT {
 } ;
 
 
-static TPM_RC TSS_MarshalTable_Process(TSS_AUTH_CONTEXT *tssAuthContext,
-				       TPM_CC commandCode)
+/* The TCG command codes are all in the range MARSHAL_INDEX_BASE to MARSHAL_INDEX_BASE +
+   MARSHAL_INDEX_SIZE - 1.  marshalIndexTable maps the low byte of those command codes directly to
+   the marshalTable index.  Vendor command codes are searched. */
+
+#define MARSHAL_INDEX_BASE	0x00000100
+#define MARSHAL_INDEX_SIZE	0x100
+#define MARSHAL_INDEX_NONE	0xffff
+
+static uint16_t marshalIndexTable[MARSHAL_INDEX_SIZE];
+#ifdef TPM_POSIX
+static pthread_once_t marshalIndexTableOnce = PTHREAD_ONCE_INIT;
+#elif defined TPM_WINDOWS
+static INIT_ONCE marshalIndexTableOnce = INIT_ONCE_STATIC_INIT;
+#else
+static int marshalIndexTableInit = FALSE;
+#endif
+
+/* TSS_MarshalTable_Search() searches marshalTable for the command code.  Returns
+   MARSHAL_INDEX_NONE if not found. */
+
+static uint16_t TSS_MarshalTable_Search(TPM_CC commandCode)
 {
-    TPM_RC rc = 0;
     size_t index;
-    int found = FALSE;
 
-    /* get the command index in the dispatch table */
     for (index = 0 ; index < (sizeof(marshalTable) / sizeof(MARSHAL_TABLE)) ; (index)++) {
 	if (marshalTable[index].commandCode == commandCode) {
-	    found = TRUE;
-	    break;
+	    return (uint16_t)index;
 	}
     }
-    if (found) {
+    return MARSHAL_INDEX_NONE;
+}
+
+/* TSS_MarshalTable_Init() builds the direct index table from marshalTable */
+
+static void TSS_MarshalTable_Init(void)
+{
+    TPM_CC commandCode;
+
+    for (commandCode = MARSHAL_INDEX_BASE ;
+	 commandCode < (MARSHAL_INDEX_BASE + MARSHAL_INDEX_SIZE) ;
+	 commandCode++) {
+	marshalIndexTable[commandCode - MARSHAL_INDEX_BASE] = TSS_MarshalTable_Search(commandCode);
+    }
+    return;
+}
+
+#ifdef TPM_WINDOWS
+
+/* TSS_MarshalTable_InitOnce() is the InitOnceExecuteOnce() callback for TSS_MarshalTable_Init() */
+
+static BOOL CALLBACK TSS_MarshalTable_InitOnce(PINIT_ONCE initOnce, PVOID parameter, PVOID *context)
+{
+    initOnce = initOnce;
+    parameter = parameter;
+    context = context;
+    TSS_MarshalTable_Init();
+    return TRUE;
+}
+
+#endif
+
+static TPM_RC TSS_MarshalTable_Process(TSS_AUTH_CONTEXT *tssAuthContext,
+				       TPM_CC commandCode)
+{
+    TPM_RC rc = 0;
+    uint16_t index;
+
+    /* the table is built once, at the first call from any thread */
+#ifdef TPM_POSIX
+    pthread_once(&marshalIndexTableOnce, TSS_MarshalTable_Init);
+#elif defined TPM_WINDOWS
+    InitOnceExecuteOnce(&marshalIndexTableOnce, TSS_MarshalTable_InitOnce, NULL, NULL);
+#else
+    if (!marshalIndexTableInit) {
+	TSS_MarshalTable_Init();
+	marshalIndexTableInit = TRUE;
+    }
+#endif
+    /* get the command index in the dispatch table */
+    if ((commandCode >= MARSHAL_INDEX_BASE) &&
+	(commandCode < (MARSHAL_INDEX_BASE + MARSHAL_INDEX_SIZE))) {
+	index = marshalIndexTable[commandCode - MARSHAL_INDEX_BASE];
+    }
+    else {
+	index = TSS_MarshalTable_Search(commandCode);
+    }
+    if (index != MARSHAL_INDEX_NONE) {
 	tssAuthContext->commandCode = commandCode;
 	tssAuthContext->commandText = marshalTable[index].commandText;
 	tssAuthContext->marshalInFunction = marshalTable[index].marshalInFunction;
@@ -720,10 +793,25 @@ TPM_RC TSS_AuthCreate(TSS_AUTH_CONTEXT **tssAuthContext)
     return rc;
 }
 
+/* TSS_InitAuthContext() erases the command and response buffers and resets the context.  It is
+   used when the context is created and deleted.
+*/
+
 void TSS_InitAuthContext(TSS_AUTH_CONTEXT *tssAuthContext)
 {
     memset(tssAuthContext->commandBuffer, 0, MAX_COMMAND_SIZE);
     memset(tssAuthContext->responseBuffer, 0, MAX_RESPONSE_SIZE);
+    TSS_ResetAuthContext(tssAuthContext);
+}
+
+/* TSS_ResetAuthContext() resets the context for the next command.
+
+   The buffers are not erased.  Marshaling and the transmit receive set the sizes, and nothing reads
+   past them.  Sensitive buffers are erased by TSS_WipeAuthContext() after the command.
+*/
+
+void TSS_ResetAuthContext(TSS_AUTH_CONTEXT *tssAuthContext)
+{
     tssAuthContext->commandText = NULL;
     tssAuthContext->commandCode = 0;
     tssAuthContext->responseCode = 0;
@@ -748,6 +836,81 @@ TPM_RC TSS_AuthDelete(TSS_AUTH_CONTEXT *tssAuthContext)
     return 0;
 }
 
+/* Commands whose command or response parameters can hold a plaintext secret, either directly or
+   after parameter decryption */
+
+static const TPM_CC tssSensitiveCommands[] = {
+    TPM_CC_Create,
+    TPM_CC_CreatePrimary,
+    TPM_CC_CreateLoaded,
+    TPM_CC_LoadExternal,
+    TPM_CC_Import,
+    TPM_CC_Duplicate,
+    TPM_CC_Unseal,
+    TPM_CC_RSA_Encrypt,
+    TPM_CC_RSA_Decrypt,
+    TPM_CC_ECDH_KeyGen,
+    TPM_CC_ECDH_ZGen,
+    TPM_CC_ZGen_2Phase,
+    TPM_CC_EncryptDecrypt,
+    TPM_CC_EncryptDecrypt2,
+    TPM_CC_NV_DefineSpace,
+    TPM_CC_NV_Read,
+    TPM_CC_NV_Write,
+    TPM_CC_NV_ChangeAuth,
+    TPM_CC_ObjectChangeAuth,
+    TPM_CC_HierarchyChangeAuth
+};
+
+/* TSS_WipeAuthContext() erases the command and response buffers at the end of a command.
+
+   A command with any authorization area, password or HMAC, is always treated as sensitive, since
+   the buffers hold the plaintext password or the HMAC over the parameters.
+
+   secureWipe is the TPM_SECURE_WIPE property:
+
+   0: erase only the bytes used by a command with authorizations
+   1: erase after a command with authorizations or in tssSensitiveCommands
+   2: erase after every command
+*/
+
+void TSS_WipeAuthContext(TSS_AUTH_CONTEXT *tssAuthContext,
+			 int secureWipe)
+{
+    size_t 	i;
+    int		wipe = FALSE;
+
+    if (secureWipe == 0) {
+	if (tssAuthContext->authCount != 0) {
+	    memset(tssAuthContext->commandBuffer, 0,
+		   (tssAuthContext->commandSize < MAX_COMMAND_SIZE) ?
+		   tssAuthContext->commandSize : MAX_COMMAND_SIZE);
+	    memset(tssAuthContext->responseBuffer, 0,
+		   (tssAuthContext->responseSize < MAX_RESPONSE_SIZE) ?
+		   tssAuthContext->responseSize : MAX_RESPONSE_SIZE);
+	}
+    }
+    else if (secureWipe == 1) {
+	wipe = (tssAuthContext->authCount != 0);
+	for (i = 0 ; !wipe && (i < (sizeof(tssSensitiveCommands) / sizeof(TPM_CC))) ; i++) {
+	    if (tssAuthContext->commandCode == tssSensitiveCommands[i]) {
+		wipe = TRUE;
+	    }
+	}
+    }
+    else {
+	wipe = TRUE;
+    }
+    if (wipe) {
+	if (tssVverbose) printf("TSS_WipeAuthContext: Erasing %s\n",
+				(tssAuthContext->commandText != NULL) ?
+				tssAuthContext->commandText : "buffers");
+	memset(tssAuthContext->commandBuffer, 0, MAX_COMMAND_SIZE);
+	memset(tssAuthContext->responseBuffer, 0, MAX_RESPONSE_SIZE);
+    }
+    return;
+}
+
 /* TSS_Marshal() marshals the in parameters into the TSS context.
 
    It also sets other member of the context in preparation for the rest of the sequence.  
@@ -763,7 +926,7 @@ TPM_RC TSS_Marshal(TSS_AUTH_CONTEXT *tssAuthContext,
     uint8_t 		*bufferu;			/* for test unmarshaling */
     INT32 		size;
     
-    TSS_InitAuthContext(tssAuthContext);
+    TSS_ResetAuthContext(tssAuthContext);
     /* index from command code to table and save items for this command */
     if (rc == 0) {
 	rc = TSS_MarshalTable_Process(tssAuthContext, commandCode);
@@ -1328,6 +1491,37 @@ TPM_RC TSS_SetResponseDecryptParam(TSS_AUTH_CONTEXT *tssAuthContext,
     return rc;
 }
 
+/* TSS_AuthSend() transmits the command without waiting for the response */
+
+TPM_RC TSS_AuthSend(TSS_CONTEXT *tssContext)
+{
+    TPM_RC rc = 0;
+    if (tssVverbose) printf("TSS_AuthSend: Sending %s\n", tssContext->tssAuthContext->commandText);
+    if (rc == 0) {
+	rc = TSS_TransmitSend(tssContext,
+			      tssContext->tssAuthContext->commandBuffer,
+			      tssContext->tssAuthContext->commandSize,
+			      tssContext->tssAuthContext->commandText);
+    }
+    return rc;
+}
+
+/* TSS_AuthReceive() receives the response to a command sent with TSS_AuthSend().  Normally returns
+   the TPM response code. */
+
+TPM_RC TSS_AuthReceive(TSS_CONTEXT *tssContext)
+{
+    TPM_RC rc = 0;
+    if (tssVverbose) printf("TSS_AuthReceive: Receiving %s\n",
+			    tssContext->tssAuthContext->commandText);
+    if (rc == 0) {
+	rc = TSS_TransmitReceive(tssContext,
+				 tssContext->tssAuthContext->responseBuffer,
+				 &tssContext->tssAuthContext->responseSize);
+    }
+    return rc;
+}
+
 TPM_RC TSS_AuthExecute(TSS_CONTEXT *tssContext)
 {
     TPM_RC rc = 0;
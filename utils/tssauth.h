@@ -52,6 +52,11 @@ TPM_RC TSS_AuthCreate(TSS_AUTH_CONTEXT **tssAuthContext);
 
 void TSS_InitAuthContext(TSS_AUTH_CONTEXT *tssAuthContext);
 
+void TSS_ResetAuthContext(TSS_AUTH_CONTEXT *tssAuthContext);
+
+void TSS_WipeAuthContext(TSS_AUTH_CONTEXT *tssAuthContext,
+			 int secureWipe);
+
 TPM_RC TSS_AuthDelete(TSS_AUTH_CONTEXT *tssAuthContext);
 
 TPM_RC TSS_Marshal(TSS_AUTH_CONTEXT *tssAuthContext,
@@ -102,5 +107,7 @@ TPM_RC TSS_SetResponseDecryptParam(TSS_AUTH_CONTEXT *tssAuthContext,
 				   uint8_t *decryptParamBuffer);
 
 TPM_RC TSS_AuthExecute(TSS_CONTEXT *tssContext);
+TPM_RC TSS_AuthSend(TSS_CONTEXT *tssContext);
+TPM_RC TSS_AuthReceive(TSS_CONTEXT *tssContext);
 
 #endif
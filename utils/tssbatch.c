@@ -0,0 +1,3568 @@
+/********************************************************************************/
+/*										*/
+/*		        Run a TSS Command Script				*/
+/*			     Written by agent					*/
+/*	      $Id: tssbatch.c $							*/
+/*										*/
+/* (c) Copyright agent 2026.							*/
+/*										*/
+/* All rights reserved.								*/
+/* 										*/
+/* Redistribution and use in source and binary forms, with or without		*/
+/* modification, are permitted provided that the following conditions are	*/
+/* met:										*/
+/* 										*/
+/* Redistributions of source code must retain the above copyright notice,	*/
+/* this list of conditions and the following disclaimer.			*/
+/* 										*/
+/* Redistributions in binary form must reproduce the above copyright		*/
+/* notice, this list of conditions and the following disclaimer in the		*/
+/* documentation and/or other materials provided with the distribution.		*/
+/* 										*/
+/* Neither the names of the IBM Corporation nor the names of its		*/
+/* contributors may be used to endorse or promote products derived from		*/
+/* this software without specific prior written permission.			*/
+/* 										*/
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		*/
+/* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		*/
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	*/
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		*/
+/* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	*/
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		*/
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	*/
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	*/
+/* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		*/
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	*/
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		*/
+/********************************************************************************/
+
+/* tssbatch runs a script of TSS utility commands within a single TSS context.
+
+   Each script line is a command name followed by its arguments, using the same syntax as the
+   corresponding command line utility, e.g.
+
+   startauthsession -se p
+   policycommandcode -ha 03000000 -cc 0000017e
+   policygetdigest -ha 03000000
+
+   Blank lines and lines starting with # are ignored.
+
+   Since all commands share one TSS context, the TPM connection is opened once.  With -cache,
+   session state is kept in memory and written back at exit, and object names are cached, rather
+   than being reloaded for each command.  Lines longer than 4096 bytes are rejected.
+   The elapsed time of each command is printed after the command output.
+
+   Only a subset of the utilities is supported.  An unsupported command is reported as a failure.
+
+   The sessionlease, sessionrelease, sessionpoolflush, and sessionpoolstats commands use the TSS
+   session pool, which has no utility since the pool lasts only as long as the TSS context.  The
+   number of idle sessions kept is the TPM_SESSION_POOL property, from the environment.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef TPM_POSIX
+#include <netinet/in.h>
+#endif
+#ifdef TPM_WINDOWS
+#include <winsock2.h>
+#endif
+
+#include <tss2/tss.h>
+#include <tss2/tssutils.h>
+#include <tss2/tssresponsecode.h>
+#include <tss2/tssfile.h>
+#include <tss2/tssmarshal.h>
+#include <tss2/tsscrypto.h>
+#include <tss2/tsscryptoh.h>
+#include <tss2/Unmarshal_fp.h>
+
+#include <openssl/rsa.h>
+#include <openssl/objects.h>
+
+#include "cryptoutils.h"
+#include "ekutils.h"
+#include "objecttemplates.h"
+
+#define BATCH_LINE_MAX	4096	/* maximum script line length */
+#define BATCH_ARGS_MAX	64	/* maximum arguments per script line */
+
+/* the session handles and attributes common to most commands */
+
+typedef struct {
+    TPMI_SH_AUTH_SESSION 	sessionHandle[3];
+    unsigned int		sessionAttributes[3];
+} BATCH_SESSIONS;
+
+/* the object template options of the create utility */
+
+typedef struct {
+    TPMA_OBJECT		addObjectAttributes;
+    TPMA_OBJECT		deleteObjectAttributes;
+    int			keyType;
+    uint32_t 		keyTypeSpecified;
+    int			rev116;
+    TPMI_ALG_PUBLIC 	algPublic;
+    TPMI_ECC_CURVE	curveID;
+    TPMI_ALG_HASH	halg;
+    TPMI_ALG_HASH	nalg;
+    const char		*policyFilename;
+} TEMPLATE_OPTIONS;
+
+typedef int (*BatchFunction_t)(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+
+typedef struct {
+    const char		*name;
+    BatchFunction_t 	function;
+} BATCH_COMMAND;
+
+static void printUsage(void);
+static double timeDiffMs(uint64_t startTime, uint64_t endTime);
+static int runLine(TSS_CONTEXT *tssContext, char *line, const char **commandName);
+static void initSessions(BATCH_SESSIONS *sessions,
+			 TPMI_SH_AUTH_SESSION sessionHandle0);
+static int parseSessions(BATCH_SESSIONS *sessions,
+			 int *found,
+			 int *i,
+			 int argc,
+			 char *argv[]);
+static int parseHalg(TPMI_ALG_HASH *halg,
+		     const char *string);
+static int parseHierarchy(TPMI_RH_PROVISION *authHandle,
+			  const char *string);
+static void initTemplateOptions(TEMPLATE_OPTIONS *options);
+static int parseTemplateOption(TEMPLATE_OPTIONS *options,
+			       int *found,
+			       int *i,
+			       int argc,
+			       char *argv[]);
+static int checkTemplateOptions(const TEMPLATE_OPTIONS *options,
+				const char *dataFilename);
+static TPM_RC publicTemplate(TPMT_PUBLIC *publicArea,
+			     const TEMPLATE_OPTIONS *options);
+static int missingParameter(const char *option);
+static int badOption(const char *command, const char *option);
+static int printFailure(const char *command, TPM_RC rc);
+static TPM_RC unmarshalPublic(void *target, uint8_t **buffer, int32_t *size);
+
+static int batchStartup(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchGetRandom(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPcrRead(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPcrExtend(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPcrReset(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchFlushContext(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchReadPublic(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchNvReadPublic(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchNvRead(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchNvWrite(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchNvUndefineSpace(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchStartAuthSession(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPolicyCommandCode(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPolicyGetDigest(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPolicyRestart(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPolicyAuthValue(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPolicyPassword(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchCreate(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchLoad(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchSign(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchLoadExternal(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPolicyPCR(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPolicyOR(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPolicySecret(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPolicySigned(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static TPM_RC signAHash(TPM2B_PUBLIC_KEY_RSA *signature,
+			TPMT_HA *aHash,
+			const char *signingKeyFilename,
+			const char *signingKeyPassword);
+static int batchPolicyAuthorize(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchSessionLease(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchSessionRelease(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchSessionPoolFlush(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchSessionPoolStats(TSS_CONTEXT *tssContext, int argc, char *argv[]);
+static int batchPolicySession(TSS_CONTEXT *tssContext, int argc, char *argv[],
+			      TPM_CC commandCode);
+
+/* the supported commands, named as the corresponding utility */
+
+static const BATCH_COMMAND batchCommandTable[] = {
+    {"startup",			batchStartup},
+    {"getrandom",		batchGetRandom},
+    {"pcrread",			batchPcrRead},
+    {"pcrextend",		batchPcrExtend},
+    {"pcrreset",		batchPcrReset},
+    {"flushcontext",		batchFlushContext},
+    {"readpublic",		batchReadPublic},
+    {"nvreadpublic",		batchNvReadPublic},
+    {"nvread",			batchNvRead},
+    {"nvwrite",			batchNvWrite},
+    {"nvundefinespace",		batchNvUndefineSpace},
+    {"startauthsession",	batchStartAuthSession},
+    {"policycommandcode",	batchPolicyCommandCode},
+    {"policygetdigest",		batchPolicyGetDigest},
+    {"policyrestart",		batchPolicyRestart},
+    {"policyauthvalue",		batchPolicyAuthValue},
+    {"policypassword",		batchPolicyPassword},
+    {"create",			batchCreate},
+    {"load",			batchLoad},
+    {"sign",			batchSign},
+    {"loadexternal",		batchLoadExternal},
+    {"policypcr",		batchPolicyPCR},
+    {"policyor",		batchPolicyOR},
+    {"policysecret",		batchPolicySecret},
+    {"policysigned",		batchPolicySigned},
+    {"policyauthorize",		batchPolicyAuthorize},
+    {"sessionlease",		batchSessionLease},
+    {"sessionrelease",		batchSessionRelease},
+    {"sessionpoolflush",	batchSessionPoolFlush},
+    {"sessionpoolstats",	batchSessionPoolStats},
+};
+
+int verbose = FALSE;
+
+int main(int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;    /* argc iterator */
+    TSS_CONTEXT			*tssContext = NULL;
+    const char			*scriptFilename = NULL;
+    FILE			*scriptFile = NULL;
+    int				keepGoing = FALSE;
+    int				cache = FALSE;
+    char			line[BATCH_LINE_MAX + 2];	/* room for the newline and nul */
+    size_t			length;
+    unsigned int		lineNumber = 0;
+    unsigned int		commands = 0;
+    unsigned int		failures = 0;
+    int				done = FALSE;
+    uint64_t 			startTime;
+    uint64_t			endTime;
+    uint64_t 			batchStartTime = 0;
+    double			lineMs;
+    double			totalMs = 0;
+    
+    setvbuf(stdout, 0, _IONBF, 0);      /* output may be going through pipe to log file */
+    TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "1");
+
+    /* command line argument defaults */
+    for (i=1 ; (i<argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-if") == 0) {
+	    i++;
+	    if (i < argc) {
+		scriptFilename = argv[i];
+	    }
+	    else {
+		printf("-if option needs a value\n");
+		printUsage();
+	    }
+	}
+	else if (strcmp(argv[i],"-k") == 0) {
+	    keepGoing = TRUE;
+	}
+	else if (strcmp(argv[i],"-cache") == 0) {
+	    cache = TRUE;
+	}
+	else if (strcmp(argv[i],"-h") == 0) {
+	    printUsage();
+	}
+	else if (strcmp(argv[i],"-v") == 0) {
+	    verbose = TRUE;
+	    TSS_SetProperty(NULL, TPM_TRACE_LEVEL, "2");
+	}
+	else {
+	    printf("\n%s is not a valid option\n", argv[i]);
+	    printUsage();
+	}
+    }
+    if (scriptFilename == NULL) {
+	printf("Missing script file parameter -if\n");
+	printUsage();
+    }
+    if (rc == 0) {
+	scriptFile = fopen(scriptFilename, "r");	/* closed @1 */
+	if (scriptFile == NULL) {
+	    printf("tssbatch: cannot open script file %s\n", scriptFilename);
+	    rc = TSS_RC_FILE_OPEN;
+	}
+    }
+    /* Start a TSS context, shared by all script commands */
+    if (rc == 0) {
+	rc = TSS_Create(&tssContext);
+    }
+    /* With -cache, the script is assumed to be the only user of its sessions and objects while it
+       runs, so keep session state in memory until TSS_Delete() and cache object names rather than
+       rereading them for each command */
+    if ((rc == 0) && cache) {
+	rc = TSS_SetProperty(tssContext, TPM_SESSION_CACHE, "2");
+    }
+    if ((rc == 0) && cache) {
+	rc = TSS_SetProperty(tssContext, TPM_NAME_CACHE, "1");
+    }
+    if (rc == 0) {
+	batchStartTime = TSS_Timing_Now();
+    }
+    while ((rc == 0) && !done) {
+	const char *commandName = NULL;
+	int lineRc;
+	if (fgets(line, sizeof(line), scriptFile) == NULL) {
+	    done = TRUE;
+	    break;
+	}
+	lineNumber++;
+	/* a line that fills the buffer without its newline is too long, and a truncated command must
+	   not run, even with -k */
+	length = strlen(line);
+	if ((length > 0) && (line[length - 1] == '\n')) {
+	    length--;
+	}
+	if (length > BATCH_LINE_MAX) {
+	    printf("tssbatch: line %u is longer than %u bytes\n", lineNumber, BATCH_LINE_MAX);
+	    commands++;
+	    failures++;
+	    done = TRUE;
+	    break;
+	}
+	startTime = TSS_Timing_Now();
+	lineRc = runLine(tssContext, line, &commandName);
+	endTime = TSS_Timing_Now();
+	/* blank or comment line */
+	if (commandName == NULL) {
+	    continue;
+	}
+	commands++;
+	lineMs = timeDiffMs(startTime, endTime);
+	printf("tssbatch: line %u %s %s %.3f ms\n",
+	       lineNumber, commandName, (lineRc == 0) ? "ok" : "failed", lineMs);
+	if (lineRc != 0) {
+	    failures++;
+	    if (!keepGoing) {
+		done = TRUE;
+	    }
+	}
+    }
+    if (rc == 0) {
+	endTime = TSS_Timing_Now();
+	totalMs = timeDiffMs(batchStartTime, endTime);
+    }
+    {
+	TPM_RC rc1 = TSS_Delete(tssContext);
+	if (rc == 0) {
+	    rc = rc1;
+	}
+    }
+    if (scriptFile != NULL) {
+	fclose(scriptFile);		/* @1 */
+    }
+    if (rc == 0) {
+	printf("tssbatch: %u commands, %u failed, %.3f ms\n", commands, failures, totalMs);
+	if (failures != 0) {
+	    rc = EXIT_FAILURE;
+	}
+    }
+    else {
+	const char *msg;
+	const char *submsg;
+	const char *num;
+	printf("tssbatch: failed, rc %08x\n", rc);
+	TSS_ResponseCode_toString(&msg, &submsg, &num, rc);
+	printf("%s%s%s\n", msg, submsg, num);
+	rc = EXIT_FAILURE;
+    }
+    return rc;
+}
+
+/* timeDiffMs() returns the elapsed time in milliseconds between the TSS_Timing_Now() values
+   startTime and endTime */
+
+static double timeDiffMs(uint64_t startTime, uint64_t endTime)
+{
+    return (double)(endTime - startTime) / 1000000.0;
+}
+
+/* runLine() splits a script line into arguments and runs the command.
+
+   commandName is returned NULL for a blank or comment line.  Otherwise, it points into line.
+
+   Returns 0 on success, non-zero if the command failed or is not supported.
+*/
+
+static int runLine(TSS_CONTEXT *tssContext, char *line, const char **commandName)
+{
+    int		argc = 0;
+    char	*argv[BATCH_ARGS_MAX];
+    char	*token;
+    size_t	c;
+
+    *commandName = NULL;
+    for (token = strtok(line, " \t\r\n") ;
+	 (token != NULL) && (argc < BATCH_ARGS_MAX) ;
+	 token = strtok(NULL, " \t\r\n")) {
+	argv[argc] = token;
+	argc++;
+    }
+    if ((argc == 0) || (argv[0][0] == '#')) {
+	return 0;
+    }
+    *commandName = argv[0];
+    if (token != NULL) {
+	printf("tssbatch: more than %u arguments\n", BATCH_ARGS_MAX);
+	return EXIT_FAILURE;
+    }
+    for (c = 0 ; c < sizeof(batchCommandTable) / sizeof(BATCH_COMMAND) ; c++) {
+	if (strcmp(argv[0], batchCommandTable[c].name) == 0) {
+	    /* the command functions parse the arguments after the command name, as in main() */
+	    return batchCommandTable[c].function(tssContext, argc, argv);
+	}
+    }
+    printf("tssbatch: %s is not supported\n", argv[0]);
+    return EXIT_FAILURE;
+}
+
+/* initSessions() sets the session defaults.  sessionHandle0 is either TPM_RS_PW for commands that
+   require an authorization or TPM_RH_NULL. */
+
+static void initSessions(BATCH_SESSIONS *sessions,
+			 TPMI_SH_AUTH_SESSION sessionHandle0)
+{
+    sessions->sessionHandle[0] = sessionHandle0;
+    sessions->sessionHandle[1] = TPM_RH_NULL;
+    sessions->sessionHandle[2] = TPM_RH_NULL;
+    sessions->sessionAttributes[0] = 0;
+    sessions->sessionAttributes[1] = 0;
+    sessions->sessionAttributes[2] = 0;
+    return;
+}
+
+/* parseSessions() parses the -se0, -se1, and -se2 session handle / attributes options.
+
+   found is set TRUE if argv[*i] is a session option, and *i is advanced past its parameters.
+*/
+
+static int parseSessions(BATCH_SESSIONS *sessions,
+			 int *found,
+			 int *i,
+			 int argc,
+			 char *argv[])
+{
+    int		rc = 0;
+    int		s;
+    
+    *found = FALSE;
+    if ((strcmp(argv[*i], "-se0") == 0) ||
+	(strcmp(argv[*i], "-se1") == 0) ||
+	(strcmp(argv[*i], "-se2") == 0)) {
+	*found = TRUE;
+	s = argv[*i][3] - '0';
+	if ((*i + 2) < argc) {
+	    sscanf(argv[*i + 1], "%x", &sessions->sessionHandle[s]);
+	    sscanf(argv[*i + 2], "%x", &sessions->sessionAttributes[s]);
+	    if (sessions->sessionAttributes[s] > 0xff) {
+		printf("Out of range session attributes for %s\n", argv[*i]);
+		rc = EXIT_FAILURE;
+	    }
+	    *i += 2;
+	}
+	else {
+	    rc = missingParameter(argv[*i]);
+	    *i = argc;
+	}
+    }
+    return rc;
+}
+
+/* parseHalg() converts the -halg and -nalg parameter to a hash algorithm */
+
+static int parseHalg(TPMI_ALG_HASH *halg,
+		     const char *string)
+{
+    int		rc = 0;
+    
+    if (strcmp(string, "sha1") == 0) {
+	*halg = TPM_ALG_SHA1;
+    }
+    else if (strcmp(string, "sha256") == 0) {
+	*halg = TPM_ALG_SHA256;
+    }
+    else if (strcmp(string, "sha384") == 0) {
+	*halg = TPM_ALG_SHA384;
+    }
+    else {
+	printf("Bad parameter %s for hash algorithm\n", string);
+	rc = EXIT_FAILURE;
+    }
+    return rc;
+}
+
+/* parseHierarchy() converts the -hi and -hia parameter o or p to a hierarchy handle */
+
+static int parseHierarchy(TPMI_RH_PROVISION *authHandle,
+			  const char *string)
+{
+    int		rc = 0;
+    
+    if (strcmp(string, "o") == 0) {
+	*authHandle = TPM_RH_OWNER;
+    }
+    else if (strcmp(string, "p") == 0) {
+	*authHandle = TPM_RH_PLATFORM;
+    }
+    else {
+	printf("Bad parameter %s for hierarchy\n", string);
+	rc = EXIT_FAILURE;
+    }
+    return rc;
+}
+
+static int missingParameter(const char *option)
+{
+    printf("Missing parameter for %s\n", option);
+    return EXIT_FAILURE;
+}
+
+static int badOption(const char *command, const char *option)
+{
+    printf("%s: %s is not a valid option\n", command, option);
+    return EXIT_FAILURE;
+}
+
+/* printFailure() prints the response code in the same format as the utilities */
+
+static int printFailure(const char *command, TPM_RC rc)
+{
+    const char *msg;
+    const char *submsg;
+    const char *num;
+    printf("%s: failed, rc %08x\n", command, rc);
+    TSS_ResponseCode_toString(&msg, &submsg, &num, rc);
+    printf("%s%s%s\n", msg, submsg, num);
+    return EXIT_FAILURE;
+}
+
+/* unmarshalPublic() is TPM2B_PUBLIC_Unmarshal() with the UnmarshalFunction_t signature, for
+   TSS_File_ReadStructure().  A null name algorithm is allowed, since loadexternal accepts one and
+   the TPM validates the public area in any case. */
+
+static TPM_RC unmarshalPublic(void *target, uint8_t **buffer, int32_t *size)
+{
+    return TPM2B_PUBLIC_Unmarshal((TPM2B_PUBLIC *)target, buffer, size, YES);
+}
+
+/* batchStartup() runs startup -c, -s, -st, -sto */
+
+static int batchStartup(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC		rc = 0;
+    int			i;
+    Startup_In 		in;
+    SelfTest_In 	selfTestIn;
+    int			doStartup = TRUE;
+    int			doSelftest = FALSE;
+
+    in.startupType = TPM_SU_CLEAR;
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-c") == 0) {
+	    in.startupType = TPM_SU_CLEAR;
+	    doStartup = TRUE;
+	}
+	else if (strcmp(argv[i],"-s") == 0) {
+	    in.startupType = TPM_SU_STATE;
+	    doStartup = TRUE;
+	}
+	else if (strcmp(argv[i],"-st") == 0) {
+	    doSelftest = TRUE;
+	}
+	else if (strcmp(argv[i],"-sto") == 0) {
+	    doStartup = FALSE;
+	    doSelftest = TRUE;
+	}
+	else {
+	    return badOption(argv[0], argv[i]);
+	}
+    }
+    if ((rc == 0) && doStartup) {
+	rc = TSS_Execute(tssContext,
+			 NULL, 
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_Startup,
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if ((rc == 0) && doSelftest) {
+	selfTestIn.fullTest = YES;
+	rc = TSS_Execute(tssContext,
+			 NULL, 
+			 (COMMAND_PARAMETERS *)&selfTestIn,
+			 NULL,
+			 TPM_CC_SelfTest,
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchGetRandom() runs getrandom -by, -of, -nz, -ns, -se[0-2] */
+
+static int batchGetRandom(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    GetRandom_In 		in;
+    GetRandom_Out 		out;
+    uint32_t			bytesRequested = 0;
+    uint32_t			bytesCopied;
+    const char			*outFilename = NULL;
+    int				noZeros = FALSE;
+    int				noSpace = FALSE;
+    unsigned char 		*randomBuffer = NULL;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RH_NULL);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-by") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%u", &bytesRequested);
+	    }
+	    else {
+		rc = missingParameter("-by");
+	    }
+	}
+	else if (strcmp(argv[i],"-of") == 0) {
+	    if (++i < argc) {
+		outFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-of");
+	    }
+	}
+	else if (strcmp(argv[i],"-nz") == 0) {
+	    noZeros = TRUE;
+	}
+	else if (strcmp(argv[i],"-ns") == 0) {
+	    noSpace = TRUE;
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if ((bytesRequested == 0) ||
+	(bytesRequested > 0xffff)) {
+	printf("Missing or bad parameter -by\n");
+	return EXIT_FAILURE;
+    }
+    /* allocate a buffer for the bytes requested, add 1 for optional nul terminator */
+    if (rc == 0) {
+	rc = TSS_Malloc(&randomBuffer, bytesRequested + 1);	/* freed @1 */
+    }
+    for (bytesCopied = 0 ; (rc == 0) && (bytesCopied < bytesRequested) ; ) {
+	/* Request whatever is left */
+	in.bytesRequested = bytesRequested - bytesCopied;
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out, 
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_GetRandom,
+			 sessions.sessionHandle[0], NULL, sessions.sessionAttributes[0],
+			 sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+			 sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+			 TPM_RH_NULL, NULL, 0);
+	if (rc == 0) {
+	    size_t br;
+	    /* copy as many bytes as were received or until bytes requested */
+	    for (br = 0 ; (br < out.randomBytes.t.size) && (bytesCopied < bytesRequested) ; br++) {
+		if (!noZeros || (out.randomBytes.t.buffer[br] != 0)) {
+		    randomBuffer[bytesCopied] = out.randomBytes.t.buffer[br];
+		    bytesCopied++;
+		}
+	    }
+	    if (noZeros) {
+		randomBuffer[bytesCopied] = 0x00;
+	    }
+	}
+    }
+    if ((rc == 0) && (outFilename != NULL)) {
+	rc = TSS_File_WriteBinaryFile(randomBuffer, bytesRequested + (noZeros ? 1 : 0),
+				      outFilename);
+    }
+    if (rc == 0) {
+	/* machine readable format */
+	if (noSpace) {
+	    uint32_t bp;
+	    for (bp = 0 ; bp < bytesRequested ; bp++) {
+		printf("%02x", randomBuffer[bp]);
+	    }
+	    printf("\n");
+	}
+	/* human readable format */
+	else {
+	    TSS_PrintAll("randomBytes", randomBuffer, bytesRequested);
+	}
+    }
+    free(randomBuffer);		/* @1 */
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchPcrRead() runs pcrread -ha, -halg (repeatable), -of, -ns, -se0 */
+
+static int batchPcrRead(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    PCR_Read_In 		in;
+    PCR_Read_Out 		out;
+    TPMI_DH_PCR 		pcrHandle = IMPLEMENTATION_PCR;
+    const char 			*datafilename = NULL;
+    int				noSpace = FALSE;
+    uint32_t			c;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RH_NULL);
+    in.pcrSelectionIn.count = 0;
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%u", &pcrHandle);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-halg") == 0) {
+	    if (in.pcrSelectionIn.count >= HASH_COUNT) {
+		printf("Too many -halg specifiers, %u permitted\n", HASH_COUNT);
+		rc = EXIT_FAILURE;
+	    }
+	    else if (++i < argc) {
+		rc = parseHalg(&in.pcrSelectionIn.pcrSelections[in.pcrSelectionIn.count].hash,
+				  argv[i]);
+		in.pcrSelectionIn.count++;
+	    }
+	    else {
+		rc = missingParameter("-halg");
+	    }
+	}
+	else if (strcmp(argv[i],"-of") == 0) {
+	    if (++i < argc) {
+		datafilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-of");
+	    }
+	}
+	else if (strcmp(argv[i],"-ns") == 0) {
+	    noSpace = TRUE;
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (pcrHandle >= IMPLEMENTATION_PCR) {
+	printf("Missing or bad PCR handle parameter -ha\n");
+	return EXIT_FAILURE;
+    }
+    /* default hash algorithm */
+    if (in.pcrSelectionIn.count == 0) {
+	in.pcrSelectionIn.count = 1;
+	in.pcrSelectionIn.pcrSelections[0].hash = TPM_ALG_SHA256;
+    }
+    for (c = 0 ; c < in.pcrSelectionIn.count ; c++) {
+	in.pcrSelectionIn.pcrSelections[c].sizeofSelect = 3;
+	in.pcrSelectionIn.pcrSelections[c].pcrSelect[0] = 0;
+	in.pcrSelectionIn.pcrSelections[c].pcrSelect[1] = 0;
+	in.pcrSelectionIn.pcrSelections[c].pcrSelect[2] = 0;
+	in.pcrSelectionIn.pcrSelections[c].pcrSelect[pcrHandle / 8] = 1 << (pcrHandle % 8);
+    }
+    rc = TSS_Execute(tssContext,
+		     (RESPONSE_PARAMETERS *)&out,
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     TPM_CC_PCR_Read,
+		     sessions.sessionHandle[0], NULL, sessions.sessionAttributes[0],
+		     TPM_RH_NULL, NULL, 0);
+    /* first hash algorithm, in binary */
+    if ((rc == 0) && (datafilename != NULL)) {
+	rc = TSS_File_WriteBinaryFile(out.pcrValues.digests[0].t.buffer,
+				      out.pcrValues.digests[0].t.size,
+				      datafilename);
+    }
+    if (rc == 0) {
+	/* machine readable format, first hash algorithm */
+	if (noSpace && (out.pcrValues.count != 0)) {
+	    uint32_t bp;
+	    for (bp = 0 ; bp < out.pcrValues.digests[0].t.size ; bp++) {
+		printf("%02x", out.pcrValues.digests[0].t.buffer[bp]);
+	    }
+	    printf("\n");
+	}
+	/* human readable format, all hash algorithms */
+	else {
+	    printf("count %u\n", out.pcrValues.count);
+	    for (c = 0 ; !noSpace && (c < out.pcrValues.count) ; c++) {
+		TSS_PrintAll("digest",
+			     out.pcrValues.digests[c].t.buffer, out.pcrValues.digests[c].t.size);
+	    }
+	}
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchPcrExtend() runs pcrextend -ha, -halg (repeatable), -ic, -if */
+
+static int batchPcrExtend(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    PCR_Extend_In 		in;
+    TPMI_DH_PCR 		pcrHandle = IMPLEMENTATION_PCR;
+    const char 			*dataString = NULL;
+    const char 			*datafilename = NULL;
+    uint8_t			*fileData = NULL;
+    size_t 			length = 0;
+    uint32_t			algs;
+
+    in.digests.count = 0;
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%u", &pcrHandle);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-halg") == 0) {
+	    if (in.digests.count >= HASH_COUNT) {
+		printf("Too many -halg specifiers, %u permitted\n", HASH_COUNT);
+		rc = EXIT_FAILURE;
+	    }
+	    else if (++i < argc) {
+		rc = parseHalg(&in.digests.digests[in.digests.count].hashAlg, argv[i]);
+		in.digests.count++;
+	    }
+	    else {
+		rc = missingParameter("-halg");
+	    }
+	}
+	else if (strcmp(argv[i],"-ic") == 0) {
+	    if (++i < argc) {
+		dataString = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-ic");
+	    }
+	}
+	else if (strcmp(argv[i],"-if") == 0) {
+	    if (++i < argc) {
+		datafilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-if");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (pcrHandle >= IMPLEMENTATION_PCR) {
+	printf("Missing or bad PCR handle parameter -ha\n");
+	return EXIT_FAILURE;
+    }
+    if ((dataString == NULL) == (datafilename == NULL)) {
+	printf("One of -ic and -if must be specified\n");
+	return EXIT_FAILURE;
+    }
+    /* default hash algorithm */
+    if (in.digests.count == 0) {
+	in.digests.count = 1;
+	in.digests.digests[0].hashAlg = TPM_ALG_SHA256;
+    }
+    in.pcrHandle = pcrHandle;
+    /* the data is zero padded or truncated to the digest size, as in pcrextend */
+    if (datafilename != NULL) {
+	rc = TSS_File_ReadBinaryFile(&fileData,     /* freed @1 */
+				     &length,
+				     datafilename);
+    }
+    else {
+	length = strlen(dataString);
+    }
+    if ((rc == 0) && (length > sizeof(TPMU_HA))) {
+	printf("Data length greater than maximum hash size %lu bytes\n",
+	       (unsigned long)sizeof(TPMU_HA));
+	free(fileData);	/* @1 */
+	return EXIT_FAILURE;
+    }
+    if (rc == 0) {
+	for (algs = 0 ; algs < in.digests.count ; algs++) {
+	    memset((uint8_t *)&in.digests.digests[algs].digest, 0, sizeof(TPMU_HA));
+	    memcpy((uint8_t *)&in.digests.digests[algs].digest,
+		   (datafilename != NULL) ? fileData : (const uint8_t *)dataString, length);
+	}
+	rc = TSS_Execute(tssContext,
+			 NULL, 
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_PCR_Extend,
+			 TPM_RS_PW, NULL, 0,
+			 TPM_RH_NULL, NULL, 0);
+    }
+    free(fileData);	/* @1 */
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchPcrReset() runs pcrreset -ha */
+
+static int batchPcrReset(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    PCR_Reset_In 		in;
+    TPMI_DH_PCR 		pcrHandle = IMPLEMENTATION_PCR;
+
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%u", &pcrHandle);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (pcrHandle >= IMPLEMENTATION_PCR) {
+	printf("Missing or bad PCR handle parameter -ha\n");
+	return EXIT_FAILURE;
+    }
+    in.pcrHandle = pcrHandle;
+    rc = TSS_Execute(tssContext,
+		     NULL, 
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     TPM_CC_PCR_Reset,
+		     TPM_RS_PW, NULL, 0,
+		     TPM_RH_NULL, NULL, 0);
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchFlushContext() runs flushcontext -ha */
+
+static int batchFlushContext(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    FlushContext_In 		in;
+    TPMI_DH_CONTEXT		flushHandle = 0;
+
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &flushHandle);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (flushHandle == 0) {
+	printf("Missing handle parameter -ha\n");
+	return EXIT_FAILURE;
+    }
+    in.flushHandle = flushHandle;
+    rc = TSS_Execute(tssContext,
+		     NULL, 
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     TPM_CC_FlushContext,
+		     TPM_RH_NULL, NULL, 0);
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchReadPublic() runs readpublic -ho, -opu, -se[0-2] */
+
+static int batchReadPublic(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    ReadPublic_In 		in;
+    ReadPublic_Out 		out;
+    TPMI_DH_OBJECT		objectHandle = TPM_RH_NULL;
+    const char			*publicKeyFilename = NULL;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RH_NULL);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-ho") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &objectHandle);
+	    }
+	    else {
+		rc = missingParameter("-ho");
+	    }
+	}
+	else if (strcmp(argv[i],"-opu") == 0) {
+	    if (++i < argc) {
+		publicKeyFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-opu");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (objectHandle == TPM_RH_NULL) {
+	printf("Missing or bad object handle parameter -ho\n");
+	return EXIT_FAILURE;
+    }
+    in.objectHandle = objectHandle;
+    rc = TSS_Execute(tssContext,
+		     (RESPONSE_PARAMETERS *)&out, 
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     TPM_CC_ReadPublic,
+		     sessions.sessionHandle[0], NULL, sessions.sessionAttributes[0],
+		     sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+		     sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+		     TPM_RH_NULL, NULL, 0);
+    if ((rc == 0) && (publicKeyFilename != NULL)) {
+	rc = TSS_File_WriteStructure(&out.outPublic,
+				     (MarshalFunction_t)TSS_TPM2B_PUBLIC_Marshal,
+				     publicKeyFilename);
+    }
+    if ((rc == 0) && verbose) {
+	TSS_PrintAll("authPolicy",
+		     out.outPublic.publicArea.authPolicy.t.buffer,
+		     out.outPublic.publicArea.authPolicy.t.size);
+	TSS_PrintAll("name",
+		     out.name.t.name,
+		     out.name.t.size);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchNvReadPublic() runs nvreadpublic -ha, -nalg, -se[0-2] */
+
+static int batchNvReadPublic(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    NV_ReadPublic_In 		in;
+    NV_ReadPublic_Out		out;
+    TPMI_RH_NV_INDEX		nvIndex = 0;
+    TPMI_ALG_HASH 		nalg = TPM_ALG_SHA256;
+    uint16_t 			nameHashAlg;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RH_NULL);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &nvIndex);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-nalg") == 0) {
+	    if (++i < argc) {
+		rc = parseHalg(&nalg, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-nalg");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if ((nvIndex >> 24) != TPM_HT_NV_INDEX) {
+	printf("NV index handle not specified or out of range, MSB not 01\n");
+	return EXIT_FAILURE;
+    }
+    in.nvIndex = nvIndex;
+    rc = TSS_Execute(tssContext,
+		     (RESPONSE_PARAMETERS *)&out,
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     TPM_CC_NV_ReadPublic,
+		     sessions.sessionHandle[0], NULL, sessions.sessionAttributes[0],
+		     sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+		     sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+		     TPM_RH_NULL, NULL, 0);
+    /* validate the result as in nvreadpublic */
+    if (rc == 0) {
+	uint16_t tmp16;
+	memcpy(&tmp16, out.nvName.t.name, sizeof(uint16_t));
+	nameHashAlg = ntohs(tmp16);
+	if ((out.nvPublic.nvPublic.nameAlg != nalg) ||
+	    (nameHashAlg != nalg) ||
+	    (out.nvPublic.nvPublic.nvIndex != in.nvIndex)) {
+	    printf("nvreadpublic: TPM2B_NV_PUBLIC does not match expected\n");
+	    rc = TSS_RC_MALFORMED_NV_PUBLIC;
+	}
+    }
+    if (rc == 0) {
+	printf("nvreadpublic: name algorithm %04x\n", out.nvPublic.nvPublic.nameAlg);
+	printf("nvreadpublic: data size %u\n", out.nvPublic.nvPublic.dataSize);
+	printf("nvreadpublic: attributes %08x\n", out.nvPublic.nvPublic.attributes.val);
+	TSS_TPMA_NV_Print(out.nvPublic.nvPublic.attributes, 0);
+	TSS_PrintAll("nvreadpublic: policy",
+		     out.nvPublic.nvPublic.authPolicy.t.buffer,
+		     out.nvPublic.nvPublic.authPolicy.t.size);
+	TSS_PrintAll("nvreadpublic: name",
+		     out.nvName.t.name, out.nvName.t.size);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchNvRead() runs nvread -ha, -hia, -pwdn, -sz, -off, -of, -se[0-2] */
+
+static int batchNvRead(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    TPMI_RH_NV_INDEX		nvIndex = 0;
+    TPMI_RH_PROVISION		authHandle = 0;
+    const char			*nvPassword = NULL;
+    const char 			*datafilename = NULL;
+    unsigned int		offset = 0;
+    unsigned int		readLength = 0;
+    uint8_t 			*readBuffer = NULL;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RS_PW);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &nvIndex);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-hia") == 0) {
+	    if (++i < argc) {
+		rc = parseHierarchy(&authHandle, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-hia");
+	    }
+	}
+	else if (strcmp(argv[i],"-pwdn") == 0) {
+	    if (++i < argc) {
+		nvPassword = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pwdn");
+	    }
+	}
+	else if (strcmp(argv[i],"-sz") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%u", &readLength);
+	    }
+	    else {
+		rc = missingParameter("-sz");
+	    }
+	}
+	else if (strcmp(argv[i],"-off") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%u", &offset);
+	    }
+	    else {
+		rc = missingParameter("-off");
+	    }
+	}
+	else if (strcmp(argv[i],"-of") == 0) {
+	    if (++i < argc) {
+		datafilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-of");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if ((nvIndex >> 24) != TPM_HT_NV_INDEX) {
+	printf("NV index handle not specified or out of range, MSB not 01\n");
+	return EXIT_FAILURE;
+    }
+    if ((readLength > 0xffff) || (offset > 0xffff)) {
+	printf("Bad parameter -sz or -off\n");
+	return EXIT_FAILURE;
+    }
+    /* default authorization is the NV index */
+    if (authHandle == 0) {
+	authHandle = nvIndex;
+    }
+    if (readLength > 0) {
+	rc = TSS_Malloc(&readBuffer, readLength);		/* freed @1 */
+    }
+    /* data may have to be read in chunks */
+    if ((rc == 0) && (readLength > 0)) {
+	rc = TSS_NV_Read(tssContext,
+			 readBuffer, readLength,
+			 authHandle, nvIndex, (uint16_t)offset,
+			 sessions.sessionHandle[0], nvPassword, sessions.sessionAttributes[0],
+			 sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+			 sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if ((rc == 0) && (datafilename != NULL)) {
+	rc = TSS_File_WriteBinaryFile(readBuffer, readLength, datafilename);
+    }
+    if (rc == 0) {
+	TSS_PrintAll("nvread: data", readBuffer, readLength);
+    }
+    free(readBuffer);	/* @1 */
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchNvWrite() runs nvwrite -ha, -hia, -pwdn, -ic, -if, -off, -se[0-2] */
+
+static int batchNvWrite(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    NV_Write_In 		in;
+    TPMI_RH_NV_INDEX		nvIndex = 0;
+    TPMI_RH_PROVISION		authHandle = 0;
+    const char			*nvPassword = NULL;
+    const char 			*commandData = NULL;
+    const char 			*datafilename = NULL;
+    unsigned int		offset = 0;
+    uint8_t 			*writeBuffer = NULL;
+    size_t 			writeLength = 0;
+    uint32_t 			nvBufferMax;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RS_PW);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &nvIndex);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-hia") == 0) {
+	    if (++i < argc) {
+		rc = parseHierarchy(&authHandle, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-hia");
+	    }
+	}
+	else if (strcmp(argv[i],"-pwdn") == 0) {
+	    if (++i < argc) {
+		nvPassword = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pwdn");
+	    }
+	}
+	else if (strcmp(argv[i],"-ic") == 0) {
+	    if (++i < argc) {
+		commandData = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-ic");
+	    }
+	}
+	else if (strcmp(argv[i],"-if") == 0) {
+	    if (++i < argc) {
+		datafilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-if");
+	    }
+	}
+	else if (strcmp(argv[i],"-off") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%u", &offset);
+	    }
+	    else {
+		rc = missingParameter("-off");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if ((nvIndex >> 24) != TPM_HT_NV_INDEX) {
+	printf("NV index handle not specified or out of range, MSB not 01\n");
+	return EXIT_FAILURE;
+    }
+    if ((commandData != NULL) && (datafilename != NULL)) {
+	printf("Only one of -ic and -if can be specified\n");
+	return EXIT_FAILURE;
+    }
+    if (offset > 0xffff) {
+	printf("Bad parameter -off\n");
+	return EXIT_FAILURE;
+    }
+    /* default authorization is the NV index */
+    in.authHandle = (authHandle != 0) ? authHandle : nvIndex;
+    in.nvIndex = nvIndex;
+    in.offset = offset;
+    in.data.b.size = 0;		/* default 0 byte write */
+    /* data may have to be written in chunks */
+    if (rc == 0) {
+	rc = readNvBufferMax(tssContext,
+			     &nvBufferMax);
+    }    
+    /* -if, file data can be written in chunks */
+    if ((rc == 0) && (datafilename != NULL)) {
+	rc = TSS_File_ReadBinaryFile(&writeBuffer,     /* freed @1 */
+				     &writeLength,
+				     datafilename);
+    }
+    /* -ic, command line data must fit in one write */
+    if ((rc == 0) && (commandData != NULL)) {
+	rc = TSS_TPM2B_StringCopy(&in.data.b, commandData, nvBufferMax);
+    }
+    /* -if, file data can be written in chunks */
+    if ((rc == 0) && (datafilename != NULL)) {
+	if (writeLength > 0xffff) {
+	    printf("Data file size %lu too large\n", (unsigned long)writeLength);
+	    rc = TSS_RC_INSUFFICIENT_BUFFER;
+	}
+	if (rc == 0) {
+	    rc = TSS_NV_Write(tssContext,
+			      writeBuffer, (uint32_t)writeLength,
+			      in.authHandle, nvIndex, (uint16_t)offset,
+			      sessions.sessionHandle[0], nvPassword, sessions.sessionAttributes[0],
+			      sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+			      sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+			      TPM_RH_NULL, NULL, 0);
+	}
+    }
+    /* other options are single write */
+    else if (rc == 0) {
+	rc = TSS_Execute(tssContext,
+			 NULL,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_NV_Write,
+			 sessions.sessionHandle[0], nvPassword, sessions.sessionAttributes[0],
+			 sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+			 sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+			 TPM_RH_NULL, NULL, 0);
+    }
+    free(writeBuffer);	/* @1 */
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchNvUndefineSpace() runs nvundefinespace -hi, -ha, -pwdp, -se[0-2] */
+
+static int batchNvUndefineSpace(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    NV_UndefineSpace_In 	in;
+    TPMI_RH_NV_INDEX		nvIndex = 0;
+    TPMI_RH_PROVISION		authHandle = TPM_RH_OWNER;
+    const char			*parentPassword = NULL;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RS_PW);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-hi") == 0) {
+	    if (++i < argc) {
+		rc = parseHierarchy(&authHandle, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-hi");
+	    }
+	}
+	else if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &nvIndex);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-pwdp") == 0) {
+	    if (++i < argc) {
+		parentPassword = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pwdp");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if ((nvIndex >> 24) != TPM_HT_NV_INDEX) {
+	printf("NV index handle not specified or out of range, MSB not 01\n");
+	return EXIT_FAILURE;
+    }
+    in.authHandle = authHandle;
+    in.nvIndex = nvIndex;
+    rc = TSS_Execute(tssContext,
+		     NULL,
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     TPM_CC_NV_UndefineSpace,
+		     sessions.sessionHandle[0], parentPassword, sessions.sessionAttributes[0],
+		     sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+		     sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+		     TPM_RH_NULL, NULL, 0);
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchStartAuthSession() runs startauthsession -se, -halg, -hs, -bi, -pwdb, -sym, -on */
+
+static int batchStartAuthSession(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    StartAuthSession_In 	in;
+    StartAuthSession_Out 	out;
+    StartAuthSession_Extra	extra;
+    TPMI_ALG_HASH		halg = TPM_ALG_SHA256;
+    TPMI_DH_OBJECT		tpmKey = TPM_RH_NULL;
+    TPMI_DH_ENTITY		bindHandle = TPM_RH_NULL;
+    const char			*bindPassword = NULL;
+    TPMI_ALG_SYM		algorithm = TPM_ALG_XOR;
+    const char			*nonceTPMFilename = NULL;
+    char			seChar = 0;
+
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-se") == 0) {
+	    if (++i < argc) {
+		seChar = argv[i][0];
+	    }
+	    else {
+		rc = missingParameter("-se");
+	    }
+	}
+	else if (strcmp(argv[i],"-halg") == 0) {
+	    if (++i < argc) {
+		rc = parseHalg(&halg, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-halg");
+	    }
+	}
+	else if (strcmp(argv[i],"-hs") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &tpmKey);
+	    }
+	    else {
+		rc = missingParameter("-hs");
+	    }
+	}
+	else if (strcmp(argv[i],"-bi") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &bindHandle);
+	    }
+	    else {
+		rc = missingParameter("-bi");
+	    }
+	}
+	else if (strcmp(argv[i],"-pwdb") == 0) {
+	    if (++i < argc) {
+		bindPassword = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pwdb");
+	    }
+	}
+	else if (strcmp(argv[i],"-sym") == 0) {
+	    if (++i < argc) {
+		if (strcmp(argv[i],"xor") == 0) {
+		    algorithm = TPM_ALG_XOR;
+		}
+		else if (strcmp(argv[i],"aes") == 0) {
+		    algorithm = TPM_ALG_AES;
+		}
+		else {
+		    printf("Bad parameter for -sym\n");
+		    rc = EXIT_FAILURE;
+		}
+	    }
+	    else {
+		rc = missingParameter("-sym");
+	    }
+	}
+	else if (strcmp(argv[i],"-on") == 0) {
+	    if (++i < argc) {
+		nonceTPMFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-on");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    switch (seChar) {
+      case 'h':
+	in.sessionType = TPM_SE_HMAC;
+	break;
+      case 'p':
+	in.sessionType = TPM_SE_POLICY;
+	break;
+      case 't':
+	in.sessionType = TPM_SE_TRIAL;
+	break;
+      default:
+	printf("Missing or illegal parameter for -se\n");
+	return EXIT_FAILURE;
+    }
+    in.tpmKey = tpmKey;
+    in.encryptedSalt.b.size = 0;
+    in.bind = bindHandle;
+    in.nonceCaller.t.size = 0;
+    in.symmetric.algorithm = algorithm;
+    in.authHash = halg;
+    if (in.symmetric.algorithm == TPM_ALG_XOR) {
+	in.symmetric.keyBits.xorr = halg;
+	in.symmetric.mode.sym = TPM_ALG_NULL;		/* none for xor */
+    }
+    else {
+	in.symmetric.keyBits.aes = 128;
+	in.symmetric.mode.aes = TPM_ALG_CFB;
+    }
+    /* pass the bind password to the TSS post processor for the session key calculation */
+    extra.bindPassword = bindPassword;
+    rc = TSS_Execute(tssContext,
+		     (RESPONSE_PARAMETERS *)&out, 
+		     (COMMAND_PARAMETERS *)&in,
+		     (EXTRA_PARAMETERS *)&extra,
+		     TPM_CC_StartAuthSession,
+		     TPM_RH_NULL, NULL, 0);
+    /* optionally store the nonceTPM for use in policy commands */
+    if ((rc == 0) && (nonceTPMFilename != NULL)) {
+	rc = TSS_File_WriteBinaryFile((uint8_t *)&out.nonceTPM.t.buffer,
+				      out.nonceTPM.t.size,
+				      nonceTPMFilename); 
+    }
+    if (rc == 0) {
+	printf("Handle %08x\n", out.sessionHandle);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchPolicyCommandCode() runs policycommandcode -ha, -cc */
+
+static int batchPolicyCommandCode(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    PolicyCommandCode_In 	in;
+    TPMI_SH_POLICY		policySession = 0;
+    TPM_CC			commandCode = 0;
+
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &policySession);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-cc") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &commandCode);
+	    }
+	    else {
+		rc = missingParameter("-cc");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if ((policySession == 0) || (commandCode == 0)) {
+	printf("Missing handle parameter -ha or command code parameter -cc\n");
+	return EXIT_FAILURE;
+    }
+    in.policySession = policySession;
+    in.code = commandCode;
+    rc = TSS_Execute(tssContext,
+		     NULL, 
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     TPM_CC_PolicyCommandCode,
+		     TPM_RH_NULL, NULL, 0);
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchPolicyGetDigest() runs policygetdigest -ha, -of */
+
+static int batchPolicyGetDigest(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    PolicyGetDigest_In 		in;
+    PolicyGetDigest_Out 	out;
+    TPMI_SH_POLICY		policySession = 0;
+    const char			*digestFilename = NULL;
+
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &policySession);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-of") == 0) {
+	    if (++i < argc) {
+		digestFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-of");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (policySession == 0) {
+	printf("Missing handle parameter -ha\n");
+	return EXIT_FAILURE;
+    }
+    in.policySession = policySession;
+    rc = TSS_Execute(tssContext,
+		     (RESPONSE_PARAMETERS *)&out, 
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     TPM_CC_PolicyGetDigest,
+		     TPM_RH_NULL, NULL, 0);
+    if ((rc == 0) && (digestFilename != NULL)) {
+	rc = TSS_File_WriteBinaryFile(out.policyDigest.t.buffer,
+				      out.policyDigest.t.size,
+				      digestFilename);
+    }
+    if (rc == 0) {
+	TSS_PrintAll("policyDigest", out.policyDigest.t.buffer, out.policyDigest.t.size);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchPolicySession() is the common code for the policy commands whose only parameter is the
+   policy session handle -ha */
+
+static int batchPolicySession(TSS_CONTEXT *tssContext, int argc, char *argv[],
+			      TPM_CC commandCode)
+{
+    TPM_RC			rc = 0;
+    int				i;
+    PolicyRestart_In 		in;	/* PolicyAuthValue_In and PolicyPassword_In are the same */
+    TPMI_SH_POLICY		policySession = 0;
+
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &policySession);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (policySession == 0) {
+	printf("Missing handle parameter -ha\n");
+	return EXIT_FAILURE;
+    }
+    in.sessionHandle = policySession;
+    rc = TSS_Execute(tssContext,
+		     NULL, 
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     commandCode,
+		     TPM_RH_NULL, NULL, 0);
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+static int batchPolicyRestart(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    return batchPolicySession(tssContext, argc, argv, TPM_CC_PolicyRestart);
+}
+
+static int batchPolicyAuthValue(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    return batchPolicySession(tssContext, argc, argv, TPM_CC_PolicyAuthValue);
+}
+
+static int batchPolicyPassword(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    return batchPolicySession(tssContext, argc, argv, TPM_CC_PolicyPassword);
+}
+
+/* batchCreate() runs create -hp, the object template options, -pwdk, -pwdp, -opu, -opr, -opem,
+   -tk, -ch, -if, -se[0-2] */
+
+static int batchCreate(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    Create_In 			in;
+    Create_Out 			out;
+    TPMI_DH_OBJECT		parentHandle = 0;
+    TEMPLATE_OPTIONS		templateOptions;
+    const char			*publicKeyFilename = NULL;
+    const char			*privateKeyFilename = NULL;
+    const char			*pemFilename = NULL;
+    const char			*ticketFilename = NULL;
+    const char			*creationHashFilename = NULL;
+    const char 			*dataFilename = NULL;
+    const char			*keyPassword = NULL;
+    const char			*parentPassword = NULL;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RS_PW);
+    initTemplateOptions(&templateOptions);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	rc = parseTemplateOption(&templateOptions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-hp") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &parentHandle);
+	    }
+	    else {
+		rc = missingParameter("-hp");
+	    }
+	}
+	else if (strcmp(argv[i],"-pwdk") == 0) {
+	    if (++i < argc) {
+		keyPassword = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pwdk");
+	    }
+	}
+	else if (strcmp(argv[i],"-pwdp") == 0) {
+	    if (++i < argc) {
+		parentPassword = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pwdp");
+	    }
+	}
+	else if (strcmp(argv[i],"-opu") == 0) {
+	    if (++i < argc) {
+		publicKeyFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-opu");
+	    }
+	}
+	else if (strcmp(argv[i],"-opr") == 0) {
+	    if (++i < argc) {
+		privateKeyFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-opr");
+	    }
+	}
+	else if (strcmp(argv[i],"-opem") == 0) {
+	    if (++i < argc) {
+		pemFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-opem");
+	    }
+	}
+	else if (strcmp(argv[i],"-tk") == 0) {
+	    if (++i < argc) {
+		ticketFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-tk");
+	    }
+	}
+	else if (strcmp(argv[i],"-ch") == 0) {
+	    if (++i < argc) {
+		creationHashFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-ch");
+	    }
+	}
+	else if (strcmp(argv[i],"-if") == 0) {
+	    if (++i < argc) {
+		dataFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-if");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (parentHandle == 0) {
+	printf("Missing handle parameter -hp\n");
+	return EXIT_FAILURE;
+    }
+    if (checkTemplateOptions(&templateOptions, dataFilename) != 0) {
+	return EXIT_FAILURE;
+    }
+    in.parentHandle = parentHandle;
+    if (keyPassword == NULL) {
+	in.inSensitive.sensitive.userAuth.t.size = 0;
+    }
+    else {
+	rc = TSS_TPM2B_StringCopy(&in.inSensitive.sensitive.userAuth.b,
+				  keyPassword, sizeof(TPMU_HA));
+    }
+    if (rc == 0) {
+	if (dataFilename != NULL) {
+	    rc = TSS_File_Read2B(&in.inSensitive.sensitive.data.b,
+				 MAX_SYM_DATA,
+				 dataFilename);
+	}
+	else {
+	    in.inSensitive.sensitive.data.t.size = 0;
+	}
+    }
+    if (rc == 0) {
+	rc = publicTemplate(&in.inPublic.publicArea, &templateOptions);
+    }
+    if (rc == 0) {
+	in.outsideInfo.t.size = 0;
+	in.creationPCR.count = 0;
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_Create,
+			 sessions.sessionHandle[0], parentPassword, sessions.sessionAttributes[0],
+			 sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+			 sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if ((rc == 0) && (privateKeyFilename != NULL)) {
+	rc = TSS_File_WriteStructure(&out.outPrivate,
+				     (MarshalFunction_t)TSS_TPM2B_PRIVATE_Marshal,
+				     privateKeyFilename);
+    }
+    if ((rc == 0) && (publicKeyFilename != NULL)) {
+	rc = TSS_File_WriteStructure(&out.outPublic,
+				     (MarshalFunction_t)TSS_TPM2B_PUBLIC_Marshal,
+				     publicKeyFilename);
+    }
+    if ((rc == 0) && (pemFilename != NULL)) {
+	rc = convertPublicToPEM(&out.outPublic,
+				pemFilename);
+    }
+    if ((rc == 0) && (ticketFilename != NULL)) {
+	rc = TSS_File_WriteStructure(&out.creationTicket,
+				     (MarshalFunction_t)TSS_TPMT_TK_CREATION_Marshal,
+				     ticketFilename);
+    }
+    if ((rc == 0) && (creationHashFilename != NULL)) {
+	rc = TSS_File_WriteBinaryFile(out.creationHash.b.buffer,
+				      out.creationHash.b.size,
+				      creationHashFilename);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* initTemplateOptions() sets the create utility defaults, no key type, RSA, sha256, and the noDA
+   attribute */
+
+static void initTemplateOptions(TEMPLATE_OPTIONS *options)
+{
+    options->addObjectAttributes.val = 0;
+    options->addObjectAttributes.val |= TPMA_OBJECT_NODA;
+    options->deleteObjectAttributes.val = 0;
+    options->keyType = 0;
+    options->keyTypeSpecified = 0;
+    options->rev116 = FALSE;
+    options->algPublic = TPM_ALG_RSA;
+    options->curveID = TPM_ECC_NONE;
+    options->halg = TPM_ALG_SHA256;
+    options->nalg = TPM_ALG_SHA256;
+    options->policyFilename = NULL;
+    return;
+}
+
+/* parseTemplateOption() parses the template options listed in printUsageTemplate().
+
+   found is set TRUE if argv[*i] is a template option, and *i is advanced past its parameters.
+*/
+
+static int parseTemplateOption(TEMPLATE_OPTIONS *options,
+			       int *found,
+			       int *i,
+			       int argc,
+			       char *argv[])
+{
+    int		rc = 0;
+    size_t	t;
+    static const struct {
+	const char	*option;
+	int		keyType;
+    } keyTypeTable [] = {
+	{"-bl",		TYPE_BL},
+	{"-den",	TYPE_DEN},
+	{"-deo",	TYPE_DEO},
+	{"-des",	TYPE_DES},
+	{"-st",		TYPE_ST},
+	{"-si",		TYPE_SI},
+	{"-dau",	TYPE_DAA},
+	{"-dar",	TYPE_DAAR},
+	{"-sir",	TYPE_SIR},
+	{"-kh",		TYPE_KH},
+	{"-dp",		TYPE_DP},
+	{"-gp",		TYPE_GP},
+    };
+
+    *found = TRUE;
+    for (t = 0 ; t < sizeof(keyTypeTable) / sizeof(keyTypeTable[0]) ; t++) {
+	if (strcmp(argv[*i], keyTypeTable[t].option) == 0) {
+	    options->keyType = keyTypeTable[t].keyType;
+	    options->keyTypeSpecified++;
+	    return 0;
+	}
+    }
+    if (strcmp(argv[*i], "-116") == 0) {
+	options->rev116 = TRUE;
+    }
+    else if (strcmp(argv[*i], "-rsa") == 0) {
+	options->algPublic = TPM_ALG_RSA;
+    }
+    else if (strcmp(argv[*i], "-ecc") == 0) {
+	options->algPublic = TPM_ALG_ECC;
+	(*i)++;
+	if (*i < argc) {
+	    if (strcmp(argv[*i],"bnp256") == 0) {
+		options->curveID = TPM_ECC_BN_P256;
+	    }
+	    else if (strcmp(argv[*i],"nistp256") == 0) {
+		options->curveID = TPM_ECC_NIST_P256;
+	    }
+	    else if (strcmp(argv[*i],"nistp384") == 0) {
+		options->curveID = TPM_ECC_NIST_P384;
+	    }
+	    else {
+		printf("Bad parameter %s for -ecc\n", argv[*i]);
+		rc = EXIT_FAILURE;
+	    }
+	}
+	else {
+	    printf("-ecc option needs a value\n");
+	    rc = EXIT_FAILURE;
+	}
+    }
+    else if (strcmp(argv[*i], "-kt") == 0) {
+	(*i)++;
+	if (*i < argc) {
+	    if (strcmp(argv[*i], "f") == 0) {
+		options->addObjectAttributes.val |= TPMA_OBJECT_FIXEDTPM;
+	    }
+	    else if (strcmp(argv[*i], "p") == 0) {
+		options->addObjectAttributes.val |= TPMA_OBJECT_FIXEDPARENT;
+	    }
+	    else if (strcmp(argv[*i], "nf") == 0) {
+		options->deleteObjectAttributes.val |= TPMA_OBJECT_FIXEDTPM;
+	    }
+	    else if (strcmp(argv[*i], "np")  == 0) {
+		options->deleteObjectAttributes.val |= TPMA_OBJECT_FIXEDPARENT;
+	    }
+	    else {
+		printf("Bad parameter %s for -kt\n", argv[*i]);
+		rc = EXIT_FAILURE;
+	    }
+	}
+	else {
+	    printf("Missing parameter for -kt\n");
+	    rc = EXIT_FAILURE;
+	}
+    }
+    else if (strcmp(argv[*i], "-uwa") == 0) {
+	options->deleteObjectAttributes.val |= TPMA_OBJECT_USERWITHAUTH;
+    }
+    else if (strcmp(argv[*i], "-da") == 0) {
+	options->addObjectAttributes.val &= ~TPMA_OBJECT_NODA;
+    }
+    else if ((strcmp(argv[*i],"-halg") == 0) ||
+	     (strcmp(argv[*i],"-nalg") == 0)) {
+	TPMI_ALG_HASH *alg = (argv[*i][1] == 'h') ? &options->halg : &options->nalg;
+	(*i)++;
+	if (*i < argc) {
+	    rc = parseHalg(alg, argv[*i]);
+	}
+	else {
+	    printf("%s option needs a value\n", argv[*i - 1]);
+	    rc = EXIT_FAILURE;
+	}
+    }
+    else if (strcmp(argv[*i],"-pol") == 0) {
+	(*i)++;
+	if (*i < argc) {
+	    options->policyFilename = argv[*i];
+	}
+	else {
+	    printf("-pol option needs a value\n");
+	    rc = EXIT_FAILURE;
+	}
+    }
+    else {
+	*found = FALSE;
+    }
+    return rc;
+}
+
+/* checkTemplateOptions() validates the key type against the algorithm and the optional sensitive
+   data file */
+
+static int checkTemplateOptions(const TEMPLATE_OPTIONS *options,
+				const char *dataFilename)
+{
+    int		rc = 0;
+
+    if (options->keyTypeSpecified != 1) {
+	printf("Missing or too many key attributes\n");
+	return EXIT_FAILURE;
+    }
+    switch (options->keyType) {
+      case TYPE_BL:
+	if (dataFilename == NULL) {
+	    printf("-bl needs -if (sealed data object needs data to seal)\n");
+	    rc = EXIT_FAILURE;
+	}
+	break;
+      case TYPE_DAA:
+      case TYPE_DAAR:
+	if (options->algPublic != TPM_ALG_ECC) {
+	    printf("-dau and -dar needs -ecc\n");
+	    rc = EXIT_FAILURE;
+	    break;
+	}
+	/* fall through - the sensitive data test is intentional */
+      case TYPE_ST:
+      case TYPE_DEN:
+      case TYPE_DEO:
+      case TYPE_SI:
+      case TYPE_SIR:
+      case TYPE_GP:
+	if (dataFilename != NULL) {
+	    printf("asymmetric key cannot have -if (sensitive data)\n");
+	    rc = EXIT_FAILURE;
+	}
+	break;
+      case TYPE_DES:
+      case TYPE_KH:
+      case TYPE_DP:
+	/* inSensitive optional for symmetric keys */
+	break;
+    }
+    return rc;
+}
+
+/* publicTemplate() fills the public area from the template for the key type */
+
+static TPM_RC publicTemplate(TPMT_PUBLIC *publicArea,
+			     const TEMPLATE_OPTIONS *options)
+{
+    TPM_RC	rc = 0;
+
+    switch (options->keyType) {
+      case TYPE_BL:
+	rc = blPublicTemplate(publicArea,
+			      options->addObjectAttributes, options->deleteObjectAttributes,
+			      options->nalg,
+			      options->policyFilename);
+	break;
+      case TYPE_ST:
+      case TYPE_DAA:
+      case TYPE_DAAR:
+      case TYPE_DEN:
+      case TYPE_DEO:
+      case TYPE_SI:
+      case TYPE_SIR:
+      case TYPE_GP:
+	rc = asymPublicTemplate(publicArea,
+				options->addObjectAttributes, options->deleteObjectAttributes,
+				options->keyType, options->algPublic, options->curveID,
+				options->nalg, options->halg,
+				options->policyFilename);
+	break;
+      case TYPE_DES:
+	rc = symmetricCipherTemplate(publicArea,
+				     options->addObjectAttributes, options->deleteObjectAttributes,
+				     options->nalg, options->rev116,
+				     options->policyFilename);
+	break;
+      case TYPE_KH:
+	rc = keyedHashPublicTemplate(publicArea,
+				     options->addObjectAttributes, options->deleteObjectAttributes,
+				     options->nalg, options->halg,
+				     options->policyFilename);
+	break;
+      case TYPE_DP:
+	rc = derivationParentPublicTemplate(publicArea,
+					    options->addObjectAttributes,
+					    options->deleteObjectAttributes,
+					    options->nalg, options->halg,
+					    options->policyFilename);
+	break;
+      default:
+	printf("publicTemplate: Error, key type %d unsupported\n", options->keyType);
+	rc = EXIT_FAILURE;
+    }
+    return rc;
+}
+
+/* batchLoad() runs load -hp, -pwdp, -ipu, -ipr, -se[0-2] */
+
+static int batchLoad(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    Load_In 			in;
+    Load_Out 			out;
+    TPMI_DH_OBJECT		parentHandle = 0;
+    const char			*publicKeyFilename = NULL;
+    const char			*privateKeyFilename = NULL;
+    const char			*parentPassword = NULL;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RS_PW);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-hp") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &parentHandle);
+	    }
+	    else {
+		rc = missingParameter("-hp");
+	    }
+	}
+	else if (strcmp(argv[i],"-pwdp") == 0) {
+	    if (++i < argc) {
+		parentPassword = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pwdp");
+	    }
+	}
+	else if (strcmp(argv[i],"-ipu") == 0) {
+	    if (++i < argc) {
+		publicKeyFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-ipu");
+	    }
+	}
+	else if (strcmp(argv[i],"-ipr") == 0) {
+	    if (++i < argc) {
+		privateKeyFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-ipr");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (parentHandle == 0) {
+	printf("Missing handle parameter -hp\n");
+	return EXIT_FAILURE;
+    }
+    if ((privateKeyFilename == NULL) || (publicKeyFilename == NULL)) {
+	printf("Missing key file parameter -ipr or -ipu\n");
+	return EXIT_FAILURE;
+    }
+    rc = TSS_File_ReadStructure(&in.inPrivate,
+				(UnmarshalFunction_t)TPM2B_PRIVATE_Unmarshal,
+				privateKeyFilename);
+    if (rc == 0) {
+	rc = TSS_File_ReadStructure(&in.inPublic,
+				    unmarshalPublic,
+				    publicKeyFilename);
+    }
+    if (rc == 0) {
+	in.parentHandle = parentHandle;
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_Load,
+			 sessions.sessionHandle[0], parentPassword, sessions.sessionAttributes[0],
+			 sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+			 sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if (rc == 0) {
+	printf("Handle %08x\n", out.objectHandle);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchSign() runs sign -hk, -pwdk, -halg, -rsa, -ecc, -if, -ipu, -tk, -os, -se[0-2]
+
+   Unlike the utility, -ipu also verifies an ECDSA signature.
+*/
+
+static int batchSign(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    Sign_In 			in;
+    Sign_Out 			out;
+    TPMI_DH_OBJECT		keyHandle = 0;
+    TPMI_ALG_HASH		halg = TPM_ALG_SHA256;
+    TPMI_ALG_SIG_SCHEME		scheme = TPM_ALG_RSASSA;
+    const char			*messageFilename = NULL;
+    const char			*ticketFilename = NULL;
+    const char			*publicKeyFilename = NULL;
+    const char			*signatureFilename = NULL;
+    const char			*keyPassword = NULL;
+    unsigned char 		*data = NULL;
+    size_t 			length;
+    TPMT_HA 			digest;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RS_PW);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-hk") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &keyHandle);
+	    }
+	    else {
+		rc = missingParameter("-hk");
+	    }
+	}
+	else if (strcmp(argv[i],"-pwdk") == 0) {
+	    if (++i < argc) {
+		keyPassword = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pwdk");
+	    }
+	}
+	else if (strcmp(argv[i],"-halg") == 0) {
+	    if (++i < argc) {
+		rc = parseHalg(&halg, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-halg");
+	    }
+	}
+	else if (strcmp(argv[i],"-rsa") == 0) {
+	    scheme = TPM_ALG_RSASSA;
+	}
+	else if (strcmp(argv[i],"-ecc") == 0) {
+	    scheme = TPM_ALG_ECDSA;
+	}
+	else if (strcmp(argv[i],"-if") == 0) {
+	    if (++i < argc) {
+		messageFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-if");
+	    }
+	}
+	else if (strcmp(argv[i],"-ipu") == 0) {
+	    if (++i < argc) {
+		publicKeyFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-ipu");
+	    }
+	}
+	else if (strcmp(argv[i],"-tk") == 0) {
+	    if (++i < argc) {
+		ticketFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-tk");
+	    }
+	}
+	else if (strcmp(argv[i],"-os") == 0) {
+	    if (++i < argc) {
+		signatureFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-os");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (keyHandle == 0) {
+	printf("Missing handle parameter -hk\n");
+	return EXIT_FAILURE;
+    }
+    if (messageFilename == NULL) {
+	printf("Missing message file name -if\n");
+	return EXIT_FAILURE;
+    }
+    rc = TSS_File_ReadBinaryFile(&data,     /* freed @1 */
+				 &length,
+				 messageFilename);
+    if (rc == 0) {
+	digest.hashAlg = halg;
+	rc = TSS_Hash_Generate(&digest,
+			       length, data,
+			       0, NULL);
+    }
+    if (rc == 0) {
+	in.keyHandle = keyHandle;
+	in.digest.t.size = TSS_GetDigestSize(halg);
+	memcpy(&in.digest.t.buffer, (uint8_t *)&digest.digest, in.digest.t.size);
+	in.inScheme.scheme = scheme;
+	if (scheme == TPM_ALG_RSASSA) {
+	    in.inScheme.details.rsassa.hashAlg = halg;
+	}
+	else {
+	    in.inScheme.details.ecdsa.hashAlg = halg;
+	}
+	if (ticketFilename == NULL) {
+	    /* proof that digest was created by the TPM (NULL ticket) */
+	    in.validation.tag = TPM_ST_HASHCHECK;
+	    in.validation.hierarchy = TPM_RH_NULL;
+	    in.validation.digest.t.size = 0;
+	}
+	else {
+	    rc = TSS_File_ReadStructure(&in.validation,
+					(UnmarshalFunction_t)TPMT_TK_HASHCHECK_Unmarshal,
+					ticketFilename);
+	}
+    }
+    if (rc == 0) {
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_Sign,
+			 sessions.sessionHandle[0], keyPassword, sessions.sessionAttributes[0],
+			 sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+			 sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if ((rc == 0) && (signatureFilename != NULL)) {
+	rc = TSS_File_WriteStructure(&out.signature,
+				     (MarshalFunction_t)TSS_TPMT_SIGNATURE_Marshal,
+				     signatureFilename);
+    }
+    /* optionally verify the signature with the TPM2B_PUBLIC key */
+    if ((rc == 0) && (publicKeyFilename != NULL)) {
+	TPM2B_PUBLIC 	public;
+	EVP_PKEY 	*evpPkey = NULL;
+
+	rc = TSS_File_ReadStructure(&public,
+				    unmarshalPublic,
+				    publicKeyFilename);
+	if ((rc == 0) && (scheme == TPM_ALG_RSASSA)) {
+	    rc = convertRsaPublicToEvpPubKey(&evpPkey,		/* freed @2 */
+					     &public.publicArea.unique.rsa);
+	    if (rc == 0) {
+		rc = verifyRSASignatureFromEvpPubKey(in.digest.t.buffer, in.digest.t.size,
+						     &out.signature, halg, evpPkey);
+	    }
+	}
+	else if (rc == 0) {
+	    rc = convertEcPublicToEvpPubKey(&evpPkey,		/* freed @2 */
+					    &public.publicArea.unique.ecc);
+	    if (rc == 0) {
+		rc = verifyEcSignatureFromEvpPubKey(in.digest.t.buffer, in.digest.t.size,
+						    &out.signature, evpPkey);
+	    }
+	}
+	if (evpPkey != NULL) {
+	    EVP_PKEY_free(evpPkey);	/* @2 */
+	}
+    }
+    free(data);		/* @1 */
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchLoadExternal() runs loadexternal -hi, -nalg, -halg, -rsa, -ecc, -ipu, -ipem, -ider, -si,
+   -st, -se0 */
+
+static int batchLoadExternal(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    LoadExternal_In 		in;
+    LoadExternal_Out 		out;
+    TPMI_RH_HIERARCHY		hierarchy = TPM_RH_NULL;
+    int				keyType = TYPE_SI;
+    uint32_t 			keyTypeSpecified = 0;
+    TPMI_ALG_PUBLIC 		algPublic = TPM_ALG_RSA;
+    TPMI_ALG_HASH		halg = TPM_ALG_SHA256;
+    TPMI_ALG_HASH		nalg = TPM_ALG_SHA256;
+    const char			*publicKeyFilename = NULL;
+    const char			*derKeyFilename = NULL;
+    const char			*pemKeyFilename = NULL;
+    unsigned int		inputCount = 0;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RH_NULL);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-hi") == 0) {
+	    if (++i < argc) {
+		if (strcmp(argv[i],"e") == 0) {
+		    hierarchy = TPM_RH_ENDORSEMENT;
+		}
+		else if (strcmp(argv[i],"o") == 0) {
+		    hierarchy = TPM_RH_OWNER;
+		}
+		else if (strcmp(argv[i],"p") == 0) {
+		    hierarchy = TPM_RH_PLATFORM;
+		}
+		else if (strcmp(argv[i],"n") == 0) {
+		    hierarchy = TPM_RH_NULL;
+		}
+		else {
+		    printf("Bad parameter %s for -hi\n", argv[i]);
+		    rc = EXIT_FAILURE;
+		}
+	    }
+	    else {
+		rc = missingParameter("-hi");
+	    }
+	}
+	else if (strcmp(argv[i],"-halg") == 0) {
+	    if (++i < argc) {
+		rc = parseHalg(&halg, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-halg");
+	    }
+	}
+	else if (strcmp(argv[i],"-nalg") == 0) {
+	    if (++i < argc) {
+		rc = parseHalg(&nalg, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-nalg");
+	    }
+	}
+	else if (strcmp(argv[i],"-rsa") == 0) {
+	    algPublic = TPM_ALG_RSA;
+	}
+	else if (strcmp(argv[i],"-ecc") == 0) {
+	    algPublic = TPM_ALG_ECC;
+	}
+	else if (strcmp(argv[i],"-st") == 0) {
+	    keyType = TYPE_ST;
+	    keyTypeSpecified++;
+	}
+	else if (strcmp(argv[i],"-si") == 0) {
+	    keyType = TYPE_SI;
+	    keyTypeSpecified++;
+	}
+	else if (strcmp(argv[i],"-ipu") == 0) {
+	    if (++i < argc) {
+		publicKeyFilename = argv[i];
+		inputCount++;
+	    }
+	    else {
+		rc = missingParameter("-ipu");
+	    }
+	}
+	else if (strcmp(argv[i],"-ipem") == 0) {
+	    if (++i < argc) {
+		pemKeyFilename = argv[i];
+		inputCount++;
+	    }
+	    else {
+		rc = missingParameter("-ipem");
+	    }
+	}
+	else if (strcmp(argv[i],"-ider") == 0) {
+	    if (++i < argc) {
+		derKeyFilename = argv[i];
+		inputCount++;
+	    }
+	    else {
+		rc = missingParameter("-ider");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (inputCount != 1) {
+	printf("Missing or too many parameters -ipu, -ipem, -ider\n");
+	return EXIT_FAILURE;
+    }
+    if (keyTypeSpecified > 1) {
+	printf("Too many key attributes\n");
+	return EXIT_FAILURE;
+    }
+    in.inPrivate.t.size = 0;	/* default - mark optional inPrivate not used */
+    /* TPM format key, output from create */
+    if (publicKeyFilename != NULL) {
+	rc = TSS_File_ReadStructure(&in.inPublic,
+				    unmarshalPublic,
+				    publicKeyFilename);
+    }
+    /* PEM format, output from e.g. openssl */
+    else if (pemKeyFilename != NULL) {
+	if (algPublic == TPM_ALG_RSA) {
+	    rc = convertRsaPemToPublic(&in.inPublic,
+				       keyType, nalg, halg,
+				       pemKeyFilename);
+	}
+	else {
+	    rc = convertEcPemToPublic(&in.inPublic,
+				      keyType, nalg, halg,
+				      pemKeyFilename);
+	}
+    }
+    else {
+	rc = convertRsaDerToKeyPair(&in.inPublic,
+				    &in.inPrivate,
+				    keyType, nalg, halg,
+				    derKeyFilename);
+	in.inPrivate.t.size = 1;		/* mark that private area should be loaded */
+    }
+    if (rc == 0) {
+	in.hierarchy = hierarchy;
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_LoadExternal,
+			 sessions.sessionHandle[0], NULL, sessions.sessionAttributes[0],
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if (rc == 0) {
+	printf("Handle %08x\n", out.objectHandle);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchPolicyPCR() runs policypcr -ha, -halg, -bm, -se[0-2] */
+
+static int batchPolicyPCR(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    PolicyPCR_In 		in;
+    TPMI_SH_POLICY		policySession = 0;
+    TPMI_ALG_HASH		halg = TPM_ALG_SHA256;
+    uint32_t	  		pcrmask = 0xffffffff;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RH_NULL);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &policySession);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-halg") == 0) {
+	    if (++i < argc) {
+		rc = parseHalg(&halg, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-halg");
+	    }
+	}
+	else if (strcmp(argv[i],"-bm") == 0) {
+	    if (++i < argc) {
+		if (sscanf(argv[i], "%x", &pcrmask) != 1) {
+		    printf("Invalid -bm argument '%s'\n", argv[i]);
+		    rc = EXIT_FAILURE;
+		}
+	    }
+	    else {
+		rc = missingParameter("-bm");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if ((policySession == 0) || (pcrmask == 0xffffffff)) {
+	printf("Missing handle parameter -ha or PCR mask parameter -bm\n");
+	return EXIT_FAILURE;
+    }
+    in.policySession = policySession;
+    in.pcrDigest.b.size = 0;
+    in.pcrs.count = 1;
+    in.pcrs.pcrSelections[0].hash = halg;
+    in.pcrs.pcrSelections[0].sizeofSelect = 3;
+    in.pcrs.pcrSelections[0].pcrSelect[0] = (pcrmask >>  0) & 0xff;
+    in.pcrs.pcrSelections[0].pcrSelect[1] = (pcrmask >>  8) & 0xff;
+    in.pcrs.pcrSelections[0].pcrSelect[2] = (pcrmask >> 16) & 0xff;
+    rc = TSS_Execute(tssContext,
+		     NULL,
+		     (COMMAND_PARAMETERS *)&in,
+		     NULL,
+		     TPM_CC_PolicyPCR,
+		     sessions.sessionHandle[0], NULL, sessions.sessionAttributes[0],
+		     sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+		     sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+		     TPM_RH_NULL, NULL, 0);
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchPolicyOR() runs policyor -ha, -if (2 to 8 times), -se[0-2] */
+
+static int batchPolicyOR(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    PolicyOR_In 		in;
+    TPMI_SH_POLICY		policySession = 0;
+    const char 			*pHashListFilename[8];
+    uint32_t			count = 0;
+    uint32_t			j;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RH_NULL);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &policySession);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-if") == 0) {
+	    if (count >= 8) {
+		printf("-if can only be specified up to 8 times\n");
+		rc = EXIT_FAILURE;
+	    }
+	    else if (++i < argc) {
+		pHashListFilename[count] = argv[i];
+		count++;
+	    }
+	    else {
+		rc = missingParameter("-if");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (policySession == 0) {
+	printf("Missing handle parameter -ha\n");
+	return EXIT_FAILURE;
+    }
+    if (count < 2) {
+	printf("-if must be specified 2 to 8 times\n");
+	return EXIT_FAILURE;
+    }
+    in.policySession = policySession;
+    in.pHashList.count = count;
+    for (j = 0 ; (j < count) && (rc == 0) ; j++) {
+	rc = TSS_File_Read2B(&in.pHashList.digests[j].b,
+			     sizeof(TPMU_HA),
+			     pHashListFilename[j]);
+    }
+    if (rc == 0) {
+	rc = TSS_Execute(tssContext,
+			 NULL,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_PolicyOR,
+			 sessions.sessionHandle[0], NULL, sessions.sessionAttributes[0],
+			 sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+			 sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchPolicySecret() runs policysecret -ha, -hs, -in, -cp, -pref, -exp, -pwde, -tk, -to,
+   -se[0-2] */
+
+static int batchPolicySecret(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    PolicySecret_In 		in;
+    PolicySecret_Out 		out;
+    TPMI_DH_ENTITY		authHandle = 0;
+    TPMI_SH_POLICY		policySession = 0;
+    const char 			*nonceTPMFilename = NULL;
+    const char 			*cpHashAFilename = NULL;
+    const char			*policyRefFilename = NULL;
+    INT32			expiration = 0;
+    const char			*ticketFilename = NULL;
+    const char			*timeoutFilename = NULL;
+    const char			*entityPassword = NULL;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RS_PW);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &authHandle);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-hs") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &policySession);
+	    }
+	    else {
+		rc = missingParameter("-hs");
+	    }
+	}
+	else if (strcmp(argv[i],"-in") == 0) {
+	    if (++i < argc) {
+		nonceTPMFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-in");
+	    }
+	}
+	else if (strcmp(argv[i],"-cp") == 0) {
+	    if (++i < argc) {
+		cpHashAFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-cp");
+	    }
+	}
+	else if (strcmp(argv[i],"-pref") == 0) {
+	    if (++i < argc) {
+		policyRefFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pref");
+	    }
+	}
+	else if (strcmp(argv[i],"-exp") == 0) {
+	    if (++i < argc) {
+		expiration = atoi(argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-exp");
+	    }
+	}
+	else if (strcmp(argv[i],"-pwde") == 0) {
+	    if (++i < argc) {
+		entityPassword = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pwde");
+	    }
+	}
+	else if (strcmp(argv[i],"-tk") == 0) {
+	    if (++i < argc) {
+		ticketFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-tk");
+	    }
+	}
+	else if (strcmp(argv[i],"-to") == 0) {
+	    if (++i < argc) {
+		timeoutFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-to");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if ((authHandle == 0) || (policySession == 0)) {
+	printf("Missing entity handle parameter -ha or policy session handle parameter -hs\n");
+	return EXIT_FAILURE;
+    }
+    in.authHandle = authHandle;
+    in.policySession = policySession;
+    in.nonceTPM.b.size = 0;
+    in.cpHashA.b.size = 0;
+    in.policyRef.b.size = 0;
+    in.expiration = expiration;
+    if (nonceTPMFilename != NULL) {
+	rc = TSS_File_Read2B(&in.nonceTPM.b,
+			     sizeof(TPMU_HA),
+			     nonceTPMFilename);
+    }
+    if ((rc == 0) && (cpHashAFilename != NULL)) {
+	rc = TSS_File_Read2B(&in.cpHashA.b,
+			     sizeof(TPMU_HA),
+			     cpHashAFilename);
+    }
+    if ((rc == 0) && (policyRefFilename != NULL)) {
+	rc = TSS_File_Read2B(&in.policyRef.b,
+			     sizeof(TPMU_HA),
+			     policyRefFilename);
+    }
+    if (rc == 0) {
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_PolicySecret,
+			 sessions.sessionHandle[0], entityPassword, sessions.sessionAttributes[0],
+			 sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+			 sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if ((rc == 0) && (ticketFilename != NULL)) {
+	rc = TSS_File_WriteStructure(&out.policyTicket,
+				     (MarshalFunction_t)TSS_TPMT_TK_AUTH_Marshal,
+				     ticketFilename);
+    }
+    if ((rc == 0) && (timeoutFilename != NULL)) {
+	rc = TSS_File_WriteBinaryFile(out.timeout.b.buffer,
+				      out.timeout.b.size,
+				      timeoutFilename);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchPolicySigned() runs policysigned -hk, -ha, -in, -cp, -pref, -exp, -halg, -sk, -pwdk, -tk,
+   -to
+
+   As in the utility, aHash is signed RSASSA with the PEM format private key -sk.
+*/
+
+static int batchPolicySigned(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    PolicySigned_In 		in;
+    PolicySigned_Out 		out;
+    TPMI_DH_OBJECT		authObject = 0;
+    TPMI_SH_POLICY		policySession = 0;
+    const char 			*nonceTPMFilename = NULL;
+    const char 			*cpHashAFilename = NULL;
+    const char			*policyRefFilename = NULL;
+    const char			*ticketFilename = NULL;
+    const char			*timeoutFilename = NULL;
+    INT32			expiration = 0;
+    const char			*signingKeyFilename = NULL;
+    const char			*signingKeyPassword = NULL;
+    TPMI_ALG_HASH		halg = TPM_ALG_SHA256;
+    TPMT_HA 			aHash;
+
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-hk") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &authObject);
+	    }
+	    else {
+		rc = missingParameter("-hk");
+	    }
+	}
+	else if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &policySession);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-in") == 0) {
+	    if (++i < argc) {
+		nonceTPMFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-in");
+	    }
+	}
+	else if (strcmp(argv[i],"-cp") == 0) {
+	    if (++i < argc) {
+		cpHashAFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-cp");
+	    }
+	}
+	else if (strcmp(argv[i],"-pref") == 0) {
+	    if (++i < argc) {
+		policyRefFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pref");
+	    }
+	}
+	else if (strcmp(argv[i],"-exp") == 0) {
+	    if (++i < argc) {
+		expiration = atoi(argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-exp");
+	    }
+	}
+	else if (strcmp(argv[i],"-halg") == 0) {
+	    if (++i < argc) {
+		rc = parseHalg(&halg, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-halg");
+	    }
+	}
+	else if (strcmp(argv[i],"-sk") == 0) {
+	    if (++i < argc) {
+		signingKeyFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-sk");
+	    }
+	}
+	else if (strcmp(argv[i],"-pwdk") == 0) {
+	    if (++i < argc) {
+		signingKeyPassword = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pwdk");
+	    }
+	}
+	else if (strcmp(argv[i],"-tk") == 0) {
+	    if (++i < argc) {
+		ticketFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-tk");
+	    }
+	}
+	else if (strcmp(argv[i],"-to") == 0) {
+	    if (++i < argc) {
+		timeoutFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-to");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if ((authObject == 0) || (policySession == 0) || (signingKeyFilename == NULL)) {
+	printf("Missing key handle parameter -hk, session handle parameter -ha, "
+	       "or signing key parameter -sk\n");
+	return EXIT_FAILURE;
+    }
+    in.authObject = authObject;
+    in.policySession = policySession;
+    in.nonceTPM.b.size = 0;
+    in.cpHashA.b.size = 0;
+    in.policyRef.b.size = 0;
+    in.expiration = expiration;
+    if (nonceTPMFilename != NULL) {
+	rc = TSS_File_Read2B(&in.nonceTPM.b,
+			     sizeof(TPMU_HA),
+			     nonceTPMFilename);
+    }
+    if ((rc == 0) && (cpHashAFilename != NULL)) {
+	rc = TSS_File_Read2B(&in.cpHashA.b,
+			     sizeof(TPMU_HA),
+			     cpHashAFilename);
+    }
+    if ((rc == 0) && (policyRefFilename != NULL)) {
+	rc = TSS_File_Read2B(&in.policyRef.b,
+			     sizeof(TPMU_HA),
+			     policyRefFilename);
+    }
+    /* aHash = HauthAlg(nonceTPM || expiration || cpHashA || policyRef) */
+    if (rc == 0) {
+	INT32 expirationNbo = htonl(in.expiration);
+	aHash.hashAlg = halg;
+	rc = TSS_Hash_Generate(&aHash,
+			       in.nonceTPM.t.size, in.nonceTPM.t.buffer,
+			       sizeof(INT32), &expirationNbo,
+			       in.cpHashA.t.size, in.cpHashA.t.buffer,
+			       in.policyRef.t.size, in.policyRef.t.buffer,
+			       0, NULL);
+    }
+    if (rc == 0) {
+	in.auth.sigAlg = TPM_ALG_RSASSA;
+	in.auth.signature.rsassa.hash = halg;
+	rc = signAHash(&in.auth.signature.rsassa.sig,
+		       &aHash,
+		       signingKeyFilename, signingKeyPassword);
+    }
+    if (rc == 0) {
+	rc = TSS_Execute(tssContext,
+			 (RESPONSE_PARAMETERS *)&out,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_PolicySigned,
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if ((rc == 0) && (ticketFilename != NULL)) {
+	rc = TSS_File_WriteStructure(&out.policyTicket,
+				     (MarshalFunction_t)TSS_TPMT_TK_AUTH_Marshal,
+				     ticketFilename);
+    }
+    if ((rc == 0) && (timeoutFilename != NULL)) {
+	rc = TSS_File_WriteBinaryFile(out.timeout.b.buffer,
+				      out.timeout.b.size,
+				      timeoutFilename);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* signAHash() signs aHash RSASSA with the PEM format private key file signingKeyFilename, using
+   the cryptoutils key conversions */
+
+static TPM_RC signAHash(TPM2B_PUBLIC_KEY_RSA *signature,
+			TPMT_HA *aHash,
+			const char *signingKeyFilename,
+			const char *signingKeyPassword)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+    EVP_PKEY 		*evpPkey = NULL;
+    RSA			*rsaKey = NULL;
+    int			nid;
+    unsigned int 	length;
+
+    switch (aHash->hashAlg) {
+      case TPM_ALG_SHA1:
+	nid = NID_sha1;
+	break;
+      case TPM_ALG_SHA256:
+	nid = NID_sha256;
+	break;
+      case TPM_ALG_SHA384:
+	nid = NID_sha384;
+	break;
+      default:
+	printf("signAHash: Error, hash algorithm %04hx unsupported\n", aHash->hashAlg);
+	return TSS_RC_BAD_HASH_ALGORITHM;
+    }
+    rc = convertPemToEvpPrivKey(&evpPkey,		/* freed @1 */
+				signingKeyFilename,
+				signingKeyPassword);
+    if (rc == 0) {
+	rc = convertEvpPkeyToRsakey(&rsaKey,		/* freed @2 */
+				    evpPkey);
+    }
+    if (rc == 0) {
+	if ((unsigned int)RSA_size(rsaKey) > sizeof(signature->t.buffer)) {
+	    printf("signAHash: Error, private key length %u > signature buffer %u\n",
+		   (unsigned int)RSA_size(rsaKey), (unsigned int)sizeof(signature->t.buffer));
+	    rc = TSS_RC_RSA_SIGNATURE;
+	}
+    }
+    if (rc == 0) {
+	irc = RSA_sign(nid,
+		       (uint8_t *)&aHash->digest, TSS_GetDigestSize(aHash->hashAlg),
+		       signature->t.buffer, &length,
+		       rsaKey);
+	if (irc != 1) {
+	    printf("signAHash: Error in OpenSSL RSA_sign()\n");
+	    rc = TSS_RC_RSA_SIGNATURE;
+	}
+	else {
+	    signature->t.size = length;
+	}
+    }
+    if (rsaKey != NULL) {
+	RSA_free(rsaKey);		/* @2 */
+    }
+    if (evpPkey != NULL) {
+	EVP_PKEY_free(evpPkey);		/* @1 */
+    }
+    return rc;
+}
+
+/* batchPolicyAuthorize() runs policyauthorize -ha, -appr, -pref, -skn, -tk, -se[0-2] */
+
+static int batchPolicyAuthorize(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    int				found;
+    PolicyAuthorize_In 		in;
+    TPMI_SH_POLICY		policySession = 0;
+    const char 			*approvedPolicyFilename = NULL;
+    const char			*policyRefFilename = NULL;
+    const char			*signingKeyNameFilename = NULL;
+    const char			*ticketFilename = NULL;
+    BATCH_SESSIONS		sessions;
+
+    initSessions(&sessions, TPM_RH_NULL);
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	rc = parseSessions(&sessions, &found, &i, argc, argv);
+	if ((rc != 0) || found) {
+	    continue;
+	}
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &policySession);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else if (strcmp(argv[i],"-appr") == 0) {
+	    if (++i < argc) {
+		approvedPolicyFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-appr");
+	    }
+	}
+	else if (strcmp(argv[i],"-pref") == 0) {
+	    if (++i < argc) {
+		policyRefFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-pref");
+	    }
+	}
+	else if (strcmp(argv[i],"-skn") == 0) {
+	    if (++i < argc) {
+		signingKeyNameFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-skn");
+	    }
+	}
+	else if (strcmp(argv[i],"-tk") == 0) {
+	    if (++i < argc) {
+		ticketFilename = argv[i];
+	    }
+	    else {
+		rc = missingParameter("-tk");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if ((policySession == 0) || (approvedPolicyFilename == NULL) ||
+	(signingKeyNameFilename == NULL) || (ticketFilename == NULL)) {
+	printf("Missing parameter -ha, -appr, -skn, or -tk\n");
+	return EXIT_FAILURE;
+    }
+    in.policySession = policySession;
+    in.policyRef.b.size = 0;
+    rc = TSS_File_Read2B(&in.approvedPolicy.b,
+			 sizeof(TPMU_HA),
+			 approvedPolicyFilename);
+    if ((rc == 0) && (policyRefFilename != NULL)) {
+	rc = TSS_File_Read2B(&in.policyRef.b,
+			     sizeof(TPMU_HA),
+			     policyRefFilename);
+    }
+    if (rc == 0) {
+	rc = TSS_File_Read2B(&in.keySign.b,
+			     sizeof(TPMU_NAME),
+			     signingKeyNameFilename);
+    }
+    if (rc == 0) {
+	rc = TSS_File_ReadStructure(&in.checkTicket,
+				    (UnmarshalFunction_t)TPMT_TK_VERIFIED_Unmarshal,
+				    ticketFilename);
+    }
+    if (rc == 0) {
+	rc = TSS_Execute(tssContext,
+			 NULL,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_PolicyAuthorize,
+			 sessions.sessionHandle[0], NULL, sessions.sessionAttributes[0],
+			 sessions.sessionHandle[1], NULL, sessions.sessionAttributes[1],
+			 sessions.sessionHandle[2], NULL, sessions.sessionAttributes[2],
+			 TPM_RH_NULL, NULL, 0);
+    }
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchSessionLease() leases an HMAC session from the TSS session pool, sessionlease -halg, -hs,
+   -sym.  Commands use it with continueSession set, e.g. -se0 02000000 1, and sessionrelease returns
+   it. */
+
+static int batchSessionLease(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    TPMI_SH_AUTH_SESSION	sessionHandle;
+    TPMI_ALG_HASH		halg = TPM_ALG_SHA256;
+    TPMI_DH_OBJECT		tpmKey = TPM_RH_NULL;
+    TPMT_SYM_DEF		symmetric;
+    
+    symmetric.algorithm = TPM_ALG_XOR;
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-halg") == 0) {
+	    if (++i < argc) {
+		rc = parseHalg(&halg, argv[i]);
+	    }
+	    else {
+		rc = missingParameter("-halg");
+	    }
+	}
+	else if (strcmp(argv[i],"-hs") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &tpmKey);
+	    }
+	    else {
+		rc = missingParameter("-hs");
+	    }
+	}
+	else if (strcmp(argv[i],"-sym") == 0) {
+	    if (++i < argc) {
+		if (strcmp(argv[i],"xor") == 0) {
+		    symmetric.algorithm = TPM_ALG_XOR;
+		}
+		else if (strcmp(argv[i],"aes") == 0) {
+		    symmetric.algorithm = TPM_ALG_AES;
+		}
+		else {
+		    printf("Bad parameter for -sym\n");
+		    rc = EXIT_FAILURE;
+		}
+	    }
+	    else {
+		rc = missingParameter("-sym");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (symmetric.algorithm == TPM_ALG_XOR) {
+	symmetric.keyBits.xorr = halg;
+	symmetric.mode.sym = TPM_ALG_NULL;		/* none for xor */
+    }
+    else {
+	symmetric.keyBits.aes = 128;
+	symmetric.mode.aes = TPM_ALG_CFB;
+    }
+    rc = TSS_SessionPool_Lease(tssContext, &sessionHandle, tpmKey, halg, &symmetric);
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    printf("Handle %08x\n", sessionHandle);
+    return 0;
+}
+
+/* batchSessionRelease() returns a leased session to the TSS session pool, sessionrelease -ha */
+
+static int batchSessionRelease(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    int				i;
+    TPMI_SH_AUTH_SESSION	sessionHandle = 0;
+
+    for (i = 1 ; (i < argc) && (rc == 0) ; i++) {
+	if (strcmp(argv[i],"-ha") == 0) {
+	    if (++i < argc) {
+		sscanf(argv[i],"%x", &sessionHandle);
+	    }
+	    else {
+		rc = missingParameter("-ha");
+	    }
+	}
+	else {
+	    rc = badOption(argv[0], argv[i]);
+	}
+    }
+    if (rc != 0) {
+	return rc;
+    }
+    if (sessionHandle == 0) {
+	printf("Missing handle parameter -ha\n");
+	return EXIT_FAILURE;
+    }
+    rc = TSS_SessionPool_Release(tssContext, sessionHandle);
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchSessionPoolFlush() flushes the idle sessions of the TSS session pool, sessionpoolflush */
+
+static int batchSessionPoolFlush(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+
+    if (argc > 1) {
+	return badOption(argv[0], argv[1]);
+    }
+    rc = TSS_SessionPool_Flush(tssContext);
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    return 0;
+}
+
+/* batchSessionPoolStats() prints the TSS session pool counters, sessionpoolstats */
+
+static int batchSessionPoolStats(TSS_CONTEXT *tssContext, int argc, char *argv[])
+{
+    TPM_RC			rc = 0;
+    TSS_SESSION_POOL_STATS	stats;
+
+    if (argc > 1) {
+	return badOption(argv[0], argv[1]);
+    }
+    rc = TSS_SessionPool_GetStats(tssContext, &stats);
+    if (rc != 0) {
+	return printFailure(argv[0], rc);
+    }
+    printf("leases %u hits %u starts %u saves %u loads %u flushes %u\n",
+	   stats.leases, stats.hits, stats.starts, stats.saves, stats.loads, stats.flushes);
+    return 0;
+}
+
+static void printUsage(void)
+{
+    size_t	c;
+    
+    printf("\n");
+    printf("tssbatch\n");
+    printf("\n");
+    printf("Runs a script of TSS utility commands in one TSS context\n");
+    printf("\n");
+    printf("\t-if script file, one command and its arguments per line, at most %u bytes\n",
+	   BATCH_LINE_MAX);
+    printf("\t\t# starts a comment line\n");
+    printf("\t[-k continue after a command fails (default stop)]\n");
+    printf("\t[-cache keep session state in memory until exit and cache object names\n");
+    printf("\t\t(default use the TPM_SESSION_CACHE and TPM_NAME_CACHE properties)]\n");
+    printf("\t\tOther programs must not use the script's sessions while it runs.\n");
+    printf("\n");
+    printf("The supported commands are:\n");
+    printf("\n");
+    for (c = 0 ; c < sizeof(batchCommandTable) / sizeof(BATCH_COMMAND) ; c++) {
+	printf("\t%s\n", batchCommandTable[c].name);
+    }
+    exit(1);	
+}
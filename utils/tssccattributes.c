@@ -47,9 +47,59 @@
 #include <string.h>
 #include <inttypes.h>
 
+#ifdef TPM_POSIX
+#include <pthread.h>
+#endif
+#ifdef TPM_WINDOWS
+#include <windows.h>
+#endif
+
 #include "tssccattributes.h"
 
+/* The TCG command codes are all in the range CC_INDEX_BASE to CC_INDEX_BASE + CC_INDEX_SIZE - 1.
+   ccIndexTable maps the low byte of those command codes directly to the s_ccAttr index.  Other
+   command codes are searched. */
+
+#define CC_INDEX_BASE	0x00000100
+#define CC_INDEX_SIZE	0x100
+
+static COMMAND_INDEX ccIndexTable[CC_INDEX_SIZE];
+#ifdef TPM_POSIX
+static pthread_once_t ccIndexTableOnce = PTHREAD_ONCE_INIT;
+#elif defined TPM_WINDOWS
+static INIT_ONCE ccIndexTableOnce = INIT_ONCE_STATIC_INIT;
+#else
+static int ccIndexTableInit = FALSE;
+#endif
+
+static COMMAND_INDEX CommandCodeToCommandIndexSearch(TPM_CC commandCode);
+static void CommandIndexTableInit(void);
+#ifdef TPM_WINDOWS
+static BOOL CALLBACK CommandIndexTableInitOnce(PINIT_ONCE initOnce, PVOID parameter, PVOID *context);
+#endif
+
 COMMAND_INDEX CommandCodeToCommandIndex(TPM_CC commandCode)
+{
+    /* the table is built once, at the first call from any thread */
+#ifdef TPM_POSIX
+    pthread_once(&ccIndexTableOnce, CommandIndexTableInit);
+#elif defined TPM_WINDOWS
+    InitOnceExecuteOnce(&ccIndexTableOnce, CommandIndexTableInitOnce, NULL, NULL);
+#else
+    if (!ccIndexTableInit) {
+	CommandIndexTableInit();
+	ccIndexTableInit = TRUE;
+    }
+#endif
+    if ((commandCode >= CC_INDEX_BASE) && (commandCode < (CC_INDEX_BASE + CC_INDEX_SIZE))) {
+	return ccIndexTable[commandCode - CC_INDEX_BASE];
+    }
+    return CommandCodeToCommandIndexSearch(commandCode);
+}
+
+/* CommandCodeToCommandIndexSearch() searches s_ccAttr for the command code */
+
+static COMMAND_INDEX CommandCodeToCommandIndexSearch(TPM_CC commandCode)
 {
     COMMAND_INDEX i;
 
@@ -62,6 +112,34 @@ COMMAND_INDEX CommandCodeToCommandIndex(TPM_CC commandCode)
     return UNIMPLEMENTED_COMMAND_INDEX;
 }
 
+/* CommandIndexTableInit() builds the direct index table from s_ccAttr */
+
+static void CommandIndexTableInit(void)
+{
+    TPM_CC commandCode;
+
+    for (commandCode = CC_INDEX_BASE ; commandCode < (CC_INDEX_BASE + CC_INDEX_SIZE) ;
+	 commandCode++) {
+	ccIndexTable[commandCode - CC_INDEX_BASE] = CommandCodeToCommandIndexSearch(commandCode);
+    }
+    return;
+}
+
+#ifdef TPM_WINDOWS
+
+/* CommandIndexTableInitOnce() is the InitOnceExecuteOnce() callback for CommandIndexTableInit() */
+
+static BOOL CALLBACK CommandIndexTableInitOnce(PINIT_ONCE initOnce, PVOID parameter, PVOID *context)
+{
+    initOnce = initOnce;
+    parameter = parameter;
+    context = context;
+    CommandIndexTableInit();
+    return TRUE;
+}
+
+#endif
+
 uint32_t getCommandHandleCount(COMMAND_INDEX index)
 {
     return s_ccAttr[index].cHandles;
@@ -42,9 +42,11 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #ifdef TPM_POSIX
 #include <netinet/in.h>
+#include <pthread.h>
 #endif
 #ifdef TPM_WINDOWS
 #include <winsock2.h>
@@ -75,6 +77,16 @@ static TPM_RC TSS_Hash_GetMd(const EVP_MD **md,
 			     TPMI_ALG_HASH hashAlg);
 static TPM_RC TSS_ECC_GeneratePlatformEphemeralKey(CURVE_DATA *eCurveData,
 						   EC_KEY *myecc);
+#ifdef TPM_POSIX
+static void *TSS_ECC_PoolThread(void *arg);
+static TPM_RC TSS_ECC_PoolGenerate(EC_KEY **myecc);
+static void TSS_ECC_PoolEmpty(void);
+static void TSS_ECC_PoolAtFork(void);
+static void TSS_ECC_PoolPrepare(void);
+static void TSS_ECC_PoolParent(void);
+static void TSS_ECC_PoolChild(void);
+#endif
+static EC_KEY *TSS_ECC_PoolGet(void);
 static TPM_RC TSS_BN_new(BIGNUM **bn);
 static TPM_RC TSS_BN_hex2bn(BIGNUM **bn, const char *str);
 static TPM_RC TSS_bin2bn(BIGNUM **bn, const unsigned char *bin, unsigned int bytes);
@@ -137,40 +149,107 @@ static TPM_RC TSS_Hash_GetMd(const EVP_MD **md,
 TPM_RC TSS_HMAC_Generate_valist(TPMT_HA *digest,		/* largest size of a digest */
 				const TPM2B_KEY *hmacKey,
 				va_list ap)
+{
+    TPM_RC		rc = 0;
+    void 		*hmacKeyCtx = NULL;
+
+    if (rc == 0) {
+	rc = TSS_HMAC_KeyCreate(&hmacKeyCtx, digest->hashAlg, hmacKey);
+    }
+    if (rc == 0) {
+	rc = TSS_HMAC_GenerateKeyed_valist(digest, hmacKeyCtx, ap);
+    }
+    TSS_HMAC_KeyDelete(hmacKeyCtx);
+    return rc;
+}
+
+/* TSS_HMAC_KeyCreate() allocates an HMAC context and keys it with hmacKey.  The inner and outer
+   pad digests are calculated once here.  TSS_HMAC_GenerateKeyed() then starts each HMAC from a
+   copy of that state, without re-keying.
+
+   The context must be freed by the caller using TSS_HMAC_KeyDelete().
+*/
+
+TPM_RC TSS_HMAC_KeyCreate(void **hmacKeyCtx,		/* freed by caller */
+			  TPMI_ALG_HASH hashAlg,
+			  const TPM2B_KEY *hmacKey)
 {
     TPM_RC		rc = 0;
     int 		irc = 0;
-    int			done = FALSE;
     const EVP_MD 	*md;	/* message digest method */
-#if OPENSSL_VERSION_NUMBER < 0x10100000
-    HMAC_CTX 		ctx;
-#else
-    HMAC_CTX 		*ctx;
-#endif
-    int			length;
-    uint8_t 		*buffer;
-    
-#if OPENSSL_VERSION_NUMBER < 0x10100000
-    HMAC_CTX_init(&ctx);
-#else
-    ctx = HMAC_CTX_new();
-#endif
+    HMAC_CTX 		*ctx = NULL;
+
     if (rc == 0) {
-	rc = TSS_Hash_GetMd(&md, digest->hashAlg);
+	rc = TSS_Hash_GetMd(&md, hashAlg);
     }
     if (rc == 0) {
 #if OPENSSL_VERSION_NUMBER < 0x10100000
-	irc = HMAC_Init_ex(&ctx,
-			   hmacKey->b.buffer, hmacKey->b.size,	/* HMAC key */
-			   md,					/* message digest method */
-			   NULL);
+	ctx = malloc(sizeof(HMAC_CTX));
+	if (ctx != NULL) {
+	    HMAC_CTX_init(ctx);
+	}
 #else
+	ctx = HMAC_CTX_new();
+#endif
+	if (ctx == NULL) {
+	    if (tssVerbose) printf("TSS_HMAC_KeyCreate: Error allocating HMAC context\n");
+	    rc = TSS_RC_OUT_OF_MEMORY;
+	}
+    }
+    if (rc == 0) {
 	irc = HMAC_Init_ex(ctx,
 			   hmacKey->b.buffer, hmacKey->b.size,	/* HMAC key */
 			   md,					/* message digest method */
 			   NULL);
+	if (irc == 0) {
+	    rc = TSS_RC_HMAC;
+	}
+    }
+    if (rc == 0) {
+	*hmacKeyCtx = ctx;
+    }
+    else {
+	TSS_HMAC_KeyDelete(ctx);
+    }
+    return rc;
+}
+
+/* TSS_HMAC_KeyDelete() frees an HMAC context allocated by TSS_HMAC_KeyCreate().  NULL is
+   ignored. */
+
+void TSS_HMAC_KeyDelete(void *hmacKeyCtx)
+{
+    if (hmacKeyCtx != NULL) {
+#if OPENSSL_VERSION_NUMBER < 0x10100000
+	HMAC_CTX_cleanup(hmacKeyCtx);
+	free(hmacKeyCtx);
+#else
+	HMAC_CTX_free(hmacKeyCtx);
 #endif
-	
+    }
+    return;
+}
+
+/* TSS_HMAC_GenerateKeyed_valist() calculates an HMAC using a context from TSS_HMAC_KeyCreate().
+   The hash algorithm is the one used to create the context.
+
+   length 0 is ignored, buffer NULL terminates list.
+*/
+
+TPM_RC TSS_HMAC_GenerateKeyed_valist(TPMT_HA *digest,		/* largest size of a digest */
+				     void *hmacKeyCtx,
+				     va_list ap)
+{
+    TPM_RC		rc = 0;
+    int 		irc = 0;
+    int			done = FALSE;
+    HMAC_CTX 		*ctx = hmacKeyCtx;
+    int			length;
+    uint8_t 		*buffer;
+
+    /* a NULL key and method restart from the saved inner pad state */
+    if (rc == 0) {
+	irc = HMAC_Init_ex(ctx, NULL, 0, NULL, NULL);
 	if (irc == 0) {
 	    rc = TSS_RC_HMAC;
 	}
@@ -184,11 +263,7 @@ TPM_RC TSS_HMAC_Generate_valist(TPMT_HA *digest,		/* largest size of a digest */
 		rc = TSS_RC_HMAC;
 	    }
 	    else {
-#if OPENSSL_VERSION_NUMBER < 0x10100000
-		irc = HMAC_Update(&ctx, buffer, length);
-#else
 		irc = HMAC_Update(ctx, buffer, length);
-#endif
 		if (irc == 0) {
 		    if (tssVerbose) printf("TSS_HMAC_Generate: HMAC_Update failed\n");
 		    rc = TSS_RC_HMAC;
@@ -199,22 +274,12 @@ TPM_RC TSS_HMAC_Generate_valist(TPMT_HA *digest,		/* largest size of a digest */
 	    done = TRUE;
 	}
     }
-
     if (rc == 0) {
-#if OPENSSL_VERSION_NUMBER < 0x10100000
-	irc = HMAC_Final(&ctx, (uint8_t *)&digest->digest, NULL);
-#else
 	irc = HMAC_Final(ctx, (uint8_t *)&digest->digest, NULL);
-#endif
 	if (irc == 0) {
 	    rc = TSS_RC_HMAC;
 	}
     }
-#if OPENSSL_VERSION_NUMBER < 0x10100000
-    HMAC_CTX_cleanup(&ctx);
-#else
-    HMAC_CTX_free(ctx);
-#endif
     return rc;
 }
 
@@ -276,6 +341,69 @@ TPM_RC TSS_Hash_Generate_valist(TPMT_HA *digest,		/* largest size of a digest */
     return rc;
 }
 
+/* TSS_Hash_ExtendBatch() performs count PCR extend calculations, in order:
+
+   pcrs[i] = H(pcrs[i] || extend[i])
+
+   where H is pcrs[i]->hashAlg.  The pcrs need not be distinct, so this can extend a sequence of
+   events into one PCR, or one event from each of several independent logs.
+
+   One digest context is reused for the whole batch, and the message digest method is looked up
+   only when the hash algorithm changes.
+*/
+
+TPM_RC TSS_Hash_ExtendBatch(TPMT_HA *pcrs[],
+			    const uint8_t *extend[],
+			    const uint16_t extendSize[],
+			    size_t count)
+{
+    TPM_RC		rc = 0;
+    int			irc = 0;
+    size_t		i;
+    EVP_MD_CTX 		*mdctx = NULL;
+    const EVP_MD 	*md = NULL;
+    TPMI_ALG_HASH	mdHashAlg = TPM_ALG_NULL;	/* algorithm of md */
+    uint16_t		digestSize = 0;
+
+    if (rc == 0) {
+	mdctx = EVP_MD_CTX_create();
+        if (mdctx == NULL) {
+	    if (tssVerbose) printf("TSS_Hash_ExtendBatch: malloc EVP_MD_CTX failed\n");
+	    rc = TSS_RC_OUT_OF_MEMORY;
+	}
+    }
+    for (i = 0 ; (rc == 0) && (i < count) ; i++) {
+	if (pcrs[i]->hashAlg != mdHashAlg) {
+	    rc = TSS_Hash_GetMd(&md, pcrs[i]->hashAlg);
+	    if (rc == 0) {
+		mdHashAlg = pcrs[i]->hashAlg;
+		digestSize = TSS_GetDigestSize(mdHashAlg);
+	    }
+	}
+	if (rc == 0) {
+	    irc = EVP_DigestInit_ex(mdctx, md, NULL);
+	    if (irc == 1) {
+		irc = EVP_DigestUpdate(mdctx, (uint8_t *)&pcrs[i]->digest, digestSize);
+	    }
+	    if (irc == 1) {
+		irc = EVP_DigestUpdate(mdctx, extend[i], extendSize[i]);
+	    }
+	    if (irc == 1) {
+		irc = EVP_DigestFinal_ex(mdctx, (uint8_t *)&pcrs[i]->digest, NULL);
+	    }
+	    if (irc != 1) {
+		if (tssVerbose) printf("TSS_Hash_ExtendBatch: extend %lu failed\n",
+				       (unsigned long)i);
+		rc = TSS_RC_HASH;
+	    }
+	}
+    }
+    if (mdctx != NULL) {
+	EVP_MD_CTX_destroy(mdctx);
+    }
+    return rc;
+}
+
 /* Random Numbers */
 
 TPM_RC TSS_RandBytes(unsigned char *buffer, uint32_t size)
@@ -364,16 +492,8 @@ TPM_RC TSS_RSAPublicEncrypt(unsigned char *encrypt_data,    /* encrypted data */
 			    TPMI_ALG_HASH halg)		/* OAEP hash algorithm */
 {
     TPM_RC  	rc = 0;
-    int         irc;
     RSA         *rsa_pub_key = NULL;
-    unsigned char *padded_data = NULL;
     
-    if (tssVverbose) printf(" TSS_RSAPublicEncrypt: Input data size %lu\n",
-			    (unsigned long)decrypt_data_size);
-    /* intermediate buffer for the decrypted but still padded data */
-    if (rc == 0) {
-        rc = TSS_Malloc(&padded_data, encrypt_data_size);               /* freed @2 */
-    }
     /* construct the OpenSSL public key object */
     if (rc == 0) {
 	rc = TSS_RSAGeneratePublicToken(&rsa_pub_key,	/* freed @1 */
@@ -382,6 +502,47 @@ TPM_RC TSS_RSAPublicEncrypt(unsigned char *encrypt_data,    /* encrypted data */
 					earr,      	/* public exponent */
 					ebytes);
     }
+    if (rc == 0) {
+	rc = TSS_RSAPublicEncryptKeyed(encrypt_data,
+				       encrypt_data_size,
+				       decrypt_data,
+				       decrypt_data_size,
+				       rsa_pub_key,
+				       p,
+				       pl,
+				       halg);
+    }
+    if (rsa_pub_key != NULL) {
+        RSA_free(rsa_pub_key);          /* @1 */
+    }
+    return rc;
+}
+
+/* TSS_RSAPublicEncryptKeyed() is TSS_RSAPublicEncrypt() using a public key previously constructed
+   by TSS_RSAGeneratePublicToken().  It lets a caller that encrypts repeatedly to the same key, such
+   as the salt key cache, skip the bignum conversion.
+*/
+
+TPM_RC TSS_RSAPublicEncryptKeyed(unsigned char *encrypt_data,	/* encrypted data */
+				 size_t encrypt_data_size,	/* size of encrypted data buffer */
+				 const unsigned char *decrypt_data,	/* decrypted data */
+				 size_t decrypt_data_size,
+				 void *rsaKey,			/* RSA public key token */
+				 unsigned char *p,		/* encoding parameter */
+				 int pl,
+				 TPMI_ALG_HASH halg)		/* OAEP hash algorithm */
+{
+    TPM_RC  	rc = 0;
+    int         irc;
+    RSA         *rsa_pub_key = rsaKey;
+    unsigned char *padded_data = NULL;
+    
+    if (tssVverbose) printf(" TSS_RSAPublicEncrypt: Input data size %lu\n",
+			    (unsigned long)decrypt_data_size);
+    /* intermediate buffer for the decrypted but still padded data */
+    if (rc == 0) {
+        rc = TSS_Malloc(&padded_data, encrypt_data_size);               /* freed @2 */
+    }
     if (rc == 0) {
 	padded_data[0] = 0x00;
 	rc = TSS_RSA_padding_add_PKCS1_OAEP(padded_data,		/* to */
@@ -414,13 +575,18 @@ TPM_RC TSS_RSAPublicEncrypt(unsigned char *encrypt_data,    /* encrypted data */
     if (rc == 0) {
         if (tssVverbose) printf("  TSS_RSAPublicEncrypt: RSA_public_encrypt() success\n");
     }
-    if (rsa_pub_key != NULL) {
-        RSA_free(rsa_pub_key);          /* @1 */
-    }
     free(padded_data);                  /* @2 */
     return rc;
 }
 
+/* TSS_RSAPublicKeyDelete() frees a public key token from TSS_RSAGeneratePublicToken() */
+
+void TSS_RSAPublicKeyDelete(void *rsaKey)
+{
+    RSA_free(rsaKey);		/* RSA_free() accepts NULL */
+    return;
+}
+
 /* TSS_GeneratePlatformEphemeralKey sets the EC parameters to NIST P256 for generating the ephemeral
    key. Some OpenSSL versions do not come with NIST p256.  */
 
@@ -559,6 +725,7 @@ static TPM_RC TSS_ECC_GeneratePlatformEphemeralKey(CURVE_DATA *eCurveData, EC_KE
     if (b != NULL) 	BN_clear_free(b);	/* @3 */
     if (rc != 0) {
 	EC_GROUP_free(eCurveData->G);	/* @4 */	
+	eCurveData->G = NULL;
 	EC_POINT_free(G);		/* @5  */
     }
     if (x != NULL)	BN_clear_free(x);	/* @6 */
@@ -572,6 +739,280 @@ static TPM_RC TSS_ECC_GeneratePlatformEphemeralKey(CURVE_DATA *eCurveData, EC_KE
     return rc;
 }
 
+/*
+  ECC ephemeral key pool
+*/
+
+/* The ephemeral key pool holds NIST P256 key pairs generated ahead of time by a background thread,
+   so that TSS_ECC_Salt() does not generate a key on the caller's path.  NIST P256 is the only curve
+   TSS_ECC_Salt() supports.
+
+   The pool is process wide.  Each TSS_CONTEXT that sets the TPM_ECC_SALT_POOL property holds a
+   reference, and the last TSS_Delete() stops the thread and frees the keys.  Each key is used once
+   and then freed.  A forked child starts with an empty pool and no thread, so parent and child
+   never share a key.  When the pool is empty, or on a platform without pthreads, TSS_ECC_Salt()
+   generates the key itself.
+*/
+
+#ifndef TSS_ECC_POOL_MAX
+#define TSS_ECC_POOL_MAX	64	/* maximum pooled keys */
+#endif
+
+#ifdef TPM_POSIX
+static EC_KEY *tssEccPool[TSS_ECC_POOL_MAX];
+static uint32_t tssEccPoolCount;	/* keys in the pool */
+static uint32_t tssEccPoolTarget;	/* keys the thread keeps in the pool */
+static uint32_t tssEccPoolUsers;	/* TSS_ECC_PoolStart() calls not yet stopped */
+static int tssEccPoolRunning;		/* TRUE while the refill thread is refilling */
+static int tssEccPoolJoin;		/* TRUE while the refill thread has not been joined */
+static int tssEccPoolStop;		/* TRUE when the refill thread should exit */
+static pthread_t tssEccPoolThread;
+static pthread_mutex_t tssEccPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t tssEccPoolControl = PTHREAD_MUTEX_INITIALIZER;	/* serializes start, stop */
+static pthread_cond_t tssEccPoolRefill = PTHREAD_COND_INITIALIZER;
+static pthread_once_t tssEccPoolOnce = PTHREAD_ONCE_INIT;
+#endif
+
+/* TSS_ECC_PoolStart() adds a reference to the pool, starts the refill thread if it is not running,
+   and raises the pool size to 'poolSize' keys, at most TSS_ECC_POOL_MAX.  The pool never shrinks
+   until the matching TSS_ECC_PoolStop() of the last reference. */
+
+TPM_RC TSS_ECC_PoolStart(uint32_t poolSize)
+{
+    TPM_RC	rc = 0;
+#ifdef TPM_POSIX
+    int		irc;
+
+    if (poolSize > TSS_ECC_POOL_MAX) {
+	poolSize = TSS_ECC_POOL_MAX;
+    }
+    pthread_once(&tssEccPoolOnce, TSS_ECC_PoolAtFork);
+    pthread_mutex_lock(&tssEccPoolControl);
+    pthread_mutex_lock(&tssEccPoolMutex);
+    if (poolSize > tssEccPoolTarget) {
+	tssEccPoolTarget = poolSize;
+	pthread_cond_signal(&tssEccPoolRefill);
+    }
+    /* a thread that exited on an error is joined and replaced */
+    if (!tssEccPoolRunning && tssEccPoolJoin) {
+	pthread_join(tssEccPoolThread, NULL);
+	tssEccPoolJoin = FALSE;
+    }
+    if (!tssEccPoolRunning && (tssEccPoolTarget > 0)) {
+	tssEccPoolStop = FALSE;
+	irc = pthread_create(&tssEccPoolThread, NULL, TSS_ECC_PoolThread, NULL);
+	if (irc == 0) {
+	    if (tssVverbose) printf("TSS_ECC_PoolStart: Started, %u keys\n", tssEccPoolTarget);
+	    tssEccPoolRunning = TRUE;
+	    tssEccPoolJoin = TRUE;
+	}
+	else {
+	    if (tssVerbose) printf("TSS_ECC_PoolStart: Error, pthread_create %d\n", irc);
+	    rc = TSS_RC_EC_EPHEMERAL_FAILURE;
+	}
+    }
+    if (rc == 0) {
+	tssEccPoolUsers++;
+    }
+    pthread_mutex_unlock(&tssEccPoolMutex);
+    pthread_mutex_unlock(&tssEccPoolControl);
+#else
+    poolSize = poolSize;
+#endif
+    return rc;
+}
+
+/* TSS_ECC_PoolStop() removes a reference added by TSS_ECC_PoolStart().  The last one stops the
+   refill thread and frees the unused keys.  TSS_Delete() calls it for a context that set
+   TPM_ECC_SALT_POOL. */
+
+void TSS_ECC_PoolStop(void)
+{
+#ifdef TPM_POSIX
+    int		last = FALSE;
+    int		join = FALSE;
+
+    pthread_mutex_lock(&tssEccPoolControl);
+    pthread_mutex_lock(&tssEccPoolMutex);
+    if (tssEccPoolUsers > 0) {
+	tssEccPoolUsers--;
+	last = (tssEccPoolUsers == 0);
+    }
+    if (last) {
+	join = tssEccPoolJoin;
+	tssEccPoolStop = TRUE;
+	pthread_cond_signal(&tssEccPoolRefill);
+    }
+    pthread_mutex_unlock(&tssEccPoolMutex);
+    /* the refill thread needs the pool lock to exit, but never takes the control lock */
+    if (join) {
+	pthread_join(tssEccPoolThread, NULL);
+    }
+    if (last) {
+	pthread_mutex_lock(&tssEccPoolMutex);
+	TSS_ECC_PoolEmpty();
+	tssEccPoolTarget = 0;
+	tssEccPoolRunning = FALSE;
+	tssEccPoolJoin = FALSE;
+	tssEccPoolStop = FALSE;
+	pthread_mutex_unlock(&tssEccPoolMutex);
+    }
+    pthread_mutex_unlock(&tssEccPoolControl);
+#endif
+    return;
+}
+
+#ifdef TPM_POSIX
+
+/* TSS_ECC_PoolEmpty() frees the pooled keys.  The caller holds the lock. */
+
+static void TSS_ECC_PoolEmpty(void)
+{
+    while (tssEccPoolCount > 0) {
+	tssEccPoolCount--;
+	EC_KEY_free(tssEccPool[tssEccPoolCount]);	/* clears the private key */
+	tssEccPool[tssEccPoolCount] = NULL;
+    }
+    return;
+}
+
+/* TSS_ECC_PoolAtFork() registers the fork handlers once.  The locks are held across fork() so
+   that the child never inherits them locked by another thread. */
+
+static void TSS_ECC_PoolAtFork(void)
+{
+    int		irc;
+
+    irc = pthread_atfork(TSS_ECC_PoolPrepare, TSS_ECC_PoolParent, TSS_ECC_PoolChild);
+    if (irc != 0) {
+	if (tssVerbose) printf("TSS_ECC_PoolAtFork: Error, pthread_atfork %d\n", irc);
+    }
+    return;
+}
+
+static void TSS_ECC_PoolPrepare(void)
+{
+    pthread_mutex_lock(&tssEccPoolControl);
+    pthread_mutex_lock(&tssEccPoolMutex);
+    return;
+}
+
+static void TSS_ECC_PoolParent(void)
+{
+    pthread_mutex_unlock(&tssEccPoolMutex);
+    pthread_mutex_unlock(&tssEccPoolControl);
+    return;
+}
+
+/* TSS_ECC_PoolChild() discards the pool in a forked child.  The parent may still use the keys, and
+   the refill thread does not exist in the child.  The child generates its keys inline until it
+   calls TSS_ECC_PoolStart() again. */
+
+static void TSS_ECC_PoolChild(void)
+{
+    TSS_ECC_PoolEmpty();
+    tssEccPoolRunning = FALSE;
+    tssEccPoolJoin = FALSE;
+    tssEccPoolStop = FALSE;
+    tssEccPoolTarget = 0;
+    pthread_mutex_unlock(&tssEccPoolMutex);
+    pthread_mutex_unlock(&tssEccPoolControl);
+    return;
+}
+
+#endif	/* TPM_POSIX */
+
+/* TSS_ECC_PoolGet() removes a key from the pool and wakes the refill thread.  It returns NULL if the
+   pool is empty. */
+
+static EC_KEY *TSS_ECC_PoolGet(void)
+{
+    EC_KEY	*myecc = NULL;
+
+#ifdef TPM_POSIX
+    pthread_mutex_lock(&tssEccPoolMutex);
+    if (tssEccPoolCount > 0) {
+	tssEccPoolCount--;
+	myecc = tssEccPool[tssEccPoolCount];
+	tssEccPool[tssEccPoolCount] = NULL;
+	pthread_cond_signal(&tssEccPoolRefill);
+    }
+    pthread_mutex_unlock(&tssEccPoolMutex);
+#endif
+    return myecc;
+}
+
+#ifdef TPM_POSIX
+
+/* TSS_ECC_PoolThread() keeps the pool filled to the target.  The keys are generated without
+   holding the lock.  The thread exits on TSS_ECC_PoolStop() or if a key cannot be generated, after
+   which TSS_ECC_Salt() generates its own keys until the next TSS_ECC_PoolStart(). */
+
+static void *TSS_ECC_PoolThread(void *arg)
+{
+    TPM_RC	rc = 0;
+    EC_KEY	*myecc;
+
+    arg = arg;
+    pthread_mutex_lock(&tssEccPoolMutex);
+    while ((rc == 0) && !tssEccPoolStop) {
+	if (tssEccPoolCount >= tssEccPoolTarget) {
+	    pthread_cond_wait(&tssEccPoolRefill, &tssEccPoolMutex);
+	    continue;
+	}
+	pthread_mutex_unlock(&tssEccPoolMutex);
+	myecc = NULL;
+	rc = TSS_ECC_PoolGenerate(&myecc);
+	pthread_mutex_lock(&tssEccPoolMutex);
+	if ((rc == 0) && (tssEccPoolCount < TSS_ECC_POOL_MAX)) {
+	    tssEccPool[tssEccPoolCount] = myecc;
+	    tssEccPoolCount++;
+	}
+	else if (myecc != NULL) {
+	    EC_KEY_free(myecc);
+	}
+    }
+    tssEccPoolRunning = FALSE;		/* the next TSS_ECC_PoolStart() joins and restarts */
+    pthread_mutex_unlock(&tssEccPoolMutex);
+    if (rc != 0) {
+	if (tssVerbose) printf("TSS_ECC_PoolThread: Error %08x, refill stopped\n", rc);
+    }
+    return NULL;
+}
+
+/* TSS_ECC_PoolGenerate() generates one ephemeral key pair for the pool */
+
+static TPM_RC TSS_ECC_PoolGenerate(EC_KEY **myecc)
+{
+    TPM_RC	rc = 0;
+    CURVE_DATA 	eCurveData;
+
+    eCurveData.G = NULL;
+    eCurveData.ctx = NULL;
+    if (rc == 0) {
+	*myecc = EC_KEY_new();		/* freed by caller */
+	if (*myecc == NULL) {
+	    if (tssVerbose) printf("TSS_ECC_PoolGenerate: EC_KEY_new failed\n");
+	    rc = TSS_RC_OUT_OF_MEMORY;
+	}
+    }
+    if (rc == 0) {
+	eCurveData.ctx = BN_CTX_new();	/* freed @1 */
+	if (eCurveData.ctx == NULL) {
+	    if (tssVerbose) printf("TSS_ECC_PoolGenerate: BN_CTX_new failed\n");
+	    rc = TSS_RC_OUT_OF_MEMORY;
+	}
+    }
+    if (rc == 0) {
+	rc = TSS_ECC_GeneratePlatformEphemeralKey(&eCurveData, *myecc);	/* G freed @2 */
+    }
+    if (eCurveData.G != NULL)	EC_GROUP_free(eCurveData.G);	/* @2 */
+    if (eCurveData.ctx != NULL)	BN_CTX_free(eCurveData.ctx);	/* @1 */
+    return rc;
+}
+
+#endif	/* TPM_POSIX */
+
 /* TSS_ECC_Salt() returns both the plaintext and excrypted salt, based on the salt key bPublic. */
 
 TPM_RC TSS_ECC_Salt(TPM2B_DIGEST 		*salt,
@@ -607,6 +1048,9 @@ TPM_RC TSS_ECC_Salt(TPM2B_DIGEST 		*salt,
     TPM2B_ECC_PARAMETER	p_tpmX_For_KDFE;
     CURVE_DATA 		eCurveData;
 
+    eCurveData.G = NULL;
+    eCurveData.ctx = NULL;
+
     /* only NIST P256 is currently supported */
     if (rc == 0) {
 	if ((publicArea->parameters.eccDetail.curveID != TPM_ECC_NIST_P256)) {
@@ -616,13 +1060,6 @@ TPM_RC TSS_ECC_Salt(TPM2B_DIGEST 		*salt,
 	    rc = TSS_RC_BAD_SALT_KEY;
 	}
     }
-    if (rc == 0) {
-	myecc = EC_KEY_new();		/* freed @1 */
-	if (myecc == NULL) {
-	    if (tssVerbose) printf("TSS_ECC_Salt: EC_KEY_new failed\n");
-	    rc = TSS_RC_OUT_OF_MEMORY;
-	}
-    }
     if (rc == 0) {
 	eCurveData.ctx = BN_CTX_new();	/* freed @16 */
 	if (eCurveData.ctx == NULL) {
@@ -630,12 +1067,32 @@ TPM_RC TSS_ECC_Salt(TPM2B_DIGEST 		*salt,
 	    rc = TSS_RC_OUT_OF_MEMORY;
 	}
     }
-    /* Generate the TSS EC ephemeral key pair outside the TPM for the salt. The public part of this
-       key is actually the 'encrypted' salt. */
+    /* use a pregenerated key pair if the pool has one.  The group is copied because the salt
+       calculation below changes its generator. */
     if (rc == 0) {
-	if (tssVverbose) printf("TSS_ECC_Salt: "
-				"Calling TSS_ECC_GeneratePlatformEphemeralKey\n"); 
-	rc = TSS_ECC_GeneratePlatformEphemeralKey(&eCurveData, myecc);
+	myecc = TSS_ECC_PoolGet();	/* freed @1 */
+	if (myecc != NULL) {
+	    if (tssVverbose) printf("TSS_ECC_Salt: Using pooled ephemeral key\n");
+	    eCurveData.G = EC_GROUP_dup(EC_KEY_get0_group(myecc));	/* freed @17 */
+	    if (eCurveData.G == NULL) {
+		if (tssVerbose) printf("TSS_ECC_Salt: EC_GROUP_dup failed\n");
+		rc = TSS_RC_OUT_OF_MEMORY;
+	    }
+	}
+    }
+    if ((rc == 0) && (myecc == NULL)) {
+	myecc = EC_KEY_new();		/* freed @1 */
+	if (myecc == NULL) {
+	    if (tssVerbose) printf("TSS_ECC_Salt: EC_KEY_new failed\n");
+	    rc = TSS_RC_OUT_OF_MEMORY;
+	}
+	/* Generate the TSS EC ephemeral key pair outside the TPM for the salt. The public part of
+	   this key is actually the 'encrypted' salt. */
+	if (rc == 0) {
+	    if (tssVverbose) printf("TSS_ECC_Salt: "
+				    "Calling TSS_ECC_GeneratePlatformEphemeralKey\n"); 
+	    rc = TSS_ECC_GeneratePlatformEphemeralKey(&eCurveData, myecc);	/* G freed @17 */
+	}
     }
     if (rc == 0) {
 	d_caller = EC_KEY_get0_private_key(myecc);		/* ephemeral private key */
@@ -995,6 +1452,7 @@ TPM_RC TSS_ECC_Salt(TPM2B_DIGEST 		*salt,
     free(p_tpmXbin);						/* @14 */
     if (bigY != NULL)           BN_clear_free(bigY);		/* @15 */
     if (eCurveData.ctx != NULL)	BN_CTX_free(eCurveData.ctx);	/* @16 */
+    if (eCurveData.G != NULL)	EC_GROUP_free(eCurveData.G);	/* @17 */
     return rc;
 }
 
@@ -131,6 +131,52 @@ TPM_RC TSS_HMAC_Verify(TPMT_HA *expect,
     return rc;
 }
 
+/* TSS_HMAC_GenerateKeyed() is TSS_HMAC_Generate() using a context from TSS_HMAC_KeyCreate().  It
+   is used when many HMACs are calculated with the same key.
+*/
+
+TPM_RC TSS_HMAC_GenerateKeyed(TPMT_HA *digest,		/* largest size of a digest */
+			      void *hmacKeyCtx,
+			      ...)
+{
+    TPM_RC		rc = 0;
+    va_list		ap;
+    
+    va_start(ap, hmacKeyCtx);
+    rc = TSS_HMAC_GenerateKeyed_valist(digest, hmacKeyCtx, ap);
+    va_end(ap);
+    return rc;
+}
+
+/* TSS_HMAC_VerifyKeyed() is TSS_HMAC_Verify() using a context from TSS_HMAC_KeyCreate(). */
+
+TPM_RC TSS_HMAC_VerifyKeyed(TPMT_HA *expect,
+			    void *hmacKeyCtx,
+			    uint32_t sizeInBytes,
+			    ...)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+    va_list		ap;
+    TPMT_HA 		actual;
+
+    actual.hashAlg = expect->hashAlg;	/* algorithm for the HMAC calculation */
+    va_start(ap, sizeInBytes);
+    if (rc == 0) {
+	rc = TSS_HMAC_GenerateKeyed_valist(&actual, hmacKeyCtx, ap);
+    }
+    if (rc == 0) {
+	irc = memcmp((uint8_t *)&expect->digest, &actual.digest, sizeInBytes);
+	if (irc != 0) {
+	    TSS_PrintAll("TSS_HMAC_VerifyKeyed: calculated HMAC",
+			 (uint8_t *)&actual.digest, sizeInBytes);
+	    rc = TSS_RC_HMAC_VERIFY;
+	}
+    }
+    va_end(ap);
+    return rc;
+}
+
 /* TSS_KDFA() 11.4.9	Key Derivation Function
 
    As defined in SP800-108, the inner loop for building the key stream is:
@@ -155,7 +201,7 @@ TPM_RC TSS_KDFA(uint8_t		*keyStream,    	/* OUT: key buffer */
     uint32_t	counter;    			/* counter value */
     uint32_t 	counterNbo;			/* counter in big endian */
     TPMT_HA 	hmac;				/* hmac result for this pass */
-    
+    void 	*hmacKeyCtx = NULL;		/* keyed once for all passes */
 
     if (rc == 0) {
 	hmac.hashAlg = hashAlg;			/* for TSS_HMAC_Generate() */
@@ -165,6 +211,10 @@ TPM_RC TSS_KDFA(uint8_t		*keyStream,    	/* OUT: key buffer */
 	    rc = TSS_RC_KDFA_FAILED;
 	}
     }
+    if (rc == 0) {
+	rc = TSS_HMAC_KeyCreate(&hmacKeyCtx, hashAlg,
+				(const TPM2B_KEY *)key);		/* FIXME */
+    }
     /* Generate required bytes */
     for (stream = keyStream, counter = 1 ;	/* beginning of stream, KDFa counter starts at 1 */
 	 (rc == 0) && bytes > 0 ;				/* bytes left to produce */
@@ -176,17 +226,18 @@ TPM_RC TSS_KDFA(uint8_t		*keyStream,    	/* OUT: key buffer */
 	}
 	counterNbo = htonl(counter);	/* counter for this pass in BE format */
 	    
-	rc = TSS_HMAC_Generate(&hmac,				/* largest size of an HMAC */
-			       (const TPM2B_KEY *)key,		/* FIXME */
-			       sizeof(UINT32), &counterNbo,	/* KDFa i2 counter */
-			       strlen(label) + 1, label,	/* KDFa label, use NUL as the KDFa
-								   00 byte */
-			       contextU->size, contextU->buffer,	/* KDFa Context */
-			       contextV->size, contextV->buffer,	/* KDFa Context */
-			       sizeof(UINT32), &sizeInBitsNbo,		/* KDFa L2 */
-			       0, NULL);
+	rc = TSS_HMAC_GenerateKeyed(&hmac,			/* largest size of an HMAC */
+				    hmacKeyCtx,
+				    sizeof(UINT32), &counterNbo,	/* KDFa i2 counter */
+				    strlen(label) + 1, label,		/* KDFa label, use NUL as the
+									   KDFa 00 byte */
+				    contextU->size, contextU->buffer,	/* KDFa Context */
+				    contextV->size, contextV->buffer,	/* KDFa Context */
+				    sizeof(UINT32), &sizeInBitsNbo,	/* KDFa L2 */
+				    0, NULL);
 	memcpy(stream, &hmac.digest.tssmax, bytesThisPass);
     }
+    TSS_HMAC_KeyDelete(hmacKeyCtx);
     return rc;
 }
 
@@ -47,6 +47,7 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <fcntl.h>
@@ -63,7 +64,8 @@
 static uint32_t TSS_Dev_Open(TSS_CONTEXT *tssContext);
 static uint32_t TSS_Dev_SendCommand(int dev_fd, const uint8_t *buffer, uint16_t length,
 				    const char *message);
-static uint32_t TSS_Dev_ReceiveCommand(int dev_fd, uint8_t *buffer, uint32_t *length);
+static uint32_t TSS_Dev_ReceiveCommand(int dev_fd, uint8_t *buffer, uint32_t *length,
+				       uint32_t *received);
 
 /* global configuration */
 
@@ -73,6 +75,8 @@ extern int tssVerbose;
 /* TSS_Dev_Transmit() transmits the command and receives the response.
 
    Can return device transmit and receive packet errors, but normally returns the TPM response code.
+
+   In non-blocking mode, it waits in poll() until the response is available.
 */
 
 TPM_RC TSS_Dev_Transmit(TSS_CONTEXT *tssContext,
@@ -81,6 +85,36 @@ TPM_RC TSS_Dev_Transmit(TSS_CONTEXT *tssContext,
 			const char *message)
 {
     TPM_RC rc = 0;
+
+    if (rc == 0) {
+	rc = TSS_Dev_Send(tssContext, commandBuffer, written, message);
+    }
+    if (rc == 0) {
+	rc = TSS_Dev_Receive(tssContext, responseBuffer, read);
+    }
+    while (rc == TSS_RC_WOULD_BLOCK) {
+	struct pollfd pollFd;
+	pollFd.fd = tssContext->dev_fd;
+	pollFd.events = POLLIN;
+	if ((poll(&pollFd, 1, -1) < 0) && (errno != EINTR)) {
+	    if (tssVerbose) printf("TSS_Dev_Transmit: poll error %d %s\n",
+				   errno, strerror(errno));
+	    rc = TSS_RC_BAD_CONNECTION;
+	}
+	else {
+	    rc = TSS_Dev_Receive(tssContext, responseBuffer, read);
+	}
+    }
+    return rc;
+}
+
+/* TSS_Dev_Send() sends the command, opening the device on the first transmit */
+
+TPM_RC TSS_Dev_Send(TSS_CONTEXT *tssContext,
+		    const uint8_t *commandBuffer, uint32_t written,
+		    const char *message)
+{
+    TPM_RC rc = 0;
     
     /* open on first transmit */
     if (tssContext->tssFirstTransmit) {	
@@ -95,10 +129,25 @@ TPM_RC TSS_Dev_Transmit(TSS_CONTEXT *tssContext,
     if (rc == 0) {
 	rc = TSS_Dev_SendCommand(tssContext->dev_fd, commandBuffer, written, message);
     }
-    /* receive the response from the dev_fd.  Returns dev_fd errors, malformed response errors.
-       Else returns the TPM response code. */
+    return rc;
+}
+
+/* TSS_Dev_Receive() receives the response to a command sent with TSS_Dev_Send().
+
+   Returns dev_fd errors, malformed response errors.  Else returns the TPM response code.
+
+   In non-blocking mode, returns TSS_RC_WOULD_BLOCK if the complete response is not yet available.
+   The bytes already read are kept in 'responseBuffer' and the next call resumes the read.
+*/
+
+TPM_RC TSS_Dev_Receive(TSS_CONTEXT *tssContext,
+		       uint8_t *responseBuffer, uint32_t *read)
+{
+    TPM_RC rc = 0;
+
     if (rc == 0) {
-	rc = TSS_Dev_ReceiveCommand(tssContext->dev_fd, responseBuffer, read);
+	rc = TSS_Dev_ReceiveCommand(tssContext->dev_fd, responseBuffer, read,
+				    &tssContext->dev_received);
     }
     return rc;
 }
@@ -111,14 +160,20 @@ static uint32_t TSS_Dev_Open(TSS_CONTEXT *tssContext)
     
     if (rc == 0) {
 	if (tssVverbose) printf("TSS_Dev_Open: Opening %s\n", tssContext->tssDevice);
-	tssContext->dev_fd = open(tssContext->tssDevice, O_RDWR);
+	if (!tssContext->tssDeviceNonblock) {
+	    tssContext->dev_fd = open(tssContext->tssDevice, O_RDWR);
+	}
+	/* the response is read when poll() reports the device readable */
+	else {
+	    tssContext->dev_fd = open(tssContext->tssDevice, O_RDWR | O_NONBLOCK);
+	}
 	if (tssContext->dev_fd <= 0) {
 	    if (tssVerbose) printf("TSS_Dev_Open: Error opening %s\n", tssContext->tssDevice);
 	    rc = TSS_RC_NO_CONNECTION;
 	}
     }
     if (rc == 0) {
-	fcntl(tssContext->dev_fd, O_RDONLY | O_NONBLOCK);
+	tssContext->dev_received = 0;
     }
     return rc;
 }
@@ -158,45 +213,67 @@ static uint32_t TSS_Dev_SendCommand(int dev_fd,
    Returns TPM packet error code.
 
    Validates that the packet length and the packet responseSize match 
+
+   'received' is the number of bytes already read.  It is updated if the read would block, and
+   reset to zero when the response is complete or on error.
 */
 
-static uint32_t TSS_Dev_ReceiveCommand(int dev_fd, uint8_t *buffer, uint32_t *length)
+static uint32_t TSS_Dev_ReceiveCommand(int dev_fd, uint8_t *buffer, uint32_t *length,
+				       uint32_t *received)
 {
     uint32_t 	rc = 0;
     int 	irc;
     uint32_t 	responseSize = 0;
     uint32_t 	responseCode = 0;
+    int		done = FALSE;
 
     if (tssVverbose) printf("TSS_Dev_ReceiveCommand:\n");
-    /* read the TPM device */
-    if (rc == 0) {
-	irc = read(dev_fd, buffer, MAX_RESPONSE_SIZE);
-	if (irc <= 0) {
+    /* read the TPM device, resuming after any partial response */
+    while ((rc == 0) && !done) {
+	irc = read(dev_fd, buffer + *received, MAX_RESPONSE_SIZE - *received);
+	if (irc < 0) {
+	    if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+		if (tssVverbose) printf("TSS_Dev_ReceiveCommand: would block after %u bytes\n",
+					*received);
+		return TSS_RC_WOULD_BLOCK;
+	    }
+	    if (tssVerbose) printf("TSS_Dev_ReceiveCommand: read error %d %s\n",
+				   errno, strerror(errno));
 	    rc = TSS_RC_BAD_CONNECTION;
-	    if (irc < 0) {
-		if (tssVerbose) printf("TSS_Dev_ReceiveCommand: read error %d %s\n",
-				       errno, strerror(errno));
+	}
+	else if (irc == 0) {
+	    if (tssVerbose) printf("TSS_Dev_ReceiveCommand: read EOF\n");
+	    rc = TSS_RC_BAD_CONNECTION;
+	}
+	else {
+	    *received += irc;
+	}
+	/* done when the responseSize in the header has been read */
+	if ((rc == 0) &&
+	    (*received >= (sizeof(TPM_ST) + sizeof(uint32_t) + sizeof(uint32_t)))) {
+	    responseSize = ntohl(*(uint32_t *)(buffer + sizeof(TPM_ST)));
+	    if (*received >= responseSize) {
+		done = TRUE;
 	    }
 	}
     }
     if ((rc == 0) && tssVverbose) {
 	TSS_PrintAll("TSS_Dev_ReceiveCommand",
-		     buffer, irc);
+		     buffer, *received);
     }
     /* verify that there is at least a tag, responseSize, and responseCode */
     if (rc == 0) {
-	if ((unsigned int)irc < (sizeof(TPM_ST) + sizeof(uint32_t) + sizeof(uint32_t))) {
-	    if (tssVerbose) printf("TSS_Dev_ReceiveCommand: read bytes %u < header\n", irc);
+	if (responseSize < (sizeof(TPM_ST) + sizeof(uint32_t) + sizeof(uint32_t))) {
+	    if (tssVerbose) printf("TSS_Dev_ReceiveCommand: responseSize %u < header\n",
+				   responseSize);
 	    rc = TSS_RC_MALFORMED_RESPONSE;
 	}
     }
-    /* get responseSize from the packet */
+    /* sanity check against the length actually received */
     if (rc == 0) {
-	responseSize = ntohl(*(uint32_t *)(buffer + sizeof(TPM_ST)));
-	/* sanity check against the length actually received, the return code */
-	if ((uint32_t)irc != responseSize) {
+	if (*received != responseSize) {
 	    if (tssVerbose) printf("TSS_Dev_ReceiveCommand: read bytes %u != responseSize %u\n",
-				   (uint32_t)irc, responseSize);
+				   *received, responseSize);
 	    rc = TSS_RC_BAD_CONNECTION;
 	}
     }
@@ -209,6 +286,7 @@ static uint32_t TSS_Dev_ReceiveCommand(int dev_fd, uint8_t *buffer, uint32_t *le
     }
 	
     *length = responseSize;
+    *received = 0;
     if (tssVverbose) printf("TSS_Dev_ReceiveCommand: rc %08x\n", rc);
     return rc;
 }	
@@ -217,6 +295,7 @@ TPM_RC TSS_Dev_Close(TSS_CONTEXT *tssContext)
 {
     if (tssVverbose) printf("TSS_Dev_Close: Closing %s\n", tssContext->tssDevice);
     close(tssContext->dev_fd);
+    tssContext->dev_received = 0;
     return 0;
 }
 
@@ -52,6 +52,11 @@ extern "C" {
 			    uint8_t *responseBuffer, uint32_t *read,
 			    const uint8_t *commandBuffer, uint32_t written,
 			    const char *message);
+    TPM_RC TSS_Dev_Send(TSS_CONTEXT *tssContext,
+			const uint8_t *commandBuffer, uint32_t written,
+			const char *message);
+    TPM_RC TSS_Dev_Receive(TSS_CONTEXT *tssContext,
+			   uint8_t *responseBuffer, uint32_t *read);
     TPM_RC TSS_Dev_Close(TSS_CONTEXT *tssContext);
 
 #ifdef __cplusplus
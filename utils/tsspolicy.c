@@ -0,0 +1,1047 @@
+/********************************************************************************/
+/*										*/
+/*				      TSS Policy Compiler				*/
+/*			     Written by agent					*/
+/*	      $Id: tsspolicy.c $							*/
+/*										*/
+/* (c) Copyright agent 2026.							*/
+/*										*/
+/* All rights reserved.								*/
+/* 										*/
+/* Redistribution and use in source and binary forms, with or without		*/
+/* modification, are permitted provided that the following conditions are	*/
+/* met:										*/
+/* 										*/
+/* Redistributions of source code must retain the above copyright notice,	*/
+/* this list of conditions and the following disclaimer.			*/
+/* 										*/
+/* Redistributions in binary form must reproduce the above copyright		*/
+/* notice, this list of conditions and the following disclaimer in the		*/
+/* documentation and/or other materials provided with the distribution.		*/
+/* 										*/
+/* Neither the names of the IBM Corporation nor the names of its		*/
+/* contributors may be used to endorse or promote products derived from		*/
+/* this software without specific prior written permission.			*/
+/* 										*/
+/* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS		*/
+/* "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT		*/
+/* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR	*/
+/* A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT		*/
+/* HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,	*/
+/* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT		*/
+/* LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,	*/
+/* DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY	*/
+/* THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT		*/
+/* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE	*/
+/* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.		*/
+/********************************************************************************/
+
+
+/* The policy compiler walks a tree of TSS_POLICY AND lists and PolicyOR terms once, extending
+   the policy digest for every requested hash algorithm in parallel.
+
+   Each TSS_POLICY compiled from a given starting digest becomes a TSS_POLICY_BRANCH.  The
+   branch table doubles as the memo: a TSS_POLICY that is reached again from the same starting
+   digests reuses the earlier branch, both its digests and its steps.
+
+   The top level steps of a branch are contiguous.  The steps of PolicyOR branches are appended
+   after them, and the PolicyOR step records the branch indexes.
+
+   The executor sends the steps to one policy session in process.  At a PolicyOR, it tries the
+   branches in order.  A policy assertion that fails leaves the session digest unchanged, so a
+   branch that fails on its first command costs nothing.  A branch that fails later is undone
+   with PolicyRestart and a replay of the commands logged before the branch.
+*/
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <tss2/tsspolicy.h>
+#include <tss2/tsserror.h>
+#include <tss2/tssutils.h>
+#include <tss2/tssprint.h>
+#include <tss2/tssmarshal.h>
+#include <tss2/tsscryptoh.h>
+
+extern int tssVerbose;
+extern int tssVverbose;
+
+/* TSS_POLICY_EXECUTE is the TSS_Policy_Execute() state */
+
+typedef struct {
+    TSS_CONTEXT			*tssContext;
+    TPMI_SH_POLICY		policySession;
+    const TSS_POLICY_COMPILED	*compiled;
+    uint32_t			h;		/* index of the session hash algorithm */
+    TPM_CC			commandCode;	/* command the session will authorize, 0 for any */
+    TSS_POLICY_SIGN_FUNCTION	signFunction;
+    void			*signParam;
+    uint32_t			*log;		/* steps sent since the last PolicyRestart */
+    uint32_t			logCount;
+    uint32_t			commands;	/* TPM commands sent, for tracing */
+} TSS_POLICY_EXECUTE;
+
+/* a format 1 response code with the parameter, handle, or session number masked off */
+
+#define TSS_POLICY_RC_FMT1(rc)	((rc) & (RC_FMT1 | 0x03f))
+
+static TPM_RC TSS_Policy_CompileBranch(TSS_POLICY_COMPILED *compiled,
+				       uint32_t *branchIndex,
+				       const TSS_POLICY *policy,
+				       const TPM2B_DIGEST *prefix,
+				       unsigned int depth);
+static TPM_RC TSS_Policy_CompileTerm(TSS_POLICY_COMPILED *compiled,
+				     uint32_t stepIndex,
+				     const TSS_POLICY_TERM *term,
+				     TPM2B_DIGEST *digest,
+				     unsigned int depth);
+static TPM_RC TSS_Policy_Extend(TPM2B_DIGEST *digest,
+				TPMI_ALG_HASH hashAlg,
+				TPM_CC commandCode,
+				uint16_t argSize,
+				const uint8_t *arg);
+static TPM_RC TSS_Policy_Update(TPM2B_DIGEST *digest,
+				TPMI_ALG_HASH hashAlg,
+				TPM_CC commandCode,
+				const TPM2B_NAME *name,
+				const TPM2B_NONCE *policyRef);
+static int TSS_Policy_Compare(const TPM2B_DIGEST *expect,
+			      const TPM2B_DIGEST *actual,
+			      uint32_t count);
+static TPM_RC TSS_Policy_ExecuteBranch(TSS_POLICY_EXECUTE *execute,
+				       uint32_t branchIndex);
+static TPM_RC TSS_Policy_ExecuteStep(TSS_POLICY_EXECUTE *execute,
+				     uint32_t stepIndex);
+static TPM_RC TSS_Policy_ExecuteOR(TSS_POLICY_EXECUTE *execute,
+				   uint32_t stepIndex);
+static TPM_RC TSS_Policy_Send(TSS_POLICY_EXECUTE *execute,
+			      uint32_t stepIndex);
+static TPM_RC TSS_Policy_Sign(TSS_POLICY_EXECUTE *execute,
+			      TPMT_SIGNATURE *signature,
+			      const TSS_POLICY_TERM *term,
+			      const uint8_t *message,
+			      uint32_t messageSize);
+static TPM_RC TSS_Policy_Restore(TSS_POLICY_EXECUTE *execute,
+				 uint32_t logCount);
+static int TSS_Policy_Rejected(TPM_RC rc);
+static TPM_RC TSS_Policy_Grow(void **buffer,
+			      uint32_t count,
+			      uint32_t add,
+			      size_t elementSize);
+static void TSS_Policy_PrintBranch(const TSS_POLICY_COMPILED *compiled,
+				   uint32_t branchIndex,
+				   unsigned int indent);
+
+/* TSS_Policy_Compile() compiles policy for each of the hashCount hash algorithms in hashAlg.
+
+   On success, *compiled is allocated and must be freed with TSS_Policy_Free().  As with
+   TSS_Malloc(), *compiled must be NULL on input.
+
+   The step and branch tables are not limited by TSS_Malloc()'s maximum size.  They grow until
+   memory is exhausted or the size overflows.
+*/
+
+TPM_RC TSS_Policy_Compile(TSS_POLICY_COMPILED **compiled,
+			  const TSS_POLICY *policy,
+			  const TPMI_ALG_HASH *hashAlg,
+			  uint32_t hashCount)
+{
+    TPM_RC		rc = 0;
+    uint32_t		h;
+    uint32_t		root;
+    TSS_POLICY_COMPILED	*tmpCompiled = NULL;
+    TPM2B_DIGEST	prefix[TSS_POLICY_HASH_MAX];
+
+    if (rc == 0) {
+	if ((compiled == NULL) || (policy == NULL) || (hashAlg == NULL)) {
+	    if (tssVerbose) printf("TSS_Policy_Compile: Error, NULL parameter\n");
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    if (rc == 0) {
+	if (*compiled != NULL) {
+	    if (tssVerbose) printf("TSS_Policy_Compile: Error, *compiled %p should be NULL\n",
+				   (void *)*compiled);
+	    rc = TSS_RC_ALLOC_INPUT;
+	}
+    }
+    if (rc == 0) {
+	if ((hashCount == 0) || (hashCount > TSS_POLICY_HASH_MAX)) {
+	    if (tssVerbose) printf("TSS_Policy_Compile: Error, hash algorithm count %u\n",
+				   hashCount);
+	    rc = TSS_RC_BAD_POLICY;
+	}
+    }
+    /* the policy digest starts as all zero, the size of the hash algorithm */
+    for (h = 0 ; (rc == 0) && (h < hashCount) ; h++) {
+	prefix[h].t.size = TSS_GetDigestSize(hashAlg[h]);
+	if (prefix[h].t.size == 0) {
+	    if (tssVerbose) printf("TSS_Policy_Compile: Error, unsupported hash algorithm %04x\n",
+				   hashAlg[h]);
+	    rc = TSS_RC_BAD_HASH_ALGORITHM;
+	}
+	else {
+	    memset(prefix[h].t.buffer, 0, prefix[h].t.size);
+	}
+    }
+    if (rc == 0) {
+	rc = TSS_Malloc((unsigned char **)&tmpCompiled, sizeof(TSS_POLICY_COMPILED));
+    }
+    if (rc == 0) {
+	tmpCompiled->hashCount = hashCount;
+	memcpy(tmpCompiled->hashAlg, hashAlg, hashCount * sizeof(TPMI_ALG_HASH));
+	tmpCompiled->steps = NULL;
+	tmpCompiled->stepCount = 0;
+	tmpCompiled->branches = NULL;
+	tmpCompiled->branchCount = 0;
+	tmpCompiled->memoHits = 0;
+	/* the top level policy is always branch 0 */
+	rc = TSS_Policy_CompileBranch(tmpCompiled, &root, policy, prefix, 0);
+    }
+    if (rc == 0) {
+	if (tssVverbose) printf("TSS_Policy_Compile: %u steps, %u branches, %u memo hits\n",
+				tmpCompiled->stepCount, tmpCompiled->branchCount,
+				tmpCompiled->memoHits);
+	*compiled = tmpCompiled;
+    }
+    else {
+	TSS_Policy_Free(tmpCompiled);
+    }
+    return rc;
+}
+
+/* TSS_Policy_CompileBranch() compiles the AND list policy starting from the prefix digests.
+
+   branchIndex is the index of the resulting branch, either new or reused.
+*/
+
+static TPM_RC TSS_Policy_CompileBranch(TSS_POLICY_COMPILED *compiled,
+				       uint32_t *branchIndex,
+				       const TSS_POLICY *policy,
+				       const TPM2B_DIGEST *prefix,
+				       unsigned int depth)
+{
+    TPM_RC		rc = 0;
+    int			found = FALSE;
+    uint32_t		i;
+    uint32_t		start = 0;
+    TSS_POLICY_BRANCH	*branch;
+    TPM2B_DIGEST	digest[TSS_POLICY_HASH_MAX];
+
+    if (rc == 0) {
+	if (depth > TSS_POLICY_DEPTH_MAX) {
+	    if (tssVerbose) printf("TSS_Policy_CompileBranch: Error, depth exceeds %u\n",
+				   TSS_POLICY_DEPTH_MAX);
+	    rc = TSS_RC_BAD_POLICY;
+	}
+    }
+    if (rc == 0) {
+	if ((policy == NULL) || ((policy->terms == NULL) && (policy->termCount != 0))) {
+	    if (tssVerbose) printf("TSS_Policy_CompileBranch: Error, NULL policy terms\n");
+	    rc = TSS_RC_BAD_POLICY;
+	}
+    }
+    /* memo, reuse a branch already compiled from the same starting digests.  Incomplete
+       branches are ancestors, a match there is a cycle that the depth check terminates. */
+    for (i = 0 ; (rc == 0) && !found && (i < compiled->branchCount) ; i++) {
+	branch = &compiled->branches[i];
+	if ((branch->policy == policy) && branch->complete &&
+	    TSS_Policy_Compare(branch->prefix, prefix, compiled->hashCount)) {
+	    if (tssVverbose) printf("TSS_Policy_CompileBranch: Reuse branch %u\n", i);
+	    *branchIndex = i;
+	    compiled->memoHits++;
+	    found = TRUE;
+	}
+    }
+    /* reserve the branch and its top level steps, so that the steps are contiguous */
+    if ((rc == 0) && !found) {
+	rc = TSS_Policy_Grow((void **)&compiled->branches,
+			     compiled->branchCount, 1, sizeof(TSS_POLICY_BRANCH));
+    }
+    if ((rc == 0) && !found && (policy->termCount != 0)) {
+	rc = TSS_Policy_Grow((void **)&compiled->steps,
+			     compiled->stepCount, policy->termCount, sizeof(TSS_POLICY_STEP));
+    }
+    if ((rc == 0) && !found) {
+	start = compiled->stepCount;
+	*branchIndex = compiled->branchCount;
+	branch = &compiled->branches[*branchIndex];
+	branch->policy = policy;
+	branch->start = start;
+	branch->count = policy->termCount;
+	branch->complete = FALSE;
+	memcpy(branch->prefix, prefix, compiled->hashCount * sizeof(TPM2B_DIGEST));
+	compiled->branchCount++;
+	compiled->stepCount += policy->termCount;
+	memcpy(digest, prefix, compiled->hashCount * sizeof(TPM2B_DIGEST));
+    }
+    for (i = 0 ; (rc == 0) && !found && (i < policy->termCount) ; i++) {
+	rc = TSS_Policy_CompileTerm(compiled, start + i, &policy->terms[i], digest, depth);
+    }
+    /* index again, nested PolicyOR terms may have moved the branch table */
+    if ((rc == 0) && !found) {
+	branch = &compiled->branches[*branchIndex];
+	memcpy(branch->digest, digest, compiled->hashCount * sizeof(TPM2B_DIGEST));
+	branch->complete = TRUE;
+    }
+    return rc;
+}
+
+/* TSS_Policy_Grow() reallocates *buffer, an array of count elements, to hold count + add
+   elements.
+
+   It uses realloc() directly rather than TSS_Realloc(), whose 64 kbyte limit would cap a policy
+   at a few hundred steps.  The element count and byte size are checked for overflow.
+*/
+
+static TPM_RC TSS_Policy_Grow(void **buffer,
+			      uint32_t count,
+			      uint32_t add,
+			      size_t elementSize)
+{
+    TPM_RC		rc = 0;
+    void		*tmpptr;
+
+    if (rc == 0) {
+	if ((count > (UINT32_MAX - add)) ||
+	    ((size_t)(count + add) > (SIZE_MAX / elementSize))) {
+	    if (tssVerbose) printf("TSS_Policy_Grow: Error, %u + %u elements overflow\n",
+				   count, add);
+	    rc = TSS_RC_MALLOC_SIZE;
+	}
+    }
+    if (rc == 0) {
+	tmpptr = realloc(*buffer, (size_t)(count + add) * elementSize);
+	if (tmpptr == NULL) {
+	    if (tssVerbose) printf("TSS_Policy_Grow: Error reallocating %u elements\n",
+				   count + add);
+	    rc = TSS_RC_OUT_OF_MEMORY;
+	}
+    }
+    if (rc == 0) {
+	*buffer = tmpptr;
+    }
+    return rc;
+}
+
+/* TSS_Policy_CompileTerm() fills in step stepIndex for term and extends the policy digest for
+   each hash algorithm.
+*/
+
+static TPM_RC TSS_Policy_CompileTerm(TSS_POLICY_COMPILED *compiled,
+				     uint32_t stepIndex,
+				     const TSS_POLICY_TERM *term,
+				     TPM2B_DIGEST *digest,
+				     unsigned int depth)
+{
+    TPM_RC		rc = 0;
+    uint32_t		h;
+    uint32_t		j;
+    uint32_t		branchIndex;
+    TPMT_HA		pcrDigest;
+    uint8_t		buffer[TSS_POLICY_OR_MAX * sizeof(TPMU_HA)];	/* marshaled arguments */
+    uint16_t		written = 0;
+    uint8_t		*bufferPtr = buffer;
+    int32_t		size = sizeof(buffer);
+
+    memset(&compiled->steps[stepIndex], 0, sizeof(TSS_POLICY_STEP));
+    compiled->steps[stepIndex].commandCode = term->commandCode;
+    compiled->steps[stepIndex].term = term;
+    switch (term->commandCode) {
+      case TPM_CC_PolicyPCR:
+	/* policyDigest || TPM_CC_PolicyPCR || pcrs || pcrDigest, where pcrDigest is the hash of
+	   the PCR values using the policy hash algorithm */
+	if ((term->pcrValues == NULL) && (term->pcrValuesSize != 0)) {
+	    if (tssVerbose) printf("TSS_Policy_CompileTerm: Error, NULL PCR values\n");
+	    rc = TSS_RC_BAD_POLICY;
+	}
+	if (rc == 0) {
+	    rc = TSS_TPML_PCR_SELECTION_Marshal(&term->pcrs, &written, &bufferPtr, &size);
+	}
+	for (h = 0 ; (rc == 0) && (h < compiled->hashCount) ; h++) {
+	    TPM2B_DIGEST *stepDigest = &compiled->steps[stepIndex].digest[h];
+	    pcrDigest.hashAlg = compiled->hashAlg[h];
+	    rc = TSS_Hash_Generate(&pcrDigest,
+				   (int)term->pcrValuesSize, term->pcrValues,
+				   0, NULL);
+	    if (rc == 0) {
+		stepDigest->t.size = digest[h].t.size;
+		memcpy(stepDigest->t.buffer, (uint8_t *)&pcrDigest.digest, stepDigest->t.size);
+		memcpy(buffer + written, stepDigest->t.buffer, stepDigest->t.size);
+		rc = TSS_Policy_Extend(&digest[h], compiled->hashAlg[h], term->commandCode,
+				       written + stepDigest->t.size, buffer);
+	    }
+	}
+	break;
+      case TPM_CC_PolicyCommandCode:
+	rc = TSS_TPM_CC_Marshal(&term->code, &written, &bufferPtr, &size);
+	for (h = 0 ; (rc == 0) && (h < compiled->hashCount) ; h++) {
+	    rc = TSS_Policy_Extend(&digest[h], compiled->hashAlg[h], term->commandCode,
+				   written, buffer);
+	}
+	break;
+      case TPM_CC_PolicySigned:
+      case TPM_CC_PolicySecret:
+	for (h = 0 ; (rc == 0) && (h < compiled->hashCount) ; h++) {
+	    rc = TSS_Policy_Update(&digest[h], compiled->hashAlg[h], term->commandCode,
+				   &term->name, &term->policyRef);
+	}
+	break;
+      case TPM_CC_PolicyAuthorize:
+	/* the digest so far is the approvedPolicy, then the digest is reset before the update */
+	for (h = 0 ; (rc == 0) && (h < compiled->hashCount) ; h++) {
+	    compiled->steps[stepIndex].digest[h] = digest[h];
+	    memset(digest[h].t.buffer, 0, digest[h].t.size);
+	    rc = TSS_Policy_Update(&digest[h], compiled->hashAlg[h], term->commandCode,
+				   &term->name, &term->policyRef);
+	}
+	break;
+      case TPM_CC_PolicyAuthValue:
+      case TPM_CC_PolicyPassword:
+	/* both extend TPM_CC_PolicyAuthValue, so the two are interchangeable */
+	for (h = 0 ; (rc == 0) && (h < compiled->hashCount) ; h++) {
+	    rc = TSS_Policy_Extend(&digest[h], compiled->hashAlg[h], TPM_CC_PolicyAuthValue,
+				   0, buffer);
+	}
+	break;
+      case TPM_CC_PolicyPhysicalPresence:
+	for (h = 0 ; (rc == 0) && (h < compiled->hashCount) ; h++) {
+	    rc = TSS_Policy_Extend(&digest[h], compiled->hashAlg[h], term->commandCode,
+				   0, buffer);
+	}
+	break;
+      case TPM_CC_PolicyLocality:
+	for (h = 0 ; (rc == 0) && (h < compiled->hashCount) ; h++) {
+	    rc = TSS_Policy_Extend(&digest[h], compiled->hashAlg[h], term->commandCode,
+				   sizeof(UINT8), &term->locality.val);
+	}
+	break;
+      case TPM_CC_PolicyNvWritten:
+	for (h = 0 ; (rc == 0) && (h < compiled->hashCount) ; h++) {
+	    rc = TSS_Policy_Extend(&digest[h], compiled->hashAlg[h], term->commandCode,
+				   sizeof(TPMI_YES_NO), &term->writtenSet);
+	}
+	break;
+      case TPM_CC_PolicyOR:
+	/* every branch starts from the digest so far, then the digest is reset and extended
+	   with the list of branch digests */
+	if ((term->branchCount < 2) || (term->branchCount > TSS_POLICY_OR_MAX)) {
+	    if (tssVerbose) printf("TSS_Policy_CompileTerm: Error, PolicyOR branch count %u\n",
+				   term->branchCount);
+	    rc = TSS_RC_BAD_POLICY;
+	}
+	for (j = 0 ; (rc == 0) && (j < term->branchCount) ; j++) {
+	    rc = TSS_Policy_CompileBranch(compiled, &branchIndex, term->branch[j],
+					  digest, depth + 1);
+	    /* index again, the branch may have moved the step array */
+	    if (rc == 0) {
+		compiled->steps[stepIndex].branch[j] = branchIndex;
+		compiled->steps[stepIndex].branchCount = j + 1;
+	    }
+	}
+	for (h = 0 ; (rc == 0) && (h < compiled->hashCount) ; h++) {
+	    written = 0;
+	    for (j = 0 ; j < term->branchCount ; j++) {
+		branchIndex = compiled->steps[stepIndex].branch[j];
+		memcpy(buffer + written,
+		       compiled->branches[branchIndex].digest[h].t.buffer, digest[h].t.size);
+		written += digest[h].t.size;
+	    }
+	    memset(digest[h].t.buffer, 0, digest[h].t.size);
+	    rc = TSS_Policy_Extend(&digest[h], compiled->hashAlg[h], term->commandCode,
+				   written, buffer);
+	}
+	break;
+      default:
+	if (tssVerbose) printf("TSS_Policy_CompileTerm: Error, unsupported command code %08x\n",
+			       term->commandCode);
+	rc = TSS_RC_BAD_POLICY;
+    }
+    return rc;
+}
+
+/* TSS_Policy_Extend() extends digest with the command code and marshaled arguments
+
+   digest = H(digest || commandCode || arg)
+*/
+
+static TPM_RC TSS_Policy_Extend(TPM2B_DIGEST *digest,
+				TPMI_ALG_HASH hashAlg,
+				TPM_CC commandCode,
+				uint16_t argSize,
+				const uint8_t *arg)
+{
+    TPM_RC		rc = 0;
+    TPMT_HA		hash;
+    uint8_t		ccBuffer[sizeof(TPM_CC)];
+    uint16_t		written = 0;
+    uint8_t		*buffer = ccBuffer;
+    int32_t		size = sizeof(ccBuffer);
+
+    if (rc == 0) {
+	rc = TSS_TPM_CC_Marshal(&commandCode, &written, &buffer, &size);
+    }
+    if (rc == 0) {
+	hash.hashAlg = hashAlg;
+	rc = TSS_Hash_Generate(&hash,
+			       digest->t.size, digest->t.buffer,
+			       written, ccBuffer,
+			       argSize, arg,
+			       0, NULL);
+    }
+    if (rc == 0) {
+	memcpy(digest->t.buffer, (uint8_t *)&hash.digest, digest->t.size);
+    }
+    return rc;
+}
+
+/* TSS_Policy_Update() is the PolicyUpdate() of Part 3, used by PolicySigned, PolicySecret, and
+   PolicyAuthorize
+
+   digest = H(H(digest || commandCode || name) || policyRef)
+*/
+
+static TPM_RC TSS_Policy_Update(TPM2B_DIGEST *digest,
+				TPMI_ALG_HASH hashAlg,
+				TPM_CC commandCode,
+				const TPM2B_NAME *name,
+				const TPM2B_NONCE *policyRef)
+{
+    TPM_RC		rc = 0;
+    TPMT_HA		hash;
+
+    if (rc == 0) {
+	if ((name->t.size > sizeof(name->t.name)) ||
+	    (policyRef->t.size > sizeof(policyRef->t.buffer))) {
+	    if (tssVerbose) printf("TSS_Policy_Update: Error, name or policyRef size\n");
+	    rc = TSS_RC_BAD_POLICY;
+	}
+    }
+    if (rc == 0) {
+	rc = TSS_Policy_Extend(digest, hashAlg, commandCode, name->t.size, name->t.name);
+    }
+    if (rc == 0) {
+	hash.hashAlg = hashAlg;
+	rc = TSS_Hash_Generate(&hash,
+			       digest->t.size, digest->t.buffer,
+			       policyRef->t.size, policyRef->t.buffer,
+			       0, NULL);
+    }
+    if (rc == 0) {
+	memcpy(digest->t.buffer, (uint8_t *)&hash.digest, digest->t.size);
+    }
+    return rc;
+}
+
+/* TSS_Policy_Compare() returns TRUE if the count digests are equal */
+
+static int TSS_Policy_Compare(const TPM2B_DIGEST *expect,
+			      const TPM2B_DIGEST *actual,
+			      uint32_t count)
+{
+    int			match = TRUE;
+    uint32_t		h;
+
+    for (h = 0 ; match && (h < count) ; h++) {
+	match = (expect[h].t.size == actual[h].t.size) &&
+		(memcmp(expect[h].t.buffer, actual[h].t.buffer, expect[h].t.size) == 0);
+    }
+    return match;
+}
+
+/* TSS_Policy_Execute() satisfies the compiled policy in policySession, a policy session started
+   with hashAlg.  The policy must have been compiled for hashAlg.
+
+   commandCode is the command the session will authorize.  A PolicyCommandCode for a different
+   command is rejected without sending it, so that PolicyOR selects the matching branch.  0
+   accepts any command code.
+
+   signFunction and signParam are required when the policy has PolicySigned or PolicyAuthorize
+   terms.
+
+   Returns TSS_RC_POLICY_NOT_SATISFIED if no PolicyOR branch is accepted, otherwise the response
+   code of the first rejected policy command.  Only an assertion failure moves on to the next
+   PolicyOR branch.  Any other response code, such as TPM_RC_RETRY or TPM_RC_SESSION_MEMORY, is
+   returned at once.
+*/
+
+TPM_RC TSS_Policy_Execute(TSS_CONTEXT *tssContext,
+			  TPMI_SH_POLICY policySession,
+			  const TSS_POLICY_COMPILED *compiled,
+			  TPMI_ALG_HASH hashAlg,
+			  TPM_CC commandCode,
+			  TSS_POLICY_SIGN_FUNCTION signFunction,
+			  void *signParam)
+{
+    TPM_RC		rc = 0;
+    int			found = FALSE;
+    uint32_t		h;
+    TSS_POLICY_EXECUTE	execute;
+
+    execute.log = NULL;
+    if (rc == 0) {
+	if ((tssContext == NULL) || (compiled == NULL)) {
+	    if (tssVerbose) printf("TSS_Policy_Execute: Error, NULL parameter\n");
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    for (h = 0 ; (rc == 0) && !found && (h < compiled->hashCount) ; h++) {
+	if (compiled->hashAlg[h] == hashAlg) {
+	    execute.h = h;
+	    found = TRUE;
+	}
+    }
+    if ((rc == 0) && !found) {
+	if (tssVerbose) printf("TSS_Policy_Execute: Error, hash algorithm %04x not compiled\n",
+			       hashAlg);
+	rc = TSS_RC_BAD_HASH_ALGORITHM;
+    }
+    /* one path through the policy sends each step at most once */
+    if ((rc == 0) && (compiled->stepCount != 0)) {
+	rc = TSS_Policy_Grow((void **)&execute.log, 0, compiled->stepCount, sizeof(uint32_t));
+    }
+    if (rc == 0) {
+	execute.tssContext = tssContext;
+	execute.policySession = policySession;
+	execute.compiled = compiled;
+	execute.commandCode = commandCode;
+	execute.signFunction = signFunction;
+	execute.signParam = signParam;
+	execute.logCount = 0;
+	execute.commands = 0;
+	rc = TSS_Policy_ExecuteBranch(&execute, 0);
+	if (tssVverbose) printf("TSS_Policy_Execute: rc %08x after %u commands\n",
+				rc, execute.commands);
+    }
+    free(execute.log);
+    return rc;
+}
+
+/* TSS_Policy_ExecuteBranch() executes the top level steps of a branch */
+
+static TPM_RC TSS_Policy_ExecuteBranch(TSS_POLICY_EXECUTE *execute,
+				       uint32_t branchIndex)
+{
+    TPM_RC			rc = 0;
+    const TSS_POLICY_BRANCH	*branch = &execute->compiled->branches[branchIndex];
+    uint32_t			i;
+
+    for (i = 0 ; (rc == 0) && (i < branch->count) ; i++) {
+	rc = TSS_Policy_ExecuteStep(execute, branch->start + i);
+    }
+    return rc;
+}
+
+/* TSS_Policy_ExecuteStep() executes one step, first selecting and executing a branch if the step
+   is a PolicyOR, and logs it for replay
+*/
+
+static TPM_RC TSS_Policy_ExecuteStep(TSS_POLICY_EXECUTE *execute,
+				     uint32_t stepIndex)
+{
+    TPM_RC			rc = 0;
+    const TSS_POLICY_STEP	*step = &execute->compiled->steps[stepIndex];
+
+    if (rc == 0) {
+	if (step->commandCode == TPM_CC_PolicyOR) {
+	    rc = TSS_Policy_ExecuteOR(execute, stepIndex);
+	}
+    }
+    /* the TPM would accept this assertion, but the session could not authorize the command */
+    if (rc == 0) {
+	if ((step->commandCode == TPM_CC_PolicyCommandCode) &&
+	    (execute->commandCode != 0) &&
+	    (step->term->code != execute->commandCode)) {
+	    if (tssVverbose) printf("TSS_Policy_ExecuteStep: PolicyCommandCode %08x skipped\n",
+				    step->term->code);
+	    rc = TSS_RC_POLICY_NOT_SATISFIED;
+	}
+    }
+    if (rc == 0) {
+	rc = TSS_Policy_Send(execute, stepIndex);
+    }
+    if (rc == 0) {
+	if (execute->logCount < execute->compiled->stepCount) {
+	    execute->log[execute->logCount] = stepIndex;
+	    execute->logCount++;
+	}
+	else {
+	    if (tssVerbose) printf("TSS_Policy_ExecuteStep: Error, step log overflow\n");
+	    rc = TSS_RC_BAD_POLICY;
+	}
+    }
+    return rc;
+}
+
+/* TSS_Policy_ExecuteOR() executes the first branch of the PolicyOR step that the TPM accepts.
+   The caller sends the PolicyOR itself.
+
+   A rejected assertion leaves the policy digest unchanged, so a branch rejected at its first
+   command needs no recovery.  Otherwise, the session is restarted and the commands logged before
+   the branch are replayed.
+*/
+
+static TPM_RC TSS_Policy_ExecuteOR(TSS_POLICY_EXECUTE *execute,
+				   uint32_t stepIndex)
+{
+    TPM_RC			rc = 0;
+    const TSS_POLICY_STEP	*step = &execute->compiled->steps[stepIndex];
+    uint32_t			logCount = execute->logCount;
+    uint32_t			j;
+    int				done = FALSE;
+
+    for (j = 0 ; !done && (j < step->branchCount) ; j++) {
+	rc = TSS_Policy_ExecuteBranch(execute, step->branch[j]);
+	if (rc == 0) {
+	    done = TRUE;
+	}
+	else if (!TSS_Policy_Rejected(rc)) {
+	    done = TRUE;		/* TSS or transport error */
+	}
+	else {
+	    if (tssVverbose) printf("TSS_Policy_ExecuteOR: Branch %u rejected, rc %08x\n", j, rc);
+	    if (execute->logCount != logCount) {
+		rc = TSS_Policy_Restore(execute, logCount);
+		done = (rc != 0);
+	    }
+	}
+    }
+    if (!done) {
+	rc = TSS_RC_POLICY_NOT_SATISFIED;
+    }
+    return rc;
+}
+
+/* TSS_Policy_Restore() restarts the policy session and replays the first logCount logged
+   commands
+*/
+
+static TPM_RC TSS_Policy_Restore(TSS_POLICY_EXECUTE *execute,
+				 uint32_t logCount)
+{
+    TPM_RC		rc = 0;
+    uint32_t		i;
+    PolicyRestart_In	in;
+
+    if (rc == 0) {
+	if (tssVverbose) printf("TSS_Policy_Restore: Replay %u commands\n", logCount);
+	in.sessionHandle = execute->policySession;
+	rc = TSS_Execute(execute->tssContext,
+			 NULL,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 TPM_CC_PolicyRestart,
+			 TPM_RH_NULL, NULL, 0);
+	execute->commands++;
+    }
+    for (i = 0 ; (rc == 0) && (i < logCount) ; i++) {
+	rc = TSS_Policy_Send(execute, execute->log[i]);
+    }
+    execute->logCount = logCount;
+    return rc;
+}
+
+/* TSS_Policy_Rejected() returns TRUE if rc means the TPM rejected a policy assertion, so that
+   the next PolicyOR branch may be tried.
+
+   Only assertion failures qualify.  Resource, retry, lockout, and failure mode response codes,
+   like TSS and transport errors, are returned to the caller.  So is TPM_RC_AUTH_FAIL, because a
+   failed PolicySecret authorization counts toward dictionary attack lockout, and trying further
+   branches could add one failure for each.
+*/
+
+static int TSS_Policy_Rejected(TPM_RC rc)
+{
+    int rejected = FALSE;
+
+    if (rc == TSS_RC_POLICY_NOT_SATISFIED) {	/* a nested PolicyOR */
+	rejected = TRUE;
+    }
+    else if (rc == TPM_RC_PCR_CHANGED) {
+	rejected = TRUE;
+    }
+    else if ((rc & 0xfffff000) == 0) {
+	if ((rc & RC_FMT1) != 0) {
+	    switch (TSS_POLICY_RC_FMT1(rc)) {
+	      case TPM_RC_POLICY_FAIL:
+	      case TPM_RC_VALUE:
+	      case TPM_RC_SIGNATURE:
+	      case TPM_RC_EXPIRED:
+		rejected = TRUE;
+		break;
+	    }
+	}
+    }
+    return rejected;
+}
+
+/* TSS_Policy_Send() sends the policy command for one step.  A PolicyOR branch must already be
+   satisfied.
+
+   PolicySigned and PolicySecret are sent without nonceTPM, cpHashA, or expiration.  PolicySecret
+   authorizes authHandle with a password session.
+*/
+
+static TPM_RC TSS_Policy_Send(TSS_POLICY_EXECUTE *execute,
+			      uint32_t stepIndex)
+{
+    TPM_RC			rc = 0;
+    const TSS_POLICY_COMPILED	*compiled = execute->compiled;
+    const TSS_POLICY_STEP	*step = &compiled->steps[stepIndex];
+    const TSS_POLICY_TERM	*term = step->term;
+    uint32_t			h = execute->h;
+    uint32_t			j;
+    TPMI_SH_AUTH_SESSION 	sessionHandle = TPM_RH_NULL;
+    const char			*password = NULL;
+    RESPONSE_PARAMETERS		*responseParameters = NULL;
+    uint8_t			message[sizeof(TPMU_HA) + sizeof(TPMU_HA)];
+    uint32_t			messageSize;
+    TPMI_ALG_HASH		nameAlg;
+    TPMT_HA			aHash;
+    VerifySignature_In 		verifySignatureIn;
+    VerifySignature_Out 	verifySignatureOut;
+    union {
+	PolicyPCR_In			policyPCR;
+	PolicyCommandCode_In		policyCommandCode;
+	PolicySigned_In			policySigned;
+	PolicySecret_In			policySecret;
+	PolicyAuthorize_In		policyAuthorize;
+	PolicyAuthValue_In		policyAuthValue;
+	PolicyPassword_In		policyPassword;
+	PolicyPhysicalPresence_In	policyPhysicalPresence;
+	PolicyLocality_In		policyLocality;
+	PolicyNvWritten_In		policyNvWritten;
+	PolicyOR_In			policyOR;
+    } in;
+    union {
+	PolicySigned_Out		policySigned;
+	PolicySecret_Out		policySecret;
+    } out;
+
+    switch (step->commandCode) {
+      case TPM_CC_PolicyPCR:
+	in.policyPCR.policySession = execute->policySession;
+	in.policyPCR.pcrDigest = step->digest[h];
+	in.policyPCR.pcrs = term->pcrs;
+	break;
+      case TPM_CC_PolicyCommandCode:
+	in.policyCommandCode.policySession = execute->policySession;
+	in.policyCommandCode.code = term->code;
+	break;
+      case TPM_CC_PolicySigned:
+	in.policySigned.authObject = term->handle;
+	in.policySigned.policySession = execute->policySession;
+	in.policySigned.nonceTPM.t.size = 0;
+	in.policySigned.cpHashA.t.size = 0;
+	in.policySigned.policyRef = term->policyRef;
+	in.policySigned.expiration = 0;
+	responseParameters = (RESPONSE_PARAMETERS *)&out;
+	/* aHash message is nonceTPM || expiration || cpHashA || policyRef */
+	memset(message, 0, sizeof(INT32));
+	memcpy(message + sizeof(INT32), term->policyRef.t.buffer, term->policyRef.t.size);
+	messageSize = sizeof(INT32) + term->policyRef.t.size;
+	rc = TSS_Policy_Sign(execute, &in.policySigned.auth, term, message, messageSize);
+	break;
+      case TPM_CC_PolicySecret:
+	in.policySecret.authHandle = term->handle;
+	in.policySecret.policySession = execute->policySession;
+	in.policySecret.nonceTPM.t.size = 0;
+	in.policySecret.cpHashA.t.size = 0;
+	in.policySecret.policyRef = term->policyRef;
+	in.policySecret.expiration = 0;
+	responseParameters = (RESPONSE_PARAMETERS *)&out;
+	sessionHandle = TPM_RS_PW;
+	password = term->password;
+	break;
+      case TPM_CC_PolicyAuthorize:
+	in.policyAuthorize.policySession = execute->policySession;
+	in.policyAuthorize.approvedPolicy = step->digest[h];
+	in.policyAuthorize.policyRef = term->policyRef;
+	in.policyAuthorize.keySign = term->name;
+	/* the ticket is over aHash = H_keySignNameAlg(approvedPolicy || policyRef) */
+	if (term->name.t.size < sizeof(TPMI_ALG_HASH)) {
+	    if (tssVerbose) printf("TSS_Policy_Send: Error, keySign Name size %u\n",
+				   term->name.t.size);
+	    rc = TSS_RC_BAD_POLICY;
+	}
+	if (rc == 0) {
+	    nameAlg = (TPMI_ALG_HASH)((term->name.t.name[0] << 8) | term->name.t.name[1]);
+	    verifySignatureIn.digest.t.size = TSS_GetDigestSize(nameAlg);
+	    if (verifySignatureIn.digest.t.size == 0) {
+		if (tssVerbose) printf("TSS_Policy_Send: Error, keySign Name algorithm %04x\n",
+				       nameAlg);
+		rc = TSS_RC_BAD_HASH_ALGORITHM;
+	    }
+	}
+	if (rc == 0) {
+	    memcpy(message, step->digest[h].t.buffer, step->digest[h].t.size);
+	    memcpy(message + step->digest[h].t.size,
+		   term->policyRef.t.buffer, term->policyRef.t.size);
+	    messageSize = step->digest[h].t.size + term->policyRef.t.size;
+	    aHash.hashAlg = nameAlg;
+	    rc = TSS_Hash_Generate(&aHash,
+				   messageSize, message,
+				   0, NULL);
+	}
+	if (rc == 0) {
+	    memcpy(verifySignatureIn.digest.t.buffer, (uint8_t *)&aHash.digest,
+		   verifySignatureIn.digest.t.size);
+	    verifySignatureIn.keyHandle = term->handle;
+	    rc = TSS_Policy_Sign(execute, &verifySignatureIn.signature, term, message, messageSize);
+	}
+	if (rc == 0) {
+	    rc = TSS_Execute(execute->tssContext,
+			     (RESPONSE_PARAMETERS *)&verifySignatureOut,
+			     (COMMAND_PARAMETERS *)&verifySignatureIn,
+			     NULL,
+			     TPM_CC_VerifySignature,
+			     TPM_RH_NULL, NULL, 0);
+	    execute->commands++;
+	}
+	if (rc == 0) {
+	    in.policyAuthorize.checkTicket = verifySignatureOut.validation;
+	}
+	break;
+      case TPM_CC_PolicyAuthValue:
+	in.policyAuthValue.policySession = execute->policySession;
+	break;
+      case TPM_CC_PolicyPassword:
+	in.policyPassword.policySession = execute->policySession;
+	break;
+      case TPM_CC_PolicyPhysicalPresence:
+	in.policyPhysicalPresence.policySession = execute->policySession;
+	break;
+      case TPM_CC_PolicyLocality:
+	in.policyLocality.policySession = execute->policySession;
+	in.policyLocality.locality = term->locality;
+	break;
+      case TPM_CC_PolicyNvWritten:
+	in.policyNvWritten.policySession = execute->policySession;
+	in.policyNvWritten.writtenSet = term->writtenSet;
+	break;
+      case TPM_CC_PolicyOR:
+	in.policyOR.policySession = execute->policySession;
+	in.policyOR.pHashList.count = step->branchCount;
+	for (j = 0 ; j < step->branchCount ; j++) {
+	    in.policyOR.pHashList.digests[j] = compiled->branches[step->branch[j]].digest[h];
+	}
+	break;
+      default:
+	if (tssVerbose) printf("TSS_Policy_Send: Error, unsupported command code %08x\n",
+			       step->commandCode);
+	rc = TSS_RC_BAD_POLICY;
+    }
+    if (rc == 0) {
+	rc = TSS_Execute(execute->tssContext,
+			 responseParameters,
+			 (COMMAND_PARAMETERS *)&in,
+			 NULL,
+			 step->commandCode,
+			 sessionHandle, password, 0,
+			 TPM_RH_NULL, NULL, 0);
+	execute->commands++;
+    }
+    return rc;
+}
+
+/* TSS_Policy_Sign() calls the application signing callback */
+
+static TPM_RC TSS_Policy_Sign(TSS_POLICY_EXECUTE *execute,
+			      TPMT_SIGNATURE *signature,
+			      const TSS_POLICY_TERM *term,
+			      const uint8_t *message,
+			      uint32_t messageSize)
+{
+    TPM_RC		rc = 0;
+
+    if (rc == 0) {
+	if (execute->signFunction == NULL) {
+	    if (tssVerbose) printf("TSS_Policy_Sign: Error, no signing function for %08x\n",
+				   term->commandCode);
+	    rc = TSS_RC_NULL_PARAMETER;
+	}
+    }
+    if (rc == 0) {
+	rc = execute->signFunction(signature, term, message, messageSize, execute->signParam);
+    }
+    return rc;
+}
+
+/* TSS_Policy_GetDigest() returns the compiled policy digest for hashAlg.
+
+   Returns TSS_RC_BAD_HASH_ALGORITHM if the policy was not compiled for hashAlg.
+*/
+
+TPM_RC TSS_Policy_GetDigest(TPM2B_DIGEST *policyDigest,
+			    const TSS_POLICY_COMPILED *compiled,
+			    TPMI_ALG_HASH hashAlg)
+{
+    TPM_RC		rc = TSS_RC_BAD_HASH_ALGORITHM;
+    uint32_t		h;
+
+    for (h = 0 ; (rc != 0) && (h < compiled->hashCount) ; h++) {
+	if (compiled->hashAlg[h] == hashAlg) {
+	    *policyDigest = compiled->branches[0].digest[h];
+	    rc = 0;
+	}
+    }
+    if (rc != 0) {
+	if (tssVerbose) printf("TSS_Policy_GetDigest: Error, hash algorithm %04x not compiled\n",
+			       hashAlg);
+    }
+    return rc;
+}
+
+/* TSS_Policy_Print() traces the policy digests and the compiled policy command sequence */
+
+void TSS_Policy_Print(const TSS_POLICY_COMPILED *compiled)
+{
+    uint32_t		h;
+
+    for (h = 0 ; h < compiled->hashCount ; h++) {
+	TSS_TPM_ALG_ID_Print(compiled->hashAlg[h], 0);
+	TSS_PrintAll("policyDigest",
+		     compiled->branches[0].digest[h].t.buffer,
+		     compiled->branches[0].digest[h].t.size);
+    }
+    printf("%u steps, %u branches, %u memo hits\n",
+	   compiled->stepCount, compiled->branchCount, compiled->memoHits);
+    TSS_Policy_PrintBranch(compiled, 0, 0);
+    return;
+}
+
+/* TSS_Policy_PrintBranch() traces the steps of one branch, PolicyOR branches indented */
+
+static void TSS_Policy_PrintBranch(const TSS_POLICY_COMPILED *compiled,
+				   uint32_t branchIndex,
+				   unsigned int indent)
+{
+    const TSS_POLICY_BRANCH	*branch = &compiled->branches[branchIndex];
+    const TSS_POLICY_STEP	*step;
+    uint32_t			i;
+    uint32_t			j;
+
+    for (i = 0 ; i < branch->count ; i++) {
+	step = &compiled->steps[branch->start + i];
+	printf("%*s" "%08x\n", indent, "", step->commandCode);
+	for (j = 0 ; j < step->branchCount ; j++) {
+	    printf("%*s" "branch %u\n", indent + 2, "", j);
+	    TSS_Policy_PrintBranch(compiled, step->branch[j], indent + 4);
+	}
+    }
+    return;
+}
+
+/* TSS_Policy_Free() frees a compiled policy.  compiled may be NULL. */
+
+void TSS_Policy_Free(TSS_POLICY_COMPILED *compiled)
+{
+    if (compiled != NULL) {
+	free(compiled->steps);
+	free(compiled->branches);
+	free(compiled);
+    }
+    return;
+}
@@ -47,8 +47,10 @@
 #include <tss2/tsstransmit.h>
 #ifndef TPM_TSS_NOCRYPTO
 #include <tss2/tsscrypto.h>
+#include <tss2/tsscryptoh.h>
 #endif
 #include <tss2/tssprint.h>
+#include <tss2/tssutils.h>
 
 #include "tssproperties.h"
 
@@ -63,6 +65,17 @@ static TPM_RC TSS_SetServerType(TSS_CONTEXT *tssContext, const char *value);
 static TPM_RC TSS_SetInterfaceType(TSS_CONTEXT *tssContext, const char *value);
 static TPM_RC TSS_SetDevice(TSS_CONTEXT *tssContext, const char *value);
 static TPM_RC TSS_SetEncryptSessions(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetSocketPool(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetDeviceNonblock(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetSessionCache(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetNameCache(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetSecureWipe(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetExecuteTiming(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetRandomPool(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetRandomMix(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetPropertyCache(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetEccSaltPool(TSS_CONTEXT *tssContext, const char *value);
+static TPM_RC TSS_SetSessionPool(TSS_CONTEXT *tssContext, const char *value);
 
 /* globals for the library */
 
@@ -118,6 +131,54 @@ int tssFirstCall = TRUE;
 #define TPM_ENCRYPT_SESSIONS_DEFAULT	"1"
 #endif
 
+#ifndef TPM_SOCKET_POOL_DEFAULT
+#define TPM_SOCKET_POOL_DEFAULT		"0"		/* default to a connection per context */
+#endif
+
+#ifndef TPM_DEVICE_NONBLOCK_DEFAULT
+#define TPM_DEVICE_NONBLOCK_DEFAULT	"0"		/* default to blocking device reads */
+#endif
+
+#ifndef TPM_SESSION_CACHE_DEFAULT
+#define TPM_SESSION_CACHE_DEFAULT	"0"		/* default to the session store only */
+#endif
+
+#ifndef TPM_NAME_CACHE_DEFAULT
+#define TPM_NAME_CACHE_DEFAULT		"0"		/* default to reading the Name files */
+#endif
+
+#ifndef TPM_SECURE_WIPE_DEFAULT
+#define TPM_SECURE_WIPE_DEFAULT		"1"		/* default to erasing after authorized and sensitive commands */
+#endif
+
+#ifndef TPM_EXECUTE_TIMING_DEFAULT
+#define TPM_EXECUTE_TIMING_DEFAULT	"0"		/* default to no step timing */
+#endif
+
+#define TSS_EXECUTE_TIMING_MAX		512		/* maximum timing records, within TSS_Malloc() */
+
+#ifndef TPM_RANDOM_POOL_DEFAULT
+#define TPM_RANDOM_POOL_DEFAULT		"0"		/* default to no random number pool */
+#endif
+
+#define TSS_RANDOM_POOL_MAX		0x10000		/* maximum random number pool, within TSS_Malloc() */
+
+#ifndef TPM_RANDOM_MIX_DEFAULT
+#define TPM_RANDOM_MIX_DEFAULT		"0"		/* default to TPM random numbers only */
+#endif
+
+#ifndef TPM_PROPERTY_CACHE_DEFAULT
+#define TPM_PROPERTY_CACHE_DEFAULT	"0"		/* default to read once per context */
+#endif
+
+#ifndef TPM_ECC_SALT_POOL_DEFAULT
+#define TPM_ECC_SALT_POOL_DEFAULT	"0"		/* default to no ECC salt key pool */
+#endif
+
+#ifndef TPM_SESSION_POOL_DEFAULT
+#define TPM_SESSION_POOL_DEFAULT	"0"		/* default to flushing released sessions */
+#endif
+
 /* TSS_GlobalProperties_Init() sets the global verbose trace flags at the first entry points to the
    TSS */
 
@@ -146,6 +207,15 @@ TPM_RC TSS_Properties_Init(TSS_CONTEXT *tssContext)
 
     if (rc == 0) {
 	tssContext->tssAuthContext = NULL;
+	tssContext->tssExecuteState = NULL;
+	tssContext->tssExecuteTiming = 0;
+	tssContext->timingRing = NULL;
+	tssContext->timingNext = 0;
+	tssContext->timingCount = 0;
+	tssContext->tssRandomPool = 0;
+	tssContext->randomPool = NULL;
+	tssContext->randomPoolAvailable = 0;
+	tssContext->fixedPropertiesValid = FALSE;
 	tssContext->tssFirstTransmit = TRUE;	/* connection not opened */
 #ifdef TPM_WINDOWS
 	tssContext->sock_fd = INVALID_SOCKET;
@@ -155,7 +225,11 @@ TPM_RC TSS_Properties_Init(TSS_CONTEXT *tssContext)
 	tssContext->sock_fd = -1;
 #endif 	/* TPM_NOSOCKET */
 #endif
+#ifndef TPM_NOSOCKET
+	tssContext->sock_pooled = FALSE;
+#endif 	/* TPM_NOSOCKET */
 	tssContext->dev_fd = -1;
+	tssContext->dev_received = 0;
 #ifdef TPM_WINDOWS
 #ifdef TPM_WINDOWS_TBSI
 	tssContext->hContext = 0;	/* FIXME:  Guess at an illegal value */
@@ -166,6 +240,38 @@ TPM_RC TSS_Properties_Init(TSS_CONTEXT *tssContext)
 	tssContext->tssSessionDecKey = NULL;
 #endif
     }
+    /* the session cache is empty */
+    {
+	size_t i;
+	tssContext->tssSessionCache = 0;
+	for (i = 0 ; i < (sizeof(tssContext->sessionCache) / sizeof(TSS_SESSION_CACHE)) ; i++) {
+	    tssContext->sessionCache[i].sessionHandle = TPM_RH_NULL;
+	    tssContext->sessionCache[i].session = NULL;
+	    tssContext->sessionCache[i].dirty = FALSE;
+	    tssContext->sessionCache[i].stored = FALSE;
+	}
+    }
+    /* the session pool is empty */
+    {
+	size_t i;
+	for (i = 0 ; i < (sizeof(tssContext->sessionPool) / sizeof(TSS_SESSION_POOL_ENTRY)) ; i++) {
+	    tssContext->sessionPool[i].sessionHandle = TPM_RH_NULL;
+	    tssContext->sessionPool[i].leased = FALSE;
+	}
+	tssContext->sessionPoolClock = 0;
+	memset(&tssContext->sessionPoolStats, 0, sizeof(TSS_SESSION_POOL_STATS));
+    }
+    /* the Name cache and the salt keys parsed from it are empty */
+    tssContext->tssNameCache = FALSE;
+#ifndef TPM_TSS_NOCRYPTO
+    {
+	size_t i;
+	for (i = 0 ; i < (sizeof(tssContext->saltKeyCache) / sizeof(TSS_SALT_KEY_CACHE)) ; i++) {
+	    tssContext->saltKeyCache[i].rsaKey = NULL;
+	}
+    }
+#endif
+    TSS_NameCache_Clear(tssContext);
     /* for a minimal TSS with no file support */
 #ifdef TPM_TSS_NOFILE
     {
@@ -193,6 +299,50 @@ TPM_RC TSS_Properties_Init(TSS_CONTEXT *tssContext)
 	value = getenv("TPM_ENCRYPT_SESSIONS");
 	rc = TSS_SetEncryptSessions(tssContext, value);
     }
+    /* session cache policy */
+    if (rc == 0) {
+	value = getenv("TPM_SESSION_CACHE");
+	rc = TSS_SetSessionCache(tssContext, value);
+    }
+    /* Name and public cache */
+    if (rc == 0) {
+	value = getenv("TPM_NAME_CACHE");
+	rc = TSS_SetNameCache(tssContext, value);
+    }
+    /* command and response buffer erasure */
+    if (rc == 0) {
+	value = getenv("TPM_SECURE_WIPE");
+	rc = TSS_SetSecureWipe(tssContext, value);
+    }
+    /* TSS_Execute() step timing */
+    if (rc == 0) {
+	value = getenv("TPM_EXECUTE_TIMING");
+	rc = TSS_SetExecuteTiming(tssContext, value);
+    }
+    /* random number pool */
+    if (rc == 0) {
+	value = getenv("TPM_RANDOM_POOL");
+	rc = TSS_SetRandomPool(tssContext, value);
+    }
+    if (rc == 0) {
+	value = getenv("TPM_RANDOM_MIX");
+	rc = TSS_SetRandomMix(tssContext, value);
+    }
+    /* TPM fixed property cache */
+    if (rc == 0) {
+	value = getenv("TPM_PROPERTY_CACHE");
+	rc = TSS_SetPropertyCache(tssContext, value);
+    }
+    /* ECC salt ephemeral key pool */
+    if (rc == 0) {
+	value = getenv("TPM_ECC_SALT_POOL");
+	rc = TSS_SetEccSaltPool(tssContext, value);
+    }
+    /* idle sessions kept by the session pool */
+    if (rc == 0) {
+	value = getenv("TPM_SESSION_POOL");
+	rc = TSS_SetSessionPool(tssContext, value);
+    }
     /* TPM socket command port */
     if (rc == 0) {
 	value = getenv("TPM_COMMAND_PORT");
@@ -223,6 +373,16 @@ TPM_RC TSS_Properties_Init(TSS_CONTEXT *tssContext)
 	value = getenv("TPM_DEVICE");
 	rc = TSS_SetDevice(tssContext, value);
     }
+    /* TPM device non-blocking mode */
+    if (rc == 0) {
+	value = getenv("TPM_DEVICE_NONBLOCK");
+	rc = TSS_SetDeviceNonblock(tssContext, value);
+    }
+    /* TPM socket connection pooling */
+    if (rc == 0) {
+	value = getenv("TPM_SOCKET_POOL");
+	rc = TSS_SetSocketPool(tssContext, value);
+    }
     return rc;
 }
 
@@ -281,6 +441,39 @@ TPM_RC TSS_SetProperty(TSS_CONTEXT *tssContext,
 	  case TPM_ENCRYPT_SESSIONS:
 	    rc = TSS_SetEncryptSessions(tssContext, value);
 	    break;
+	  case TPM_SOCKET_POOL:
+	    rc = TSS_SetSocketPool(tssContext, value);
+	    break;
+	  case TPM_DEVICE_NONBLOCK:
+	    rc = TSS_SetDeviceNonblock(tssContext, value);
+	    break;
+	  case TPM_SESSION_CACHE:
+	    rc = TSS_SetSessionCache(tssContext, value);
+	    break;
+	  case TPM_NAME_CACHE:
+	    rc = TSS_SetNameCache(tssContext, value);
+	    break;
+	  case TPM_SECURE_WIPE:
+	    rc = TSS_SetSecureWipe(tssContext, value);
+	    break;
+	  case TPM_EXECUTE_TIMING:
+	    rc = TSS_SetExecuteTiming(tssContext, value);
+	    break;
+	  case TPM_RANDOM_POOL:
+	    rc = TSS_SetRandomPool(tssContext, value);
+	    break;
+	  case TPM_RANDOM_MIX:
+	    rc = TSS_SetRandomMix(tssContext, value);
+	    break;
+	  case TPM_PROPERTY_CACHE:
+	    rc = TSS_SetPropertyCache(tssContext, value);
+	    break;
+	  case TPM_ECC_SALT_POOL:
+	    rc = TSS_SetEccSaltPool(tssContext, value);
+	    break;
+	  case TPM_SESSION_POOL:
+	    rc = TSS_SetSessionPool(tssContext, value);
+	    break;
 	  default:
 	    rc = TSS_RC_BAD_PROPERTY;
 	}
@@ -336,6 +529,12 @@ static TPM_RC TSS_SetDataDirectory(TSS_CONTEXT *tssContext, const char *value)
 {
     TPM_RC		rc = 0;
 
+    /* cached sessions, Names, and saved TPM properties belong to the old directory */
+    if (rc == 0) {
+	rc = TSS_SessionCache_Flush(tssContext);
+	TSS_NameCache_Clear(tssContext);
+	tssContext->fixedPropertiesValid = FALSE;
+    }
     if (rc == 0) {
 	if (value == NULL) {
 	    value = TPM_DATA_DIR_DEFAULT;
@@ -477,6 +676,10 @@ static TPM_RC TSS_SetEncryptSessions(TSS_CONTEXT *tssContext, const char *value)
     TPM_RC		rc = 0;
     int			irc;
 
+    /* write cached sessions in the old format */
+    if (rc == 0) {
+	rc = TSS_SessionCache_Flush(tssContext);
+    }
     if (rc == 0) {
 	if (value == NULL) {
 	    value = TPM_ENCRYPT_SESSIONS_DEFAULT;
@@ -491,3 +694,403 @@ static TPM_RC TSS_SetEncryptSessions(TSS_CONTEXT *tssContext, const char *value)
     }
     return rc;
 }
+
+/* TSS_SetSocketPool() sets whether the socket interface reuses connections.
+
+   0:	open a connection on the first transmit, close it at TSS_Close()
+   1:	take a connection from the process wide pool, return it at TSS_Close()
+
+   Do not set 1 when the server is a resource manager.  A resource manager ties loaded objects and
+   sessions to the connection, and the pool hands that connection to an unrelated TSS_CONTEXT.
+*/
+
+static TPM_RC TSS_SetSocketPool(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+
+    /* close an open connection before changing property */
+    if (rc == 0) {
+	rc = TSS_Close(tssContext);
+    }
+    if (rc == 0) {
+	if (value == NULL) {
+	    value = TPM_SOCKET_POOL_DEFAULT;
+	}
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &tssContext->tssSocketPool);
+	if (irc != 1) {
+	    if (tssVerbose) printf("TSS_SetSocketPool: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+    return rc;
+}
+
+/* TSS_SetDeviceNonblock() sets whether the device interface is opened non-blocking.
+
+   0:	a read waits for the TPM response
+   1:	TSS_ExecuteComplete() returns TSS_RC_WOULD_BLOCK until the response is available
+*/
+
+static TPM_RC TSS_SetDeviceNonblock(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+
+    /* close an open connection before changing property */
+    if (rc == 0) {
+	rc = TSS_Close(tssContext);
+    }
+    if (rc == 0) {
+	if (value == NULL) {
+	    value = TPM_DEVICE_NONBLOCK_DEFAULT;
+	}
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &tssContext->tssDeviceNonblock);
+	if (irc != 1) {
+	    if (tssVerbose) printf("TSS_SetDeviceNonblock: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+    return rc;
+}
+
+/* TSS_SetSessionCache() sets the session cache policy.
+
+   0:	each command loads the session from and saves it to the session store
+   1:	write-through, sessions are loaded from the cache but every update is also saved
+   2:	write-back, updates are saved at TSS_Delete(), TSS_SaveSessionCache(), or a change to the
+	data directory, session encryption, or cache policy
+
+   The cache is private to the context.  A session must not be used by another context or
+   process while it is cached.
+*/
+
+static TPM_RC TSS_SetSessionCache(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+
+    /* save and empty the cache before changing property */
+    if (rc == 0) {
+	rc = TSS_SessionCache_Flush(tssContext);
+    }
+    if (rc == 0) {
+	if (value == NULL) {
+	    value = TPM_SESSION_CACHE_DEFAULT;
+	}
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &tssContext->tssSessionCache);
+	if (irc != 1) {
+	    if (tssVerbose) printf("TSS_SetSessionCache: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+    return rc;
+}
+
+/* TSS_SetNameCache() sets whether the Name and public files are cached.
+
+   0:	each command reads the Name and public files
+   1:	the files are read once and then served from the context.  Updates are written through.
+	RSA salt keys are also parsed once per handle.
+
+   The cache is private to the context.  A handle must not be reused by another context or
+   process while it is cached.  A TSS without file support only caches the parsed salt keys.
+*/
+
+static TPM_RC TSS_SetNameCache(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+
+    /* empty the cache before changing property */
+    if (rc == 0) {
+	TSS_NameCache_Clear(tssContext);
+    }
+    if (rc == 0) {
+	if (value == NULL) {
+	    value = TPM_NAME_CACHE_DEFAULT;
+	}
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &tssContext->tssNameCache);
+	if (irc != 1) {
+	    if (tssVerbose) printf("TSS_SetNameCache: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+    return rc;
+}
+
+/* TSS_SetSecureWipe() sets when the command and response buffers are erased.  They are always
+   erased when the context is deleted.
+
+   0:	the used bytes, after commands with a password or HMAC authorization
+   1:	all, after commands with authorizations and commands that can carry a plaintext secret,
+	such as Unseal, Import, and RSA_Decrypt
+   2:	all, after every command
+*/
+
+static TPM_RC TSS_SetSecureWipe(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+
+    if (rc == 0) {
+	if (value == NULL) {
+	    value = TPM_SECURE_WIPE_DEFAULT;
+	}
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &tssContext->tssSecureWipe);
+	if (irc != 1) {
+	    if (tssVerbose) printf("TSS_SetSecureWipe: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+    return rc;
+}
+
+/* TSS_SetExecuteTiming() sets the number of TSS_Execute() step timing records kept in the context,
+   read with TSS_GetExecuteTiming().  When the ring is full, the oldest record is replaced.
+
+   0 turns timing off.  Setting the property discards any records.
+*/
+
+static TPM_RC TSS_SetExecuteTiming(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+    uint32_t		size = 0;
+
+    if (rc == 0) {
+	if (value == NULL) {
+	    value = TPM_EXECUTE_TIMING_DEFAULT;
+	}
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &size);
+	if ((irc != 1) || (size > TSS_EXECUTE_TIMING_MAX)) {
+	    if (tssVerbose) printf("TSS_SetExecuteTiming: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+    if (rc == 0) {
+	free(tssContext->timingRing);
+	tssContext->timingRing = NULL;
+	tssContext->tssExecuteTiming = 0;
+	tssContext->timingNext = 0;
+	tssContext->timingCount = 0;
+	if (size > 0) {
+	    rc = TSS_Malloc((uint8_t **)&tssContext->timingRing,
+			    size * sizeof(TSS_EXECUTE_TIMING));
+	}
+    }
+    if (rc == 0) {
+	tssContext->tssExecuteTiming = size;
+    }
+    return rc;
+}
+
+/* TSS_SetRandomPool() sets the size of the pool of random numbers prefetched from the TPM by
+   TSS_GetRandom().  0 disables the pool.  Setting the property erases any unused random numbers.
+*/
+
+static TPM_RC TSS_SetRandomPool(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+    uint32_t		size = 0;
+
+    if (rc == 0) {
+	if (value == NULL) {
+	    value = TPM_RANDOM_POOL_DEFAULT;
+	}
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &size);
+	if ((irc != 1) || (size > TSS_RANDOM_POOL_MAX)) {
+	    if (tssVerbose) printf("TSS_SetRandomPool: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+    if (rc == 0) {
+	if (tssContext->randomPool != NULL) {
+	    memset(tssContext->randomPool, 0, tssContext->tssRandomPool);
+	}
+	free(tssContext->randomPool);
+	tssContext->randomPool = NULL;
+	tssContext->randomPoolAvailable = 0;
+	tssContext->tssRandomPool = 0;
+	if (size > 0) {
+	    rc = TSS_Malloc(&tssContext->randomPool, size);
+	}
+    }
+    if (rc == 0) {
+	tssContext->tssRandomPool = size;
+    }
+    return rc;
+}
+
+/* TSS_SetRandomMix() sets whether TSS_GetRandom() XORs the TPM random numbers with random numbers
+   from the crypto library, so that the result is no weaker than either source. */
+
+static TPM_RC TSS_SetRandomMix(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+
+    if (rc == 0) {
+	if (value == NULL) {
+	    value = TPM_RANDOM_MIX_DEFAULT;
+	}
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &tssContext->tssRandomMix);
+	if (irc != 1) {
+	    if (tssVerbose) printf("TSS_SetRandomMix: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+#ifdef TPM_TSS_NOCRYPTO
+    if (rc == 0) {
+	if (tssContext->tssRandomMix) {
+	    if (tssVerbose) printf("TSS_SetRandomMix: Error, no crypto library\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+#endif
+    return rc;
+}
+
+/* TSS_SetPropertyCache() sets where the TPM fixed properties are cached.
+
+   0:	read from the TPM once per context
+   1:	also saved in the data directory, so that later contexts read only the TPM identity
+
+   The saved properties record the TPM manufacturer and firmware version.  Before they are used,
+   those are compared to the TPM, and a file saved from a different TPM or firmware is replaced.
+   A TSS without file support only supports 0.
+*/
+
+static TPM_RC TSS_SetPropertyCache(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+
+    /* reread the properties under the new policy */
+    if (rc == 0) {
+	tssContext->fixedPropertiesValid = FALSE;
+	if (value == NULL) {
+	    value = TPM_PROPERTY_CACHE_DEFAULT;
+	}
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &tssContext->tssPropertyCache);
+	if (irc != 1) {
+	    if (tssVerbose) printf("TSS_SetPropertyCache: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+#ifdef TPM_TSS_NOFILE
+    if (rc == 0) {
+	if (tssContext->tssPropertyCache) {
+	    if (tssVerbose) printf("TSS_SetPropertyCache: Error, no file support\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+#endif
+    return rc;
+}
+
+/* TSS_SetEccSaltPool() sets the number of NIST P256 ephemeral keys that a background thread keeps
+   ready for ECC salted sessions.
+
+   0:	TSS_ECC_Salt() generates the key for each session
+   n:	a process wide pool of up to n keys, at most 64
+
+   The pool is shared by all contexts.  A context with a nonzero value holds a pool reference,
+   released when the value is set back to 0 or by TSS_Delete().  Without pthreads the value is
+   accepted and the keys are generated per session.  A TSS without crypto only supports 0.
+*/
+
+static TPM_RC TSS_SetEccSaltPool(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+    uint32_t		eccSaltPool;
+
+    if (value == NULL) {
+	value = TPM_ECC_SALT_POOL_DEFAULT;
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &eccSaltPool);
+	if (irc != 1) {
+	    if (tssVerbose) printf("TSS_SetEccSaltPool: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+#ifndef TPM_TSS_NOCRYPTO
+    /* take the new reference before releasing the old one, so that a resize keeps the pool */
+    if ((rc == 0) && (eccSaltPool > 0)) {
+	rc = TSS_ECC_PoolStart(eccSaltPool);
+    }
+    if (rc == 0) {
+	if (tssContext->tssEccSaltPool > 0) {
+	    TSS_ECC_PoolStop();
+	}
+	tssContext->tssEccSaltPool = eccSaltPool;
+    }
+#else
+    if (rc == 0) {
+	if (eccSaltPool) {
+	    if (tssVerbose) printf("TSS_SetEccSaltPool: Error, no crypto library\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+#endif
+    return rc;
+}
+
+/* TSS_SetSessionPool() sets how many idle sessions TSS_SessionPool_Release() keeps for later
+   leases.
+
+   0:	released sessions are flushed
+   n:	up to n idle sessions are kept, at most 8
+
+   A smaller value takes effect at the next release.
+*/
+
+static TPM_RC TSS_SetSessionPool(TSS_CONTEXT *tssContext, const char *value)
+{
+    TPM_RC		rc = 0;
+    int			irc;
+    uint32_t		sessionPool;
+
+    if (value == NULL) {
+	value = TPM_SESSION_POOL_DEFAULT;
+    }
+    if (rc == 0) {
+	irc = sscanf(value, "%u", &sessionPool);
+	if (irc != 1) {
+	    if (tssVerbose) printf("TSS_SetSessionPool: Error, value invalid\n");
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+    if (rc == 0) {
+	if (sessionPool > TSS_SESSION_POOL_MAX) {
+	    if (tssVerbose) printf("TSS_SetSessionPool: Error, value %u greater than %u\n",
+				   sessionPool, TSS_SESSION_POOL_MAX);
+	    rc = TSS_RC_BAD_PROPERTY_VALUE;
+	}
+    }
+    if (rc == 0) {
+	tssContext->tssSessionPool = sessionPool;
+    }
+    return rc;
+}
@@ -87,6 +87,15 @@ extern "C" {
 	uint16_t sessionDataLength;
     } TSS_SESSIONS;
 
+    /* Structure to hold a decoded session in the session cache */
+
+    typedef struct TSS_SESSION_CACHE {
+	TPMI_SH_AUTH_SESSION sessionHandle;	/* TPM_RH_NULL for an empty slot */
+	struct TSS_HMAC_CONTEXT *session;
+	int dirty;				/* TRUE if newer than the session store */
+	int stored;				/* TRUE if the session store has a copy */
+    } TSS_SESSION_CACHE;
+
     /* Structure to hold transient or persistent object data within the context */
     
     typedef struct TSS_OBJECT_PUBLIC {
@@ -103,6 +112,41 @@ extern "C" {
 	TPMS_NV_PUBLIC	nvPublic;
     } TSS_NVPUBLIC;
 
+    /* Structure to hold the cached Name and public data for a handle */
+
+    typedef struct TSS_NAME_CACHE {
+	TPM_HANDLE handle;		/* TPM_RH_NULL for an empty slot */
+	int nameValid;
+	TPM2B_NAME name;
+	int publicValid;
+	TPM2B_PUBLIC objectPublic;	/* transient and persistent objects */
+	int nvPublicValid;
+	TPMS_NV_PUBLIC nvPublic;	/* NV indexes */
+    } TSS_NAME_CACHE;
+
+    /* Structure to hold a session in the session pool */
+
+#define TSS_SESSION_POOL_MAX	8	/* sessions leased or idle in one context */
+
+    typedef struct TSS_SESSION_POOL_ENTRY {
+	TPMI_SH_AUTH_SESSION sessionHandle;	/* TPM_RH_NULL for an empty slot */
+	TPMI_DH_OBJECT tpmKey;			/* StartAuthSession parameters */
+	TPMI_ALG_HASH authHash;
+	TPMT_SYM_DEF symmetric;
+	int leased;				/* TRUE while a caller holds the session */
+	int saved;				/* TRUE if context saved to 'context' */
+	TPMS_CONTEXT context;
+	uint32_t lastUse;			/* pool clock at release, for LRU */
+    } TSS_SESSION_POOL_ENTRY;
+
+    /* Structure to hold an RSA salt key parsed for TPM2_StartAuthSession */
+
+    typedef struct TSS_SALT_KEY_CACHE {
+	TPM_HANDLE handle;		/* TPM_RH_NULL for an empty slot */
+	TPMT_PUBLIC publicArea;
+	void *rsaKey;			/* crypto library public key */
+    } TSS_SALT_KEY_CACHE;
+
     /* Context for TSS global parameters.
 
        NOTE:  Keep this in sync with TSS_Properties_Init() and TSS_Delete() */
@@ -111,12 +155,65 @@ extern "C" {
 
 	TSS_AUTH_CONTEXT *tssAuthContext;
 
+	/* erase the command and response buffers after none, sensitive, or all commands */
+	int tssSecureWipe;
+
+	/* command submitted by TSS_ExecuteSubmit(), NULL if none is pending */
+	struct TSS_EXECUTE_STATE *tssExecuteState;
+
+	/* ring of TSS_Execute() step timings, NULL if timing is off, and the command being timed */
+	uint32_t tssExecuteTiming;		/* ring size */
+	TSS_EXECUTE_TIMING *timingRing;
+	uint32_t timingNext;			/* next slot to write */
+	uint32_t timingCount;			/* records in the ring */
+	TSS_EXECUTE_TIMING timingCurrent;
+	uint64_t timingMark;			/* end of the previous step */
+
+	/* random number pool prefetched from the TPM, and its size, 0 for no pool */
+	uint32_t tssRandomPool;
+	uint8_t *randomPool;
+	uint32_t randomPoolAvailable;		/* unused bytes at the end of the pool */
+	/* TRUE if the TPM random numbers are mixed with the crypto library random numbers */
+	int tssRandomMix;
+
+	/* TPM fixed properties, read from the TPM with one bulk TPM2_GetCapability, and TRUE if they
+	   are also saved in the data directory */
+	int tssPropertyCache;
+	int fixedPropertiesValid;
+	TPML_TAGGED_TPM_PROPERTY fixedProperties;
+
+	/* number of ECC salt ephemeral keys the process wide pool keeps ready, 0 for none */
+	uint32_t tssEccSaltPool;
+
 	/* directory for persistant storage */
 	const char *tssDataDirectory;
 
 	/* encrypt saved session state */
 	int tssEncryptSessions;
 
+	/* session cache policy, decoded sessions resident in the context */
+	int tssSessionCache;
+	TSS_SESSION_CACHE sessionCache[MAX_ACTIVE_SESSIONS];
+
+	/* idle sessions kept for TSS_SessionPool_Lease(), the leased and idle sessions, the LRU
+	   clock, and the counters */
+	uint32_t tssSessionPool;
+	TSS_SESSION_POOL_ENTRY sessionPool[TSS_SESSION_POOL_MAX];
+	uint32_t sessionPoolClock;
+	TSS_SESSION_POOL_STATS sessionPoolStats;
+
+	/* TRUE if the Name and public files are cached, the cache and the next slot to replace */
+	int tssNameCache;
+#ifndef TPM_TSS_NOFILE
+	TSS_NAME_CACHE nameCache[64];
+	size_t nameCacheNext;
+#endif
+#ifndef TPM_TSS_NOCRYPTO
+	/* RSA salt keys parsed while the Name cache is enabled, and the next slot to replace */
+	TSS_SALT_KEY_CACHE saltKeyCache[4];
+	size_t saltKeyCacheNext;
+#endif
+
 	/* saved session encryption key.  This seems to port to openssl 1.0 and 1.1, but will have to
 	   become a malloced void * for other crypto libraries. */
 #ifndef TPM_TSS_NOCRYPTO
@@ -137,11 +234,15 @@ extern "C" {
 	const char *tssServerName;
 	const char *tssServerType;
 
+	/* TRUE if socket connections are taken from and returned to the process wide pool */
+	int tssSocketPool;
+
 	/* interface type */
 	const char *tssInterfaceType;
 
 	/* device driver interface */
 	const char *tssDevice;
+	int tssDeviceNonblock;
 
 	/* TRUE for the first time through, indicates that interface open must occur */
 	int tssFirstTransmit;
@@ -149,10 +250,14 @@ extern "C" {
 	/* socket file descriptor */
 #ifndef TPM_NOSOCKET
 	TSS_SOCKET_FD sock_fd;
+	/* TRUE if sock_fd should be returned to the connection pool on close */
+	int sock_pooled;
 #endif 	/* TPM_NOSOCKET */
 
 	/* Linux device file descriptor */
 	int dev_fd;
+	/* bytes of a partial response already read in non-blocking mode */
+	uint32_t dev_received;
 
 	/* Windows device driver handle */
 #ifdef TPM_WINDOWS
@@ -165,6 +270,8 @@ extern "C" {
 
     TPM_RC TSS_GlobalProperties_Init(void);
     TPM_RC TSS_Properties_Init(TSS_CONTEXT *tssContext);
+    TPM_RC TSS_SessionCache_Flush(TSS_CONTEXT *tssContext);
+    void TSS_NameCache_Clear(TSS_CONTEXT *tssContext);
     
 #ifdef __cplusplus
 }
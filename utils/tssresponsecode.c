@@ -258,6 +258,12 @@ const RC_TABLE tssTable [] = {
     {TSS_RC_BAD_HANDLE_NUMBER, "TSS_RC_BAD_HANDLE_NUMBER - Bad handle number for this command"},
     {TSS_RC_KDFE_FAILED, "TSS_RC_KDFE_FAILED - KDFe function failed"},
     {TSS_RC_EC_EPHEMERAL_FAILURE, "TSS_RC_EC_EPHEMERAL_FAILURE - Failed while making or using EC ephemeral key"},
+    {TSS_RC_COMMAND_PENDING, "TSS_RC_COMMAND_PENDING - A submitted command has not been completed"},
+    {TSS_RC_NO_COMMAND_PENDING, "TSS_RC_NO_COMMAND_PENDING - There is no submitted command to complete"},
+    {TSS_RC_WOULD_BLOCK, "TSS_RC_WOULD_BLOCK - The response is not yet available"},
+    {TSS_RC_NO_TPM_PROPERTY, "TSS_RC_NO_TPM_PROPERTY - The TPM did not report the property"},
+    {TSS_RC_BAD_POLICY, "TSS_RC_BAD_POLICY - The policy description is malformed"},
+    {TSS_RC_POLICY_NOT_SATISFIED, "TSS_RC_POLICY_NOT_SATISFIED - No policy branch can be satisfied"},
     {TSS_RC_NO_SESSION_SLOT, "TSS_RC_NO_SESSION_SLOT - TSS context has no session slot for handle"},
     {TSS_RC_NO_OBJECTPUBLIC_SLOT, "TSS_RC_NO_OBJECTPUBLIC_SLOT - TSS context has no object public slot for handle"},
     {TSS_RC_NO_NVPUBLIC_SLOT, "TSS_RC_NO_NVPUBLIC_SLOT -TSS context has no NV public slot for handle"}
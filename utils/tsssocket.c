@@ -42,6 +42,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <time.h>
 
 /* TSS_SOCKET_FD encapsulates the differences between the Posix and Windows socket type */
 
@@ -49,8 +50,10 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <netdb.h>
+#include <pthread.h>
 #endif
 
 #ifdef TPM_WINDOWS
@@ -83,6 +86,55 @@ static uint32_t TSS_Socket_SendBytes(TSS_SOCKET_FD sock_fd, const uint8_t *buffe
 
 static uint32_t TSS_Socket_GetServerType(TSS_CONTEXT *tssContext,
 					 int *mssim);
+static uint32_t TSS_Socket_CloseFd(TSS_SOCKET_FD sock_fd, int mssim);
+
+static uint32_t TSS_Socket_PoolAcquire(TSS_CONTEXT *tssContext, int mssim);
+static int TSS_Socket_PoolRelease(TSS_CONTEXT *tssContext, int mssim);
+static int TSS_Socket_PoolIsHealthy(TSS_SOCKET_FD sock_fd);
+static void TSS_Socket_PoolKeepAlive(TSS_SOCKET_FD sock_fd);
+static void TSS_Socket_PoolLock(void);
+static void TSS_Socket_PoolUnlock(void);
+
+/* The connection pool holds idle command port connections so that a long lived process can reuse
+   them across TSS_CONTEXT's rather than opening and closing a connection per context.
+
+   A connection is either owned by exactly one TSS_CONTEXT or idle in the pool.  It is taken from
+   the pool at the first transmit and returned at TSS_Close().  Platform port connections are never
+   pooled.
+
+   The pool is process wide and keyed only by server name, port, and packet format.  It is not safe
+   behind a resource manager, which ties loaded objects and sessions to the connection.  A
+   TSS_CONTEXT could then use another context's handles.  Pool only connections to a TPM or
+   simulator that has no per connection state.
+*/
+
+#ifndef TSS_SOCKET_POOL_SIZE
+#define TSS_SOCKET_POOL_SIZE		8	/* maximum idle connections */
+#endif
+
+#ifndef TSS_SOCKET_POOL_IDLE_MAX
+#define TSS_SOCKET_POOL_IDLE_MAX	60	/* seconds before an idle connection is discarded */
+#endif
+
+#define TSS_SOCKET_POOL_NAME_MAX	256
+
+typedef struct TSS_SOCKET_POOL_ENTRY {
+    int			idle;		/* TRUE if the entry holds an idle connection */
+    TSS_SOCKET_FD	sock_fd;
+    char		serverName[TSS_SOCKET_POOL_NAME_MAX];
+    short		port;
+    int			mssim;
+    time_t		releaseTime;	/* when the connection was returned to the pool */
+} TSS_SOCKET_POOL_ENTRY;
+
+static TSS_SOCKET_POOL_ENTRY tssSocketPool[TSS_SOCKET_POOL_SIZE];
+
+#ifdef TPM_POSIX
+static pthread_mutex_t tssSocketPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+#ifdef TPM_WINDOWS
+static SRWLOCK tssSocketPoolLock = SRWLOCK_INIT;
+#endif
 
 extern int tssVverbose;
 extern int tssVerbose;
@@ -114,6 +166,7 @@ TPM_RC TSS_Socket_TransmitPlatform(TSS_CONTEXT *tssContext,
 	    rc = TSS_Socket_Open(tssContext, tssContext->tssPlatformPort);
 	}
 	if (rc == 0) {
+	    tssContext->sock_pooled = FALSE;
 	    tssContext->tssFirstTransmit = FALSE;
 	}
     }
@@ -130,7 +183,6 @@ TPM_RC TSS_Socket_TransmitPlatform(TSS_CONTEXT *tssContext,
 
    It can return socket transmit and receive packet errors, but normally returns the TPM response
    code.
-
 */
 
 TPM_RC TSS_Socket_Transmit(TSS_CONTEXT *tssContext,
@@ -139,6 +191,29 @@ TPM_RC TSS_Socket_Transmit(TSS_CONTEXT *tssContext,
 			   const char *message)
 {
     TPM_RC 	rc = 0;
+
+    if (rc == 0) {
+	rc = TSS_Socket_Send(tssContext, commandBuffer, written, message);
+    }
+    if (rc == 0) {
+	rc = TSS_Socket_Receive(tssContext, responseBuffer, read);
+    }
+    return rc;
+}
+
+/* TSS_Socket_Send() transmits the TPM command, opening the connection on the first transmit.
+
+   If the connection came from the pool and the send fails, the server most likely dropped the idle
+   connection.  The command cannot have been processed, so it is sent once more on a new
+   connection.  A receive failure is not retried, since the TPM may have already executed the
+   command.
+*/
+
+TPM_RC TSS_Socket_Send(TSS_CONTEXT *tssContext,
+		       const uint8_t *commandBuffer, uint32_t written,
+		       const char *message)
+{
+    TPM_RC 	rc = 0;
     int 	mssim;	/* boolean, true for MS simulator packet format, false for raw packet
 			   format */
 
@@ -149,7 +224,13 @@ TPM_RC TSS_Socket_Transmit(TSS_CONTEXT *tssContext,
 	    rc = TSS_Socket_GetServerType(tssContext, &mssim);
 	}
 	if (rc == 0) {
-	    rc = TSS_Socket_Open(tssContext, tssContext->tssCommandPort);
+	    if (tssContext->tssSocketPool) {
+		rc = TSS_Socket_PoolAcquire(tssContext, mssim);
+	    }
+	    else {
+		rc = TSS_Socket_Open(tssContext, tssContext->tssCommandPort);
+		tssContext->sock_pooled = FALSE;
+	    }
 	}
 	if (rc == 0) {
 	    tssContext->tssFirstTransmit = FALSE;
@@ -159,11 +240,50 @@ TPM_RC TSS_Socket_Transmit(TSS_CONTEXT *tssContext,
     if (rc == 0) {
 	rc = TSS_Socket_SendCommand(tssContext, commandBuffer, written, message);
     }
-    /* receive the response over the socket.  Returns socket errors, malformed response errors.
-       Else returns the TPM response code. */
+    /* reconnect once if a pooled connection was dropped by the server */
+    if ((rc == TSS_RC_BAD_CONNECTION) && tssContext->sock_pooled) {
+	if (tssVverbose) printf("TSS_Socket_Transmit: Reconnecting pooled connection\n");
+	rc = TSS_Socket_GetServerType(tssContext, &mssim);
+	if (rc == 0) {
+	    TSS_Socket_CloseFd(tssContext->sock_fd, FALSE);	/* peer is gone, no session end */
+	    rc = TSS_Socket_Open(tssContext, tssContext->tssCommandPort);
+	    if (rc == 0) {
+		TSS_Socket_PoolKeepAlive(tssContext->sock_fd);
+	    }
+	    /* the context still owns a connection, closed or not, see TSS_Close() */
+	    else {
+		tssContext->sock_pooled = FALSE;
+		tssContext->tssFirstTransmit = TRUE;
+	    }
+	}
+	if (rc == 0) {
+	    rc = TSS_Socket_SendCommand(tssContext, commandBuffer, written, message);
+	}
+    }
+    if (rc == TSS_RC_BAD_CONNECTION) {
+	tssContext->sock_pooled = FALSE;
+    }
+    return rc;
+}
+
+/* TSS_Socket_Receive() receives the response to a command sent with TSS_Socket_Send().
+
+   Returns socket errors, malformed response errors.  Else returns the TPM response code.
+*/
+
+TPM_RC TSS_Socket_Receive(TSS_CONTEXT *tssContext,
+			  uint8_t *responseBuffer, uint32_t *read)
+{
+    TPM_RC 	rc = 0;
+
     if (rc == 0) {
 	rc = TSS_Socket_ReceiveCommand(tssContext, responseBuffer, read);
     }
+    /* a connection with a transport error may hold a partial packet, never return it to the
+       pool */
+    if (rc == TSS_RC_BAD_CONNECTION) {
+	tssContext->sock_pooled = FALSE;
+    }
     return rc;
 }
 
@@ -304,22 +424,39 @@ static uint32_t TSS_Socket_SendCommand(TSS_CONTEXT *tssContext,
     if (rc == 0) {
 	rc = TSS_Socket_GetServerType(tssContext, &mssim);
     }
-    /* MS simulator wants a command type, locality, length */
-    if ((rc == 0) && mssim) {
+    /* MS simulator wants a command type, locality, length.  The header and the command are
+       sent in one write, so that a small header segment is not held by the Nagle algorithm
+       waiting for the delayed ack of the previous one. */
+    if ((rc == 0) && mssim && (length <= MAX_COMMAND_SIZE)) {
+	uint8_t packet[sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t) + MAX_COMMAND_SIZE];
 	uint32_t commandType = htonl(TPM_SEND_COMMAND);	/* command type is network byte order */
-	rc = TSS_Socket_SendBytes(tssContext->sock_fd, (uint8_t *)&commandType, sizeof(uint32_t));
-    }
-    if ((rc == 0) && mssim) {
-	uint8_t locality = 0;
-	rc = TSS_Socket_SendBytes(tssContext->sock_fd, &locality, sizeof(uint8_t));
-    }
-    if ((rc == 0) && mssim) {
-	uint32_t lengthNbo = htonl(length);	/* length is network byte order */
-	rc = TSS_Socket_SendBytes(tssContext->sock_fd, (uint8_t *)&lengthNbo, sizeof(uint32_t));
+	uint32_t lengthNbo = htonl(length);		/* length is network byte order */
+	memcpy(packet, &commandType, sizeof(uint32_t));
+	packet[sizeof(uint32_t)] = 0;			/* locality */
+	memcpy(packet + sizeof(uint32_t) + sizeof(uint8_t), &lengthNbo, sizeof(uint32_t));
+	memcpy(packet + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t), buffer, length);
+	rc = TSS_Socket_SendBytes(tssContext->sock_fd, packet,
+				  sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t) + length);
     }
-    /* all packet formats (types) send the TPM command packet */
-    if (rc == 0) {
-	rc = TSS_Socket_SendBytes(tssContext->sock_fd, buffer, length);
+    else {
+	if ((rc == 0) && mssim) {
+	    uint32_t commandType = htonl(TPM_SEND_COMMAND);
+	    rc = TSS_Socket_SendBytes(tssContext->sock_fd, (uint8_t *)&commandType,
+				      sizeof(uint32_t));
+	}
+	if ((rc == 0) && mssim) {
+	    uint8_t locality = 0;
+	    rc = TSS_Socket_SendBytes(tssContext->sock_fd, &locality, sizeof(uint8_t));
+	}
+	if ((rc == 0) && mssim) {
+	    uint32_t lengthNbo = htonl(length);
+	    rc = TSS_Socket_SendBytes(tssContext->sock_fd, (uint8_t *)&lengthNbo,
+				      sizeof(uint32_t));
+	}
+	/* all packet formats (types) send the TPM command packet */
+	if (rc == 0) {
+	    rc = TSS_Socket_SendBytes(tssContext->sock_fd, buffer, length);
+	}
     }
     return rc;
 }
@@ -362,7 +499,12 @@ static uint32_t TSS_Socket_SendBytes(TSS_SOCKET_FD sock_fd, const uint8_t *buffe
     nleft = length;
     while (nleft > 0) {
 #ifdef TPM_POSIX
+	/* a peer that dropped the connection returns an error rather than raising SIGPIPE */
+#ifdef MSG_NOSIGNAL
+	nwritten = send(sock_fd, &buffer[offset], nleft, MSG_NOSIGNAL);
+#else
 	nwritten = write(sock_fd, &buffer[offset], nleft);
+#endif
 	if (nwritten < 0) {        /* error */
 	    if (tssVerbose) printf("TSS_Socket_SendBytes: write error %d\n", (int)nwritten);
 	    return TSS_RC_BAD_CONNECTION;
@@ -550,13 +692,15 @@ static uint32_t TSS_Socket_ReceiveBytes(TSS_SOCKET_FD sock_fd,
 
    It sends the TPM_SESSION_END required by the MS simulator.
 
+   A pooled connection is instead returned to the pool, unless the pool is full.
 */
 
 TPM_RC TSS_Socket_Close(TSS_CONTEXT *tssContext)
 {
     uint32_t 	rc = 0;
-    int 	mssim;	/* boolean, true for MS simulator packet format, false for raw packet
-			   format */
+    int 	mssim = FALSE;	/* boolean, true for MS simulator packet format, false for raw
+				   packet format */
+    int		released = FALSE;
     
     if (tssVverbose) printf("TSS_Socket_Close: Closing %s-%s\n",
 			    tssContext->tssServerName, tssContext->tssServerType);
@@ -564,14 +708,36 @@ TPM_RC TSS_Socket_Close(TSS_CONTEXT *tssContext)
     if (rc == 0) {
 	rc = TSS_Socket_GetServerType(tssContext, &mssim);
     }
+    /* keep a healthy pooled connection open for the next TSS_CONTEXT */
+    if ((rc == 0) && tssContext->sock_pooled) {
+	released = TSS_Socket_PoolRelease(tssContext, mssim);
+    }
+    if (!released) {
+	uint32_t rc1 = TSS_Socket_CloseFd(tssContext->sock_fd, (rc == 0) && mssim);
+	if (rc == 0) {
+	    rc = rc1;
+	}
+    }
+    tssContext->sock_pooled = FALSE;
+    return rc;
+}
+
+/* TSS_Socket_CloseFd() closes the socket.  If mssim is TRUE, it first sends the TPM_SESSION_END
+   required by the MS simulator.
+*/
+
+static uint32_t TSS_Socket_CloseFd(TSS_SOCKET_FD sock_fd, int mssim)
+{
+    uint32_t 	rc = 0;
+
     /* the MS simulator expects a TPM_SESSION_END command before close */
-    if ((rc == 0) && mssim) {
+    if (mssim) {
 	uint32_t commandType = htonl(TPM_SESSION_END);
-	rc = TSS_Socket_SendBytes(tssContext->sock_fd, (uint8_t *)&commandType, sizeof(uint32_t));
+	rc = TSS_Socket_SendBytes(sock_fd, (uint8_t *)&commandType, sizeof(uint32_t));
     }
 #ifdef TPM_POSIX
-    if (close(tssContext->sock_fd) != 0) {
-	if (tssVerbose) printf("TSS_Socket_Close: close error\n");
+    if (close(sock_fd) != 0) {
+	if (tssVerbose) printf("TSS_Socket_CloseFd: close error\n");
 	rc = TSS_RC_BAD_CONNECTION;
     }
 #endif
@@ -579,14 +745,178 @@ TPM_RC TSS_Socket_Close(TSS_CONTEXT *tssContext)
     /* gracefully shut down the socket */
     {
 	int		irc;
-	irc = shutdown(tssContext->sock_fd, SD_SEND);
+	irc = shutdown(sock_fd, SD_SEND);
 	if (irc == SOCKET_ERROR) {       /* error */
-	    if (tssVerbose) printf("TSS_Socket_Close: shutdown error\n");
+	    if (tssVerbose) printf("TSS_Socket_CloseFd: shutdown error\n");
 	    rc = TSS_RC_BAD_CONNECTION;
 	}
     }
-    closesocket(tssContext->sock_fd);
+    closesocket(sock_fd);
     WSACleanup();
 #endif
     return rc;
 }
+
+/* TSS_Socket_PoolAcquire() sets the TSS_CONTEXT sock_fd to an idle pooled connection to
+   tssServerName:tssCommandPort, or opens a new connection if there is none.
+
+   Idle connections that have exceeded TSS_SOCKET_POOL_IDLE_MAX or that fail the health check are
+   closed.
+*/
+
+static uint32_t TSS_Socket_PoolAcquire(TSS_CONTEXT *tssContext, int mssim)
+{
+    uint32_t 	rc = 0;
+    size_t	i;
+    int		found = FALSE;
+    time_t	now = time(NULL);
+
+    TSS_Socket_PoolLock();
+    for (i = 0 ; !found && (i < TSS_SOCKET_POOL_SIZE) ; i++) {
+	TSS_SOCKET_POOL_ENTRY *entry = &tssSocketPool[i];
+	if (!entry->idle ||
+	    (entry->port != tssContext->tssCommandPort) ||
+	    (entry->mssim != mssim) ||
+	    (strcmp(entry->serverName, tssContext->tssServerName) != 0)) {
+	    continue;
+	}
+	entry->idle = FALSE;
+	if (((now - entry->releaseTime) > TSS_SOCKET_POOL_IDLE_MAX) ||
+	    !TSS_Socket_PoolIsHealthy(entry->sock_fd)) {
+	    if (tssVverbose) printf("TSS_Socket_PoolAcquire: Discarding stale connection\n");
+	    TSS_Socket_CloseFd(entry->sock_fd, FALSE);
+	    continue;
+	}
+	tssContext->sock_fd = entry->sock_fd;
+	found = TRUE;
+    }
+    TSS_Socket_PoolUnlock();
+    if (found) {
+	if (tssVverbose) printf("TSS_Socket_PoolAcquire: Reusing %s:%hu\n",
+				tssContext->tssServerName, tssContext->tssCommandPort);
+    }
+    else {
+	rc = TSS_Socket_Open(tssContext, tssContext->tssCommandPort);
+	if (rc == 0) {
+	    TSS_Socket_PoolKeepAlive(tssContext->sock_fd);
+	}
+    }
+    if (rc == 0) {
+	tssContext->sock_pooled = TRUE;
+    }
+    return rc;
+}
+
+/* TSS_Socket_PoolRelease() returns the TSS_CONTEXT connection to the pool.
+
+   Returns TRUE if the connection was pooled, FALSE if the caller should close it.
+*/
+
+static int TSS_Socket_PoolRelease(TSS_CONTEXT *tssContext, int mssim)
+{
+    int		released = FALSE;
+    size_t	i;
+
+    if (strlen(tssContext->tssServerName) >= TSS_SOCKET_POOL_NAME_MAX) {
+	return FALSE;
+    }
+    TSS_Socket_PoolLock();
+    for (i = 0 ; !released && (i < TSS_SOCKET_POOL_SIZE) ; i++) {
+	TSS_SOCKET_POOL_ENTRY *entry = &tssSocketPool[i];
+	if (!entry->idle) {
+	    entry->idle = TRUE;
+	    entry->sock_fd = tssContext->sock_fd;
+	    strcpy(entry->serverName, tssContext->tssServerName);
+	    entry->port = tssContext->tssCommandPort;
+	    entry->mssim = mssim;
+	    entry->releaseTime = time(NULL);
+	    released = TRUE;
+	}
+    }
+    TSS_Socket_PoolUnlock();
+    if (released && tssVverbose) printf("TSS_Socket_PoolRelease: Pooled %s:%hu\n",
+					tssContext->tssServerName, tssContext->tssCommandPort);
+    return released;
+}
+
+/* TSS_Socket_PoolIsHealthy() checks an idle connection before reuse.
+
+   An idle connection should have nothing to read.  If it is readable, the server either closed it
+   (EOF) or sent unexpected data, and it cannot be reused.
+*/
+
+static int TSS_Socket_PoolIsHealthy(TSS_SOCKET_FD sock_fd)
+{
+    int			irc;
+#ifdef TPM_POSIX
+    struct pollfd	pollFd;
+
+    /* poll() rather than select(), which cannot test a descriptor >= FD_SETSIZE */
+    pollFd.fd = sock_fd;
+    pollFd.events = POLLIN;
+    pollFd.revents = 0;
+    irc = poll(&pollFd, 1, 0);		/* do not wait */
+#endif
+#ifdef TPM_WINDOWS
+    /* a Windows fd_set is an array of SOCKET's, not a bit mask indexed by the descriptor */
+    fd_set		readFds;
+    struct timeval	timeout = {0, 0};	/* do not wait */
+
+    FD_ZERO(&readFds);
+    FD_SET(sock_fd, &readFds);
+    irc = select(0, &readFds, NULL, NULL, &timeout);
+#endif
+    return (irc == 0);
+}
+
+/* TSS_Socket_PoolKeepAlive() enables keep-alive on a pooled connection, so that a dead peer is
+   detected while the connection is idle in the pool.  It is called for every pooled connection,
+   including one reopened after the server dropped it. */
+
+static void TSS_Socket_PoolKeepAlive(TSS_SOCKET_FD sock_fd)
+{
+    int keepAlive = 1;
+
+    setsockopt(sock_fd, SOL_SOCKET, SO_KEEPALIVE, (const char *)&keepAlive, sizeof(keepAlive));
+    return;
+}
+
+/* TSS_Socket_PoolClose() closes all idle pooled connections.  A connection owned by a TSS_CONTEXT
+   is not affected, and is pooled again at its TSS_Close().
+*/
+
+TPM_RC TSS_Socket_PoolClose(void)
+{
+    size_t	i;
+
+    TSS_Socket_PoolLock();
+    for (i = 0 ; i < TSS_SOCKET_POOL_SIZE ; i++) {
+	TSS_SOCKET_POOL_ENTRY *entry = &tssSocketPool[i];
+	if (entry->idle) {
+	    TSS_Socket_CloseFd(entry->sock_fd, entry->mssim);
+	    entry->idle = FALSE;
+	}
+    }
+    TSS_Socket_PoolUnlock();
+    return 0;
+}
+
+static void TSS_Socket_PoolLock(void)
+{
+#ifdef TPM_POSIX
+    pthread_mutex_lock(&tssSocketPoolMutex);
+#endif
+#ifdef TPM_WINDOWS
+    AcquireSRWLockExclusive(&tssSocketPoolLock);
+#endif
+}
+
+static void TSS_Socket_PoolUnlock(void)
+{
+#ifdef TPM_POSIX
+    pthread_mutex_unlock(&tssSocketPoolMutex);
+#endif
+#ifdef TPM_WINDOWS
+    ReleaseSRWLockExclusive(&tssSocketPoolLock);
+#endif
+}
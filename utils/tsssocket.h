@@ -56,7 +56,13 @@ extern "C" {
 			       uint8_t *responseBuffer, uint32_t *read,
 			       const uint8_t *commandBuffer, uint32_t written,
 			       const char *message);
+    TPM_RC TSS_Socket_Send(TSS_CONTEXT *tssContext,
+			   const uint8_t *commandBuffer, uint32_t written,
+			   const char *message);
+    TPM_RC TSS_Socket_Receive(TSS_CONTEXT *tssContext,
+			      uint8_t *responseBuffer, uint32_t *read);
     TPM_RC TSS_Socket_Close(TSS_CONTEXT *tssContext);
+    TPM_RC TSS_Socket_PoolClose(void);
 
 #ifdef __cplusplus
 }
@@ -148,6 +148,118 @@ TPM_RC TSS_Transmit(TSS_CONTEXT *tssContext,
     return rc;
 }
 
+/* TSS_TransmitSend() transmits a TPM command packet without waiting for the response.  The
+   response is read with TSS_TransmitReceive().
+
+   The Windows TBSI interface is synchronous and is not supported.
+*/
+
+TPM_RC TSS_TransmitSend(TSS_CONTEXT *tssContext,
+			const uint8_t *commandBuffer, uint32_t written,
+			const char *message)
+{
+    TPM_RC rc = 0;
+
+#ifndef TPM_NOSOCKET
+    if ((strcmp(tssContext->tssInterfaceType, "socsim") == 0)) {
+	rc = TSS_Socket_Send(tssContext, commandBuffer, written, message);
+    }
+    else
+#endif
+#ifdef TPM_POSIX	/* transmit through Linux device driver */
+    if ((strcmp(tssContext->tssInterfaceType, "dev") == 0)) {
+	rc = TSS_Dev_Send(tssContext, commandBuffer, written, message);
+    }
+    else
+#endif
+    {
+	commandBuffer = commandBuffer;
+	written = written;
+	message = message;
+	if (tssVerbose) printf("TSS_TransmitSend: device %s unsupported\n",
+			       tssContext->tssInterfaceType);
+	rc = TSS_RC_INSUPPORTED_INTERFACE;	
+    }
+    return rc;
+}
+
+/* TSS_TransmitReceive() receives the response to a command sent with TSS_TransmitSend().
+
+   It blocks until the complete response is read.  An event driven application should call it
+   when the TSS_GetPollFd() descriptor is readable.
+
+   With the device interface and TPM_DEVICE_NONBLOCK set, it instead returns TSS_RC_WOULD_BLOCK
+   if the complete response is not yet available.  The partial response is retained and the next
+   call resumes the read.
+*/
+
+TPM_RC TSS_TransmitReceive(TSS_CONTEXT *tssContext,
+			   uint8_t *responseBuffer, uint32_t *read)
+{
+    TPM_RC rc = 0;
+
+#ifndef TPM_NOSOCKET
+    if ((strcmp(tssContext->tssInterfaceType, "socsim") == 0)) {
+	rc = TSS_Socket_Receive(tssContext, responseBuffer, read);
+    }
+    else
+#endif
+#ifdef TPM_POSIX	/* receive through Linux device driver */
+    if ((strcmp(tssContext->tssInterfaceType, "dev") == 0)) {
+	rc = TSS_Dev_Receive(tssContext, responseBuffer, read);
+    }
+    else
+#endif
+    {
+	responseBuffer = responseBuffer;
+	read = read;
+	if (tssVerbose) printf("TSS_TransmitReceive: device %s unsupported\n",
+			       tssContext->tssInterfaceType);
+	rc = TSS_RC_INSUPPORTED_INTERFACE;	
+    }
+    return rc;
+}
+
+/* TSS_GetPollFd() returns the file descriptor of the open TPM connection, suitable for poll(),
+   select(), or epoll.
+
+   Returns TSS_RC_NO_CONNECTION if the connection is not open.  The connection is opened by the
+   first transmit, e.g., TSS_ExecuteSubmit().
+*/
+
+TPM_RC TSS_GetPollFd(TSS_CONTEXT *tssContext, int *fd)
+{
+    TPM_RC rc = 0;
+
+    if (rc == 0) {
+	if (tssContext->tssFirstTransmit) {
+	    if (tssVerbose) printf("TSS_GetPollFd: connection is not open\n");
+	    rc = TSS_RC_NO_CONNECTION;
+	}
+    }
+    if (rc == 0) {
+#ifdef TPM_POSIX
+#ifndef TPM_NOSOCKET
+	if ((strcmp(tssContext->tssInterfaceType, "socsim") == 0)) {
+	    *fd = tssContext->sock_fd;
+	}
+	else
+#endif
+	if ((strcmp(tssContext->tssInterfaceType, "dev") == 0)) {
+	    *fd = tssContext->dev_fd;
+	}
+	else
+#endif
+	{
+	    fd = fd;
+	    if (tssVerbose) printf("TSS_GetPollFd: device %s unsupported\n",
+				   tssContext->tssInterfaceType);
+	    rc = TSS_RC_INSUPPORTED_INTERFACE;	
+	}
+    }
+    return rc;
+}
+
 /* TSS_Close() closes the connection to the TPM */
 
 TPM_RC TSS_Close(TSS_CONTEXT *tssContext)
@@ -184,5 +296,20 @@ TPM_RC TSS_Close(TSS_CONTEXT *tssContext)
 	}
 	tssContext->tssFirstTransmit = TRUE;
     }
+    /* the next connection may be to a different TPM */
+    tssContext->fixedPropertiesValid = FALSE;
+    return rc;
+}
+
+/* TSS_ClosePool() closes the idle connections in the process wide connection pool.  An application
+   that set TPM_SOCKET_POOL can call it before exit. */
+
+TPM_RC TSS_ClosePool(void)
+{
+    TPM_RC rc = 0;
+
+#ifndef TPM_NOSOCKET
+    rc = TSS_Socket_PoolClose();
+#endif
     return rc;
 }